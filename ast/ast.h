@@ -13,14 +13,15 @@
 namespace ast {
 
 #define ACCEPT_VISITOR_ABSTRACT(type) \
-  virtual sptr<const type> Accept(Visitor* visitor, const sptr<const type>& ptr) const = 0
+  virtual sptr<const type> Accept(Visitor* visitor, const sptr<const type>& ptr) const = 0; \
+  NodeKind GetNodeKind() const { return kind_; }
 
 #define ACCEPT_VISITOR(type, ret_type) \
+  static constexpr NodeKind kKind = NodeKind::type; \
+  NodeKind GetNodeKind() const { return kKind; } \
   virtual sptr<const ret_type> Accept(Visitor* visitor, const sptr<const ret_type>& ptr) const { \
-    sptr<const type> downcasted = std::dynamic_pointer_cast<const type, const ret_type>(ptr); \
-    CHECK(downcasted != nullptr); \
-    CHECK(downcasted.get() == this); \
-    return visitor->Rewrite##type(*this, downcasted); \
+    CHECK(ptr.get() == this); \
+    return visitor->Rewrite##type(*this, std::static_pointer_cast<const type>(ptr)); \
   }
 
 
@@ -140,18 +141,19 @@ class Expr {
   VAL_GETTER(TypeId, GetTypeId, tid_);
 
  protected:
-  Expr(TypeId tid = TypeId::kUnassigned) : tid_(tid) {}
+  Expr(NodeKind kind, TypeId tid = TypeId::kUnassigned) : kind_(kind), tid_(tid) {}
 
  private:
   DISALLOW_COPY_AND_ASSIGN(Expr);
 
+  NodeKind kind_;
   TypeId tid_;
 };
 
 class NameExpr : public Expr {
  public:
   NameExpr(const QualifiedName& name, LocalVarId vid = kVarUnassigned, TypeId tid = TypeId::kUnassigned)
-    : Expr(tid), name_(name), vid_(vid) {}
+    : Expr(kKind, tid), name_(name), vid_(vid) {}
 
   ACCEPT_VISITOR(NameExpr, Expr);
 
@@ -168,7 +170,7 @@ class NameExpr : public Expr {
 class InstanceOfExpr : public Expr {
  public:
   InstanceOfExpr(sptr<const Expr> lhs, lexer::Token instanceof, sptr<const Type> type, TypeId tid = TypeId::kUnassigned)
-      : Expr(tid), lhs_(lhs), instanceof_(instanceof), type_(type) {}
+      : Expr(kKind, tid), lhs_(lhs), instanceof_(instanceof), type_(type) {}
 
   ACCEPT_VISITOR(InstanceOfExpr, Expr);
 
@@ -186,7 +188,7 @@ class InstanceOfExpr : public Expr {
 
 class ParenExpr : public Expr {
  public:
-  ParenExpr(lexer::Token lparen, sptr<const Expr> nested, lexer::Token rparen) : lparen_(lparen), nested_(nested), rparen_(rparen) { CHECK(nested_ != nullptr); }
+  ParenExpr(lexer::Token lparen, sptr<const Expr> nested, lexer::Token rparen) : Expr(kKind), lparen_(lparen), nested_(nested), rparen_(rparen) { CHECK(nested_ != nullptr); }
 
   ACCEPT_VISITOR(ParenExpr, Expr);
 
@@ -203,7 +205,7 @@ class ParenExpr : public Expr {
 class BinExpr : public Expr {
  public:
   BinExpr(sptr<const Expr> lhs, lexer::Token op, sptr<const Expr> rhs, TypeId tid = TypeId::kUnassigned)
-      : Expr(tid), op_(op), lhs_(lhs), rhs_(rhs) {
+      : Expr(kKind, tid), op_(op), lhs_(lhs), rhs_(rhs) {
     CHECK(lhs != nullptr);
     CHECK(op.TypeInfo().IsBinOp());
     CHECK(rhs != nullptr);
@@ -223,7 +225,7 @@ class BinExpr : public Expr {
 
 class UnaryExpr : public Expr {
  public:
-  UnaryExpr(lexer::Token op, sptr<const Expr> rhs, TypeId tid = TypeId::kUnassigned) : Expr(tid), op_(op), rhs_(rhs) {
+  UnaryExpr(lexer::Token op, sptr<const Expr> rhs, TypeId tid = TypeId::kUnassigned) : Expr(kKind, tid), op_(op), rhs_(rhs) {
     CHECK(op.TypeInfo().IsUnaryOp());
     CHECK(rhs != nullptr);
   }
@@ -243,7 +245,7 @@ class LitExpr : public Expr {
   VAL_GETTER(lexer::Token, GetToken, token_);
 
  protected:
-  LitExpr(lexer::Token token, TypeId tid = TypeId::kUnassigned) : Expr(tid), token_(token) {}
+  LitExpr(NodeKind kind, lexer::Token token, TypeId tid = TypeId::kUnassigned) : Expr(kind, tid), token_(token) {}
 
  private:
   lexer::Token token_;
@@ -251,7 +253,7 @@ class LitExpr : public Expr {
 
 class BoolLitExpr : public LitExpr {
  public:
-  BoolLitExpr(lexer::Token token, TypeId tid = TypeId::kUnassigned) : LitExpr(token, tid) {}
+  BoolLitExpr(lexer::Token token, TypeId tid = TypeId::kUnassigned) : LitExpr(kKind, token, tid) {}
 
   ACCEPT_VISITOR(BoolLitExpr, Expr);
 };
@@ -259,7 +261,7 @@ class BoolLitExpr : public LitExpr {
 class IntLitExpr : public LitExpr {
  public:
   IntLitExpr(lexer::Token token, i32 value = 0, TypeId tid = TypeId::kUnassigned)
-      : LitExpr(token, tid), value_(value) {}
+      : LitExpr(kKind, token, tid), value_(value) {}
 
   ACCEPT_VISITOR(IntLitExpr, Expr);
 
@@ -271,7 +273,7 @@ class IntLitExpr : public LitExpr {
 
 class StringLitExpr : public LitExpr {
  public:
-  StringLitExpr(lexer::Token token, const jstring& str, TypeId tid = TypeId::kUnassigned) : LitExpr(token, tid), str_(str) {}
+  StringLitExpr(lexer::Token token, const jstring& str, TypeId tid = TypeId::kUnassigned) : LitExpr(kKind, token, tid), str_(str) {}
 
   ACCEPT_VISITOR(StringLitExpr, Expr);
 
@@ -283,7 +285,7 @@ class StringLitExpr : public LitExpr {
 
 class CharLitExpr : public LitExpr {
  public:
-  CharLitExpr(lexer::Token token, jchar the_char, TypeId tid = TypeId::kUnassigned) : LitExpr(token, tid), char_(the_char) {}
+  CharLitExpr(lexer::Token token, jchar the_char, TypeId tid = TypeId::kUnassigned) : LitExpr(kKind, token, tid), char_(the_char) {}
 
   ACCEPT_VISITOR(CharLitExpr, Expr);
 
@@ -295,14 +297,14 @@ class CharLitExpr : public LitExpr {
 
 class NullLitExpr : public LitExpr {
  public:
-  NullLitExpr(lexer::Token token, TypeId tid = TypeId::kUnassigned) : LitExpr(token, tid) {}
+  NullLitExpr(lexer::Token token, TypeId tid = TypeId::kUnassigned) : LitExpr(kKind, token, tid) {}
 
   ACCEPT_VISITOR(NullLitExpr, Expr);
 };
 
 class ThisExpr : public Expr {
  public:
-  ThisExpr(lexer::Token thisTok, TypeId tid = TypeId::kUnassigned) : Expr(tid), thisTok_(thisTok) {}
+  ThisExpr(lexer::Token thisTok, TypeId tid = TypeId::kUnassigned) : Expr(kKind, tid), thisTok_(thisTok) {}
 
   static sptr<const ThisExpr> ImplicitThis(base::PosRange pos, TypeId tid) {
     return make_shared<ThisExpr>(lexer::Token(lexer::K_THIS, base::PosRange(pos.fileid, pos.begin, pos.begin)), tid);
@@ -322,7 +324,7 @@ class ThisExpr : public Expr {
 
 class ArrayIndexExpr : public Expr {
  public:
-  ArrayIndexExpr(sptr<const Expr> base, lexer::Token lbrack, sptr<const Expr> index, lexer::Token rbrack, TypeId tid = TypeId::kUnassigned) : Expr(tid), base_(base), lbrack_(lbrack), index_(index), rbrack_(rbrack) {}
+  ArrayIndexExpr(sptr<const Expr> base, lexer::Token lbrack, sptr<const Expr> index, lexer::Token rbrack, TypeId tid = TypeId::kUnassigned) : Expr(kKind, tid), base_(base), lbrack_(lbrack), index_(index), rbrack_(rbrack) {}
 
   ACCEPT_VISITOR(ArrayIndexExpr, Expr);
 
@@ -341,7 +343,7 @@ class ArrayIndexExpr : public Expr {
 class FieldDerefExpr : public Expr {
  public:
   FieldDerefExpr(sptr<const Expr> base, const string& fieldname, lexer::Token token, FieldId fid = kErrorFieldId, TypeId tid = TypeId::kUnassigned)
-      : Expr(tid), base_(base), fieldname_(fieldname), token_(token), fid_(fid) {}
+      : Expr(kKind, tid), base_(base), fieldname_(fieldname), token_(token), fid_(fid) {}
 
   ACCEPT_VISITOR(FieldDerefExpr, Expr);
 
@@ -360,7 +362,7 @@ class FieldDerefExpr : public Expr {
 class CallExpr : public Expr {
  public:
   CallExpr(sptr<const Expr> base, lexer::Token lparen, const base::SharedPtrVector<const Expr>& args, lexer::Token rparen, MethodId mid = kUnassignedMethodId, TypeId tid = TypeId::kUnassigned)
-      : Expr(tid), base_(base), lparen_(lparen), args_(args), rparen_(rparen), mid_(mid) {}
+      : Expr(kKind, tid), base_(base), lparen_(lparen), args_(args), rparen_(rparen), mid_(mid) {}
 
   ACCEPT_VISITOR(CallExpr, Expr);
 
@@ -382,7 +384,7 @@ class CallExpr : public Expr {
 
 class StaticRefExpr : public Expr {
 public:
-  StaticRefExpr(sptr<const Type> ref_type) : Expr(TypeId::kType), ref_type_(ref_type) {}
+  StaticRefExpr(sptr<const Type> ref_type) : Expr(kKind, TypeId::kType), ref_type_(ref_type) {}
 
   ACCEPT_VISITOR(StaticRefExpr, Expr);
 
@@ -396,7 +398,7 @@ public:
 
 class CastExpr : public Expr {
  public:
-  CastExpr(lexer::Token lparen, sptr<const Type> type, lexer::Token rparen, sptr<const Expr> expr, TypeId tid = TypeId::kUnassigned) : Expr(tid), lparen_(lparen), type_(type), rparen_(rparen), expr_(expr) {}
+  CastExpr(lexer::Token lparen, sptr<const Type> type, lexer::Token rparen, sptr<const Expr> expr, TypeId tid = TypeId::kUnassigned) : Expr(kKind, tid), lparen_(lparen), type_(type), rparen_(rparen), expr_(expr) {}
 
   ACCEPT_VISITOR(CastExpr, Expr);
 
@@ -417,7 +419,7 @@ class CastExpr : public Expr {
 class NewClassExpr : public Expr {
  public:
   NewClassExpr(lexer::Token newTok, sptr<const Type> type, lexer::Token lparen, const base::SharedPtrVector<const Expr>& args, lexer::Token rparen, MethodId mid = kUnassignedMethodId, TypeId tid = TypeId::kUnassigned)
-      : Expr(tid), newTok_(newTok), type_(type), lparen_(lparen), args_(args), rparen_(rparen), mid_(mid) {}
+      : Expr(kKind, tid), newTok_(newTok), type_(type), lparen_(lparen), args_(args), rparen_(rparen), mid_(mid) {}
 
   ACCEPT_VISITOR(NewClassExpr, Expr);
 
@@ -441,7 +443,7 @@ class NewClassExpr : public Expr {
 
 class NewArrayExpr : public Expr {
  public:
-  NewArrayExpr(lexer::Token newTok, sptr<const Type> type, lexer::Token lbrack, sptr<const Expr> expr, lexer::Token rbrack, TypeId tid = TypeId::kUnassigned) : Expr(tid), newTok_(newTok), type_(type), lbrack_(lbrack), expr_(expr), rbrack_(rbrack) {}
+  NewArrayExpr(lexer::Token newTok, sptr<const Type> type, lexer::Token lbrack, sptr<const Expr> expr, lexer::Token rbrack, TypeId tid = TypeId::kUnassigned) : Expr(kKind, tid), newTok_(newTok), type_(type), lbrack_(lbrack), expr_(expr), rbrack_(rbrack) {}
 
   ACCEPT_VISITOR(NewArrayExpr, Expr);
 
@@ -463,7 +465,7 @@ class NewArrayExpr : public Expr {
 
 class ConstExpr : public Expr {
  public:
-  ConstExpr(sptr<const Expr> constant, sptr<const Expr> original) : Expr(constant->GetTypeId()), constant_(constant), original_(original) {
+  ConstExpr(sptr<const Expr> constant, sptr<const Expr> original) : Expr(kKind, constant->GetTypeId()), constant_(constant), original_(original) {
     CHECK(constant->GetTypeId() == original->GetTypeId());
   }
 
@@ -486,15 +488,17 @@ class Stmt {
   ACCEPT_VISITOR_ABSTRACT(Stmt);
 
  protected:
-  Stmt() = default;
+  Stmt(NodeKind kind) : kind_(kind) {}
 
  private:
   DISALLOW_COPY_AND_ASSIGN(Stmt);
+
+  NodeKind kind_;
 };
 
 class EmptyStmt : public Stmt {
  public:
-  EmptyStmt(lexer::Token semi): semi_(semi) {}
+  EmptyStmt(lexer::Token semi): Stmt(kKind), semi_(semi) {}
 
   ACCEPT_VISITOR(EmptyStmt, Stmt);
 
@@ -507,7 +511,7 @@ class EmptyStmt : public Stmt {
 class LocalDeclStmt : public Stmt {
  public:
   LocalDeclStmt(sptr<const Type> type, const string& name, lexer::Token nameToken, sptr<const Expr> expr, LocalVarId vid = kVarUnassigned)
-      : type_(type), name_(name), nameToken_(nameToken), expr_(expr), vid_(vid) {}
+      : Stmt(kKind), type_(type), name_(name), nameToken_(nameToken), expr_(expr), vid_(vid) {}
 
   ACCEPT_VISITOR(LocalDeclStmt, Stmt);
 
@@ -529,7 +533,7 @@ class LocalDeclStmt : public Stmt {
 
 class ReturnStmt : public Stmt {
  public:
-  ReturnStmt(lexer::Token returnToken, sptr<const Expr> expr) : returnToken_(returnToken), expr_(expr) {}
+  ReturnStmt(lexer::Token returnToken, sptr<const Expr> expr) : Stmt(kKind), returnToken_(returnToken), expr_(expr) {}
 
   ACCEPT_VISITOR(ReturnStmt, Stmt);
 
@@ -543,7 +547,7 @@ class ReturnStmt : public Stmt {
 
 class ExprStmt : public Stmt {
  public:
-  ExprStmt(sptr<const Expr> expr) : expr_(expr) {}
+  ExprStmt(sptr<const Expr> expr) : Stmt(kKind), expr_(expr) {}
 
   ACCEPT_VISITOR(ExprStmt, Stmt);
 
@@ -556,7 +560,7 @@ class ExprStmt : public Stmt {
 class BlockStmt : public Stmt {
  public:
   BlockStmt(lexer::Token lbrace, const base::SharedPtrVector<const Stmt>& stmts, lexer::Token rbrace)
-      : lbrace_(lbrace), stmts_(stmts), rbrace_(rbrace) {}
+      : Stmt(kKind), lbrace_(lbrace), stmts_(stmts), rbrace_(rbrace) {}
 
   ACCEPT_VISITOR(BlockStmt, Stmt);
 
@@ -575,7 +579,7 @@ class BlockStmt : public Stmt {
 class IfStmt : public Stmt {
  public:
   IfStmt(sptr<const Expr> cond, sptr<const Stmt> trueBody, sptr<const Stmt> falseBody)
-      : cond_(cond), trueBody_(trueBody), falseBody_(falseBody) {}
+      : Stmt(kKind), cond_(cond), trueBody_(trueBody), falseBody_(falseBody) {}
 
   ACCEPT_VISITOR(IfStmt, Stmt);
 
@@ -594,7 +598,7 @@ class IfStmt : public Stmt {
 class ForStmt : public Stmt {
  public:
   ForStmt(sptr<const Stmt> init, sptr<const Expr> cond, sptr<const Expr> update, sptr<const Stmt> body)
-      : init_(init), cond_(cond), update_(update), body_(body) {}
+      : Stmt(kKind), init_(init), cond_(cond), update_(update), body_(body) {}
 
   ACCEPT_VISITOR(ForStmt, Stmt);
 
@@ -614,7 +618,7 @@ class ForStmt : public Stmt {
 
 class WhileStmt : public Stmt {
  public:
-  WhileStmt(sptr<const Expr> cond, sptr<const Stmt> body) : cond_(cond), body_(body) {}
+  WhileStmt(sptr<const Expr> cond, sptr<const Stmt> body) : Stmt(kKind), cond_(cond), body_(body) {}
 
   ACCEPT_VISITOR(WhileStmt, Stmt);
 
@@ -716,12 +720,14 @@ class MemberDecl {
   REF_GETTER(lexer::Token, NameToken, nameToken_);
 
  protected:
-  MemberDecl(const ModifierList& mods, const string& name, lexer::Token nameToken)
-      : mods_(mods), name_(name), nameToken_(nameToken) {}
+  MemberDecl(NodeKind kind, const ModifierList& mods, const string& name, lexer::Token nameToken)
+      : kind_(kind), mods_(mods), name_(name), nameToken_(nameToken) {}
 
  private:
   DISALLOW_COPY_AND_ASSIGN(MemberDecl);
 
+  NodeKind kind_;
+
   ModifierList mods_;
   string name_;
   lexer::Token nameToken_;
@@ -730,7 +736,7 @@ class MemberDecl {
 class FieldDecl : public MemberDecl {
  public:
   FieldDecl(const ModifierList& mods, sptr<const Type> type, const string& name, lexer::Token nameToken, sptr<const Expr> val, FieldId fid = kErrorFieldId)
-      : MemberDecl(mods, name, nameToken),
+      : MemberDecl(kKind, mods, name, nameToken),
         type_(type),
         val_(val),
         fid_(fid) {}
@@ -753,7 +759,7 @@ class MethodDecl : public MemberDecl {
  public:
   MethodDecl(const ModifierList& mods, sptr<const Type> type, const string& name, lexer::Token nameToken,
              sptr<const ParamList> params, sptr<const Stmt> body, MethodId mid = kErrorMethodId)
-      : MemberDecl(mods, name, nameToken),
+      : MemberDecl(kKind, mods, name, nameToken),
         type_(type),
         params_(params),
         body_(body),
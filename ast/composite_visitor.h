@@ -0,0 +1,173 @@
+#ifndef AST_COMPOSITE_VISITOR_H
+#define AST_COMPOSITE_VISITOR_H
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+
+namespace ast {
+
+// Runs several visitors over a tree in a single traversal, as if each had
+// visited it alone, one after the other:
+//
+//   CompositeVisitor<FooVisitor, BarVisitor> both(&foo, &bar);
+//   prog = both.Rewrite(prog);
+//
+// Every node is handed to the Visit hook of each pass, in order, so passes
+// may look at the same kinds of nodes. A pass that returns SKIP or SKIP_PRUNE
+// for a node is shown nothing under it; the other passes carry on.
+//
+// Passes may only look at the tree through their Visit hooks; one that
+// overrides a Rewrite handler fails to compile. If any pass prunes a node, it
+// is pruned once the passes that recursed into it have seen its children, and
+// Pruned() says so: passes that ran after that one alone would never have
+// seen the subtree.
+//
+// A subclass may override Rewrite handlers to rewrite the tree alongside the
+// passes. So that it sees the whole tree, the children of a node are visited
+// unless it is pruned, even once every pass has skipped them.
+template <typename... Passes>
+class CompositeVisitor : public Visitor {
+public:
+  CompositeVisitor(Passes*... passes) : passes_(passes...) {}
+
+  // Whether any pass pruned a subtree.
+  bool Pruned() const { return pruned_; }
+
+  // Whether some pass has a Visit hook for nodes of type T.
+  template <typename T>
+  static constexpr bool AnyHooks() {
+    const bool hooks[] = {false, Hooks<Passes>(static_cast<const T*>(nullptr), 0)...};
+    for (bool hook : hooks) {
+      if (hook) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+#define _COMPOSITE_REWRITE_DEFN(type, rettype, name) \
+  sptr<const rettype> Rewrite##type(const type& name, const sptr<const type>& name##ptr) override { \
+    ActiveScope active(this); \
+    return Finish(name, name##ptr, VisitAll(name, name##ptr, std::index_sequence_for<Passes...>())); \
+  }
+  AST_FOR_EACH_VISITABLE(_COMPOSITE_REWRITE_DEFN)
+#undef _COMPOSITE_REWRITE_DEFN
+
+private:
+  static_assert(sizeof...(Passes) <= 32, "active_ has one bit per pass");
+
+  // Restores the set of active passes once a node has been finished, however
+  // that ends.
+  class ActiveScope {
+   public:
+    ActiveScope(CompositeVisitor* visitor) : visitor_(visitor), was_active_(visitor->active_) {}
+    ~ActiveScope() {
+      visitor_->active_ = was_active_;
+    }
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ActiveScope);
+
+    CompositeVisitor* visitor_;
+    u32 was_active_;
+  };
+
+  // Whether pass P overrides the Visit hook for this type of node; ones it
+  // doesn't override would just return RECURSE, so they aren't called. Hooks
+  // that P has made private can't be looked at, but then P has overridden
+  // them.
+#define _HOOKS_DEFN(type, rettype, name) \
+  template <typename P> \
+  static constexpr auto Hooks(const type*, int) -> decltype(&P::Visit##type, bool()) { \
+    return !std::is_same<decltype(&P::Visit##type), VisitResult (Visitor::*)(const type&, const sptr<const type>&)>::value; \
+  } \
+  template <typename P> \
+  static constexpr bool Hooks(const type*, long) { \
+    return true; \
+  }
+  AST_FOR_EACH_VISITABLE(_HOOKS_DEFN)
+#undef _HOOKS_DEFN
+
+  // Likewise for the Rewrite handler for this type of node.
+#define _REWRITES_DEFN(type, rettype, name) \
+  template <typename P> \
+  static constexpr auto Rewrites(const type*, int) -> decltype(&P::Rewrite##type, bool()) { \
+    return !std::is_same<decltype(&P::Rewrite##type), sptr<const rettype> (Visitor::*)(const type&, const sptr<const type>&)>::value; \
+  } \
+  template <typename P> \
+  static constexpr bool Rewrites(const type*, long) { \
+    return true; \
+  }
+  AST_FOR_EACH_VISITABLE(_REWRITES_DEFN)
+#undef _REWRITES_DEFN
+
+  // Whether pass P overrides any Rewrite handler.
+#define _REWRITES_TERM(type, rettype, name) || Rewrites<P>(static_cast<const type*>(nullptr), 0)
+  template <typename P>
+  static constexpr bool Rewrites() {
+    return false AST_FOR_EACH_VISITABLE(_REWRITES_TERM);
+  }
+#undef _REWRITES_TERM
+
+  static constexpr bool AnyRewrites() {
+    const bool rewrites[] = {false, Rewrites<Passes>()...};
+    for (bool rewrite : rewrites) {
+      if (rewrite) {
+        return true;
+      }
+    }
+    return false;
+  }
+  static_assert(!AnyRewrites(), "CompositeVisitor passes may only override Visit hooks");
+
+  // Shows node to each active pass with a hook for it, and works out what to
+  // do with the node from what they return.
+  template <typename T, size_t... I>
+  VisitResult VisitAll(const T& node, const sptr<const T>& ptr, std::index_sequence<I...>) {
+    bool prune = false;
+    const int unused[] = {0, (VisitOne<I>(node, ptr, &prune), 0)...};
+    (void)unused;
+    if (!prune) {
+      return VisitResult::RECURSE;
+    }
+    pruned_ = true;
+    return active_ != 0 ? VisitResult::RECURSE_PRUNE : VisitResult::SKIP_PRUNE;
+  }
+
+  template <size_t I, typename T>
+  void VisitOne(const T& node, const sptr<const T>& ptr, bool* prune) {
+    using Pass = typename std::tuple_element<I, std::tuple<Passes...>>::type;
+    const u32 bit = 1u << I;
+    if (!Hooks<Pass>(&node, 0) || (active_ & bit) == 0) {
+      return;
+    }
+    Visitor* pass = std::get<I>(passes_);
+    VisitResult result = Dispatch(pass, node, ptr);
+    if (result == VisitResult::SKIP || result == VisitResult::SKIP_PRUNE) {
+      active_ &= ~bit;
+    }
+    if (result == VisitResult::SKIP_PRUNE || result == VisitResult::RECURSE_PRUNE) {
+      *prune = true;
+    }
+  }
+
+#define _DISPATCH_DEFN(type, rettype, name) \
+  static VisitResult Dispatch(Visitor* pass, const type& name, const sptr<const type>& name##ptr) { \
+    return pass->Visit##type(name, name##ptr); \
+  }
+  AST_FOR_EACH_VISITABLE(_DISPATCH_DEFN)
+#undef _DISPATCH_DEFN
+
+  std::tuple<Passes*...> passes_;
+  // Bit i is set while pass i still wants to see the nodes being visited.
+  u32 active_ = (sizeof...(Passes) == 32 ? 0u : 1u << sizeof...(Passes)) - 1;
+  bool pruned_ = false;
+};
+
+} // namespace ast
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef AST_REWRITE_CHILDREN_H
+#define AST_REWRITE_CHILDREN_H
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+
+namespace ast {
+
+// How each kind of node rewrites its children. Visitor rewrites them with
+// itself in visitor.cpp; a StaticVisitor rewrites them with itself, so that
+// its children never go through the virtual Accept.
+
+#define REWRITE_CHILDREN_DEFN(type, rettype, var, varptr) \
+  template <typename D> \
+  sptr<const rettype> Visitor::RewriteChildren(D* d, const type& var, const sptr<const type>& varptr, bool prune_after)
+
+#define SHOULD_PRUNE_AFTER (prune_after)
+
+REWRITE_CHILDREN_DEFN(ArrayIndexExpr, Expr, expr, exprptr) {
+  sptr<const Expr> base = d->Rewrite(expr.BasePtr());
+  sptr<const Expr> index = d->Rewrite(expr.IndexPtr());
+  if (SHOULD_PRUNE_AFTER || base == nullptr || index == nullptr) {
+    return nullptr;
+  }
+  if (base == expr.BasePtr() && index == expr.IndexPtr()) {
+    return exprptr;
+  }
+  return Rebuild<ArrayIndexExpr>(base, expr.Lbrack(), index, expr.Rbrack(), expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(BinExpr, Expr, expr, exprptr) {
+  sptr<const Expr> lhs = d->Rewrite(expr.LhsPtr());
+  sptr<const Expr> rhs = d->Rewrite(expr.RhsPtr());
+  if (SHOULD_PRUNE_AFTER || lhs == nullptr || rhs == nullptr) {
+    return nullptr;
+  }
+  if (lhs == expr.LhsPtr() && rhs == expr.RhsPtr()) {
+    return exprptr;
+  }
+
+  return Rebuild<BinExpr>(lhs, expr.Op(), rhs);
+}
+
+REWRITE_CHILDREN_DEFN(CallExpr, Expr, expr, exprptr) {
+  base::SharedPtrVector<const Expr> args;
+  sptr<const Expr> base = d->Rewrite(expr.BasePtr());
+  bool argsChanged = AcceptMulti(d, expr.Args(), &args);
+
+  if (SHOULD_PRUNE_AFTER || base == nullptr || (argsChanged && args.Size() != expr.Args().Size())) {
+    return nullptr;
+  }
+  if (base == expr.BasePtr() && !argsChanged) {
+    return exprptr;
+  }
+
+  // AcceptMulti only fills args if an argument changed.
+  return Rebuild<CallExpr>(base, expr.Lparen(), argsChanged ? args : expr.Args(), expr.Rparen(), expr.GetMethodId(), expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(CastExpr, Expr, expr, exprptr) {
+  sptr<const Expr> castedExpr = d->Rewrite(expr.GetExprPtr());
+  if (SHOULD_PRUNE_AFTER || castedExpr == nullptr) {
+    return nullptr;
+  } else if (castedExpr == expr.GetExprPtr()) {
+    return exprptr;
+  }
+  return Rebuild<CastExpr>(expr.Lparen(), expr.GetTypePtr(), expr.Rparen(), castedExpr, expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(FieldDerefExpr, Expr, expr, exprptr) {
+  sptr<const Expr> base = d->Rewrite(expr.BasePtr());
+  if (SHOULD_PRUNE_AFTER || base == nullptr) {
+    return nullptr;
+  } else if (base == expr.BasePtr()) {
+    return exprptr;
+  }
+  return Rebuild<FieldDerefExpr>(base, expr.FieldName(), expr.GetToken(), expr.GetFieldId(), expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(BoolLitExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+REWRITE_CHILDREN_DEFN(CharLitExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+REWRITE_CHILDREN_DEFN(StringLitExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+
+REWRITE_CHILDREN_DEFN(StaticRefExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+
+REWRITE_CHILDREN_DEFN(NullLitExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+REWRITE_CHILDREN_DEFN(IntLitExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+REWRITE_CHILDREN_DEFN(NameExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+
+REWRITE_CHILDREN_DEFN(NewArrayExpr, Expr, expr, exprptr) {
+  sptr<const Expr> arrayExpr = nullptr;
+  if (expr.GetExprPtr() != nullptr) {
+    arrayExpr = d->Rewrite(expr.GetExprPtr());
+  }
+
+  // We don't prune the subtree if the expr returns null, because the expr is a
+  // nullable field.
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  } else if (arrayExpr == expr.GetExprPtr()) {
+    return exprptr;
+  }
+  return Rebuild<NewArrayExpr>(expr.NewToken(), expr.GetTypePtr(), expr.Lbrack(), arrayExpr, expr.Rbrack(), expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(NewClassExpr, Expr, expr, exprptr) {
+  base::SharedPtrVector<const Expr> args;
+  bool argsChanged = AcceptMulti(d, expr.Args(), &args);
+
+  if (SHOULD_PRUNE_AFTER || (argsChanged && args.Size() != expr.Args().Size())) {
+    return nullptr;
+  }
+  if (!argsChanged) {
+    return exprptr;
+  }
+  return Rebuild<NewClassExpr>(expr.NewToken(), expr.GetTypePtr(), expr.Lparen(), args, expr.Rparen(), expr.GetMethodId(), expr.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(ParenExpr, Expr, expr, exprptr) {
+  sptr<const Expr> nested = d->Rewrite(expr.NestedPtr());
+  if (SHOULD_PRUNE_AFTER || nested == nullptr) {
+    return nullptr;
+  } else if (nested == expr.NestedPtr()) {
+    return exprptr;
+  }
+  return Rebuild<ParenExpr>(expr.Lparen(), nested, expr.Rparen());
+}
+
+REWRITE_CHILDREN_DEFN(ThisExpr, Expr, expr, exprptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return exprptr;
+}
+
+REWRITE_CHILDREN_DEFN(UnaryExpr, Expr, expr, exprptr) {
+  sptr<const Expr> rhs = d->Rewrite(expr.RhsPtr());
+  if (SHOULD_PRUNE_AFTER || rhs == nullptr) {
+    return nullptr;
+  } else if (rhs == expr.RhsPtr()) {
+    return exprptr;
+  }
+  return Rebuild<UnaryExpr>(expr.Op(), rhs);
+}
+
+REWRITE_CHILDREN_DEFN(ConstExpr, Expr, expr, exprptr) {
+  sptr<const Expr> constant = d->Rewrite(expr.ConstantPtr());
+  if (SHOULD_PRUNE_AFTER || constant == nullptr) {
+    return nullptr;
+  } else if (constant == expr.ConstantPtr()) {
+    return exprptr;
+  }
+  return Rebuild<ConstExpr>(constant, expr.OriginalPtr());
+}
+
+REWRITE_CHILDREN_DEFN(InstanceOfExpr, Expr, expr, exprptr) {
+  sptr<const Expr> lhs = d->Rewrite(expr.LhsPtr());
+  if (SHOULD_PRUNE_AFTER || lhs == nullptr) {
+    return nullptr;
+  } else if (lhs == expr.LhsPtr()) {
+    return exprptr;
+  }
+  return Rebuild<InstanceOfExpr>(lhs, expr.InstanceOf(), expr.GetTypePtr());
+}
+
+REWRITE_CHILDREN_DEFN(BlockStmt, Stmt, stmt, stmtptr) {
+  base::SharedPtrVector<const Stmt> newStmts;
+  bool stmtsChanged = AcceptMulti(d, stmt.Stmts(), &newStmts);
+
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  if (!stmtsChanged) {
+    return stmtptr;
+  }
+
+  return Rebuild<BlockStmt>(stmt.Lbrace(), newStmts, stmt.Rbrace());
+}
+
+REWRITE_CHILDREN_DEFN(EmptyStmt, Stmt, stmt, stmtptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return stmtptr;
+}
+
+REWRITE_CHILDREN_DEFN(ExprStmt, Stmt, stmt, stmtptr) {
+  sptr<const Expr> expr = d->Rewrite(stmt.GetExprPtr());
+  if (SHOULD_PRUNE_AFTER || expr == nullptr) {
+    return nullptr;
+  } else if (expr == stmt.GetExprPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<ExprStmt>(expr);
+}
+
+REWRITE_CHILDREN_DEFN(LocalDeclStmt, Stmt, stmt, stmtptr) {
+  sptr<const Expr> expr = d->Rewrite(stmt.GetExprPtr());
+  if (SHOULD_PRUNE_AFTER || expr == nullptr) {
+    return nullptr;
+  } else if (expr == stmt.GetExprPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<LocalDeclStmt>(stmt.GetTypePtr(), stmt.Name(), stmt.NameToken(), expr, stmt.GetVarId());
+}
+
+REWRITE_CHILDREN_DEFN(ReturnStmt, Stmt, stmt, stmtptr) {
+  sptr<const Expr> expr = nullptr;
+  if (stmt.GetExprPtr() != nullptr) {
+    expr = d->Rewrite(stmt.GetExprPtr());
+  }
+
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  } else if (expr == stmt.GetExprPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<ReturnStmt>(stmt.ReturnToken(), expr);
+}
+
+REWRITE_CHILDREN_DEFN(IfStmt, Stmt, stmt, stmtptr) {
+  sptr<const Expr> cond = d->Rewrite(stmt.CondPtr());
+  if (cond == nullptr) {
+    return nullptr;
+  }
+
+  sptr<const Stmt> trueBody = d->Rewrite(stmt.TrueBodyPtr());
+  sptr<const Stmt> falseBody = d->Rewrite(stmt.FalseBodyPtr());
+
+  // If a subtree was pruned, then prune this subtree as well.
+  if (trueBody == nullptr || falseBody == nullptr) {
+    return nullptr;
+  }
+
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  if (cond == stmt.CondPtr() && trueBody == stmt.TrueBodyPtr() && falseBody == stmt.FalseBodyPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<IfStmt>(cond, trueBody, falseBody);
+}
+
+REWRITE_CHILDREN_DEFN(ForStmt, Stmt, stmt, stmtptr) {
+  sptr<const Stmt> init = d->Rewrite(stmt.InitPtr());
+
+  sptr<const Expr> cond = nullptr;
+  if (stmt.CondPtr() != nullptr) {
+    cond = d->Rewrite(stmt.CondPtr());
+  }
+
+  sptr<const Expr> update = nullptr;
+  if (stmt.UpdatePtr() != nullptr) {
+    update = d->Rewrite(stmt.UpdatePtr());
+  }
+
+  sptr<const Stmt> body = d->Rewrite(stmt.BodyPtr());
+  if (body == nullptr) {
+    return nullptr;
+  }
+
+  if (SHOULD_PRUNE_AFTER || init == nullptr) {
+    return nullptr;
+  } else if (init == stmt.InitPtr() && cond == stmt.CondPtr() && update == stmt.UpdatePtr() && body == stmt.BodyPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<ForStmt>(init, cond, update, body);
+}
+
+REWRITE_CHILDREN_DEFN(WhileStmt, Stmt, stmt, stmtptr) {
+  sptr<const Expr> cond = d->Rewrite(stmt.CondPtr());
+  sptr<const Stmt> body = d->Rewrite(stmt.BodyPtr());
+
+  if (SHOULD_PRUNE_AFTER || cond == nullptr || body == nullptr) {
+    return nullptr;
+  }
+
+  if (cond == stmt.CondPtr() && body == stmt.BodyPtr()) {
+    return stmtptr;
+  }
+
+  return Rebuild<WhileStmt>(cond, body);
+}
+
+REWRITE_CHILDREN_DEFN(ParamList, ParamList, params, paramsptr) {
+  base::SharedPtrVector<const Param> newParams;
+  bool paramsChanged = AcceptMulti(d, params.Params(), &newParams);
+
+  if (SHOULD_PRUNE_AFTER || (paramsChanged && newParams.Size() != params.Params().Size())) {
+    return nullptr;
+  }
+  if (!paramsChanged) {
+    return paramsptr;
+  }
+
+  return Rebuild<ParamList>(newParams);
+}
+
+
+REWRITE_CHILDREN_DEFN(Param, Param, param, paramptr) {
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  return paramptr;
+}
+
+REWRITE_CHILDREN_DEFN(FieldDecl, MemberDecl, field, fieldptr) {
+  sptr<const Expr> val;
+  if (field.ValPtr() != nullptr) {
+    val = d->Rewrite(field.ValPtr());
+  }
+
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  if (val == field.ValPtr()) {
+    return fieldptr;
+  }
+
+  return Rebuild<FieldDecl>(field.Mods(), field.GetTypePtr(), field.Name(), field.NameToken(), val, field.GetFieldId());
+}
+
+REWRITE_CHILDREN_DEFN(MethodDecl, MemberDecl, meth, methptr) {
+  sptr<const ParamList> params = d->Rewrite(meth.ParamsPtr());
+  sptr<const Stmt> body = d->Rewrite(meth.BodyPtr());
+
+  if (SHOULD_PRUNE_AFTER || params == nullptr || body == nullptr) {
+    return nullptr;
+  } else if (params == meth.ParamsPtr() && body == meth.BodyPtr()) {
+    return methptr;
+  }
+
+  return Rebuild<MethodDecl>(meth.Mods(), meth.TypePtr(), meth.Name(), meth.NameToken(), params, body, meth.GetMethodId());
+}
+
+REWRITE_CHILDREN_DEFN(TypeDecl, TypeDecl, type, typeptr) {
+  base::SharedPtrVector<const MemberDecl> newMembers;
+  bool membersChanged = AcceptMulti(d, type.Members(), &newMembers);
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  if (!membersChanged) {
+    return typeptr;
+  }
+
+  return Rebuild<TypeDecl>(type.Mods(), type.Kind(), type.Name(), type.NameToken(), type.Extends(), type.Implements(), newMembers, type.GetTypeId());
+}
+
+REWRITE_CHILDREN_DEFN(CompUnit, CompUnit, unit, unitptr) {
+  base::SharedPtrVector<const TypeDecl> newTypes;
+  bool typesChanged = AcceptMulti(d, unit.Types(), &newTypes);
+
+  if (SHOULD_PRUNE_AFTER) {
+    return nullptr;
+  }
+  if (!typesChanged) {
+    return unitptr;
+  }
+  return Rebuild<CompUnit>(unit.FileId(), unit.PackagePtr(), unit.Imports(), newTypes);
+}
+
+REWRITE_CHILDREN_DEFN(Program, Program, prog, progptr) {
+  // Finish has already checked that the program isn't pruned.
+  CHECK(!prune_after);
+
+  base::SharedPtrVector<const CompUnit> units;
+  bool unitsChanged = AcceptMulti(d, prog.CompUnits(), &units);
+
+  if (!unitsChanged) {
+    return progptr;
+  }
+
+  return Rebuild<Program>(units);
+}
+
+#undef SHOULD_PRUNE_AFTER
+#undef REWRITE_CHILDREN_DEFN
+
+} // namespace ast
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef AST_STATIC_VISITOR_H
+#define AST_STATIC_VISITOR_H
+
+#include <type_traits>
+
+#include "ast/ast.h"
+#include "ast/rewrite_children.h"
+#include "ast/visitor.h"
+
+namespace ast {
+
+// A Visitor that dispatches on GetNodeKind() instead of through the virtual
+// Accept, and calls the Rewrite handlers and Visit hooks of Derived directly.
+// Derived must be final, so those calls need no vtable and can be inlined:
+//
+//   class Foo final : public ast::StaticVisitor<Foo> { ... };
+//
+// Rewrite and Visit called from Derived dispatch statically, and so does the
+// rewriting of every node's children. A handler in Derived that falls back to
+// the default should call StaticVisitor's, not Visitor's, to keep it that way.
+template <typename Derived>
+class StaticVisitor : public Visitor {
+public:
+  template <typename T>
+  auto WARN_UNUSED Rewrite(const sptr<const T>& t) -> decltype(t->Accept(this, t)) {
+    CHECK(t != nullptr);
+    switch (t->GetNodeKind()) {
+#define _DISPATCH_CASE(type, rettype, name) \
+      case NodeKind::type: \
+        return DispatchAs<type>(t, std::is_base_of<T, type>());
+      AST_FOR_EACH_VISITABLE(_DISPATCH_CASE)
+#undef _DISPATCH_CASE
+    }
+    UNREACHABLE();
+  }
+
+  template <typename T>
+  void Visit(const sptr<const T>& t) {
+    ReadOnlyScope read_only(this);
+    CHECK(t == Rewrite(t));
+  }
+
+#define _STATIC_REWRITE_DEFN(type, rettype, name) \
+  sptr<const rettype> Rewrite##type(const type& name, const sptr<const type>& name##ptr) override { \
+    return Finish(name, name##ptr, static_cast<Derived*>(this)->Visit##type(name, name##ptr), [&](bool prune_after) { \
+      return Visitor::RewriteChildren(this, name, name##ptr, prune_after); \
+    }); \
+  }
+  AST_FOR_EACH_VISITABLE(_STATIC_REWRITE_DEFN)
+#undef _STATIC_REWRITE_DEFN
+
+private:
+#define _DISPATCH_DEFN(type, rettype, name) \
+  sptr<const rettype> Dispatch(const type& name, const sptr<const type>& name##ptr) { \
+    return static_cast<Derived*>(this)->Rewrite##type(name, name##ptr); \
+  }
+  AST_FOR_EACH_VISITABLE(_DISPATCH_DEFN)
+#undef _DISPATCH_DEFN
+
+  template <typename N, typename T>
+  auto DispatchAs(const sptr<const T>& t, std::true_type) -> decltype(t->Accept(this, t)) {
+    sptr<const N> node = std::static_pointer_cast<const N>(t);
+    return Dispatch(*node, node);
+  }
+
+  // A node of kind N can't be a T.
+  template <typename N, typename T>
+  auto DispatchAs(const sptr<const T>& t, std::false_type) -> decltype(t->Accept(this, t)) {
+    UNREACHABLE();
+  }
+};
+
+} // namespace ast
+
+#endif
@@ -8,7 +8,10 @@
 
 namespace ast {
 
-#define FOR_EACH_VISITABLE(code) \
+// Calls code(type, rettype, name) for every kind of node a Visitor can visit,
+// where rettype is what rewriting that kind of node returns and name is what
+// the node is called in handlers generated from it.
+#define AST_FOR_EACH_VISITABLE(code) \
   code(ArrayIndexExpr, Expr, expr) \
   code(BinExpr, Expr, expr) \
   code(BoolLitExpr, Expr, expr) \
@@ -44,6 +47,13 @@ namespace ast {
   code(CompUnit, CompUnit, unit) \
   code(Program, Program, prog)
 
+// Identifies the concrete type of a node without a virtual call.
+enum class NodeKind : u8 {
+#define _NODE_KIND(type, rettype, name) type,
+  AST_FOR_EACH_VISITABLE(_NODE_KIND)
+#undef _NODE_KIND
+};
+
 enum class VisitResult {
   SKIP, // Don't visit children; keep them in resulting AST.
   RECURSE, // Visit children.
@@ -53,48 +63,154 @@ enum class VisitResult {
 
 class Visitor {
 public:
+  // What this visitor has done to the trees it was given. Rewriting is
+  // copy-on-write: a node or child list is only copied when something under
+  // it changed, so an unchanged list costs no allocation.
+  struct RewriteStats {
+    u64 nodes = 0;
+    u64 nodes_rebuilt = 0;
+    u64 lists = 0; // Non-empty child lists.
+    u64 lists_rebuilt = 0;
+
+    // Each reused list is one or more allocations that copying it would have
+    // made.
+    u64 AllocationsSaved() const { return lists - lists_rebuilt; }
+  };
+
   template <typename T>
   auto WARN_UNUSED Rewrite(const sptr<const T>& t) -> decltype(t->Accept(this, t)) {
     CHECK(t != nullptr);
     return t->Accept(this, t);
   }
 
+  // Traverses t without changing it. Nothing is copied on the way; a
+  // VisitResult or Rewrite override that tries to prune or replace a node
+  // fails a CHECK where it happens, after which the visitor can be used
+  // again. This is a Rewrite that must return what it was given rather than a
+  // separate traversal, so Rewrite overrides still run.
   template <typename T>
   void Visit(const sptr<const T>& t) {
+    ReadOnlyScope read_only(this);
     CHECK(t == Rewrite(t));
   }
 
+  const RewriteStats& GetRewriteStats() const {
+    return stats_;
+  }
+
 #define _REWRITE_DECL(type, rettype, name) virtual sptr<const rettype> Rewrite##type(const type& name, const sptr<const type>& name##ptr);
-  FOR_EACH_VISITABLE(_REWRITE_DECL)
+  AST_FOR_EACH_VISITABLE(_REWRITE_DECL)
 #undef _REWRITE_DECL
 
 protected:
 #define _VISIT_DECL(type, rettype, name) virtual VisitResult Visit##type(const type&, const sptr<const type>&) { return VisitResult::RECURSE; }
-  FOR_EACH_VISITABLE(_VISIT_DECL)
+  AST_FOR_EACH_VISITABLE(_VISIT_DECL)
 #undef _VISIT_DECL
 
+  // Rewrites the children of a node and rebuilds it if any of them changed.
+  // If prune_after, the node is pruned once its children have been visited.
+#define _REWRITE_CHILDREN_DECL(type, rettype, name) sptr<const rettype> RewriteChildren(const type& name, const sptr<const type>& name##ptr, bool prune_after);
+  AST_FOR_EACH_VISITABLE(_REWRITE_CHILDREN_DECL)
+#undef _REWRITE_CHILDREN_DECL
+
+  // The same, but rewrites each child with d->Rewrite. Defined in
+  // ast/rewrite_children.h.
+#define _REWRITE_CHILDREN_TMPL_DECL(type, rettype, name) template <typename D> sptr<const rettype> RewriteChildren(D* d, const type& name, const sptr<const type>& name##ptr, bool prune_after);
+  AST_FOR_EACH_VISITABLE(_REWRITE_CHILDREN_TMPL_DECL)
+#undef _REWRITE_CHILDREN_TMPL_DECL
+
+  // Finishes rewriting node, given what its Visit hook returned.
+  template <typename T>
+  auto Finish(const T& node, const sptr<const T>& ptr, VisitResult result) -> decltype(RewriteChildren(node, ptr, false)) {
+    return Finish(node, ptr, result, [&](bool prune_after) { return RewriteChildren(node, ptr, prune_after); });
+  }
+
+  // The same, but rewrites the children, if it has to, by calling
+  // rewrite_children(prune_after).
+  template <typename T, typename F>
+  auto Finish(const T& node, const sptr<const T>& ptr, VisitResult result, F&& rewrite_children) -> decltype(RewriteChildren(node, ptr, false)) {
+    ++stats_.nodes;
+    if (!CanPrune(node)) {
+      CHECK(result == VisitResult::SKIP || result == VisitResult::RECURSE);
+    }
+    if (result == VisitResult::SKIP) {
+      return ptr;
+    }
+    if (result == VisitResult::SKIP_PRUNE) {
+      return nullptr;
+    }
+    return rewrite_children(result == VisitResult::RECURSE_PRUNE);
+  }
+
 private:
+  template <typename Derived>
+  friend class StaticVisitor;
+  template <typename... Passes>
+  friend class CompositeVisitor;
+
+  // Makes the visitor read-only until the scope ends, however it ends.
+  class ReadOnlyScope {
+   public:
+    ReadOnlyScope(Visitor* visitor) : visitor_(visitor), was_read_only_(visitor->read_only_) {
+      visitor_->read_only_ = true;
+    }
+    ~ReadOnlyScope() {
+      visitor_->read_only_ = was_read_only_;
+    }
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ReadOnlyScope);
+
+    Visitor* visitor_;
+    bool was_read_only_;
+  };
+
+  // Only the program may not be pruned, because there would be nothing left.
   template <typename T>
-  base::SharedPtrVector<const T> AcceptMulti(const base::SharedPtrVector<const T>& oldVec, bool* changed_out) {
-    base::SharedPtrVector<const T> newVec;
-    *changed_out = false;
-    for (int i = 0; i < oldVec.Size(); ++i) {
-      sptr<const T> oldVal = oldVec.At(i);
-      sptr<const T> newVal = oldVal->Accept(this, oldVal);
-      if (newVal == nullptr) {
-        *changed_out = true;
-        continue;
+  static bool CanPrune(const T&) { return true; }
+  static bool CanPrune(const Program&) { return false; }
+
+  // Builds the replacement for a node whose children changed.
+  template <typename T, typename... Args>
+  sptr<const T> Rebuild(Args&&... args) {
+    CHECK(!read_only_);
+    ++stats_.nodes_rebuilt;
+    return make_shared<T>(std::forward<Args>(args)...);
+  }
+
+  // Rewrites each element of vec with d->Rewrite. If any element is replaced
+  // or pruned, appends the resulting elements to the empty *out and returns
+  // true. Otherwise returns false and leaves *out alone.
+  template <typename D, typename T>
+  bool AcceptMulti(D* d, const base::SharedPtrVector<const T>& vec, base::SharedPtrVector<const T>* out) {
+    const vector<sptr<const T>>& elems = vec.Vec();
+    if (!elems.empty()) {
+      ++stats_.lists;
+    }
+    bool changed = false;
+    for (size_t i = 0; i < elems.size(); ++i) {
+      sptr<const T> newVal = d->Rewrite(elems[i]);
+      if (!changed) {
+        if (newVal == elems[i]) {
+          continue;
+        }
+        CHECK(!read_only_);
+        ++stats_.lists_rebuilt;
+        changed = true;
+        for (size_t j = 0; j < i; ++j) {
+          out->Append(elems[j]);
+        }
       }
-      if (newVal != oldVal) {
-        *changed_out = true;
+      if (newVal != nullptr) {
+        out->Append(newVal);
       }
-      newVec.Append(newVal);
     }
-    return newVec;
+    return changed;
   }
-};
 
-#undef FOR_EACH_VISITABLE
+  bool read_only_ = false;
+  RewriteStats stats_;
+};
 
 #define VISIT_DECL(type, var, varptr) ast::VisitResult Visit##type(const ast::type& var, const sptr<const ast::type>& varptr) override
 #define VISIT_DEFN(cls, type, var, varptr) ast::VisitResult cls::Visit##type(const ast::type& var, const sptr<const ast::type>& varptr)
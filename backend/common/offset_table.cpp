@@ -165,21 +165,31 @@ void BuildClassMethodOffsets(const vector<TypeInfo>& types, u8 ptr_size,
   }
 }
 
+// Interface methods are dispatched through per-class itables. Rather than
+// giving every interface method signature in the program its own slot, we
+// color signatures so that two signatures share a slot unless some class
+// implements interfaces declaring both. A class's itable then only needs to be
+// as large as the highest color among its own signatures.
 void BuildIfaceMethodOffsets(const vector<TypeInfo>& types, u8 ptr_size,
-    OffsetTable::MethodMap* method_out, OffsetTable::ItableMap* itable_out) {
+    OffsetTable::MethodMap* method_out, OffsetTable::ItableMap* itable_out,
+    OffsetTable::ItableStats* stats_out) {
 
   using Ituple = tuple<u64, TypeId, MethodId>;
   auto itable_cmp = [&](const Ituple& lhs, const Ituple& rhs) {
     return get<0>(lhs) < get<0>(rhs);
   };
 
-  // Pass 1: we collect all interface method signatures.
-  map<MethodSignature, u64> iface_methods;
+  // Pass 1: we collect all interface method signatures, and the signatures
+  // declared by each interface.
+  map<MethodSignature, size_t> iface_methods;
+  map<TypeId, set<MethodSignature>> iface_sigs;
   for (const TypeInfo& tinfo : types) {
     if (tinfo.kind != TypeKind::INTERFACE) {
       continue;
     }
 
+    set<MethodSignature>& sigs = iface_sigs[tinfo.type];
+
     for (const auto& m_pair : tinfo.methods.GetMethodMap()) {
       const MethodInfo& minfo = m_pair.second;
 
@@ -195,17 +205,97 @@ void BuildIfaceMethodOffsets(const vector<TypeInfo>& types, u8 ptr_size,
       }
 
       iface_methods.insert({minfo.signature, 0});
+      sigs.insert(minfo.signature);
     }
   }
 
-  // Pass 2: we assign all interface method signatures an offset.
-  u64 offset = 0;
-  for (auto& p : iface_methods) {
-    p.second = offset;
-    offset += (u64)ptr_size;
+  {
+    size_t idx = 0;
+    for (auto& p : iface_methods) {
+      p.second = idx;
+      ++idx;
+    }
   }
 
-  // Pass 3: we build a mapping from interface method id to offset.
+  // Pass 2: we find the interface signatures each class can be dispatched on,
+  // i.e. those declared by any interface it transitively implements. Types are
+  // in topological order, so parents are always visited first.
+  map<TypeId, set<TypeId>> ifaces_of;
+  map<TypeId, set<size_t>> class_sigs;
+  for (const TypeInfo& tinfo : types) {
+    set<TypeId>& ifaces = ifaces_of[tinfo.type];
+    auto add_parent = [&](TypeId parent) {
+      if (iface_sigs.count(parent) == 1) {
+        ifaces.insert(parent);
+      }
+      auto iter = ifaces_of.find(parent);
+      if (iter != ifaces_of.end()) {
+        ifaces.insert(iter->second.begin(), iter->second.end());
+      }
+    };
+    for (size_t i = 0; i < tinfo.extends.Size(); ++i) {
+      add_parent(tinfo.extends.At(i));
+    }
+    for (size_t i = 0; i < tinfo.implements.Size(); ++i) {
+      add_parent(tinfo.implements.At(i));
+    }
+
+    if (tinfo.kind != TypeKind::CLASS) {
+      continue;
+    }
+
+    set<size_t>& sigs = class_sigs[tinfo.type];
+    for (TypeId iface : ifaces) {
+      for (const MethodSignature& sig : iface_sigs.at(iface)) {
+        sigs.insert(iface_methods.at(sig));
+      }
+    }
+  }
+
+  // Pass 3: we color the signatures. Two signatures conflict if a class can
+  // be dispatched on both. We color greedily, most constrained first.
+  vector<u64> offsets(iface_methods.size(), 0);
+  {
+    vector<set<size_t>> conflicts(iface_methods.size());
+    for (const auto& c_pair : class_sigs) {
+      for (size_t lhs : c_pair.second) {
+        for (size_t rhs : c_pair.second) {
+          if (lhs != rhs) {
+            conflicts.at(lhs).insert(rhs);
+          }
+        }
+      }
+    }
+
+    vector<size_t> order;
+    for (size_t i = 0; i < conflicts.size(); ++i) {
+      order.push_back(i);
+    }
+    auto degree_cmp = [&](size_t lhs, size_t rhs) {
+      return conflicts.at(lhs).size() > conflicts.at(rhs).size();
+    };
+    std::stable_sort(order.begin(), order.end(), degree_cmp);
+
+    vector<bool> colored(conflicts.size(), false);
+    for (size_t sig : order) {
+      set<u64> taken;
+      for (size_t other : conflicts.at(sig)) {
+        if (colored.at(other)) {
+          taken.insert(offsets.at(other));
+        }
+      }
+
+      u64 offset = 0;
+      while (taken.count(offset) == 1) {
+        offset += (u64)ptr_size;
+      }
+
+      offsets.at(sig) = offset;
+      colored.at(sig) = true;
+    }
+  }
+
+  // Pass 4: we build a mapping from interface method id to offset.
   for (const TypeInfo& tinfo : types) {
     if (tinfo.kind != TypeKind::INTERFACE) {
       continue;
@@ -225,7 +315,7 @@ void BuildIfaceMethodOffsets(const vector<TypeInfo>& types, u8 ptr_size,
         if (iter == iface_methods.end()) {
           continue;
         }
-        offset = iter->second;
+        offset = offsets.at(iter->second);
       }
 
       {
@@ -237,22 +327,37 @@ void BuildIfaceMethodOffsets(const vector<TypeInfo>& types, u8 ptr_size,
     }
   }
 
-  // Pass 4: we build an itable for each class.
+  // Pass 5: we build an itable for each class. We also tally what the itables
+  // would have cost with one global slot per signature.
   for (const TypeInfo& tinfo : types) {
     if (tinfo.kind != TypeKind::CLASS) {
       continue;
     }
+    const set<size_t>& sigs = class_sigs.at(tinfo.type);
+
     OffsetTable::Itable itable;
+    u64 global_size = 0;
     for (const auto& m_pair : tinfo.methods.GetMethodMap()) {
       const MethodInfo& minfo = m_pair.second;
       auto iter = iface_methods.find(minfo.signature);
       if (iter == iface_methods.end()) {
         continue;
       }
-      itable.emplace_back(make_tuple(iter->second, minfo.class_type, minfo.mid));
+      global_size = std::max(global_size, (iter->second + 1) * (u64)ptr_size);
+
+      if (sigs.count(iter->second) == 0) {
+        continue;
+      }
+      itable.emplace_back(make_tuple(offsets.at(iter->second), minfo.class_type, minfo.mid));
     }
 
     std::sort(itable.begin(), itable.end(), itable_cmp);
+
+    stats_out->global_bytes += global_size;
+    if (!itable.empty()) {
+      stats_out->colored_bytes += get<0>(itable.back()) + (u64)ptr_size;
+    }
+
     {
       auto iter = itable_out->insert({tinfo.type, itable});
       CHECK(iter.second);
@@ -352,12 +457,13 @@ OffsetTable OffsetTable::Build(const TypeInfoMap& tinfo_map, u8 ptr_size) {
   BuildClassMethodOffsets(types, ptr_size, &method_offsets, &vtables);
 
   ItableMap itables;
-  BuildIfaceMethodOffsets(types, ptr_size, &method_offsets, &itables);
+  ItableStats itable_stats;
+  BuildIfaceMethodOffsets(types, ptr_size, &method_offsets, &itables, &itable_stats);
 
   NativeMap natives;
   BuildNatives(types, &natives);
 
-  return OffsetTable(type_sizes, field_offsets, method_offsets, vtables, itables, statics, natives, ptr_size);
+  return OffsetTable(type_sizes, field_offsets, method_offsets, vtables, itables, itable_stats, statics, natives, ptr_size);
 }
 
 } // namespace common
@@ -21,6 +21,14 @@ public:
   using StaticFieldMap = map<ast::TypeId, StaticFields>;
   using NativeMap = map<ast::MethodId, string>;
 
+  // Total bytes of itable data emitted for all classes, alongside what it
+  // would have been had every interface method signature in the program been
+  // given its own slot.
+  struct ItableStats {
+    u64 colored_bytes = 0;
+    u64 global_bytes = 0;
+  };
+
   static OffsetTable Build(const types::TypeInfoMap& tinfo_map, u8 ptr_size);
 
   static u64 VtableOverhead(u8 ptr_size) {
@@ -50,6 +58,10 @@ public:
     return itables_.at(tid);
   }
 
+  const ItableStats& GetItableStats() const {
+    return itable_stats_;
+  }
+
   const StaticFields& StaticFieldsOf(ast::TypeId tid) const {
     return statics_.at(tid);
   }
@@ -63,7 +75,7 @@ public:
   }
 
 private:
-  OffsetTable(const TypeMap& type_sizes, const FieldMap& field_offsets, const MethodMap& method_offsets, const VtableMap& vtables, const ItableMap& itables, const StaticFieldMap& statics, const NativeMap& natives, u8 ptr_size) : type_sizes_(type_sizes), field_offsets_(field_offsets), method_offsets_(method_offsets), vtables_(vtables), itables_(itables), statics_(statics), natives_(natives), ptr_size_(ptr_size) {}
+  OffsetTable(const TypeMap& type_sizes, const FieldMap& field_offsets, const MethodMap& method_offsets, const VtableMap& vtables, const ItableMap& itables, const ItableStats& itable_stats, const StaticFieldMap& statics, const NativeMap& natives, u8 ptr_size) : type_sizes_(type_sizes), field_offsets_(field_offsets), method_offsets_(method_offsets), vtables_(vtables), itables_(itables), itable_stats_(itable_stats), statics_(statics), natives_(natives), ptr_size_(ptr_size) {}
 
   u64 ObjectOverhead() const {
     u64 vtable_ptr_size = (u64)ptr_size_;
@@ -75,6 +87,7 @@ private:
   MethodMap method_offsets_;
   VtableMap vtables_;
   ItableMap itables_;
+  ItableStats itable_stats_;
   StaticFieldMap statics_;
   NativeMap natives_;
   u8 ptr_size_;
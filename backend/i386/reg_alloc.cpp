@@ -0,0 +1,478 @@
+#include "backend/i386/reg_alloc.h"
+
+#include <algorithm>
+
+using ir::LabelId;
+using ir::MemId;
+using ir::Op;
+using ir::OpType;
+using ir::SizeClass;
+using ir::Stream;
+using ir::kInvalidMemId;
+
+namespace backend {
+namespace i386 {
+
+namespace {
+
+// Uses inside loops are weighted by this factor per level of nesting.
+const int kLoopWeightShift = 3;
+const int kMaxLoopDepth = 4;
+
+// Spilling and reloading a register around a call costs two memory accesses.
+const i64 kCallCost = 2;
+
+bool IsCall(OpType type) {
+  switch (type) {
+    case OpType::ALLOC_HEAP: // Fall through.
+    case OpType::ALLOC_ARRAY: // Fall through.
+    case OpType::STATIC_CALL: // Fall through.
+    case OpType::DYNAMIC_CALL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool EndsBlock(OpType type) {
+  return type == OpType::JMP || type == OpType::JMP_IF || type == OpType::RET;
+}
+
+struct OpMems {
+  vector<MemId> uses;
+  vector<MemId> defs;
+};
+
+// Collect the Mems read and written by op. MOV_ADDR and MOV_TO_ADDR pairs in
+// local_stores are treated as a plain write to the local.
+OpMems MemsOf(const Stream& stream, const Op& op, const map<MemId, MemId>& local_stores) {
+  OpMems mems;
+  auto arg = [&](size_t i) {
+    return (MemId)stream.args.at(op.begin + i);
+  };
+  auto use = [&](MemId mem) {
+    if (mem != kInvalidMemId) {
+      mems.uses.push_back(mem);
+    }
+  };
+  auto def = [&](MemId mem) {
+    if (mem != kInvalidMemId) {
+      mems.defs.push_back(mem);
+    }
+  };
+
+  switch (op.type) {
+    case OpType::ALLOC_MEM: // Fall through.
+    case OpType::DEALLOC_MEM: // Fall through.
+    case OpType::LABEL: // Fall through.
+    case OpType::JMP:
+      break;
+    case OpType::ALLOC_HEAP: // Fall through.
+    case OpType::CONST: // Fall through.
+    case OpType::CONST_STR:
+      def(arg(0));
+      break;
+    case OpType::ALLOC_ARRAY:
+      def(arg(0));
+      use(arg(2));
+      break;
+    case OpType::MOV_ADDR:
+      // The source has its address taken rather than being read.
+      if (local_stores.count(arg(0)) == 0) {
+        def(arg(0));
+      }
+      break;
+    case OpType::MOV_TO_ADDR: {
+      auto iter = local_stores.find(arg(0));
+      if (iter != local_stores.end()) {
+        def(iter->second);
+      } else {
+        use(arg(0));
+      }
+      use(arg(1));
+      break;
+    }
+    case OpType::MOV: // Fall through.
+    case OpType::NOT: // Fall through.
+    case OpType::NEG: // Fall through.
+    case OpType::EXTEND: // Fall through.
+    case OpType::TRUNCATE: // Fall through.
+    case OpType::FIELD_DEREF: // Fall through.
+    case OpType::FIELD_ADDR: // Fall through.
+    case OpType::INSTANCE_OF:
+      def(arg(0));
+      use(arg(1));
+      break;
+    case OpType::ARRAY_DEREF: // Fall through.
+    case OpType::ARRAY_ADDR: // Fall through.
+    case OpType::ADD: // Fall through.
+    case OpType::SUB: // Fall through.
+    case OpType::MUL: // Fall through.
+    case OpType::DIV: // Fall through.
+    case OpType::MOD: // Fall through.
+    case OpType::LT: // Fall through.
+    case OpType::LEQ: // Fall through.
+    case OpType::EQ: // Fall through.
+    case OpType::AND: // Fall through.
+    case OpType::OR: // Fall through.
+    case OpType::XOR:
+      def(arg(0));
+      use(arg(1));
+      use(arg(2));
+      break;
+    case OpType::JMP_IF:
+      use(arg(1));
+      break;
+    case OpType::CAST_EXCEPTION_IF_FALSE: // Fall through.
+    case OpType::CHECK_NULL:
+      use(arg(0));
+      break;
+    case OpType::CHECK_ARRAY_STORE:
+      use(arg(0));
+      use(arg(1));
+      break;
+    case OpType::STATIC_CALL:
+      def(arg(0));
+      for (size_t i = 5; i < op.end - op.begin; ++i) {
+        use(arg(i));
+      }
+      break;
+    case OpType::DYNAMIC_CALL:
+      def(arg(0));
+      use(arg(1));
+      for (size_t i = 5; i < op.end - op.begin; ++i) {
+        use(arg(i));
+      }
+      break;
+    case OpType::RET:
+      if (op.end - op.begin == 1) {
+        use(arg(0));
+      }
+      break;
+    default:
+      UNREACHABLE();
+  }
+
+  return mems;
+}
+
+map<MemId, SizeClass> MemSizes(const Stream& stream) {
+  map<MemId, SizeClass> sizes;
+  for (size_t i = 0; i < stream.params.size(); ++i) {
+    sizes[i + 1] = stream.params.at(i);
+  }
+  for (const Op& op : stream.ops) {
+    if (op.type == OpType::ALLOC_MEM) {
+      sizes[stream.args.at(op.begin)] = (SizeClass)stream.args.at(op.begin + 1);
+    }
+  }
+  return sizes;
+}
+
+// Find MOV_ADDR temporaries whose only use is as the destination of a single
+// MOV_TO_ADDR of the same size as the local; i.e. plain assignments to
+// locals. Fills addr_taken with every other local whose address is taken.
+void FindLocalStores(const Stream& stream, const map<MemId, SizeClass>& sizes, map<MemId, MemId>* local_stores, set<MemId>* addr_taken) {
+  const map<MemId, MemId> no_stores;
+
+  // Count every reference to each Mem, and remember where address
+  // temporaries are stored through.
+  map<MemId, int> refs;
+  map<MemId, MemId> stored_values;
+  for (const Op& op : stream.ops) {
+    OpMems mems = MemsOf(stream, op, no_stores);
+    for (MemId mem : mems.uses) {
+      ++refs[mem];
+    }
+    for (MemId mem : mems.defs) {
+      ++refs[mem];
+    }
+    if (op.type == OpType::MOV_TO_ADDR) {
+      stored_values[stream.args.at(op.begin)] = stream.args.at(op.begin + 1);
+    }
+  }
+
+  for (const Op& op : stream.ops) {
+    if (op.type != OpType::MOV_ADDR) {
+      continue;
+    }
+
+    MemId addr = stream.args.at(op.begin);
+    MemId local = stream.args.at(op.begin + 1);
+
+    // The MOV_ADDR itself and the MOV_TO_ADDR must be the only references.
+    auto iter = stored_values.find(addr);
+    if (refs[addr] == 2 && iter != stored_values.end() && sizes.at(iter->second) == sizes.at(local)) {
+      local_stores->insert({addr, local});
+      continue;
+    }
+
+    addr_taken->insert(local);
+  }
+}
+
+struct Block {
+  size_t begin;
+  size_t end;
+  vector<size_t> succs;
+};
+
+vector<Block> BuildBlocks(const Stream& stream) {
+  const vector<Op>& ops = stream.ops;
+
+  map<LabelId, size_t> label_idx;
+  set<size_t> leaders = {0};
+  for (size_t i = 0; i < ops.size(); ++i) {
+    if (ops[i].type == OpType::LABEL) {
+      label_idx[stream.args.at(ops[i].begin)] = i;
+      leaders.insert(i);
+    }
+    if (EndsBlock(ops[i].type)) {
+      leaders.insert(i + 1);
+    }
+  }
+  leaders.insert(ops.size());
+
+  vector<Block> blocks;
+  map<size_t, size_t> block_at;
+  for (auto iter = leaders.begin(); std::next(iter) != leaders.end(); ++iter) {
+    block_at[*iter] = blocks.size();
+    blocks.push_back({*iter, *std::next(iter), {}});
+  }
+
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    Block& block = blocks[b];
+    const Op& last = ops[block.end - 1];
+    if (last.type == OpType::JMP || last.type == OpType::JMP_IF) {
+      block.succs.push_back(block_at.at(label_idx.at(stream.args.at(last.begin))));
+    }
+    if (last.type != OpType::JMP && last.type != OpType::RET && b + 1 < blocks.size()) {
+      block.succs.push_back(b + 1);
+    }
+  }
+
+  return blocks;
+}
+
+// Nesting depth of loops around each op, where a loop is any backwards jump.
+vector<int> LoopDepths(const Stream& stream) {
+  const vector<Op>& ops = stream.ops;
+
+  map<LabelId, size_t> label_idx;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    if (ops[i].type == OpType::LABEL) {
+      label_idx[stream.args.at(ops[i].begin)] = i;
+    }
+  }
+
+  vector<int> depths(ops.size(), 0);
+  for (size_t i = 0; i < ops.size(); ++i) {
+    if (ops[i].type != OpType::JMP && ops[i].type != OpType::JMP_IF) {
+      continue;
+    }
+    size_t target = label_idx.at(stream.args.at(ops[i].begin));
+    for (size_t j = target; j <= i && target < i; ++j) {
+      ++depths[j];
+    }
+  }
+  return depths;
+}
+
+struct Interval {
+  MemId mem;
+  SizeClass size;
+  size_t start;
+  size_t end;
+  i64 benefit;
+  Reg reg;
+};
+
+} // namespace
+
+string RegName(Reg reg, SizeClass size) {
+  bool byte = size == SizeClass::BOOL || size == SizeClass::BYTE;
+  bool word = size == SizeClass::SHORT || size == SizeClass::CHAR;
+  switch (reg) {
+    case Reg::EBX:
+      return byte ? "bl" : word ? "bx" : "ebx";
+    case Reg::ECX:
+      return byte ? "cl" : word ? "cx" : "ecx";
+    case Reg::ESI:
+      CHECK(!byte);
+      return word ? "si" : "esi";
+    case Reg::EDI:
+      CHECK(!byte);
+      return word ? "di" : "edi";
+    default:
+      UNREACHABLE();
+  }
+}
+
+RegAlloc AllocateRegisters(const Stream& stream) {
+  RegAlloc alloc;
+  const vector<Op>& ops = stream.ops;
+  if (ops.empty()) {
+    return alloc;
+  }
+
+  map<MemId, SizeClass> sizes = MemSizes(stream);
+
+  set<MemId> addr_taken;
+  FindLocalStores(stream, sizes, &alloc.local_stores, &addr_taken);
+
+  vector<OpMems> op_mems;
+  for (const Op& op : ops) {
+    op_mems.push_back(MemsOf(stream, op, alloc.local_stores));
+  }
+
+  // Compute live-in sets for each block by iterating to a fixed point.
+  vector<Block> blocks = BuildBlocks(stream);
+  vector<set<MemId>> live_in(blocks.size());
+  auto live_out_of = [&](const Block& block) {
+    set<MemId> out;
+    for (size_t succ : block.succs) {
+      out.insert(live_in[succ].begin(), live_in[succ].end());
+    }
+    return out;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t b = blocks.size(); b-- > 0;) {
+      set<MemId> live = live_out_of(blocks[b]);
+      for (size_t i = blocks[b].end; i-- > blocks[b].begin;) {
+        for (MemId mem : op_mems[i].defs) {
+          live.erase(mem);
+        }
+        live.insert(op_mems[i].uses.begin(), op_mems[i].uses.end());
+      }
+      if (live != live_in[b]) {
+        live_in[b] = live;
+        changed = true;
+      }
+    }
+  }
+
+  // Build a single conservative interval per Mem, covering every op at which
+  // it is live, and note which Mems live across calls.
+  vector<int> depths = LoopDepths(stream);
+  auto weight = [&](size_t i) -> i64 {
+    return (i64)1 << (kLoopWeightShift * std::min(depths[i], kMaxLoopDepth));
+  };
+
+  map<MemId, Interval> intervals;
+  auto extend = [&](MemId mem, size_t i) {
+    auto iter = intervals.find(mem);
+    if (iter == intervals.end()) {
+      intervals.insert({mem, {mem, sizes.at(mem), i, i, 0, Reg::NONE}});
+      return;
+    }
+    iter->second.start = std::min(iter->second.start, i);
+    iter->second.end = std::max(iter->second.end, i);
+  };
+
+  map<size_t, vector<MemId>> live_across;
+  for (const Block& block : blocks) {
+    set<MemId> live = live_out_of(block);
+    for (size_t i = block.end; i-- > block.begin;) {
+      const OpMems& mems = op_mems[i];
+      bool is_call = IsCall(ops[i].type);
+
+      for (MemId mem : live) {
+        extend(mem, i);
+        bool defined_here = std::find(mems.defs.begin(), mems.defs.end(), mem) != mems.defs.end();
+        if (is_call && !defined_here) {
+          live_across[i].push_back(mem);
+          intervals.at(mem).benefit -= kCallCost * weight(i);
+        }
+      }
+
+      for (MemId mem : mems.defs) {
+        extend(mem, i);
+        intervals.at(mem).benefit += weight(i);
+        live.erase(mem);
+      }
+      for (MemId mem : mems.uses) {
+        extend(mem, i);
+        intervals.at(mem).benefit += weight(i);
+        live.insert(mem);
+      }
+    }
+  }
+
+  vector<Interval*> candidates;
+  for (auto& i_pair : intervals) {
+    Interval& interval = i_pair.second;
+    if (addr_taken.count(interval.mem) == 1 || interval.benefit <= 0) {
+      continue;
+    }
+    candidates.push_back(&interval);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(), [](const Interval* lhs, const Interval* rhs) {
+    return lhs->start < rhs->start;
+  });
+
+  // Linear scan. Intervals that share an op never share a register, so op
+  // templates may freely read sources after writing their destination. When
+  // out of registers, the interval with the lowest benefit is left in memory.
+  const vector<Reg> kWideRegs = {Reg::ESI, Reg::EDI, Reg::EBX, Reg::ECX};
+  const vector<Reg> kByteRegs = {Reg::EBX, Reg::ECX};
+  vector<Interval*> active;
+  for (Interval* cur : candidates) {
+    active.erase(std::remove_if(active.begin(), active.end(), [&](const Interval* i) {
+      return i->end < cur->start;
+    }), active.end());
+
+    bool byte = cur->size == SizeClass::BOOL || cur->size == SizeClass::BYTE;
+    const vector<Reg>& allowed = byte ? kByteRegs : kWideRegs;
+
+    for (Reg reg : allowed) {
+      bool in_use = std::any_of(active.begin(), active.end(), [&](const Interval* i) {
+        return i->reg == reg;
+      });
+      if (!in_use) {
+        cur->reg = reg;
+        break;
+      }
+    }
+
+    if (cur->reg == Reg::NONE) {
+      Interval* victim = nullptr;
+      for (Interval* i : active) {
+        bool usable = std::find(allowed.begin(), allowed.end(), i->reg) != allowed.end();
+        if (usable && (victim == nullptr || i->benefit < victim->benefit)) {
+          victim = i;
+        }
+      }
+      if (victim == nullptr || victim->benefit >= cur->benefit) {
+        continue;
+      }
+      cur->reg = victim->reg;
+      victim->reg = Reg::NONE;
+      active.erase(std::find(active.begin(), active.end(), victim));
+    }
+
+    active.push_back(cur);
+  }
+
+  for (const auto& i_pair : intervals) {
+    if (i_pair.second.reg != Reg::NONE) {
+      alloc.regs.insert({i_pair.first, i_pair.second.reg});
+    }
+  }
+
+  for (const auto& l_pair : live_across) {
+    vector<MemId>& saved = alloc.live_across[l_pair.first];
+    for (MemId mem : l_pair.second) {
+      if (alloc.regs.count(mem) == 1) {
+        saved.push_back(mem);
+      }
+    }
+  }
+
+  return alloc;
+}
+
+} // namespace i386
+} // namespace backend
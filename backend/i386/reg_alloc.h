@@ -0,0 +1,51 @@
+#ifndef BACKEND_I386_REG_ALLOC_H
+#define BACKEND_I386_REG_ALLOC_H
+
+#include "ir/mem.h"
+#include "ir/stream.h"
+
+namespace backend {
+namespace i386 {
+
+// General purpose registers available to the allocator. eax and edx are
+// reserved as scratch registers for op templates, and esp and ebp hold the
+// stack and frame pointers that _joos_throw walks.
+enum class Reg {
+  NONE,
+  EBX,
+  ECX,
+  ESI,
+  EDI,
+};
+
+// Returns the name of the part of reg that holds a value of the given size.
+string RegName(Reg reg, ir::SizeClass size);
+
+// The result of running the register allocator over a single ir::Stream.
+// Every Mem keeps its stack slot; Mems assigned a register only use it as a
+// home for spills around calls.
+struct RegAlloc {
+  // Register assigned to each Mem. Mems not in the map live in their stack
+  // slot.
+  map<ir::MemId, Reg> regs;
+
+  // Address temporaries that are only produced by a MOV_ADDR of a local and
+  // only consumed by a single MOV_TO_ADDR, mapped to that local. Such pairs
+  // are emitted as a plain store to the local, so the local is not considered
+  // address-taken.
+  map<ir::MemId, ir::MemId> local_stores;
+
+  // For each op index, the register-allocated Mems that are live both before
+  // and after the op. These must be saved around any call the op makes.
+  map<size_t, vector<ir::MemId>> live_across;
+};
+
+// Linear-scan register allocation over the live ranges of a Stream's Mems.
+// Mems that cross many calls relative to how often they are used are left in
+// memory.
+RegAlloc AllocateRegisters(const ir::Stream& stream);
+
+} // namespace i386
+} // namespace backend
+
+#endif
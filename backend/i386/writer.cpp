@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "backend/common/asm_writer.h"
+#include "backend/i386/reg_alloc.h"
 #include "base/printf.h"
 #include "ir/mem.h"
 #include "ir/stream.h"
@@ -23,9 +24,11 @@ using ast::kTypeInitMethodId;
 using backend::common::AsmWriter;
 using backend::common::OffsetTable;
 using base::File;
+using base::FileSet;
 using base::Fprintf;
 using base::Sprintf;
 using ir::CompUnit;
+using ir::InlineSite;
 using ir::LabelId;
 using ir::MemId;
 using ir::Op;
@@ -105,6 +108,21 @@ string StackOffset(i64 offset) {
   return Sprintf("[ebp+%v]", -offset);
 }
 
+// Number of type ids the subtype table has rows for.
+u64 NumTypeIds(const TypeInfoMap& tinfo_map) {
+  u64 max_tid = TypeId::kFirstRefTypeBase;
+  for (const auto& t_pair : tinfo_map.GetTypeMap()) {
+    max_tid = std::max(t_pair.first.base, max_tid);
+  }
+  return max_tid + 1;
+}
+
+// The subtype table holds one bitset per type, indexed by the type ids of its
+// subtypes. Rows are padded to dwords so they can be tested with `bt'.
+u64 SubtypeRowBytes(const TypeInfoMap& tinfo_map) {
+  return ((NumTypeIds(tinfo_map) + 31) / 32) * 4;
+}
+
 enum class ExceptionType {
   ARITHMETIC,
   NPE,
@@ -115,11 +133,25 @@ enum class ExceptionType {
 };
 
 struct FuncWriter final {
-  FuncWriter(const TypeInfoMap& tinfo_map, const OffsetTable& offsets, const File* file, const RuntimeLinkIds& rt_ids, vector<StackFrame>* stack_frames, StackFrame frame, ostream* out) : tinfo_map(tinfo_map), offsets(offsets), file(file), rt_ids(rt_ids), stack_frames(*stack_frames), frame(frame), w(out) {}
+  FuncWriter(const TypeInfoMap& tinfo_map, const OffsetTable& offsets, const FileSet& fs, const RuntimeLinkIds& rt_ids, const Stream& stream, const RegAlloc& reg_alloc, vector<StackFrame>* stack_frames, StackFrame frame, ostream* out) : tinfo_map(tinfo_map), offsets(offsets), fs(fs), rt_ids(rt_ids), stream(stream), reg_alloc(reg_alloc), stack_frames(*stack_frames), frame(frame), subtype_row_bytes(SubtypeRowBytes(tinfo_map)), w(out) {}
 
   size_t MakeStackFrame(int file_offset) {
+    return MakeStackFrameImpl(stream.ops.at(cur_op).inline_site, file_offset);
+  }
+
+  // Ops inlined from another method get a frame for that method, chained to
+  // the frame of the call it was inlined through.
+  size_t MakeStackFrameImpl(u64 site, int file_offset) {
     StackFrame new_frame = frame;
-    new_frame.line = OffsetToLine(file_offset);
+    if (site != 0) {
+      const InlineSite& s = stream.inline_sites.at(site - 1);
+      auto iter = site_frames.find(site);
+      if (iter == site_frames.end()) {
+        iter = site_frames.insert({site, MakeStackFrameImpl(s.parent, s.call_offset)}).first;
+      }
+      new_frame = {s.fileid, s.tid, s.mid, 0, (i64)iter->second};
+    }
+    new_frame.line = OffsetToLine(new_frame.fid, file_offset);
     size_t frame_idx = stack_frames.size();
     stack_frames.emplace_back(new_frame);
     return frame_idx;
@@ -159,6 +191,19 @@ struct FuncWriter final {
       w.Col1("mov ebx, stackframe_%v", e.stack_frame_id);
       w.Col1("jmp _joos_throw");
     }
+
+    // Slow paths for heap allocations that overflowed the current chunk.
+    for (size_t i = 0; i < allocs.size(); ++i) {
+      const AllocSite& a = allocs.at(i);
+      w.Col0(".a%v:", i);
+      w.Col1("sub eax, edx");
+      SaveRegs(a.saved);
+      w.Col1("sub esp, %v", a.stack_used);
+      w.Col1("call _joos_malloc");
+      w.Col1("add esp, %v", a.stack_used);
+      RestoreRegs(a.saved);
+      w.Col1("jmp .LL%v", a.return_label);
+    }
     w.Col0("\n");
   }
 
@@ -170,13 +215,22 @@ struct FuncWriter final {
       i64 cur = param_offset;
       param_offset -= 4;
 
-      StackEntry entry = {stream.params.at(i), cur, i + 1};
+      StackEntry entry = {stream.params.at(i), cur, i + 1, RegOf(i + 1)};
 
       auto iter_pair = stack_map.insert({entry.id, entry});
       CHECK(iter_pair.second);
+
+      if (entry.reg != Reg::NONE) {
+        w.Col1("; t%v lives in %v.", entry.id, RegName(entry.reg, SizeClass::INT));
+        w.Col1("mov %v, %v", RegName(entry.reg, SizeClass::INT), StackOffset(entry.offset));
+      }
     }
   }
 
+  void SetCurrentOp(size_t op_idx) {
+    cur_op = op_idx;
+  }
+
   void AllocHeap(ArgIter begin, ArgIter end) {
     EXPECT_NARGS(2);
 
@@ -187,16 +241,16 @@ struct FuncWriter final {
 
     CHECK(dst_e.size == SizeClass::PTR);
 
+    // Object sizes are always a multiple of 4, so the heap stays aligned.
     u64 size = offsets.SizeOf({tid, 0});
-    i64 stack_used = cur_offset;
 
     w.Col1("; t%v = new %v", dst, size);
-    w.Col1("mov eax, %v", size);
-    w.Col1("sub esp, %v", stack_used);
-    w.Col1("call _joos_malloc");
-    w.Col1("add esp, %v", stack_used);
+    w.Col1("mov edx, [__heap_ptr]");
+    w.Col1("mov eax, edx");
+    w.Col1("add eax, %v", size);
+    BumpAllocImpl();
     w.Col1("mov dword [eax], vtable_t%v", tid);
-    w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+    w.Col1("mov %v, eax", Loc(dst_e));
   }
 
   void AllocArray(ArgIter begin, ArgIter end) {
@@ -214,10 +268,9 @@ struct FuncWriter final {
     CHECK(len_e.size == SizeClass::INT);
 
     u64 elem_size = ByteSizeFrom(SizeClassFrom({elemtype, 0}), 4);
-    i64 stack_used = cur_offset;
 
     w.Col1("; t%v = new[t%v]", dst, len);
-    w.Col1("mov eax, %v", StackOffset(len_e.offset));
+    w.Col1("mov eax, %v", Loc(len_e));
     // Handle negative array length.
     {
       size_t exception_id = MakeException(ExceptionType::NASE, file_offset);
@@ -225,28 +278,25 @@ struct FuncWriter final {
       w.Col1("cmp eax, 0");
       w.Col1("jl .e%v", exception_id);
     }
-    w.Col1("mov ebx, %v", elem_size);
-    w.Col1("imul ebx");
-    w.Col1("add eax, 12"); // Add space for vptr, length, and elem-type ptr.
-    w.Col1("sub esp, %v", stack_used);
-    w.Col1("call _joos_malloc");
-    w.Col1("add esp, %v", stack_used);
-    w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+    w.Col1("imul eax, eax, %v", elem_size);
+    // Add space for vptr, length, and elem-type ptr, and round up to keep the
+    // heap aligned.
+    w.Col1("add eax, 15");
+    w.Col1("and eax, 0xfffffffc");
+    w.Col1("mov edx, [__heap_ptr]");
+    w.Col1("add eax, edx");
+    BumpAllocImpl(&len_e);
+    w.Col1("mov %v, eax", Loc(dst_e));
 
     // Set the vptr to be object's vptr.
     w.Col1("mov dword [eax], array_vtable_t%v", rt_ids.object_tid.base);
 
     // Set the length field.
-    w.Col1("mov ebx, %v", StackOffset(len_e.offset));
-    w.Col1("mov [eax+4], ebx");
+    w.Col1("mov edx, %v", Loc(len_e));
+    w.Col1("mov [eax+4], edx");
 
-    if (TypeChecker::IsPrimitive(TypeId{elemtype, 0})) {
-      // For primitive arrays, store the type id directly.
-      w.Col1("mov dword [eax+8], %v", elemtype);
-    } else {
-      w.Col1("mov ebx, [static_t%v_f%v]", elemtype, kStaticTypeInfoId);
-      w.Col1("mov [eax+8], ebx");
-    }
+    // Set the element type id.
+    w.Col1("mov dword [eax+8], %v", elemtype);
   }
 
   void AllocMem(ArgIter begin, ArgIter end) {
@@ -261,9 +311,13 @@ struct FuncWriter final {
     i64 offset = cur_offset;
     cur_offset += 4;
 
-    w.Col1("; %v refers to t%v.", StackOffset(offset), memid);
+    StackEntry entry = {size, offset, memid, RegOf(memid)};
 
-    StackEntry entry = {size, offset, memid};
+    if (entry.reg != Reg::NONE) {
+      w.Col1("; t%v lives in %v, spilled to %v.", memid, RegName(entry.reg, SizeClass::INT), StackOffset(offset));
+    } else {
+      w.Col1("; %v refers to t%v.", StackOffset(offset), memid);
+    }
 
     auto iter_pair = stack_map.insert({memid, entry});
     CHECK(iter_pair.second);
@@ -308,10 +362,8 @@ struct FuncWriter final {
     const StackEntry& entry = stack_map.at(memid);
     CHECK(entry.size == size);
 
-    string mov_size = Sized(size, "byte", "word", "dword");
-
     w.Col1("; t%v = %v.", memid, value);
-    w.Col1("mov %v %v, %v", mov_size, StackOffset(entry.offset), value);
+    w.Col1("mov %v, %v", SizedLoc(entry), value);
   }
 
   void ConstStr(ArgIter begin, ArgIter end) {
@@ -324,7 +376,7 @@ struct FuncWriter final {
     CHECK(entry.size == SizeClass::PTR);
 
     w.Col1("; t%v = static string %v", memid, strid);
-    w.Col1("mov dword %v, string%v", StackOffset(entry.offset), strid);
+    w.Col1("mov %v, string%v", SizedLoc(entry), strid);
   }
 
   void MovImpl(ArgIter begin, ArgIter end, bool addr) {
@@ -333,11 +385,19 @@ struct FuncWriter final {
     MemId dst = begin[0];
     MemId src = begin[1];
 
-    const StackEntry& dst_e = stack_map.at(dst);
     const StackEntry& src_e = stack_map.at(src);
 
+    // Plain assignments to locals are written directly by MovToAddr.
+    if (addr && reg_alloc.local_stores.count(dst) == 1) {
+      w.Col1("; t%v = &t%v, folded into its store.", dst, src_e.id);
+      return;
+    }
+
+    const StackEntry& dst_e = stack_map.at(dst);
+
     if (addr) {
       CHECK(dst_e.size == SizeClass::PTR);
+      CHECK(src_e.reg == Reg::NONE);
     } else {
       CHECK(dst_e.size == src_e.size);
     }
@@ -347,8 +407,8 @@ struct FuncWriter final {
     string instr = addr ? "lea" : "mov";
 
     w.Col1("; t%v = %vt%v.", dst_e.id, src_prefix, src_e.id);
-    w.Col1("%v %v, %v", instr, sized_reg, StackOffset(src_e.offset));
-    w.Col1("mov %v, %v", StackOffset(dst_e.offset), sized_reg);
+    w.Col1("%v %v, %v", instr, sized_reg, Loc(src_e));
+    w.Col1("mov %v, %v", Loc(dst_e), sized_reg);
   }
 
   void Mov(ArgIter begin, ArgIter end) {
@@ -366,16 +426,32 @@ struct FuncWriter final {
     MemId src = begin[1];
     u64 file_offset = begin[2];
 
-    const StackEntry& dst_e = stack_map.at(dst);
     const StackEntry& src_e = stack_map.at(src);
 
+    {
+      auto iter = reg_alloc.local_stores.find(dst);
+      if (iter != reg_alloc.local_stores.end()) {
+        const StackEntry& local_e = stack_map.at(iter->second);
+        CHECK(local_e.size == src_e.size);
+
+        string sized_reg = Sized(src_e.size, "al", "ax", "eax");
+
+        w.Col1("; t%v = t%v.", local_e.id, src_e.id);
+        w.Col1("mov %v, %v", sized_reg, Loc(src_e));
+        w.Col1("mov %v, %v", Loc(local_e), sized_reg);
+        return;
+      }
+    }
+
+    const StackEntry& dst_e = stack_map.at(dst);
+
     CHECK(dst_e.size == SizeClass::PTR);
 
-    string src_reg = Sized(src_e.size, "bl", "bx", "ebx");
+    string src_reg = Sized(src_e.size, "dl", "dx", "edx");
 
     w.Col1("; *t%v = t%v.", dst_e.id, src_e.id);
-    w.Col1("mov %v, %v", src_reg, StackOffset(src_e.offset));
-    w.Col1("mov eax, %v", StackOffset(dst_e.offset));
+    w.Col1("mov %v, %v", src_reg, Loc(src_e));
+    w.Col1("mov eax, %v", Loc(dst_e));
 
     // Test for NPE. ArrayAddr will not generate an NPE so that order of
     // evaluation meets the spec.
@@ -412,21 +488,21 @@ struct FuncWriter final {
 
       w.Col1("; t%v = %vstatic_t%v_f%v", dst_e.id, src_prefix, parent_tid.base, fid);
       w.Col1("%v %v, [static_t%v_f%v]", instr, sized_reg, parent_tid.base, fid);
-      w.Col1("mov %v, %v", StackOffset(dst_e.offset), sized_reg);
+      w.Col1("mov %v, %v", Loc(dst_e), sized_reg);
     } else {
       const StackEntry& src_e = stack_map.at(src);
       u64 field_offset = offsets.OffsetOfField(fid);
       w.Col1("; t%v = %vt%v.f%v.", dst_e.id, src_prefix, src_e.id, fid);
-      w.Col1("mov ebx, %v", StackOffset(src_e.offset));
+      w.Col1("mov edx, %v", Loc(src_e));
 
       // Handle NPE.
       size_t exception_id = MakeException(ExceptionType::NPE, file_offset);
       w.Col1("; Checking for NPE.");
-      w.Col1("test ebx, ebx");
+      w.Col1("test edx, edx");
       w.Col1("jz .e%v", exception_id);
 
-      w.Col1("%v %v, [ebx+%v]", instr, sized_reg, field_offset);
-      w.Col1("mov %v, %v", StackOffset(dst_e.offset), sized_reg);
+      w.Col1("%v %v, [edx+%v]", instr, sized_reg, field_offset);
+      w.Col1("mov %v, %v", Loc(dst_e), sized_reg);
     }
   }
 
@@ -465,7 +541,7 @@ struct FuncWriter final {
     ++local_label_counter;
 
     w.Col1("; t%v = %vt%v[t%v]", dst, src_prefix, src, idx);
-    w.Col1("mov ecx, %v", StackOffset(src_e.offset));
+    w.Col1("mov edx, %v", Loc(src_e));
 
     // Handle NPE.
     w.Col1("; Checking for NPE.");
@@ -473,35 +549,29 @@ struct FuncWriter final {
       // If we're computing an lvalue, don't crash here. We have to evaluate
       // the LHS of the assignment first. MovToAddr will take care of crashing
       // on NPE.
-      w.Col1("mov %v, 0", sized_reg);
-      w.Col1("mov %v, %v", StackOffset(dst_e.offset), sized_reg);
-      w.Col1("test ecx, ecx");
+      w.Col1("mov %v, 0", SizedLoc(dst_e));
+      w.Col1("test edx, edx");
       w.Col1("jz .LL%v", local_label);
     } else {
       size_t exception_id = MakeException(ExceptionType::NPE, file_offset);
-      w.Col1("test ecx, ecx");
+      w.Col1("test edx, edx");
       w.Col1("jz .e%v", exception_id);
     }
 
-    w.Col1("mov eax, %v", StackOffset(idx_e.offset));
-    w.Col1("mov ebx, [ecx+4]");
+    w.Col1("mov eax, %v", Loc(idx_e));
 
-    // Handle out of bounds exception.
+    // Handle out of bounds exception. Negative indices compare as large
+    // unsigned values, so a single unsigned comparison covers both bounds.
     {
       size_t exception_id = MakeException(ExceptionType::OOBE, file_offset);
       w.Col1("; Checking bounds for array access.");
-      w.Col1("cmp eax, 0");
-      w.Col1("jl .e%v", exception_id);
-      w.Col1("cmp eax, ebx");
-      w.Col1("jge .e%v", exception_id);
+      w.Col1("cmp eax, [edx+4]");
+      w.Col1("jae .e%v", exception_id);
     }
 
-    w.Col1("mov ebx, %v", ByteSizeFrom(elemsize, 4));
-    w.Col1("imul ebx");
-    w.Col1("add eax, 12"); // Move past the vptr, the length field, and the elem type ptr.
-
-    w.Col1("%v %v, [ecx+eax]", instr, sized_reg);
-    w.Col1("mov %v, %v", StackOffset(dst_e.offset), sized_reg);
+    // Move past the vptr, the length field, and the elem type ptr.
+    w.Col1("%v %v, [edx+eax*%v+12]", instr, sized_reg, ByteSizeFrom(elemsize, 4));
+    w.Col1("mov %v, %v", Loc(dst_e), sized_reg);
 
     w.Col1(".LL%v:", local_label);
   }
@@ -533,9 +603,9 @@ struct FuncWriter final {
     string instr = add ? "add" : "sub";
 
     w.Col1("; t%v = t%v %v t%v.", dst_e.id, lhs_e.id, op_str, rhs_e.id);
-    w.Col1("mov eax, %v", StackOffset(lhs_e.offset));
-    w.Col1("%v eax, %v", instr, StackOffset(rhs_e.offset));
-    w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+    w.Col1("mov eax, %v", Loc(lhs_e));
+    w.Col1("%v eax, %v", instr, Loc(rhs_e));
+    w.Col1("mov %v, eax", Loc(dst_e));
   }
 
   void Add(ArgIter begin, ArgIter end) {
@@ -562,10 +632,9 @@ struct FuncWriter final {
     CHECK(rhs_e.size == SizeClass::INT);
 
     w.Col1("; t%v = t%v * t%v.", dst_e.id, lhs_e.id, rhs_e.id);
-    w.Col1("mov eax, %v", StackOffset(lhs_e.offset));
-    w.Col1("mov ebx, %v", StackOffset(rhs_e.offset));
-    w.Col1("imul ebx");
-    w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+    w.Col1("mov eax, %v", Loc(lhs_e));
+    w.Col1("imul eax, %v", Loc(rhs_e));
+    w.Col1("mov %v, eax", Loc(dst_e));
   }
 
   void DivMod(ArgIter begin, ArgIter end, bool div) {
@@ -588,18 +657,17 @@ struct FuncWriter final {
     string res_reg = div ? "eax" : "edx";
 
     w.Col1("; t%v = t%v %v t%v.", dst_e.id, lhs_e.id, op_str, rhs_e.id);
-    w.Col1("mov eax, %v", StackOffset(lhs_e.offset));
+    w.Col1("mov eax, %v", Loc(lhs_e));
     w.Col1("cdq"); // Sign-extend EAX through to EDX.
-    w.Col1("mov ebx, %v", StackOffset(rhs_e.offset));
 
     // Handle div-by-zero.
     size_t exception_id = MakeException(ExceptionType::ARITHMETIC, file_offset);
     w.Col1("; Checking for div-by-zero.");
-    w.Col1("test ebx, ebx");
-    w.Col1("jz .e%v", exception_id);
+    w.Col1("cmp %v, 0", SizedLoc(rhs_e));
+    w.Col1("je .e%v", exception_id);
 
-    w.Col1("idiv ebx");
-    w.Col1("mov %v, %v", StackOffset(dst_e.offset), res_reg);
+    w.Col1("idiv %v", SizedLoc(rhs_e));
+    w.Col1("mov %v, %v", Loc(dst_e), res_reg);
   }
 
   void Div(ArgIter begin, ArgIter end) {
@@ -629,9 +697,8 @@ struct FuncWriter final {
     CHECK(cond_e.size == SizeClass::BOOL);
 
     w.Col1("; Jumping if t%v.", cond);
-    w.Col1("mov al, %v", StackOffset(cond_e.offset));
-    w.Col1("test al, al");
-    w.Col1("jnz .L%v", lid);
+    w.Col1("cmp %v, 0", SizedLoc(cond_e));
+    w.Col1("jne .L%v", lid);
   }
 
   void RelImpl(ArgIter begin, ArgIter end, const string& relation, const string& instruction) {
@@ -650,9 +717,9 @@ struct FuncWriter final {
     CHECK(rhs_e.size == SizeClass::INT);
 
     w.Col1("; t%v = (t%v %v t%v).", dst_e.id, lhs_e.id, relation, rhs_e.id);
-    w.Col1("mov eax, %v", StackOffset(lhs_e.offset));
-    w.Col1("cmp eax, %v", StackOffset(rhs_e.offset));
-    w.Col1("%v %v", instruction, StackOffset(dst_e.offset));
+    w.Col1("mov eax, %v", Loc(lhs_e));
+    w.Col1("cmp eax, %v", Loc(rhs_e));
+    w.Col1("%v %v", instruction, Loc(dst_e));
   }
 
   void Lt(ArgIter begin, ArgIter end) {
@@ -683,9 +750,9 @@ struct FuncWriter final {
     string sized_reg = Sized(lhs_e.size, "al", "", "eax");
 
     w.Col1("; t%v = (t%v == t%v).", dst_e.id, lhs_e.id, rhs_e.id);
-    w.Col1("mov %v, %v", sized_reg, StackOffset(lhs_e.offset));
-    w.Col1("cmp %v, %v", sized_reg, StackOffset(rhs_e.offset));
-    w.Col1("sete %v", StackOffset(dst_e.offset));
+    w.Col1("mov %v, %v", sized_reg, Loc(lhs_e));
+    w.Col1("cmp %v, %v", sized_reg, Loc(rhs_e));
+    w.Col1("sete %v", Loc(dst_e));
   }
 
   void Not(ArgIter begin, ArgIter end) {
@@ -701,9 +768,9 @@ struct FuncWriter final {
     CHECK(src_e.size == SizeClass::BOOL);
 
     w.Col1("; t%v = !t%v", dst_e.id, src_e.id);
-    w.Col1("mov al, %v", StackOffset(src_e.offset));
+    w.Col1("mov al, %v", Loc(src_e));
     w.Col1("xor al, 1");
-    w.Col1("mov %v, al", StackOffset(dst_e.offset));
+    w.Col1("mov %v, al", Loc(dst_e));
   }
 
   void Neg(ArgIter begin, ArgIter end) {
@@ -719,9 +786,9 @@ struct FuncWriter final {
     CHECK(src_e.size == SizeClass::INT);
 
     w.Col1("; t%v = -t%v", dst_e.id, src_e.id);
-    w.Col1("mov eax, %v", StackOffset(src_e.offset));
+    w.Col1("mov eax, %v", Loc(src_e));
     w.Col1("neg eax");
-    w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+    w.Col1("mov %v, eax", Loc(dst_e));
   }
 
 
@@ -741,9 +808,9 @@ struct FuncWriter final {
     CHECK(rhs_e.size == SizeClass::BOOL);
 
     w.Col1("; t%v = t%v %v t%v.", dst_e.id, lhs_e.id, op_str, rhs_e.id);
-    w.Col1("mov al, %v", StackOffset(lhs_e.offset));
-    w.Col1("%v al, %v", instr, StackOffset(rhs_e.offset));
-    w.Col1("mov %v, al", StackOffset(dst_e.offset));
+    w.Col1("mov al, %v", Loc(lhs_e));
+    w.Col1("%v al, %v", instr, Loc(rhs_e));
+    w.Col1("mov %v, al", Loc(dst_e));
   }
 
   void And(ArgIter begin, ArgIter end) {
@@ -768,14 +835,14 @@ struct FuncWriter final {
     const StackEntry& src_e = stack_map.at(src);
 
     string src_sized_reg = Sized(src_e.size, "al", "ax", "eax");
-    string dst_sized_reg = Sized(dst_e.size, "bl", "bx", "ebx");
+    string dst_sized_reg = Sized(dst_e.size, "dl", "dx", "edx");
 
     string instr = src_e.size == SizeClass::CHAR ? "movzx" : "movsx";
 
     w.Col1("; t%v = extend(t%v)", dst, src);
-    w.Col1("mov %v, %v", src_sized_reg, StackOffset(src_e.offset));
+    w.Col1("mov %v, %v", src_sized_reg, Loc(src_e));
     w.Col1("%v %v, %v", instr, dst_sized_reg, src_sized_reg);
-    w.Col1("mov %v, %v", StackOffset(dst_e.offset), dst_sized_reg);
+    w.Col1("mov %v, %v", Loc(dst_e), dst_sized_reg);
   }
 
   void Truncate(ArgIter begin, ArgIter end) {
@@ -791,35 +858,15 @@ struct FuncWriter final {
     string dst_sized_reg = Sized(dst_e.size, "al", "ax", "eax");
 
     w.Col1("; t%v = truncate(t%v)", dst, src);
-    w.Col1("mov %v, %v", src_sized_reg, StackOffset(src_e.offset));
-    w.Col1("mov %v, %v", StackOffset(dst_e.offset), dst_sized_reg);
+    w.Col1("mov %v, %v", src_sized_reg, Loc(src_e));
+    w.Col1("mov %v, %v", Loc(dst_e), dst_sized_reg);
   }
 
-  // Assume eax contains destination type, and ebx contains source type. Calls
-  // the runtime InstanceOf static method, and returns a bool in al.
-  void InstanceOfImpl() {
-    i64 stack_used = cur_offset;
-
-    // Push the dst type id onto stack.
-    {
-      w.Col1("mov %v, eax", StackOffset(stack_used));
-      stack_used += 4;
-    }
-
-    // Push the src type id onto stack
-    {
-      w.Col1("mov %v, ebx", StackOffset(stack_used));
-      stack_used += 4;
-    }
-
-    // Perform the call.
-    {
-      w.Col1("sub esp, %v", stack_used);
-      w.Col1("push 0"); // Stackframe would ordinarily go here.
-      w.Col1("call _t%v_m%v", rt_ids.type_info_tid.base, rt_ids.type_info_instanceof);
-      w.Col1("pop ecx");
-      w.Col1("add esp, %v", stack_used);
-    }
+  // Assume edx contains the source type id. Tests the source type against the
+  // compile-time subtype table, and returns a bool in al.
+  void InstanceOfImpl(TypeId::Base dst_tid) {
+    w.Col1("bt dword [_subtypes+%v], edx", dst_tid * subtype_row_bytes);
+    w.Col1("setc al");
   }
 
   void InstanceOf(ArgIter begin, ArgIter end) {
@@ -837,89 +884,61 @@ struct FuncWriter final {
 
     CHECK(dst_e.size == SizeClass::BOOL);
 
-    // TODO: use tinfo_map_ to immediately allow "obvious" ancestor
-    // relationships; i.e. `"foo" instanceof Object'.
-
     // First, handle array to non-array instanceof. Runtime checks are
     // superfluous because the typechecker does not allow any situations which
     // would return false.
     if (!dst_array && src_array) {
-      w.Col1("mov byte %v, 1", StackOffset(dst_e.offset));
+      w.Col1("mov %v, 1", SizedLoc(dst_e));
       return;
     }
 
     // Second, handle two non-arrays.
     if (!dst_array && !src_array) {
-      // Dst type id.
-      w.Col1("mov eax, [static_t%v_f%v]", dst_tid, kStaticTypeInfoId);
-
       // Src type id.
       {
-        w.Col1("mov ebx, %v", StackOffset(src_e.offset));
+        w.Col1("mov edx, %v", Loc(src_e));
         // Dereference `this'.
-        w.Col1("mov ebx, [ebx]");
+        w.Col1("mov edx, [edx]");
         // Dereference vptr.
-        w.Col1("mov ebx, [ebx]");
-        // Dereference the pointer to a type info ptr.
-        w.Col1("mov ebx, [ebx]");
+        w.Col1("mov edx, [edx]");
       }
 
-      InstanceOfImpl();
+      InstanceOfImpl(dst_tid);
 
       // Write return value.
-      w.Col1("mov %v, al", StackOffset(dst_e.offset));
+      w.Col1("mov %v, al", Loc(dst_e));
       return;
     }
 
-    // Third, handle two arrays.
-    if (dst_array && src_array) {
-      // Dst type id.
-      w.Col1("mov eax, [static_t%v_f%v]", dst_tid, kStaticTypeInfoId);
-
-      // Src type id.
-      {
-        w.Col1("mov ebx, %v", StackOffset(src_e.offset));
-        // Dereference array's elem-type-ptr.
-        w.Col1("mov ebx, [ebx+8]");
-      }
-
-      InstanceOfImpl();
-
-      w.Col1("mov %v, al", StackOffset(dst_e.offset));
-      return;
-    }
-
-    // Last, handle non-array to array.
-    CHECK(dst_array && !src_array);
     u64 local_label = local_label_counter;
     ++local_label_counter;
 
     // Set result to 0.
-    w.Col1("mov byte %v, 0", StackOffset(dst_e.offset));
+    w.Col1("mov %v, 0", SizedLoc(dst_e));
 
-    w.Col1("mov ebx, %v", StackOffset(src_e.offset));
+    w.Col1("mov edx, %v", Loc(src_e));
 
-    // If the source is not an array, then short-circuit.
-    w.Col1("mov ecx, [ebx]");
-    w.Col1("cmp ecx, array_vtable_t%v", rt_ids.object_tid.base);
-    w.Col1("jne .LL%v", local_label);
+    // Last, handle non-array to array. If the source is not an array, then
+    // short-circuit.
+    if (!src_array) {
+      CHECK(dst_array);
+      w.Col1("cmp dword [edx], array_vtable_t%v", rt_ids.object_tid.base);
+      w.Col1("jne .LL%v", local_label);
+    }
+
+    // Arrays store their element type id directly.
+    w.Col1("mov edx, [edx+8]");
 
     // If the dst element-type is a primitive type, then just compare the type directly.
     if (TypeChecker::IsPrimitive(TypeId{dst_tid, 0})) {
-      w.Col1("mov ebx, [ebx+8]");
-      w.Col1("cmp ebx, %v", dst_tid);
-      w.Col1("jne .LL%v", local_label);
-      w.Col1("mov al, 1");
+      w.Col1("cmp edx, %v", dst_tid);
+      w.Col1("sete al");
     } else {
-      // Dst type id.
-      w.Col1("mov eax, [static_t%v_f%v]", dst_tid, kStaticTypeInfoId);
-      // Src type id.
-      w.Col1("mov ebx, [ebx+8]");
-      InstanceOfImpl();
+      InstanceOfImpl(dst_tid);
     }
 
     // Write result.
-    w.Col1("mov %v, al", StackOffset(dst_e.offset));
+    w.Col1("mov %v, al", Loc(dst_e));
 
     // Write short-circuit label.
     w.Col0(".LL%v:", local_label);
@@ -937,9 +956,8 @@ struct FuncWriter final {
 
     size_t exception_id = MakeException(ExceptionType::CCE, file_offset);
     w.Col1("; Checking for invalid class cast.");
-    w.Col1("mov al, %v", StackOffset(cond_e.offset));
-    w.Col1("test al, al");
-    w.Col1("jz .e%v", exception_id);
+    w.Col1("cmp %v, 0", SizedLoc(cond_e));
+    w.Col1("je .e%v", exception_id);
   }
 
   void CheckArrayStore(ArgIter begin, ArgIter end) {
@@ -955,18 +973,42 @@ struct FuncWriter final {
     CHECK(array_e.size == SizeClass::PTR);
     CHECK(elem_e.size == SizeClass::PTR);
 
-    // Handle array-store-exception.
+    u64 local_label = local_label_counter;
+    ++local_label_counter;
+
+    // Handle array-store-exception. Storing null is always allowed, and a
+    // null array is left for MovToAddr to report.
     size_t exception_id = MakeException(ExceptionType::ASE, file_offset);
     w.Col1("; Checking for invalid polymorphic array store.");
-    w.Col1("mov eax, %v", StackOffset(array_e.offset));
+    w.Col1("mov eax, %v", Loc(array_e));
+    w.Col1("mov edx, %v", Loc(elem_e));
+    w.Col1("test eax, eax");
+    w.Col1("jz .LL%v", local_label);
+    w.Col1("test edx, edx");
+    w.Col1("jz .LL%v", local_label);
     w.Col1("mov eax, [eax+8]");
-    w.Col1("mov ebx, %v", StackOffset(elem_e.offset));
-    w.Col1("mov ebx, [ebx]");
-    w.Col1("mov ebx, [ebx]");
-    w.Col1("mov ebx, [ebx]");
-    InstanceOfImpl();
-    w.Col1("test al, al");
-    w.Col1("jz .e%v", exception_id);
+    w.Col1("imul eax, eax, %v", subtype_row_bytes);
+    w.Col1("mov edx, [edx]");
+    w.Col1("mov edx, [edx]");
+    w.Col1("bt dword [_subtypes+eax], edx");
+    w.Col1("jnc .e%v", exception_id);
+    w.Col0(".LL%v:", local_label);
+  }
+
+  void CheckNull(ArgIter begin, ArgIter end) {
+    EXPECT_NARGS(2);
+
+    MemId src = begin[0];
+    u64 file_offset = begin[1];
+
+    const StackEntry& src_e = stack_map.at(src);
+
+    CHECK(src_e.size == SizeClass::PTR);
+
+    size_t exception_id = MakeException(ExceptionType::NPE, file_offset);
+    w.Col1("; Checking for NPE.");
+    w.Col1("cmp %v, 0", SizedLoc(src_e));
+    w.Col1("je .e%v", exception_id);
   }
 
   void StaticCall(ArgIter begin, ArgIter end) {
@@ -981,6 +1023,7 @@ struct FuncWriter final {
     CHECK(((u64)(end-begin) - 5) == nargs);
 
     i64 stack_used = cur_offset;
+    vector<StackEntry> saved = LiveAcrossCurrentOp();
 
     {
       auto label_ok = offsets.NativeCall(mid);
@@ -992,14 +1035,16 @@ struct FuncWriter final {
         const StackEntry& src_e = stack_map.at(src);
 
         w.Col1("; Performing native call.");
-        w.Col1("mov eax, %v", StackOffset(src_e.offset));
+        w.Col1("mov eax, %v", Loc(src_e));
+        SaveRegs(saved);
         w.Col1("sub esp, %v", stack_used);
         w.Col1("call %v", label_ok.first);
         w.Col1("add esp, %v", stack_used);
+        RestoreRegs(saved);
 
         if (dst != kInvalidMemId) {
           const StackEntry& dst_e = stack_map.at(dst);
-          w.Col1("mov %v, eax", StackOffset(dst_e.offset));
+          w.Col1("mov %v, eax", Loc(dst_e));
         }
 
         return;
@@ -1014,7 +1059,7 @@ struct FuncWriter final {
       const StackEntry& arg_e = stack_map.at(arg);
 
       string reg = Sized(arg_e.size, "al", "ax", "eax");
-      w.Col1("mov %v, %v", reg, StackOffset(arg_e.offset));
+      w.Col1("mov %v, %v", reg, Loc(arg_e));
       w.Col1("mov %v, %v", StackOffset(stack_used), reg);
 
       stack_used += 4;
@@ -1024,16 +1069,17 @@ struct FuncWriter final {
 
     w.Col1("; Performing call.");
 
+    SaveRegs(saved);
     w.Col1("sub esp, %v", stack_used);
     w.Col1("push stackframe_%v", frame_idx);
     w.Col1("call _t%v_m%v", tid, mid);
-    w.Col1("pop ecx");
-    w.Col1("add esp, %v", stack_used);
+    w.Col1("add esp, %v", stack_used + 4);
+    RestoreRegs(saved);
 
     if (dst != kInvalidMemId) {
       const StackEntry& dst_e = stack_map.at(dst);
       string dst_reg = Sized(dst_e.size, "al", "ax", "eax");
-      w.Col1("mov %v, %v", StackOffset(dst_e.offset), dst_reg);
+      w.Col1("mov %v, %v", Loc(dst_e), dst_reg);
     }
   }
 
@@ -1051,6 +1097,7 @@ struct FuncWriter final {
     const StackEntry& this_e = stack_map.at(this_ptr);
 
     i64 stack_used = cur_offset;
+    vector<StackEntry> saved = LiveAcrossCurrentOp();
 
     w.Col1("; Pushing %v arguments onto stack for call.", nargs);
 
@@ -1060,14 +1107,14 @@ struct FuncWriter final {
       const StackEntry& arg_e = stack_map.at(arg);
 
       string reg = Sized(arg_e.size, "al", "ax", "eax");
-      w.Col1("mov %v, %v", reg, StackOffset(arg_e.offset));
+      w.Col1("mov %v, %v", reg, Loc(arg_e));
       w.Col1("mov %v, %v", StackOffset(stack_used), reg);
 
       stack_used += 4;
     }
 
     w.Col1("; Pushing `this' onto stack for call.");
-    w.Col1("mov eax, %v", StackOffset(this_e.offset));
+    w.Col1("mov eax, %v", Loc(this_e));
 
     // Handle NPE.
     size_t exception_id = MakeException(ExceptionType::NPE, file_offset);
@@ -1088,6 +1135,7 @@ struct FuncWriter final {
 
     size_t frame_idx = MakeStackFrame(file_offset);
 
+    SaveRegs(saved);
     w.Col1("sub esp, %v", stack_used);
     w.Col1("push stackframe_%v", frame_idx);
     // Dereference the `this' ptr to get the vtable ptr.
@@ -1107,13 +1155,13 @@ struct FuncWriter final {
       w.Col1("call [eax + %v]", offset);
     }
 
-    w.Col1("pop ecx");
-    w.Col1("add esp, %v", stack_used);
+    w.Col1("add esp, %v", stack_used + 4);
+    RestoreRegs(saved);
 
     if (dst != kInvalidMemId) {
       const StackEntry& dst_e = stack_map.at(dst);
       string dst_reg = Sized(dst_e.size, "al", "ax", "eax");
-      w.Col1("mov %v, %v", StackOffset(stack_map.at(dst).offset), dst_reg);
+      w.Col1("mov %v, %v", Loc(dst_e), dst_reg);
     }
   }
 
@@ -1127,7 +1175,7 @@ struct FuncWriter final {
       string sized_reg = Sized(ret_e.size, "al", "ax", "eax");
 
       w.Col1("; Return t%v.", ret_e.id);
-      w.Col1("mov %v, %v", sized_reg, StackOffset(ret_e.offset));
+      w.Col1("mov %v, %v", sized_reg, Loc(ret_e));
     } else {
       w.Col1("; Return.");
     }
@@ -1140,6 +1188,7 @@ struct FuncWriter final {
     SizeClass size;
     i64 offset;
     MemId id;
+    Reg reg;
   };
 
   struct ExceptionSite final {
@@ -1147,13 +1196,104 @@ struct FuncWriter final {
     u64 stack_frame_id;
   };
 
-  int OffsetToLine(int offset) {
+  struct AllocSite final {
+    i64 stack_used;
+    u64 return_label;
+    vector<StackEntry> saved;
+  };
+
+  int OffsetToLine(int fileid, int offset) {
     int line = -1;
     int col = -1;
-    file->IndexToLineCol(offset, &line, &col);
+    fs.Get(fileid)->IndexToLineCol(offset, &line, &col);
     return line + 1;
   }
 
+  Reg RegOf(MemId mem) const {
+    auto iter = reg_alloc.regs.find(mem);
+    if (iter == reg_alloc.regs.end()) {
+      return Reg::NONE;
+    }
+    return iter->second;
+  }
+
+  // The operand holding a Mem's value; either its register or its stack slot.
+  string Loc(const StackEntry& entry) const {
+    if (entry.reg != Reg::NONE) {
+      return RegName(entry.reg, entry.size);
+    }
+    return StackOffset(entry.offset);
+  }
+
+  // Like Loc, but with an explicit operand size for stack slots, for use
+  // with instructions that have no register operand.
+  string SizedLoc(const StackEntry& entry) const {
+    if (entry.reg != Reg::NONE) {
+      return Loc(entry);
+    }
+    return Sized(entry.size, "byte ", "word ", "dword ") + StackOffset(entry.offset);
+  }
+
+  // Register-allocated Mems that must survive a call made by the current op.
+  vector<StackEntry> LiveAcrossCurrentOp() const {
+    vector<StackEntry> saved;
+    auto iter = reg_alloc.live_across.find(cur_op);
+    if (iter == reg_alloc.live_across.end()) {
+      return saved;
+    }
+    for (MemId mem : iter->second) {
+      saved.push_back(stack_map.at(mem));
+    }
+    return saved;
+  }
+
+  // Callees may clobber every register but ebp, so live registers are spilled
+  // to their stack slots around calls.
+  void SaveRegs(const vector<StackEntry>& saved) {
+    for (const StackEntry& entry : saved) {
+      w.Col1("mov %v, %v", StackOffset(entry.offset), RegName(entry.reg, SizeClass::INT));
+    }
+  }
+
+  void RestoreRegs(const vector<StackEntry>& saved) {
+    for (const StackEntry& entry : saved) {
+      w.Col1("mov %v, %v", RegName(entry.reg, SizeClass::INT), StackOffset(entry.offset));
+    }
+  }
+
+  // Bump-allocates from the runtime's current heap chunk. Assumes edx
+  // contains the current heap pointer and eax the heap pointer after the
+  // allocation; on return eax points to the allocated memory. Falls back to
+  // _joos_malloc when the chunk is exhausted. The runtime never reuses heap
+  // memory, so anything handed out here is already zeroed. `reread' is an
+  // operand that is still read after the allocation, and so must survive the
+  // slow path even if this op is its last use.
+  void BumpAllocImpl(const StackEntry* reread = nullptr) {
+    size_t alloc_id = allocs.size();
+    u64 local_label = local_label_counter;
+    ++local_label_counter;
+
+    vector<StackEntry> saved = LiveAcrossCurrentOp();
+    if (reread != nullptr && reread->reg != Reg::NONE) {
+      bool found = false;
+      for (const StackEntry& entry : saved) {
+        found = found || entry.id == reread->id;
+      }
+      if (!found) {
+        saved.push_back(*reread);
+      }
+    }
+
+    allocs.push_back({cur_offset, local_label, saved});
+
+    w.Col1("jc .a%v", alloc_id);
+    w.Col1("cmp eax, [__heap_end]");
+    w.Col1("ja .a%v", alloc_id);
+    w.Col1("mov [__heap_ptr], eax");
+    w.Col1("mov eax, edx");
+    w.Col0(".LL%v:", local_label);
+  }
+
   map<MemId, StackEntry> stack_map;
   i64 cur_offset = 0;
   vector<StackEntry> stack;
@@ -1162,14 +1302,24 @@ struct FuncWriter final {
 
   vector<ExceptionSite> exceptions;
 
+  vector<AllocSite> allocs;
+
+  // The frame of the call each InlineSite was inlined through.
+  map<u64, size_t> site_frames;
+
   u64 local_label_counter = 0;
 
+  size_t cur_op = 0;
+
   const TypeInfoMap& tinfo_map;
   const OffsetTable& offsets;
-  const File* file;
+  const FileSet& fs;
   const RuntimeLinkIds& rt_ids;
+  const Stream& stream;
+  const RegAlloc& reg_alloc;
   vector<StackFrame>& stack_frames;
   StackFrame frame;
+  u64 subtype_row_bytes;
 
   AsmWriter w;
 };
@@ -1184,12 +1334,14 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
   static string kStaticNameFmt = "static_t%v_f%v";
 
   set<string> externs{
+    "__heap_end",
+    "__heap_ptr",
     "_joos_malloc",
     "_joos_throw",
     Sprintf(kVtableNameFmt, rt_ids_.object_tid.base),
     Sprintf(kVtableNameFmt, rt_ids_.stackframe_type.base),
     Sprintf("src_file%v", comp_unit.fileid),
-    Sprintf(kMethodNameFmt, rt_ids_.type_info_tid.base, rt_ids_.type_info_instanceof),
+    "_subtypes",
   };
   set<string> globals;
   for (const Type& type : comp_unit.types) {
@@ -1197,9 +1349,7 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
     globals.insert(Sprintf(kItableNameFmt, type.tid));
     globals.insert(Sprintf(kStaticNameFmt, type.tid, kStaticTypeInfoId));
 
-    if (type.tid == rt_ids_.object_tid.base) {
-      externs.insert(Sprintf(kStaticNameFmt, rt_ids_.array_runtime_type.base, kStaticTypeInfoId));
-    } else {
+    if (type.tid != rt_ids_.object_tid.base) {
       externs.insert(Sprintf("array_vtable_t%v", rt_ids_.object_tid.base));
     }
 
@@ -1213,6 +1363,12 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
 
       externs.insert(Sprintf("methods%v", method_stream.mid));
 
+      for (const InlineSite& site : method_stream.inline_sites) {
+        externs.insert(Sprintf("src_file%v", site.fileid));
+        externs.insert(Sprintf("types%v", site.tid));
+        externs.insert(Sprintf("methods%v", site.mid));
+      }
+
       for (const Op& op : method_stream.ops) {
         if (op.type == OpType::STATIC_CALL) {
           TypeId::Base tid = method_stream.args[op.begin + 1];
@@ -1227,13 +1383,6 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
         } else if (op.type == OpType::ALLOC_HEAP) {
           TypeId::Base tid = method_stream.args[op.begin + 1];
           externs.insert(Sprintf(kVtableNameFmt, tid));
-        } else if (op.type == OpType::ALLOC_ARRAY) {
-          TypeId::Base tid = method_stream.args[op.begin + 1];
-          if (TypeChecker::IsPrimitive(TypeId{tid, 0})) {
-            // no-op.
-          } else {
-            externs.insert(Sprintf(kStaticNameFmt, tid, kStaticTypeInfoId));
-          }
         } else if (op.type == OpType::FIELD_DEREF || op.type == OpType::FIELD_ADDR) {
           TypeId::Base child_tid = method_stream.args[op.begin + 2];
           FieldId fid = method_stream.args[op.begin + 3];
@@ -1242,9 +1391,6 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
         } else if (op.type == OpType::CONST_STR) {
           StringId strid = method_stream.args[op.begin + 1];
           externs.insert(Sprintf("string%v", strid));
-        } else if (op.type == OpType::INSTANCE_OF) {
-          TypeId::Base tid = method_stream.args[op.begin + 2];
-          externs.insert(Sprintf(kStaticNameFmt, tid, kStaticTypeInfoId));
         }
       }
     }
@@ -1274,12 +1420,11 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
   }
 
   vector<StackFrame> stack;
-  const File* file = fs_.Get(comp_unit.fileid);
   for (const Type& type : comp_unit.types) {
     Fprintf(out, "section .text\n\n");
     for (const Stream& method_stream : type.streams) {
-      StackFrame frame = {comp_unit.fileid, type.tid, method_stream.mid, 0};
-      WriteFunc(method_stream, file, frame, &stack, out);
+      StackFrame frame = {comp_unit.fileid, type.tid, method_stream.mid, 0, -1};
+      WriteFunc(method_stream, frame, &stack, out);
     }
     Fprintf(out, "section .rodata\n");
     WriteVtable(type, out);
@@ -1290,14 +1435,19 @@ void Writer::WriteCompUnit(const CompUnit& comp_unit, ostream* out) const {
   WriteStackFrames(stack, out);
 }
 
-void Writer::WriteFunc(const Stream& stream, const File* file, StackFrame frame, vector<StackFrame>* stack_out, ostream* out) const {
-  FuncWriter writer{tinfo_map_, offsets_, file, rt_ids_, stack_out, frame, out};
+void Writer::WriteFunc(const Stream& stream, StackFrame frame, vector<StackFrame>* stack_out, ostream* out) const {
+  RegAlloc reg_alloc = AllocateRegisters(stream);
+
+  FuncWriter writer{tinfo_map_, offsets_, fs_, rt_ids_, stream, reg_alloc, stack_out, frame, out};
 
   writer.WritePrologue(stream);
 
   writer.SetupParams(stream);
 
-  for (const Op& op : stream.ops) {
+  for (size_t i = 0; i < stream.ops.size(); ++i) {
+    const Op& op = stream.ops.at(i);
+    writer.SetCurrentOp(i);
+
     ArgIter begin = stream.args.begin() + op.begin;
     ArgIter end = stream.args.begin() + op.end;
 
@@ -1404,6 +1554,9 @@ void Writer::WriteFunc(const Stream& stream, const File* file, StackFrame frame,
       case OpType::CHECK_ARRAY_STORE:
         writer.CheckArrayStore(begin, end);
         break;
+      case OpType::CHECK_NULL:
+        writer.CheckNull(begin, end);
+        break;
       case OpType::STATIC_CALL:
         writer.StaticCall(begin, end);
         break;
@@ -1429,7 +1582,7 @@ void Writer::WriteVtableImpl(bool array, const TypeInfo& tinfo, ostream* out) co
 
   w.Col0("global %vvtable_t%v", prefix, tinfo.type.base);
   w.Col0("%vvtable_t%v:", prefix, tinfo.type.base);
-  w.Col1("dd static_t%v_f%v", tid, kStaticTypeInfoId); // Type info ptr.
+  w.Col1("dd %v", tid); // Type id.
   w.Col1("dd itable_t%v", tinfo.type.base);
 
   for (const auto& v_pair : offsets_.VtableOf(tinfo.type)) {
@@ -1548,6 +1701,11 @@ void Writer::WriteStackFrames(const vector<StackFrame>& stack_frames, ostream* o
     w.Col1("dd src_file%v", frame.fid);
     w.Col1("dd types%v", frame.tid);
     w.Col1("dd methods%v", frame.mid);
+    if (frame.caller < 0) {
+      w.Col1("dd 0");
+    } else {
+      w.Col1("dd stackframe_%v", frame.caller);
+    }
     w.Col1("dd %v", frame.line);
   }
 }
@@ -1559,8 +1717,14 @@ void Writer::WriteMain(ostream* out) const {
   string print_ex = Sprintf("_t%v_m%v", rt_ids_.stackframe_type.base,
     rt_ids_.stackframe_print_ex);
 
+  {
+    const OffsetTable::ItableStats& stats = offsets_.GetItableStats();
+    w.Col0("; Itables use %v bytes (%v with a global slot per interface method).", stats.colored_bytes, stats.global_bytes);
+  }
+
   // Externs and globals.
   w.Col0("extern __exception");
+  w.Col0("extern __flush");
   w.Col0("extern __malloc");
   w.Col0("extern _entry");
   w.Col0("extern %v", print_stack);
@@ -1580,29 +1744,24 @@ void Writer::WriteMain(ostream* out) const {
   w.Col1("call _static_init");
   w.Col1("; Call user code.");
   w.Col1("call _entry");
+  w.Col1("; Flush buffered output.");
+  w.Col1("push eax");
+  w.Col1("call __flush");
+  w.Col1("pop ebx");
   w.Col1("; Call EXIT syscall.");
-  w.Col1("mov ebx, eax");
   w.Col1("mov eax, 1");
   w.Col1("int 0x80");
   w.Col0("\n");
 
-  // Zeroing malloc.
-  w.Col0("; Custom malloc that zeroes memory.");
+  // Zeroing malloc. The runtime carves allocations out of freshly mapped
+  // brk/mmap chunks and never reuses memory, so everything __malloc returns
+  // is already zero and needs no clearing here.
+  w.Col0("; Custom malloc that returns zeroed memory.");
   w.Col0("_joos_malloc:");
-  w.Col1("push eax"); // Save number of bytes.
   w.Col1("push ebp");
   w.Col1("mov ebp, esp");
   w.Col1("call __malloc");
   w.Col1("pop ebp");
-  w.Col1("pop ebx");
-  w.Col1("mov ecx, 0");
-  w.Col0(".before:");
-  w.Col1("cmp ecx, ebx");
-  w.Col1("je .after");
-  w.Col1("mov byte [eax + ecx], 0");
-  w.Col1("inc ecx");
-  w.Col1("jmp .before");
-  w.Col0(".after:");
   w.Col1("ret");
   w.Col0("\n");
 
@@ -1661,6 +1820,47 @@ void Writer::WriteMain(ostream* out) const {
   w.Col1("jmp __exception");
 }
 
+void Writer::WriteSubtypes(ostream* out) const {
+  AsmWriter w(out);
+
+  u64 num_types = NumTypeIds(tinfo_map_);
+  u64 row_words = SubtypeRowBytes(tinfo_map_) / 4;
+
+  w.Col0("section .rodata");
+  w.Col0("global _subtypes");
+  w.Col0("; Row i is a bitset of the type ids of all subtypes of type i.");
+  w.Col0("_subtypes:");
+
+  for (u64 ancestor = 0; ancestor < num_types; ++ancestor) {
+    vector<u32> row(row_words, 0);
+    for (u64 child = 0; child < num_types; ++child) {
+      bool is_subtype = (child == ancestor);
+
+      bool both_types =
+          tinfo_map_.GetTypeMap().count({child, 0}) == 1 &&
+          tinfo_map_.GetTypeMap().count({ancestor, 0}) == 1;
+      if (both_types) {
+        // Every reference type, including the runtime array type, is an
+        // Object.
+        is_subtype = is_subtype ||
+          ancestor == rt_ids_.object_tid.base ||
+          tinfo_map_.IsAncestor({child, 0}, {ancestor, 0});
+      }
+
+      if (is_subtype) {
+        row.at(child / 32) |= (u32)1 << (child % 32);
+      }
+    }
+
+    stringstream ss;
+    for (size_t i = 0; i < row.size(); ++i) {
+      ss << (i == 0 ? "" : ", ") << row.at(i);
+    }
+    w.Col1("dd %v ; t%v", ss.str(), ancestor);
+  }
+  w.Col0("\n");
+}
+
 void Writer::WriteStaticInit(const Program& prog, ostream* out) const {
   AsmWriter w(out);
 
@@ -1673,22 +1873,6 @@ void Writer::WriteStaticInit(const Program& prog, ostream* out) const {
   w.Col1("push 0");
 
   // Body.
-  // Write global number of types.
-  u64 max_tid = 0;
-  for (const auto& t_pair : tinfo_map_.GetTypeMap()) {
-    max_tid = std::max(t_pair.first.base, max_tid);
-  }
-
-  w.Col1("; Initializing number of types.");
-  string num_types_label = Sprintf(
-      "static_t%v_f%v",
-      prog.rt_ids.type_info_tid.base,
-      prog.rt_ids.type_info_num_types);
-  w.Col1("extern %v", num_types_label);
-  w.Col1("mov dword [%v], %v",
-      num_types_label,
-      max_tid + 1);
-
   // Initialize type's static type info.
   auto units = prog.units;
 
@@ -19,6 +19,9 @@ struct StackFrame {
   ast::TypeId::Base tid;
   ast::MethodId mid;
   int line;
+
+  // Index of the frame this one was inlined into, or -1.
+  i64 caller;
 };
 
 class Writer {
@@ -27,11 +30,12 @@ public:
   void WriteCompUnit(const ir::CompUnit& comp_unit, std::ostream* out) const;
   void WriteMain(std::ostream* out) const;
   void WriteStaticInit(const ir::Program& prog, std::ostream* out) const;
+  void WriteSubtypes(std::ostream* out) const;
   void WriteConstStrings(const types::ConstStringMap&, std::ostream* out) const;
   void WriteFileNames(std::ostream* out) const;
   void WriteMethods(std::ostream* out) const;
 private:
-  void WriteFunc(const ir::Stream& stream, const base::File* file, StackFrame frame, vector<StackFrame>* stack_out, std::ostream* out) const;
+  void WriteFunc(const ir::Stream& stream, StackFrame frame, vector<StackFrame>* stack_out, std::ostream* out) const;
   void WriteVtable(const ir::Type& type, std::ostream* out) const;
   void WriteVtableImpl(bool array, const types::TypeInfo& tinfo, std::ostream* out) const;
   void WriteItable(const ir::Type& type, std::ostream* out) const;
@@ -0,0 +1,23 @@
+#include "base/arena.h"
+
+#include <algorithm>
+
+namespace base {
+
+void* Arena::AllocateSlow(size_t size, size_t align) {
+  // Blocks come from new[], so offsets aligned within a block are only
+  // aligned in memory up to what new[] promises.
+  CHECK(align <= alignof(std::max_align_t));
+
+  // Anything too big to share a block gets one of its own.
+  size_t block_size = std::max(block_size_, size);
+  blocks_.emplace_back(new u8[block_size]);
+  cur_size_ = block_size;
+  bytes_reserved_ += block_size;
+
+  used_ = size;
+  bytes_allocated_ += size;
+  return blocks_.back().get();
+}
+
+}  // namespace base
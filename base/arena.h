@@ -0,0 +1,102 @@
+#ifndef BASE_ARENA_H
+#define BASE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+
+#include "std.h"
+
+namespace base {
+
+// A bump allocator that hands out memory from large blocks and frees it all
+// at once when it is destroyed. Not thread-safe; give each thread its own.
+//
+// Objects are usually put in an arena with MakeShared below. Their shared_ptrs
+// keep the arena alive, so the arena is released in bulk once the last of
+// them is gone.
+class Arena final : public std::enable_shared_from_this<Arena> {
+ public:
+  explicit Arena(size_t block_size = kDefaultBlockSize)
+      : block_size_(block_size) {}
+
+  // Returns size bytes aligned to align, which must be a power of two no
+  // larger than alignof(std::max_align_t).
+  void* Allocate(size_t size, size_t align) {
+    size_t offset = (used_ + align - 1) & ~(align - 1);
+    if (blocks_.empty() || offset + size > cur_size_) {
+      return AllocateSlow(size, align);
+    }
+    used_ = offset + size;
+    bytes_allocated_ += size;
+    return blocks_.back().get() + offset;
+  }
+
+  // Bytes handed out by Allocate, not counting alignment padding.
+  size_t BytesAllocated() const { return bytes_allocated_; }
+
+  // Bytes held in blocks, used or not.
+  size_t BytesReserved() const { return bytes_reserved_; }
+
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+
+  void* AllocateSlow(size_t size, size_t align);
+
+  size_t block_size_;
+  vector<uptr<u8[]>> blocks_;
+  size_t cur_size_ = 0;
+  size_t used_ = 0;
+  size_t bytes_allocated_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+// A standard allocator that takes memory from an arena and never gives it
+// back. Each copy holds a reference to the arena.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(sptr<Arena> arena) : arena_(std::move(arena)) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t n) {
+    return (T*)arena_->Allocate(n * sizeof(T), alignof(T));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena_;
+  }
+
+ private:
+  template <typename U>
+  friend class ArenaAllocator;
+
+  sptr<Arena> arena_;
+};
+
+// Constructs a T in arena, with its shared_ptr control block beside it. If
+// arena is null, this is make_shared. The arena must be owned by a shared_ptr.
+template <typename T, typename... Args>
+sptr<T> MakeShared(Arena* arena, Args&&... args) {
+  if (arena == nullptr) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena->shared_from_this()),
+                                 std::forward<Args>(args)...);
+}
+
+}  // namespace base
+
+#endif
@@ -0,0 +1,65 @@
+#include "base/arena.h"
+#include "gtest/gtest.h"
+
+namespace base {
+
+TEST(ArenaTest, AllocationsAreAlignedAndDisjoint) {
+  Arena arena(64);
+  vector<std::pair<uintptr_t, size_t>> spans;
+  for (size_t i = 1; i < 40; ++i) {
+    size_t align = (size_t)1 << (i % 4);
+    uintptr_t p = (uintptr_t)arena.Allocate(i, align);
+    EXPECT_EQ(0u, p % align) << i;
+    for (const auto& span : spans) {
+      EXPECT_TRUE(p + i <= span.first || span.first + span.second <= p) << i;
+    }
+    spans.push_back({p, i});
+  }
+  EXPECT_EQ(780u, arena.BytesAllocated());
+  EXPECT_GE(arena.BytesReserved(), arena.BytesAllocated());
+}
+
+TEST(ArenaTest, LargeAllocationGetsOwnBlock) {
+  Arena arena(64);
+  arena.Allocate(8, 8);
+  u8* big = (u8*)arena.Allocate(1000, 8);
+  big[999] = 1;
+  EXPECT_EQ(64u + 1000u, arena.BytesReserved());
+}
+
+struct Counted {
+  Counted(int* live, int value) : live(live), value(value) { ++*live; }
+  ~Counted() { --*live; }
+
+  int* live;
+  int value;
+};
+
+TEST(ArenaTest, MakeSharedKeepsArenaAlive) {
+  int live = 0;
+  sptr<Counted> a;
+  sptr<Counted> b;
+  {
+    sptr<Arena> arena = std::make_shared<Arena>();
+    a = MakeShared<Counted>(arena.get(), &live, 1);
+    b = MakeShared<Counted>(arena.get(), &live, 2);
+    EXPECT_GT(arena->BytesAllocated(), 2 * sizeof(Counted));
+  }
+  EXPECT_EQ(2, live);
+  EXPECT_EQ(1, a->value);
+  EXPECT_EQ(2, b->value);
+  a.reset();
+  EXPECT_EQ(1, live);
+  b.reset();
+  EXPECT_EQ(0, live);
+}
+
+TEST(ArenaTest, MakeSharedWithoutArena) {
+  int live = 0;
+  sptr<Counted> a = MakeShared<Counted>(nullptr, &live, 3);
+  EXPECT_EQ(3, a->value);
+  a.reset();
+  EXPECT_EQ(0, live);
+}
+
+}  // namespace base
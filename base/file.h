@@ -21,6 +21,12 @@ class File {
   // TODO: comment me.
   u8 At(int index) const;
 
+  // The file's bytes; valid while the file is. Not NUL-terminated.
+  const u8* Data() const { return buf_; }
+
+  // Returns a copy of the whole file.
+  string Contents() const { return string((const char*)buf_, len_); }
+
   // Converts a zero-based index to a zero-based line number and a zero-based
   // column number.  Takes time logarithmic in the size of the file.
   void IndexToLineCol(int offset, int* line_out, int* col_out) const;
@@ -10,24 +10,20 @@ bool FileSet::Builder::Build(FileSet** fs, ErrorList* errors) const {
   // TODO: for assignment 2+, we should report *which* file fails to load,
   // rather than just returning false.
 
-  // Take local snapshot.
-  vector<string> diskspecs = diskfiles_;
-  vector<pair<string, string>> stringspecs = stringfiles_;
-
   // Preallocate some space.
   vector<File*> files;
-  files.reserve(stringspecs.size() + diskspecs.size());
-
-  // Handle StringFiles first, because they can never fail.
-  for (auto stringspec : stringspecs) {
-    files.push_back(new StringFile(stringspec.first, stringspec.second));
-  }
+  files.reserve(specs_.size());
 
-  // Handle the DiskFiles, being careful to not leak memory when failing to read
+  // Load files in order, being careful to not leak memory when failing to read
   // a file.
-  for (auto path : diskspecs) {
+  for (const auto& spec : specs_) {
+    if (!spec.on_disk) {
+      files.push_back(new StringFile(spec.path, spec.contents));
+      continue;
+    }
+
     File* file = nullptr;
-    if (DiskFile::LoadFile(path, &file, errors)) {
+    if (DiskFile::LoadFile(spec.path, &file, errors)) {
       files.push_back(file);
     }
   }
@@ -16,19 +16,25 @@ class FileSet final {
   class Builder final {
    public:
     Builder& AddDiskFile(string path) {
-      diskfiles_.push_back(path);
+      specs_.push_back({true, path, ""});
       return *this;
     }
     Builder& AddStringFile(string path, string contents) {
-      stringfiles_.push_back(make_pair(path, contents));
+      specs_.push_back({false, path, contents});
       return *this;
     }
 
+    // Files are numbered in the order they were added, regardless of kind.
     bool Build(FileSet** fs, ErrorList* errors) const;
 
    private:
-    vector<string> diskfiles_;
-    vector<pair<string, string>> stringfiles_;
+    struct Spec {
+      bool on_disk;
+      string path;
+      string contents;
+    };
+
+    vector<Spec> specs_;
   };
 
   ~FileSet() {
@@ -78,4 +78,14 @@ TEST_F(FileSetTest, MultiEntry) {
   EXPECT_EQ("a.txt", file1->Basename());
 }
 
+TEST_F(FileSetTest, MixedEntriesKeepOrder) {
+  ASSERT_TRUE(FileSet::Builder()
+                  .AddDiskFile("base/testdata/a.txt")
+                  .AddStringFile("c.txt", "c")
+                  .Build(&fs, &errors));
+  EXPECT_EQ(2, fs->Size());
+  EXPECT_EQ("a.txt", fs->Get(0)->Basename());
+  EXPECT_EQ("c.txt", fs->Get(1)->Basename());
+}
+
 }  // namespace base
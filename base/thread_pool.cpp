@@ -0,0 +1,138 @@
+#include "base/thread_pool.h"
+
+#include <algorithm>
+
+using std::lock_guard;
+using std::mutex;
+using std::unique_lock;
+
+namespace base {
+
+ThreadPool::ThreadPool(int num_threads) : queues_(std::max(num_threads, 1)) {
+  // The thread calling ParallelFor acts as worker 0.
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    threads_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mu_);
+    shutdown_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t)>& fn) {
+  if (n == 0) {
+    return;
+  }
+
+  if (queues_.size() == 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  {
+    lock_guard<mutex> lock(mu_);
+    fn_ = &fn;
+    remaining_ = n;
+    error_ = nullptr;
+  }
+
+  // Deal out contiguous runs of tasks, so threads that never steal touch
+  // neighbouring inputs.
+  for (size_t i = 0; i < n; ++i) {
+    Queue& queue = queues_.at(i * queues_.size() / n);
+    lock_guard<mutex> lock(queue.mu);
+    queue.tasks.push_back(i);
+  }
+
+  {
+    lock_guard<mutex> lock(mu_);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  RunTasks(0);
+
+  std::exception_ptr error;
+  {
+    unique_lock<mutex> lock(mu_);
+    done_.wait(lock, [this] { return remaining_ == 0; });
+    fn_ = nullptr;
+    error = error_;
+    error_ = nullptr;
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool ThreadPool::TakeTask(size_t self, size_t* task) {
+  {
+    Queue& own = queues_.at(self);
+    lock_guard<mutex> lock(own.mu);
+    if (!own.tasks.empty()) {
+      *task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue& victim = queues_.at((self + i) % queues_.size());
+    lock_guard<mutex> lock(victim.mu);
+    if (!victim.tasks.empty()) {
+      *task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::RunTasks(size_t self) {
+  size_t task = 0;
+  while (TakeTask(self, &task)) {
+    std::exception_ptr error;
+    try {
+      (*fn_)(task);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock_guard<mutex> lock(mu_);
+    if (error && !error_) {
+      error_ = error;
+    }
+    --remaining_;
+    if (remaining_ == 0) {
+      done_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::WorkerLoop(size_t self) {
+  u64 seen = 0;
+  while (true) {
+    {
+      unique_lock<mutex> lock(mu_);
+      wake_.wait(lock, [&] { return shutdown_ || generation_ != seen; });
+      if (shutdown_) {
+        return;
+      }
+      seen = generation_;
+    }
+    RunTasks(self);
+  }
+}
+
+} // namespace base
@@ -0,0 +1,60 @@
+#ifndef BASE_THREAD_POOL_H
+#define BASE_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "std.h"
+
+namespace base {
+
+// A fixed set of threads that run batches of independent tasks. Each thread
+// owns a queue of task indices; it takes work from the front of its own queue
+// and, once that is empty, steals from the back of the others'.
+class ThreadPool {
+ public:
+  // Creates a pool that runs tasks on num_threads threads, including the
+  // thread calling ParallelFor. A pool of one thread runs everything inline.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  int NumThreads() const { return (int)queues_.size(); }
+
+  // Calls fn(0), ..., fn(n - 1) across the pool and returns once all of them
+  // have finished. If any call throws, the first exception is rethrown here
+  // after the remaining calls complete.
+  void ParallelFor(size_t n, const std::function<void(size_t)>& fn);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+  struct Queue {
+    std::mutex mu;
+    std::deque<size_t> tasks;
+  };
+
+  bool TakeTask(size_t self, size_t* task);
+  void RunTasks(size_t self);
+  void WorkerLoop(size_t self);
+
+  vector<Queue> queues_;
+  vector<std::thread> threads_;
+
+  // Guards everything below.
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t)>* fn_ = nullptr;
+  size_t remaining_ = 0;
+  u64 generation_ = 0;
+  bool shutdown_ = false;
+  std::exception_ptr error_;
+};
+
+} // namespace base
+
+#endif
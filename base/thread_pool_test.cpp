@@ -0,0 +1,69 @@
+#include <atomic>
+
+#include "base/thread_pool.h"
+#include "gtest/gtest.h"
+
+namespace base {
+
+TEST(ThreadPoolTest, RunsEachTaskOnce) {
+  ThreadPool pool(4);
+  vector<int> counts(1000, 0);
+  pool.ParallelFor(counts.size(), [&](size_t i) { ++counts[i]; });
+  for (int count : counts) {
+    EXPECT_EQ(1, count);
+  }
+}
+
+TEST(ThreadPoolTest, SingleThreadRunsInOrder) {
+  ThreadPool pool(1);
+  vector<size_t> order;
+  pool.ParallelFor(5, [&](size_t i) { order.push_back(i); });
+  EXPECT_EQ((vector<size_t>{0, 1, 2, 3, 4}), order);
+}
+
+TEST(ThreadPoolTest, NoTasks) {
+  ThreadPool pool(3);
+  bool called = false;
+  pool.ParallelFor(0, [&](size_t) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+TEST(ThreadPoolTest, ReusedAcrossBatches) {
+  ThreadPool pool(3);
+  std::atomic<int> sum(0);
+  for (int batch = 0; batch < 50; ++batch) {
+    pool.ParallelFor(batch, [&](size_t i) { sum += (int)i; });
+  }
+  int expected = 0;
+  for (int batch = 0; batch < 50; ++batch) {
+    expected += batch * (batch - 1) / 2;
+  }
+  EXPECT_EQ(expected, sum.load());
+}
+
+TEST(ThreadPoolTest, UnevenTasksAreStolen) {
+  ThreadPool pool(4);
+  std::atomic<int> done(0);
+  // The first thread's share is much slower; the others should finish it.
+  pool.ParallelFor(64, [&](size_t i) {
+    if (i < 16) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ++done;
+  });
+  EXPECT_EQ(64, done.load());
+}
+
+TEST(ThreadPoolTest, RethrowsTaskException) {
+  ThreadPool pool(4);
+  std::atomic<int> done(0);
+  EXPECT_THROW(pool.ParallelFor(100, [&](size_t i) {
+    ++done;
+    if (i == 37) {
+      throw std::logic_error("task failed");
+    }
+  }), std::logic_error);
+  EXPECT_EQ(100, done.load());
+}
+
+} // namespace base
@@ -0,0 +1,89 @@
+#include "benchmark/bench_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "base/file_walker.h"
+
+using std::cerr;
+using std::endl;
+
+namespace {
+
+std::atomic<u64> allocations(0);
+
+} // namespace
+
+void* operator new(size_t size) {
+  ++allocations;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+namespace benchmark {
+
+namespace {
+
+bool WalkJavaFiles(const string& dir, vector<string>* out) {
+  return base::WalkDir(dir, [&](const dirent& ent) {
+    string name = ent.d_name;
+    string path = dir + "/" + name;
+    if (ent.d_type == DT_DIR) {
+      return name == "." || name == ".." || WalkJavaFiles(path, out);
+    }
+    const string kSuffix = ".java";
+    if (name.size() > kSuffix.size() && name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) == 0) {
+      out->push_back(path);
+    }
+    return true;
+  });
+}
+
+} // namespace
+
+bool ParseArgs(int argc, char** argv, const char* usage, size_t min_args, size_t max_args, int* iters, vector<string>* args) {
+  *iters = 20;
+  int first = 1;
+  if (argc > 2 && string(argv[1]) == "-n") {
+    *iters = atoi(argv[2]);
+    first = 3;
+  }
+  size_t num_args = argc - first;
+  if (*iters < 1 || num_args < min_args || num_args > max_args) {
+    cerr << usage << endl;
+    return false;
+  }
+  args->assign(argv + first, argv + argc);
+  return true;
+}
+
+bool ListJavaFiles(const string& dir, vector<string>* out) {
+  vector<string> files;
+  if (!WalkJavaFiles(dir, &files) || files.empty()) {
+    cerr << "No .java files under " << dir << endl;
+    return false;
+  }
+  std::sort(files.begin(), files.end());
+  out->insert(out->end(), files.begin(), files.end());
+  return true;
+}
+
+u64 Allocations() {
+  return allocations;
+}
+
+} // namespace benchmark
@@ -0,0 +1,36 @@
+#ifndef BENCHMARK_BENCH_UTIL_H
+#define BENCHMARK_BENCH_UTIL_H
+
+#include <chrono>
+
+#include "std.h"
+
+namespace benchmark {
+
+// Parses a command line of the form "[-n ITERS] ARGS...", where ITERS
+// defaults to 20. Prints usage and returns false unless ITERS is positive and
+// there are between min_args and max_args ARGS.
+bool ParseArgs(int argc, char** argv, const char* usage, size_t min_args, size_t max_args, int* iters, vector<string>* args);
+
+// Appends every .java file under dir, recursively, to out in sorted order.
+// Prints an error and returns false if there are none.
+bool ListJavaFiles(const string& dir, vector<string>* out);
+
+// The number of times operator new has been called in this process. Linking
+// this library replaces the global operator new and delete to count them.
+u64 Allocations();
+
+// Returns the mean wall time of fn in milliseconds over iters calls.
+template <typename F>
+double TimeMs(int iters, F&& fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / iters;
+}
+
+} // namespace benchmark
+
+#endif
@@ -0,0 +1,227 @@
+// Measures keyword classification and whole-file lexing.
+//
+// usage: lexer_benchmark [-n ITERS] <stdlib dir>
+//
+// Lexes every .java file under the stdlib directory, and a synthetic corpus of
+// generated classes, with each lexer engine, reporting the mean time per pass.
+// Each identifier and keyword in the corpora is also classified both by
+// MatchKeyword and by the linear scan over TokenTypeInfo::kEntries that the
+// lexer used to do. Finally, the compiler's lexing of each file, which keeps
+// only significant tokens, is timed against lexing everything then stripping
+// whitespace and comments and looking for unsupported tokens, and the memory
+// its significant tokens take as a vector<Token> and as a TokenBuffer is
+// compared.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "base/errorlist.h"
+#include "base/fileset.h"
+#include "benchmark/bench_util.h"
+#include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+using base::ErrorList;
+using base::FileSet;
+using base::PosRange;
+using lexer::IDENTIFIER;
+using lexer::LexEngine;
+using lexer::Token;
+using lexer::TokenBuffer;
+using lexer::TokenType;
+using lexer::TokenTypeInfo;
+
+namespace {
+
+// Builds classes that look like typical Joos code: lots of short keywords,
+// identifiers that share prefixes with keywords, and a few comments.
+string SyntheticClass(int n) {
+  stringstream ss;
+  ss << "package synthetic;\n\n"
+     << "import java.util.Arrays;\n\n"
+     << "// Generated class " << n << ".\n"
+     << "public class Class" << n << " extends Object implements Cloneable {\n"
+     << "  protected int integer" << n << ";\n"
+     << "  public static boolean whileFlag = true;\n"
+     << "  public Class" << n << "() { integer" << n << " = " << n << "; }\n";
+  for (int i = 0; i < 20; ++i) {
+    ss << "  /* Method " << i << ". */\n"
+       << "  public final int method" << i << "(int forward, char classic, short newest) {\n"
+       << "    int returned = forward + " << i << ";\n"
+       << "    if (classic == 'x' && this.integer" << n << " != 0) { return returned; }\n"
+       << "    else { while (returned > newest) { returned = returned - 1; } }\n"
+       << "    Object instance = null;\n"
+       << "    if (instance instanceof String) { return 0; }\n"
+       << "    return returned;\n"
+       << "  }\n";
+  }
+  ss << "}\n";
+  return ss.str();
+}
+
+TokenType LinearMatchKeywords(const base::File* file, const PosRange& range) {
+  for (int i = 0; i < lexer::NUM_TOKEN_TYPES; ++i) {
+    const TokenTypeInfo& info = TokenTypeInfo::kEntries[i];
+    if (!info.IsKeyword()) {
+      continue;
+    }
+    const string& s = info.Value();
+    if ((int)s.size() != range.end - range.begin) {
+      continue;
+    }
+    bool matches = true;
+    for (u64 j = 0; j < s.size() && matches; ++j) {
+      matches = (u8)s[j] == file->At(range.begin + j);
+    }
+    if (matches) {
+      return info.Type();
+    }
+  }
+  return IDENTIFIER;
+}
+
+void Report(const string& name, const FileSet* fs, int iters) {
+  ErrorList errors;
+  vector<vector<Token>> tokens;
+  lexer::LexJoosFiles(fs, &tokens, &errors);
+  if (errors.IsFatal()) {
+    errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+    exit(1);
+  }
+
+  // Every identifier and keyword, as the lexer would classify them.
+  vector<PosRange> words;
+  u64 bytes = 0;
+  for (int i = 0; i < fs->Size(); ++i) {
+    bytes += fs->Get(i)->Size();
+    for (const Token& tok : tokens[i]) {
+      if (tok.type == IDENTIFIER || tok.TypeInfo().IsKeyword()) {
+        words.push_back(tok.pos);
+      }
+    }
+  }
+
+  u64 sink = 0;
+  double linear_ms = benchmark::TimeMs(iters, [&]() {
+    for (const PosRange& word : words) {
+      sink += LinearMatchKeywords(fs->Get(word.fileid), word);
+    }
+  });
+  double hash_ms = benchmark::TimeMs(iters, [&]() {
+    for (const PosRange& word : words) {
+      const base::File* file = fs->Get(word.fileid);
+      sink += lexer::MatchKeyword(file->Data() + word.begin, word.end - word.begin);
+    }
+  });
+  auto time_lex = [&](LexEngine engine) {
+    return benchmark::TimeMs(iters, [&]() {
+      ErrorList errors;
+      vector<vector<Token>> tokens;
+      lexer::LexJoosFiles(fs, &tokens, &errors, engine);
+      sink += tokens.size();
+    });
+  };
+  double states_ms = time_lex(LexEngine::STATE_FUNCTIONS);
+  double dfa_ms = time_lex(LexEngine::DFA);
+  double strip_ms = benchmark::TimeMs(iters, [&]() {
+    ErrorList errors;
+    for (int i = 0; i < fs->Size(); ++i) {
+      vector<Token> tokens;
+      vector<Token> stripped;
+      lexer::LexJoosFile(fs, fs->Get(i), i, &tokens, &errors, LexEngine::DFA);
+      lexer::StripSkippableTokens(tokens, &stripped);
+      lexer::FindUnsupportedTokens(tokens, &errors);
+      sink += stripped.size();
+    }
+  });
+  u64 significant = 0;
+  double significant_ms = benchmark::TimeMs(iters, [&]() {
+    ErrorList errors;
+    significant = 0;
+    for (int i = 0; i < fs->Size(); ++i) {
+      TokenBuffer tokens(i);
+      lexer::LexSignificantTokens(fs, fs->Get(i), i, &tokens, &errors, &errors, LexEngine::DFA);
+      significant += tokens.Size();
+    }
+  });
+  sink += significant;
+
+  cout << std::left << std::setw(12) << name
+       << std::right << std::setw(8) << fs->Size()
+       << std::setw(12) << bytes / 1024
+       << std::setw(10) << words.size()
+       << std::fixed << std::setprecision(3)
+       << std::setw(12) << linear_ms
+       << std::setw(10) << hash_ms
+       << std::setw(11) << states_ms
+       << std::setw(10) << dfa_ms
+       << std::setw(10) << std::setprecision(1) << (bytes / 1048576.0) / (dfa_ms / 1000)
+       << std::setprecision(3)
+       << std::setw(11) << strip_ms
+       << std::setw(9) << significant_ms
+       << std::setw(11) << significant * sizeof(Token) / 1024
+       << std::setw(11) << significant * TokenBuffer::kBytesPerToken / 1024 << '\n';
+  if (sink == 0) {
+    cerr << "nothing lexed" << endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* kUsage = "usage: lexer_benchmark [-n ITERS] <stdlib dir>";
+
+  int iters;
+  vector<string> args;
+  if (!benchmark::ParseArgs(argc, argv, kUsage, 1, 1, &iters, &args)) {
+    return 1;
+  }
+
+  vector<string> stdlib;
+  if (!benchmark::ListJavaFiles(args.at(0), &stdlib)) {
+    return 1;
+  }
+
+  ErrorList errors;
+  FileSet::Builder stdlib_builder;
+  for (const string& file : stdlib) {
+    stdlib_builder.AddDiskFile(file);
+  }
+  FileSet::Builder synthetic_builder;
+  for (int i = 0; i < 2000; ++i) {
+    synthetic_builder.AddStringFile("synthetic/Class" + std::to_string(i) + ".java", SyntheticClass(i));
+  }
+
+  FileSet* stdlib_fs = nullptr;
+  FileSet* synthetic_fs = nullptr;
+  if (!stdlib_builder.Build(&stdlib_fs, &errors) || !synthetic_builder.Build(&synthetic_fs, &errors)) {
+    cerr << errors;
+    return 1;
+  }
+  uptr<FileSet> stdlib_owner(stdlib_fs);
+  uptr<FileSet> synthetic_owner(synthetic_fs);
+
+  cout << std::left << std::setw(12) << "corpus"
+       << std::right << std::setw(8) << "files"
+       << std::setw(12) << "KiB"
+       << std::setw(10) << "words"
+       << std::setw(12) << "linear ms"
+       << std::setw(10) << "hash ms"
+       << std::setw(11) << "states ms"
+       << std::setw(10) << "dfa ms"
+       << std::setw(10) << "dfa MB/s"
+       << std::setw(11) << "strip ms"
+       << std::setw(9) << "1pass ms"
+       << std::setw(11) << "vec KiB"
+       << std::setw(11) << "buf KiB" << '\n';
+  Report("stdlib", stdlib_fs, iters);
+  Report("synthetic", synthetic_fs, std::max(1, iters / 10));
+
+  return 0;
+}
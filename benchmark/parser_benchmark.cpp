@@ -0,0 +1,158 @@
+// Measures parsing throughput.
+//
+// usage: parser_benchmark [-n ITERS] <stdlib dir>
+//
+// Lexes every .java file under the stdlib directory, and a synthetic corpus of
+// generated classes, then times parsing each corpus's tokens, reporting the
+// mean time per pass, tokens per second, and heap allocations per token, with
+// AST nodes allocated one by one and in a per-file arena.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "ast/ast.h"
+#include "base/errorlist.h"
+#include "base/fileset.h"
+#include "benchmark/bench_util.h"
+#include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
+#include "parser/parser.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+using base::ErrorList;
+using base::FileSet;
+using lexer::TokenBuffer;
+using parser::AstAllocation;
+
+namespace {
+
+// Builds classes whose bodies lean on the constructs the parser has to try
+// several ways: statements that start with a name, casts next to
+// parenthesised expressions, array types, and long operator chains.
+string SyntheticClass(int n) {
+  stringstream ss;
+  ss << "package synthetic;\n\n"
+     << "import java.util.Arrays;\n\n"
+     << "public class Class" << n << " extends Object {\n"
+     << "  protected int[] values;\n"
+     << "  public static int count = 0;\n"
+     << "  public Class" << n << "() { values = new int[" << n % 50 + 1 << "]; }\n";
+  for (int i = 0; i < 20; ++i) {
+    ss << "  public int method" << i << "(int a, Object o, java.lang.String s) {\n"
+       << "    int total = a * " << i << " + (a - 1) / 2 % 7;\n"
+       << "    Class" << n << " self = (Class" << n << ") o;\n"
+       << "    java.lang.String[] names = new java.lang.String[a];\n"
+       << "    for (int j = 0; j < values.length; j = j + 1) {\n"
+       << "      total = total + values[j] * (int) 'c' - self.values[j];\n"
+       << "      names[j] = s.substring(j, j + 1);\n"
+       << "    }\n"
+       << "    while (total > 100 && !(o instanceof Class" << n << ")) { total = total - (a + 3); }\n"
+       << "    self.values[0] = java.lang.Math.max(total, -a);\n"
+       << "    count = count + 1;\n"
+       << "    return total;\n"
+       << "  }\n";
+  }
+  ss << "}\n";
+  return ss.str();
+}
+
+void Report(const string& name, const FileSet* fs, int iters) {
+  ErrorList errors;
+  vector<TokenBuffer> tokens;
+  u64 count = 0;
+  for (int i = 0; i < fs->Size(); ++i) {
+    tokens.emplace_back(i);
+    lexer::LexSignificantTokens(fs, fs->Get(i), i, &tokens.back(), &errors, &errors);
+    count += tokens.back().Size();
+  }
+  if (errors.IsFatal()) {
+    errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+    exit(1);
+  }
+
+  cout << std::left << std::setw(12) << name
+       << std::right << std::setw(8) << fs->Size()
+       << std::setw(10) << count;
+
+  for (AstAllocation allocation : {AstAllocation::HEAP, AstAllocation::ARENA}) {
+    u64 parsed = 0;
+    u64 before = benchmark::Allocations();
+    double parse_ms = benchmark::TimeMs(iters, [&]() {
+      ErrorList errors;
+      for (int i = 0; i < fs->Size(); ++i) {
+        sptr<const ast::CompUnit> unit = parser::ParseFile(fs, i, tokens[i], &errors, allocation);
+        parsed += unit != nullptr;
+      }
+      if (errors.IsFatal()) {
+        errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+        exit(1);
+      }
+    });
+    double allocs_per_token = (double)(benchmark::Allocations() - before) / iters / count;
+    if (parsed != (u64)fs->Size() * iters) {
+      cerr << "not every file parsed" << endl;
+    }
+
+    cout << std::fixed << std::setprecision(3)
+         << std::setw(12) << parse_ms
+         << std::setprecision(2)
+         << std::setw(9) << count / (parse_ms * 1000)
+         << std::setw(12) << allocs_per_token;
+  }
+  cout << '\n';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* kUsage = "usage: parser_benchmark [-n ITERS] <stdlib dir>";
+
+  int iters;
+  vector<string> args;
+  if (!benchmark::ParseArgs(argc, argv, kUsage, 1, 1, &iters, &args)) {
+    return 1;
+  }
+
+  vector<string> stdlib;
+  if (!benchmark::ListJavaFiles(args.at(0), &stdlib)) {
+    return 1;
+  }
+
+  ErrorList errors;
+  FileSet::Builder stdlib_builder;
+  for (const string& file : stdlib) {
+    stdlib_builder.AddDiskFile(file);
+  }
+  FileSet::Builder synthetic_builder;
+  for (int i = 0; i < 500; ++i) {
+    synthetic_builder.AddStringFile("synthetic/Class" + std::to_string(i) + ".java", SyntheticClass(i));
+  }
+
+  FileSet* stdlib_fs = nullptr;
+  FileSet* synthetic_fs = nullptr;
+  if (!stdlib_builder.Build(&stdlib_fs, &errors) || !synthetic_builder.Build(&synthetic_fs, &errors)) {
+    cerr << errors;
+    return 1;
+  }
+  uptr<FileSet> stdlib_owner(stdlib_fs);
+  uptr<FileSet> synthetic_owner(synthetic_fs);
+
+  cout << std::left << std::setw(12) << "corpus"
+       << std::right << std::setw(8) << "files"
+       << std::setw(10) << "tokens"
+       << std::setw(12) << "heap ms"
+       << std::setw(9) << "Mtok/s"
+       << std::setw(12) << "allocs/tok"
+       << std::setw(12) << "arena ms"
+       << std::setw(9) << "Mtok/s"
+       << std::setw(12) << "allocs/tok" << '\n';
+  Report("stdlib", stdlib_fs, iters);
+  Report("synthetic", synthetic_fs, std::max(1, iters / 10));
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Measures how much a stdlib snapshot saves on each compile.
+//
+// usage: snapshot_benchmark [-n ITERS] <stdlib dir> <filename>...
+//
+// Writes a snapshot of every .java file under the stdlib directory, then
+// compiles the given files against the stdlib both from source and from the
+// snapshot, reporting the mean time per compile for each.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "benchmark/bench_util.h"
+#include "joosc.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+namespace {
+
+// Returns the mean wall time of a compile in milliseconds.
+double TimeCompile(CompilerStage stage, const vector<string>& files, const CompilerOptions& opts, int iters) {
+  std::stringstream sink;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; ++i) {
+    if (!CompilerMain(stage, files, &sink, &sink, opts)) {
+      cerr << sink.str();
+      exit(1);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() / iters;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* kUsage = "usage: snapshot_benchmark [-n ITERS] <stdlib dir> <filename>...";
+
+  int iters;
+  vector<string> args;
+  if (!benchmark::ParseArgs(argc, argv, kUsage, 2, argc, &iters, &args)) {
+    return 1;
+  }
+
+  vector<string> stdlib;
+  if (!benchmark::ListJavaFiles(args.at(0), &stdlib)) {
+    return 1;
+  }
+
+  vector<string> user_files(args.begin() + 1, args.end());
+  vector<string> all_files = user_files;
+  all_files.insert(all_files.end(), stdlib.begin(), stdlib.end());
+
+  const char* tmpdir = getenv("TMPDIR");
+  CompilerOptions emit;
+  emit.emit_snapshot = string(tmpdir == nullptr ? "/tmp" : tmpdir) + "/snapshot_benchmark.snap";
+  double emit_ms = TimeCompile(CompilerStage::ALL, stdlib, emit, 1);
+
+  CompilerOptions from_source;
+  CompilerOptions from_snapshot;
+  from_snapshot.snapshot = emit.emit_snapshot;
+
+  cout << "snapshot of " << stdlib.size() << " files written in "
+       << std::fixed << std::setprecision(2) << emit_ms << " ms\n\n";
+  cout << std::left << std::setw(12) << "stage"
+       << std::right << std::setw(12) << "source ms"
+       << std::setw(14) << "snapshot ms"
+       << std::setw(12) << "saved ms" << '\n';
+
+  const pair<CompilerStage, const char*> stages[] = {
+    {CompilerStage::WEED, "weed"},
+    {CompilerStage::TYPE_CHECK, "type_check"},
+    {CompilerStage::GEN_IR, "gen_ir"},
+  };
+  for (const auto& stage : stages) {
+    double source_ms = TimeCompile(stage.first, all_files, from_source, iters);
+    double snapshot_ms = TimeCompile(stage.first, user_files, from_snapshot, iters);
+    cout << std::left << std::setw(12) << stage.second
+         << std::right << std::setw(12) << source_ms
+         << std::setw(14) << snapshot_ms
+         << std::setw(12) << source_ms - snapshot_ms << '\n';
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+// Measures the cost of dispatching a visitor over an AST.
+//
+// usage: visitor_benchmark [-n ITERS] <dir>...
+//
+// Parses every .java file under the given directories into one program, then
+// times a traversal that does nothing at each node, first with a Visitor,
+// which dispatches every node through the virtual Accept and Rewrite##type,
+// then with a StaticVisitor, which switches on the node kind. The difference
+// is the most that moving a pass to StaticVisitor can save on that program.
+
+#include <iomanip>
+#include <iostream>
+
+#include "ast/ast.h"
+#include "ast/static_visitor.h"
+#include "base/errorlist.h"
+#include "base/fileset.h"
+#include "benchmark/bench_util.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+
+using std::cerr;
+using std::cout;
+
+using ast::Program;
+using ast::Visitor;
+using base::ErrorList;
+using base::FileSet;
+
+namespace {
+
+class NoopStaticVisitor final : public ast::StaticVisitor<NoopStaticVisitor> {};
+
+void Report(const string& name, u64 nodes, double ms) {
+  cout << std::left << std::setw(12) << name
+       << std::right << std::fixed << std::setprecision(3)
+       << std::setw(10) << ms
+       << std::setw(10) << nodes
+       << std::setw(10) << ms * 1e6 / nodes << '\n';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* kUsage = "usage: visitor_benchmark [-n ITERS] <dir>...";
+
+  int iters;
+  vector<string> args;
+  if (!benchmark::ParseArgs(argc, argv, kUsage, 1, 1000, &iters, &args)) {
+    return 1;
+  }
+
+  vector<string> files;
+  for (const string& dir : args) {
+    if (!benchmark::ListJavaFiles(dir, &files)) {
+      return 1;
+    }
+  }
+
+  ErrorList errors;
+  FileSet::Builder builder;
+  for (const string& file : files) {
+    builder.AddDiskFile(file);
+  }
+  FileSet* fs = nullptr;
+  if (!builder.Build(&fs, &errors)) {
+    cerr << errors;
+    return 1;
+  }
+  uptr<FileSet> fs_owner(fs);
+
+  vector<vector<lexer::Token>> tokens;
+  lexer::LexJoosFiles(fs, &tokens, &errors);
+  vector<vector<lexer::Token>> significant;
+  lexer::StripSkippableTokens(tokens, &significant);
+  sptr<const Program> prog = parser::Parse(fs, significant, &errors);
+  if (errors.IsFatal()) {
+    errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+    return 1;
+  }
+
+  u64 nodes = 0;
+  double virtual_ms = benchmark::TimeMs(iters, [&]() {
+    Visitor visitor;
+    visitor.Visit(prog);
+    nodes = visitor.GetRewriteStats().nodes;
+  });
+  double static_ms = benchmark::TimeMs(iters, [&]() {
+    NoopStaticVisitor visitor;
+    visitor.Visit(prog);
+  });
+
+  cout << std::left << std::setw(12) << "dispatch"
+       << std::right << std::setw(10) << "ms"
+       << std::setw(10) << "nodes"
+       << std::setw(10) << "ns/node" << '\n';
+  Report("virtual", nodes, virtual_ms);
+  Report("static", nodes, static_ms);
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+// Measures the weeder.
+//
+// usage: weeder_benchmark [-n ITERS] <stdlib dir>
+//
+// Parses every .java file under the stdlib directory, and a synthetic corpus
+// of generated classes, then times each weeder pass over each corpus. For
+// every pass it reports the mean time, the nodes and non-empty child lists it
+// visited, how many of those it had to copy, and the heap allocations it made.
+// It then compares the passes' total with WeedProgram, which runs them all in
+// one traversal.
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <tuple>
+
+#include "ast/ast.h"
+#include "base/errorlist.h"
+#include "base/fileset.h"
+#include "benchmark/bench_util.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "weeder/assignment_visitor.h"
+#include "weeder/call_visitor.h"
+#include "weeder/int_range_visitor.h"
+#include "weeder/modifier_visitor.h"
+#include "weeder/structure_visitor.h"
+#include "weeder/type_visitor.h"
+#include "weeder/weeder.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+using ast::Program;
+using ast::Visitor;
+using base::ErrorList;
+using base::FileSet;
+
+namespace {
+
+// Builds classes with plenty of what the weeder looks at: modifiers, casts,
+// calls, assignments, integer literals and nested blocks.
+string SyntheticClass(int n) {
+  stringstream ss;
+  ss << "package synthetic;\n\n"
+     << "public class Class" << n << " extends Object {\n"
+     << "  protected int[] values;\n"
+     << "  public static int count = 0;\n"
+     << "  public Class" << n << "() { values = new int[" << n % 50 + 1 << "]; }\n";
+  for (int i = 0; i < 20; ++i) {
+    ss << "  public int method" << i << "(int a, Object o, java.lang.String s) {\n"
+       << "    int total = a * " << i << " + (a - 1) / 2 % 7 + -2147483648;\n"
+       << "    Class" << n << " self = (Class" << n << ") o;\n"
+       << "    java.lang.String[] names = new java.lang.String[a];\n"
+       << "    for (int j = 0; j < values.length; j = j + 1) {\n"
+       << "      total = total + values[j] * (int) 'c' - self.values[j];\n"
+       << "      names[j] = s.substring(j, j + 1);\n"
+       << "    }\n"
+       << "    while (total > 100 && !(o instanceof Class" << n << ")) { total = total - (a + 3); }\n"
+       << "    if (a > 0) { self.values[0] = java.lang.Math.max(total, -a); } else { count = count + 1; }\n"
+       << "    return total;\n"
+       << "  }\n";
+  }
+  ss << "}\n";
+  return ss.str();
+}
+
+struct Pass {
+  string name;
+  std::function<uptr<Visitor>(const FileSet*, ErrorList*)> make;
+};
+
+template <typename T>
+Pass MakePass(const string& name) {
+  return {name, [](const FileSet*, ErrorList* errors) { return uptr<Visitor>(new T(errors)); }};
+}
+
+template <typename T>
+Pass MakeFsPass(const string& name) {
+  return {name, [](const FileSet* fs, ErrorList* errors) { return uptr<Visitor>(new T(fs, errors)); }};
+}
+
+void Report(const string& corpus, const FileSet* fs, int iters) {
+  ErrorList errors;
+  vector<vector<lexer::Token>> tokens;
+  lexer::LexJoosFiles(fs, &tokens, &errors);
+  vector<vector<lexer::Token>> significant;
+  lexer::StripSkippableTokens(tokens, &significant);
+  sptr<const Program> prog = parser::Parse(fs, significant, &errors);
+  if (errors.IsFatal()) {
+    errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+    exit(1);
+  }
+
+  const vector<Pass> passes = {
+    MakePass<weeder::AssignmentVisitor>("assignment"),
+    MakePass<weeder::CallVisitor>("call"),
+    MakePass<weeder::TypeVisitor>("type"),
+    MakePass<weeder::ModifierVisitor>("modifier"),
+    MakeFsPass<weeder::IntRangeVisitor>("int_range"),
+    MakeFsPass<weeder::StructureVisitor>("structure"),
+  };
+
+  double total_ms = 0;
+  u64 total_allocs = 0;
+  for (const Pass& pass : passes) {
+    Visitor::RewriteStats stats;
+    u64 before = benchmark::Allocations();
+    double ms = benchmark::TimeMs(iters, [&]() {
+      ErrorList pass_errors;
+      uptr<Visitor> visitor = pass.make(fs, &pass_errors);
+      sptr<const Program> out = visitor->Rewrite(prog);
+      stats = visitor->GetRewriteStats();
+    });
+    u64 allocs = (benchmark::Allocations() - before) / iters;
+    total_ms += ms;
+    total_allocs += allocs;
+
+    cout << std::left << std::setw(12) << corpus
+         << std::setw(12) << pass.name
+         << std::right << std::fixed << std::setprecision(3)
+         << std::setw(10) << ms
+         << std::setw(10) << stats.nodes
+         << std::setw(10) << stats.nodes_rebuilt
+         << std::setw(10) << stats.lists
+         << std::setw(10) << stats.lists_rebuilt
+         << std::setw(10) << stats.AllocationsSaved()
+         << std::setw(10) << allocs << '\n';
+  }
+
+  u64 before = benchmark::Allocations();
+  double fused_ms = benchmark::TimeMs(iters, [&]() {
+    ErrorList weed_errors;
+    sptr<const Program> out = weeder::WeedProgram(fs, prog, &weed_errors);
+    if (weed_errors.IsFatal()) {
+      weed_errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
+      exit(1);
+    }
+  });
+  u64 fused_allocs = (benchmark::Allocations() - before) / iters;
+
+  for (const auto& row : {std::make_tuple("all passes", total_ms, total_allocs), std::make_tuple("WeedProgram", fused_ms, fused_allocs)}) {
+    cout << std::left << std::setw(12) << corpus
+         << std::setw(12) << std::get<0>(row)
+         << std::right << std::fixed << std::setprecision(3)
+         << std::setw(10) << std::get<1>(row)
+         << std::setw(60) << std::get<2>(row) << '\n';
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const char* kUsage = "usage: weeder_benchmark [-n ITERS] <stdlib dir>";
+
+  int iters;
+  vector<string> args;
+  if (!benchmark::ParseArgs(argc, argv, kUsage, 1, 1, &iters, &args)) {
+    return 1;
+  }
+
+  vector<string> stdlib;
+  if (!benchmark::ListJavaFiles(args.at(0), &stdlib)) {
+    return 1;
+  }
+
+  ErrorList errors;
+  FileSet::Builder stdlib_builder;
+  for (const string& file : stdlib) {
+    stdlib_builder.AddDiskFile(file);
+  }
+  FileSet::Builder synthetic_builder;
+  for (int i = 0; i < 500; ++i) {
+    synthetic_builder.AddStringFile("synthetic/Class" + std::to_string(i) + ".java", SyntheticClass(i));
+  }
+
+  FileSet* stdlib_fs = nullptr;
+  FileSet* synthetic_fs = nullptr;
+  if (!stdlib_builder.Build(&stdlib_fs, &errors) || !synthetic_builder.Build(&synthetic_fs, &errors)) {
+    cerr << errors;
+    return 1;
+  }
+  uptr<FileSet> stdlib_owner(stdlib_fs);
+  uptr<FileSet> synthetic_owner(synthetic_fs);
+
+  cout << std::left << std::setw(12) << "corpus"
+       << std::setw(12) << "pass"
+       << std::right << std::setw(10) << "ms"
+       << std::setw(10) << "nodes"
+       << std::setw(10) << "rebuilt"
+       << std::setw(10) << "lists"
+       << std::setw(10) << "copied"
+       << std::setw(10) << "saved"
+       << std::setw(10) << "allocs" << '\n';
+  Report("stdlib", stdlib_fs, iters);
+  Report("synthetic", synthetic_fs, std::max(1, iters / 10));
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include "compile_server.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "ast/ast.h"
+#include "base/errorlist.h"
+#include "base/file.h"
+#include "runtime/runtime.h"
+#include "snapshot/snapshot.h"
+#include "snapshot/unit_cache.h"
+#include "types/type_info_map.h"
+#include "types/typeset.h"
+
+using std::ostream;
+
+using ast::CompUnit;
+using ast::Program;
+using base::ErrorList;
+using base::FileSet;
+using types::ConstStringMap;
+using types::TypeInfoMap;
+using types::TypeSet;
+
+namespace {
+
+// How long to wait for an editor to finish a burst of writes before
+// recompiling.
+const int kSettleMillis = 50;
+
+} // namespace
+
+// Keeps the weeded unit of each file id along with the contents it was built
+// from. Anything it does not have is looked up in the fallback, normally the
+// snapshot.
+class CompileServer::Cache final : public snapshot::UnitCache {
+ public:
+  Cache(const snapshot::UnitCache* fallback) : fallback_(fallback) {}
+
+  // Sets the contents of the files about to be compiled.
+  void Begin(const vector<string>* contents) {
+    contents_ = contents;
+    misses_ = 0;
+  }
+
+  int Misses() const { return misses_; }
+
+  sptr<const CompUnit> Lookup(const FileSet& fs, int fileid) const override {
+    auto iter = entries_.find(fileid);
+    if (iter != entries_.end() && iter->second.contents == contents_->at(fileid)) {
+      return iter->second.unit;
+    }
+
+    sptr<const CompUnit> unit;
+    if (fallback_ != nullptr) {
+      unit = fallback_->Lookup(fs, fileid);
+    }
+    if (unit == nullptr) {
+      ++misses_;
+    }
+    return unit;
+  }
+
+  void Store(const FileSet&, int fileid, sptr<const CompUnit> unit) override {
+    entries_[fileid] = {contents_->at(fileid), unit};
+  }
+
+ private:
+  struct Entry {
+    string contents;
+    sptr<const CompUnit> unit;
+  };
+
+  const snapshot::UnitCache* fallback_;
+  const vector<string>* contents_ = nullptr;
+  map<int, Entry> entries_;
+  mutable std::atomic<int> misses_{0};
+};
+
+CompileServer::CompileServer(const vector<string>& files, const CompilerOptions& opts, const string& output_dir)
+    : files_(files), opts_(opts), output_dir_(output_dir), pool_(opts.num_threads) {}
+
+CompileServer::~CompileServer() = default;
+
+bool CompileServer::Init(ostream* err) {
+  if (!opts_.snapshot.empty() && !LoadSnapshot(opts_.snapshot, &snapshot_, err)) {
+    return false;
+  }
+  cache_.reset(new Cache(snapshot_.get()));
+  return true;
+}
+
+bool CompileServer::Compile(ostream* err) {
+  CHECK(cache_ != nullptr);
+  auto start = std::chrono::steady_clock::now();
+
+  FileSet* fs = nullptr;
+  if (!OpenFiles(files_, snapshot_.get(), &fs, err)) {
+    last_contents_.clear();
+    return false;
+  }
+  uptr<FileSet> fs_deleter(fs);
+
+  vector<string> contents;
+  for (int i = 0; i < fs->Size(); ++i) {
+    contents.push_back(fs->Get(i)->Contents());
+  }
+  if (contents == last_contents_) {
+    *err << "joosc: no changes" << std::endl;
+    return last_success_;
+  }
+  last_contents_ = contents;
+  cache_->Begin(&last_contents_);
+
+  ErrorList errors;
+  TypeInfoMap tinfo_map = TypeInfoMap::Empty();
+  TypeSet typeset = TypeSet::Empty();
+  ConstStringMap string_map;
+  sptr<const Program> program = CompilerFrontend(CompilerStage::ALL, fs, opts_, &typeset, &tinfo_map, &string_map, &errors, &pool_, cache_.get(), &typecheck_cache_);
+  if (errors.Size() > 0) {
+    errors.PrintTo(err, base::OutputOptions::kUserOutput, fs);
+  }
+
+  bool success = !errors.IsFatal();
+  if (success) {
+    success = CompilerBackend(CompilerStage::ALL, std::move(program), output_dir_, typeset, tinfo_map, string_map, *fs, runtime::kNumRuntimeFiles, err, &outputs_);
+  }
+  last_success_ = success;
+
+  auto end = std::chrono::steady_clock::now();
+  *err << "joosc: " << (success ? "compiled " : "failed ") << fs->Size()
+       << " files (" << cache_->Misses() << " parsed, "
+       << typecheck_cache_.NumChecked() << " typechecked) in "
+       << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+       << " ms" << std::endl;
+  return success;
+}
+
+bool CompileServer::Watch(ostream* err) {
+  int fd = inotify_init1(IN_CLOEXEC);
+  if (fd == -1) {
+    *err << "joosc: could not watch files: " << strerror(errno) << std::endl;
+    return false;
+  }
+
+  // Editors often replace a file rather than writing it in place, so watch
+  // each file's directory and filter by name.
+  map<int, string> dirs;
+  set<pair<string, string>> watched;
+  for (const string& file : files_) {
+    string dir = base::Dirname(file);
+    if (dir.empty()) {
+      dir = file.compare(0, 1, "/") == 0 ? "/" : ".";
+    }
+    watched.insert({dir, base::Basename(file)});
+
+    int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+    if (wd == -1) {
+      *err << "joosc: could not watch " << dir << ": " << strerror(errno) << std::endl;
+      close(fd);
+      return false;
+    }
+    dirs[wd] = dir;
+  }
+
+  // Reads the queued events, noting in *relevant whether any of them touched
+  // one of our files. Returns false if the events could not be read.
+  auto read_events = [&](bool* relevant) {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len;
+    do {
+      len = read(fd, buf, sizeof(buf));
+    } while (len == -1 && errno == EINTR);
+    if (len == -1) {
+      *err << "joosc: could not watch files: " << strerror(errno) << std::endl;
+      return false;
+    }
+    for (ssize_t pos = 0; pos < len;) {
+      const struct inotify_event* event = (const struct inotify_event*)(buf + pos);
+      if (event->len > 0 && watched.count({dirs[event->wd], event->name}) == 1) {
+        *relevant = true;
+      }
+      pos += sizeof(struct inotify_event) + event->len;
+    }
+    return true;
+  };
+
+  while (true) {
+    Compile(err);
+
+    // Block until one of our files changes, then let the burst of writes
+    // settle.
+    bool relevant = false;
+    while (!relevant) {
+      if (!read_events(&relevant)) {
+        close(fd);
+        return false;
+      }
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (poll(&pfd, 1, kSettleMillis) > 0) {
+      if (!read_events(&relevant)) {
+        close(fd);
+        return false;
+      }
+    }
+  }
+}
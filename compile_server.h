@@ -0,0 +1,51 @@
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include "joosc.h"
+#include "types/incremental.h"
+
+// A resident compiler for the edit-compile-test loop. It keeps the weeded
+// units of every file it has compiled, keyed by file contents, so a recompile
+// only lexes, parses, and weeds the files that changed. Typechecking is redone
+// only for those files and files depending on a declaration that changed. It
+// also remembers what it last wrote to the output directory and rewrites only
+// files whose assembly changed.
+class CompileServer final {
+ public:
+  CompileServer(const vector<string>& files, const CompilerOptions& opts, const string& output_dir);
+  ~CompileServer();
+
+  // Loads the snapshot named in the options, if any. Must succeed before
+  // Compile or Watch are used.
+  bool Init(std::ostream* err);
+
+  // Compiles the files as they are now on disk. If no file has changed since
+  // the last call, the previous result is returned without doing any work.
+  bool Compile(std::ostream* err);
+
+  // Compiles, then recompiles each time one of the files is written, until the
+  // process is killed. Returns false only if the files cannot be watched, or
+  // reading the changes fails.
+  bool Watch(std::ostream* err);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(CompileServer);
+
+  class Cache;
+
+  const vector<string> files_;
+  const CompilerOptions opts_;
+  const string output_dir_;
+
+  uptr<snapshot::Snapshot> snapshot_;
+  uptr<Cache> cache_;
+  types::TypecheckCache typecheck_cache_;
+  OutputCache outputs_;
+  base::ThreadPool pool_;
+
+  // The contents of every file at the last compile, and its result.
+  vector<string> last_contents_;
+  bool last_success_ = false;
+};
+
+#endif
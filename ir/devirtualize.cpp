@@ -0,0 +1,149 @@
+#include "ir/devirtualize.h"
+
+#include "lexer/lexer.h"
+
+using ast::MethodId;
+using ast::TypeId;
+using ast::TypeKind;
+using types::MethodInfo;
+using types::TypeInfo;
+using types::TypeInfoMap;
+
+namespace ir {
+
+namespace {
+
+class CallResolver {
+ public:
+  CallResolver(const TypeInfoMap& tinfo_map) : tinfo_map_(tinfo_map) {
+    for (const auto& t_pair : tinfo_map.GetTypeMap()) {
+      const TypeInfo& tinfo = t_pair.second;
+      for (const auto& m_pair : tinfo.methods.GetMethodMap()) {
+        const MethodInfo& minfo = m_pair.second;
+        if (minfo.class_type == tinfo.type) {
+          decls_.insert({minfo.mid, &minfo});
+        }
+      }
+
+      bool instantiable =
+          tinfo.kind == TypeKind::CLASS &&
+          !tinfo.mods.HasModifier(lexer::ABSTRACT);
+      if (instantiable) {
+        classes_.push_back(&tinfo);
+      }
+    }
+  }
+
+  // Returns the only method that a dynamic call to mid can reach, or nullptr
+  // if there is more than one.
+  const MethodInfo* Resolve(MethodId mid) {
+    auto cached = cache_.find(mid);
+    if (cached != cache_.end()) {
+      return cached->second;
+    }
+
+    const MethodInfo* result = ResolveImpl(mid);
+    cache_.insert({mid, result});
+    return result;
+  }
+
+ private:
+  const MethodInfo* ResolveImpl(MethodId mid) {
+    auto decl_iter = decls_.find(mid);
+    if (decl_iter == decls_.end()) {
+      return nullptr;
+    }
+    const MethodInfo& decl = *decl_iter->second;
+    TypeId owner = decl.class_type;
+
+    // Collect the body each instantiable receiver would dispatch to. Arrays
+    // dispatch like Object, which is itself instantiable.
+    map<MethodId, const MethodInfo*> targets;
+    for (const TypeInfo* tinfo : classes_) {
+      if (tinfo->type != owner && !tinfo_map_.IsAncestor(tinfo->type, owner)) {
+        continue;
+      }
+
+      const MethodInfo& impl = tinfo->methods.LookupMethod(decl.signature);
+      if (impl.mid == ast::kErrorMethodId) {
+        return nullptr;
+      }
+      targets.insert({impl.mid, &impl});
+    }
+
+    if (targets.size() != 1) {
+      return nullptr;
+    }
+
+    const MethodInfo* target = targets.begin()->second;
+    if (tinfo_map_.LookupTypeInfo(target->class_type).kind != TypeKind::CLASS) {
+      return nullptr;
+    }
+    return target;
+  }
+
+  const TypeInfoMap& tinfo_map_;
+  map<MethodId, const MethodInfo*> decls_;
+  vector<const TypeInfo*> classes_;
+  map<MethodId, const MethodInfo*> cache_;
+};
+
+void DevirtualizeStream(CallResolver* resolver, Stream* stream) {
+  vector<Op> ops;
+  for (const Op& op : stream->ops) {
+    if (op.type != OpType::DYNAMIC_CALL) {
+      ops.push_back(op);
+      continue;
+    }
+
+    // (Mem, Mem, MethodId, int file_offset, int nargs, Mem[]).
+    vector<u64> args(stream->args.begin() + op.begin, stream->args.begin() + op.end);
+    MethodId mid = args.at(2);
+    const MethodInfo* target = resolver->Resolve(mid);
+    if (target == nullptr) {
+      ops.push_back(op);
+      continue;
+    }
+
+    MemId this_ptr = args.at(1);
+    u64 file_offset = args.at(3);
+
+    // (Mem, int file_offset).
+    {
+      size_t begin = stream->args.size();
+      stream->args.push_back(this_ptr);
+      stream->args.push_back(file_offset);
+      ops.push_back({OpType::CHECK_NULL, begin, stream->args.size(), op.inline_site});
+    }
+
+    // (Mem, TypeId::Base, MethodId, int file_offset, int nargs, Mem[]).
+    {
+      size_t begin = stream->args.size();
+      stream->args.push_back(args.at(0));
+      stream->args.push_back(target->class_type.base);
+      stream->args.push_back(target->mid);
+      stream->args.push_back(file_offset);
+      stream->args.push_back(args.at(4) + 1);
+      stream->args.push_back(this_ptr);
+      stream->args.insert(stream->args.end(), args.begin() + 5, args.end());
+      ops.push_back({OpType::STATIC_CALL, begin, stream->args.size(), op.inline_site});
+    }
+  }
+
+  stream->ops = ops;
+}
+
+} // namespace
+
+void Devirtualize(const TypeInfoMap& tinfo_map, Program* prog) {
+  CallResolver resolver(tinfo_map);
+  for (CompUnit& unit : prog->units) {
+    for (Type& type : unit.types) {
+      for (Stream& stream : type.streams) {
+        DevirtualizeStream(&resolver, &stream);
+      }
+    }
+  }
+}
+
+} // namespace ir
@@ -0,0 +1,18 @@
+#ifndef IR_DEVIRTUALIZE_H
+#define IR_DEVIRTUALIZE_H
+
+#include "ir/mem.h"
+#include "ir/stream.h"
+#include "types/type_info_map.h"
+
+namespace ir {
+
+// Whole-program class-hierarchy analysis. Rewrites each DYNAMIC_CALL that can
+// only ever reach one method body, across every instantiable class in the
+// program, into a CHECK_NULL of the receiver followed by a STATIC_CALL with
+// the receiver as its first argument.
+void Devirtualize(const types::TypeInfoMap& tinfo_map, Program* prog);
+
+} // namespace ir
+
+#endif
@@ -0,0 +1,337 @@
+#include "ir/inliner.h"
+
+#include "lexer/lexer.h"
+
+using ast::MethodId;
+using ast::TypeId;
+using types::MethodInfo;
+using types::TypeInfo;
+using types::TypeInfoMap;
+
+namespace ir {
+
+namespace {
+
+// Callees whose bodies cost more than this are never inlined.
+const u64 kMaxCalleeCost = 24;
+
+// Inlining into a stream stops once it has grown to this many ops.
+const size_t kMaxCallerOps = 4000;
+
+// Returns the positions in an op's args that hold MemIds.
+vector<size_t> MemArgs(const Op& op) {
+  switch (op.type) {
+    case OpType::ALLOC_MEM:
+    case OpType::DEALLOC_MEM:
+    case OpType::ALLOC_HEAP:
+    case OpType::CONST:
+    case OpType::CONST_STR:
+    case OpType::CAST_EXCEPTION_IF_FALSE:
+    case OpType::CHECK_NULL:
+      return {0};
+    case OpType::ALLOC_ARRAY:
+      return {0, 2};
+    case OpType::MOV:
+    case OpType::MOV_ADDR:
+    case OpType::MOV_TO_ADDR:
+    case OpType::FIELD_DEREF:
+    case OpType::FIELD_ADDR:
+    case OpType::NOT:
+    case OpType::NEG:
+    case OpType::EXTEND:
+    case OpType::TRUNCATE:
+    case OpType::INSTANCE_OF:
+    case OpType::CHECK_ARRAY_STORE:
+      return {0, 1};
+    case OpType::ARRAY_DEREF:
+    case OpType::ARRAY_ADDR:
+    case OpType::ADD:
+    case OpType::SUB:
+    case OpType::MUL:
+    case OpType::DIV:
+    case OpType::MOD:
+    case OpType::LT:
+    case OpType::LEQ:
+    case OpType::EQ:
+    case OpType::AND:
+    case OpType::OR:
+    case OpType::XOR:
+      return {0, 1, 2};
+    case OpType::JMP_IF:
+      return {1};
+    case OpType::LABEL:
+    case OpType::JMP:
+      return {};
+    case OpType::RET:
+      if (op.end - op.begin == 1) {
+        return {0};
+      }
+      return {};
+    case OpType::STATIC_CALL:
+    case OpType::DYNAMIC_CALL: {
+      vector<size_t> positions = {0};
+      if (op.type == OpType::DYNAMIC_CALL) {
+        positions.push_back(1);
+      }
+      for (size_t i = 5; i < op.end - op.begin; ++i) {
+        positions.push_back(i);
+      }
+      return positions;
+    }
+  }
+  UNREACHABLE();
+}
+
+bool IsLabelOp(OpType type) {
+  return type == OpType::LABEL || type == OpType::JMP || type == OpType::JMP_IF;
+}
+
+bool IsCallOp(OpType type) {
+  return type == OpType::STATIC_CALL || type == OpType::DYNAMIC_CALL;
+}
+
+// Bookkeeping ops cost nothing once the backend has laid out the frame.
+u64 CostOf(const Stream& stream) {
+  u64 cost = 0;
+  for (const Op& op : stream.ops) {
+    if (op.type != OpType::ALLOC_MEM && op.type != OpType::DEALLOC_MEM && op.type != OpType::LABEL) {
+      ++cost;
+    }
+  }
+  return cost;
+}
+
+map<MemId, SizeClass> SizesOf(const Stream& stream) {
+  map<MemId, SizeClass> sizes;
+  for (size_t i = 0; i < stream.params.size(); ++i) {
+    sizes.insert({i + 1, stream.params.at(i)});
+  }
+  for (const Op& op : stream.ops) {
+    if (op.type == OpType::ALLOC_MEM) {
+      sizes.insert({stream.args.at(op.begin), (SizeClass)stream.args.at(op.begin + 1)});
+    }
+  }
+  return sizes;
+}
+
+// The op that copies a value of one size into a Mem of another, matching the
+// conversion a call's return or argument passing would have performed.
+OpType ConversionOp(SizeClass dst, SizeClass src) {
+  if (dst == src) {
+    return OpType::MOV;
+  }
+  if (ByteSizeFrom(dst, 4) > ByteSizeFrom(src, 4)) {
+    return OpType::EXTEND;
+  }
+  return OpType::TRUNCATE;
+}
+
+class Inliner {
+ public:
+  Inliner(const TypeInfoMap& tinfo_map, Program* prog) {
+    for (const auto& t_pair : tinfo_map.GetTypeMap()) {
+      for (const auto& m_pair : t_pair.second.methods.GetMethodMap()) {
+        const MethodInfo& minfo = m_pair.second;
+        if (minfo.mods.HasModifier(lexer::NATIVE)) {
+          natives_.insert(minfo.mid);
+        }
+      }
+    }
+
+    for (const CompUnit& unit : prog->units) {
+      for (const Type& type : unit.types) {
+        for (const Stream& stream : type.streams) {
+          callees_.insert({{stream.tid, stream.mid}, {unit.fileid, &stream}});
+        }
+      }
+    }
+  }
+
+  // Inlines every eligible call in stream, returning whether any were found.
+  bool InlineInto(Stream* stream) {
+    if (stream->ops.size() >= kMaxCallerOps) {
+      return false;
+    }
+
+    sizes_ = SizesOf(*stream);
+    next_mem_ = stream->params.size() + 1;
+    next_label_ = 0;
+    for (const Op& op : stream->ops) {
+      for (size_t pos : MemArgs(op)) {
+        next_mem_ = std::max(next_mem_, stream->args.at(op.begin + pos) + 1);
+      }
+      if (IsLabelOp(op.type)) {
+        next_label_ = std::max(next_label_, stream->args.at(op.begin) + 1);
+      }
+    }
+
+    bool changed = false;
+    vector<Op> ops;
+    for (const Op& op : stream->ops) {
+      if (op.type != OpType::STATIC_CALL) {
+        ops.push_back(op);
+        continue;
+      }
+
+      // (Mem, TypeId::Base, MethodId, int file_offset, int nargs, Mem[]).
+      vector<u64> call(stream->args.begin() + op.begin, stream->args.begin() + op.end);
+      const Callee* callee = Lookup(call.at(1), call.at(2));
+      if (callee == nullptr || callee->stream == stream) {
+        ops.push_back(op);
+        continue;
+      }
+
+      Splice(op, call, *callee, stream, &ops);
+      changed = true;
+    }
+
+    stream->ops = ops;
+    return changed;
+  }
+
+ private:
+  struct Callee {
+    int fileid;
+    const Stream* stream;
+  };
+
+  const Callee* Lookup(TypeId::Base tid, MethodId mid) const {
+    if (natives_.count(mid) == 1) {
+      return nullptr;
+    }
+
+    auto iter = callees_.find({tid, mid});
+    if (iter == callees_.end()) {
+      return nullptr;
+    }
+
+    const Stream& body = *iter->second.stream;
+    for (const Op& op : body.ops) {
+      if (IsCallOp(op.type)) {
+        return nullptr;
+      }
+    }
+    if (CostOf(body) > kMaxCalleeCost) {
+      return nullptr;
+    }
+    return &iter->second;
+  }
+
+  // Appends the callee's body in place of call_op. Params become fresh Mems
+  // initialised from the arguments, and each RET becomes a move into the
+  // call's destination followed by a jump past the body.
+  void Splice(const Op& call_op, const vector<u64>& call, const Callee& callee, Stream* stream, vector<Op>* ops) {
+    const Stream& body = *callee.stream;
+    map<MemId, SizeClass> body_sizes = SizesOf(body);
+
+    stream->inline_sites.push_back({callee.fileid, body.tid, body.mid, call_op.inline_site, call.at(3)});
+    u64 site = stream->inline_sites.size();
+
+    // Sites the callee itself inlined through now hang off this one.
+    u64 site_base = stream->inline_sites.size();
+    for (InlineSite inner : body.inline_sites) {
+      inner.parent = inner.parent == 0 ? site : inner.parent + site_base;
+      stream->inline_sites.push_back(inner);
+    }
+
+    map<MemId, MemId> mems;
+    auto rename_mem = [&](MemId mem) {
+      if (mem == kInvalidMemId) {
+        return mem;
+      }
+      auto iter = mems.find(mem);
+      if (iter == mems.end()) {
+        iter = mems.insert({mem, next_mem_++}).first;
+      }
+      return iter->second;
+    };
+
+    map<LabelId, LabelId> labels;
+    auto rename_label = [&](LabelId label) {
+      auto iter = labels.find(label);
+      if (iter == labels.end()) {
+        iter = labels.insert({label, next_label_++}).first;
+      }
+      return iter->second;
+    };
+
+    auto emit = [&](OpType type, const vector<u64>& args, u64 op_site) {
+      size_t begin = stream->args.size();
+      stream->args.insert(stream->args.end(), args.begin(), args.end());
+      ops->push_back({type, begin, stream->args.size(), op_site});
+    };
+
+    MemId dst = call.at(0);
+    CHECK(call.at(4) == body.params.size());
+
+    for (size_t i = 0; i < body.params.size(); ++i) {
+      MemId param = rename_mem(i + 1);
+      emit(OpType::ALLOC_MEM, {param, (u64)body.params.at(i), 0}, site);
+      MemId arg = call.at(5 + i);
+      emit(ConversionOp(body.params.at(i), sizes_.at(arg)), {param, arg}, site);
+    }
+
+    LabelId end_label = next_label_++;
+
+    for (size_t i = 0; i < body.ops.size(); ++i) {
+      const Op& op = body.ops.at(i);
+      vector<u64> args(body.args.begin() + op.begin, body.args.begin() + op.end);
+      vector<u64> orig_args = args;
+      for (size_t pos : MemArgs(op)) {
+        args.at(pos) = rename_mem(args.at(pos));
+      }
+      if (IsLabelOp(op.type)) {
+        args.at(0) = rename_label(args.at(0));
+      }
+
+      u64 op_site = op.inline_site == 0 ? site : op.inline_site + site_base;
+
+      if (op.type != OpType::RET) {
+        emit(op.type, args, op_site);
+        continue;
+      }
+
+      if (args.size() == 1 && dst != kInvalidMemId) {
+        OpType conversion = ConversionOp(sizes_.at(dst), body_sizes.at(orig_args.at(0)));
+        emit(conversion, {dst, args.at(0)}, op_site);
+      }
+      if (i + 1 != body.ops.size()) {
+        emit(OpType::JMP, {end_label}, op_site);
+      }
+    }
+
+    emit(OpType::LABEL, {end_label}, site);
+
+    for (size_t i = body.params.size(); i > 0; --i) {
+      emit(OpType::DEALLOC_MEM, {mems.at(i)}, site);
+    }
+  }
+
+  set<MethodId> natives_;
+  map<MemId, SizeClass> sizes_;
+  map<pair<TypeId::Base, MethodId>, Callee> callees_;
+  MemId next_mem_ = 0;
+  LabelId next_label_ = 0;
+};
+
+} // namespace
+
+void InlineCalls(const TypeInfoMap& tinfo_map, Program* prog) {
+  Inliner inliner(tinfo_map, prog);
+
+  // Every inlined callee is call-free, so each pass strictly reduces the
+  // number of calls left and this terminates.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (CompUnit& unit : prog->units) {
+      for (Type& type : unit.types) {
+        for (Stream& stream : type.streams) {
+          changed = inliner.InlineInto(&stream) || changed;
+        }
+      }
+    }
+  }
+}
+
+} // namespace ir
@@ -0,0 +1,20 @@
+#ifndef IR_INLINER_H
+#define IR_INLINER_H
+
+#include "ir/mem.h"
+#include "ir/stream.h"
+#include "types/type_info_map.h"
+
+namespace ir {
+
+// Replaces STATIC_CALLs, including the ones Devirtualize produced from
+// monomorphic DYNAMIC_CALLs, with the body of the callee when the callee is
+// small and makes no calls of its own. Callees become eligible bottom-up as
+// their own calls are inlined. Inlined ops are tagged with an InlineSite so
+// exceptions they raise are still reported against the callee's line,
+// followed by the line of the call.
+void InlineCalls(const types::TypeInfoMap& tinfo_map, Program* prog);
+
+} // namespace ir
+
+#endif
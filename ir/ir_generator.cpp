@@ -6,11 +6,13 @@
 #include "ast/ast.h"
 #include "ast/extent.h"
 #include "ast/print_visitor.h"
-#include "ast/visitor.h"
+#include "ast/static_visitor.h"
+#include "ir/devirtualize.h"
+#include "ir/inliner.h"
 #include "ir/size.h"
 #include "ir/stream_builder.h"
+#include "ir/type_check_folding.h"
 #include "lexer/lexer.h"
-#include "runtime/runtime.h"
 #include "types/type_info_map.h"
 #include "types/typechecker.h"
 
@@ -19,6 +21,7 @@ using std::get;
 using std::tuple;
 
 using ast::ArrayIndexExpr;
+using ast::BinExpr;
 using ast::Expr;
 using ast::ExtentOf;
 using ast::FieldDecl;
@@ -46,7 +49,7 @@ namespace ir {
 
 namespace {
 
-class MethodIRGenerator final : public ast::Visitor {
+class MethodIRGenerator final : public ast::StaticVisitor<MethodIRGenerator> {
  public:
   MethodIRGenerator(Mem res, Mem array_rvalue, bool lvalue, StreamBuilder* builder, vector<ast::LocalVarId>* locals, map<ast::LocalVarId, Mem>* locals_map, TypeId tid, const ConstStringMap& string_map, const RuntimeLinkIds& rt_ids): res_(res), array_rvalue_(array_rvalue), lvalue_(lvalue), builder_(*builder), locals_(*locals), locals_map_(*locals_map), tid_(tid), string_map_(string_map), rt_ids_(rt_ids) {}
 
@@ -241,6 +244,13 @@ class MethodIRGenerator final : public ast::Visitor {
       is_assg = true;
     }
 
+    // If we are adding strings.
+    if (!is_assg && expr.GetTypeId() == rt_ids_.string_tid) {
+      CHECK(expr.Op().type == lexer::ADD);
+      Concat(expr);
+      return VisitResult::SKIP;
+    }
+
     Mem lhs_old = builder_.AllocTemp(is_assg ? SizeClass::PTR : lhs_size);
     Mem rhs_old = builder_.AllocTemp(rhs_size);
 
@@ -276,31 +286,6 @@ class MethodIRGenerator final : public ast::Visitor {
       return VisitResult::SKIP;
     }
 
-    // If we are adding strings.
-    if (expr.GetTypeId() == rt_ids_.string_tid) {
-      CHECK(expr.Op().type == lexer::ADD);
-
-      Mem lhs_str = builder_.AllocTemp(SizeClass::PTR);
-      if (lhs.Size() == SizeClass::PTR) {
-        builder_.StaticCall(lhs_str, rt_ids_.stringops_type.base, rt_ids_.stringops_str, {lhs}, expr.Op().pos);
-      } else {
-        CHECK(types::TypeChecker::IsPrimitive(lhs_tid));
-        builder_.StaticCall(lhs_str, rt_ids_.string_tid.base, rt_ids_.string_valueof.at(lhs_tid.base), {lhs}, expr.Op().pos);
-      }
-
-      Mem rhs_str = builder_.AllocTemp(SizeClass::PTR);
-      if (rhs.Size() == SizeClass::PTR) {
-        builder_.StaticCall(rhs_str, rt_ids_.stringops_type.base, rt_ids_.stringops_str, {rhs}, expr.Op().pos);
-      } else {
-        CHECK(types::TypeChecker::IsPrimitive(rhs_tid));
-        builder_.StaticCall(rhs_str, rt_ids_.string_tid.base, rt_ids_.string_valueof.at(rhs_tid.base), {rhs}, expr.Op().pos);
-      }
-
-      builder_.DynamicCall(res_, lhs_str, rt_ids_.string_concat, {rhs_str}, expr.Op().pos);
-
-      return VisitResult::SKIP;
-    }
-
     // Only perform binary numeric promotion if we are performing operations on
     // numeric types.
     if (lhs.Size() != SizeClass::PTR && lhs.Size() != SizeClass::BOOL) {
@@ -655,6 +640,89 @@ class MethodIRGenerator final : public ast::Visitor {
     return VisitResult::SKIP;
   }
 
+  struct ConcatOperand {
+    sptr<const Expr> expr;
+    PosRange pos;
+  };
+
+  bool IsConcat(const Expr& expr) const {
+    const BinExpr* bin = dynamic_cast<const BinExpr*>(&expr);
+    return bin != nullptr && bin->Op().type == lexer::ADD && expr.GetTypeId() == rt_ids_.string_tid;
+  }
+
+  // Collects the operands of a left-nested chain of string additions in
+  // evaluation order, each paired with the position of the addition that
+  // converts it. A string addition on the right is left as one operand, since
+  // flattening it would convert the operands before it too early.
+  void FlattenConcat(const BinExpr& expr, vector<ConcatOperand>* out) const {
+    if (IsConcat(expr.Lhs())) {
+      FlattenConcat(dynamic_cast<const BinExpr&>(expr.Lhs()), out);
+    } else {
+      out->push_back({expr.LhsPtr(), expr.Op().pos});
+    }
+    out->push_back({expr.RhsPtr(), expr.Op().pos});
+  }
+
+  // Lowers a chain of string additions into a single call to
+  // StringOps.Concat, which sizes the result once and copies each operand
+  // once. Operands are converted to strings in the same order as nested
+  // additions would: the first two once both are evaluated, and each later
+  // one right after it is evaluated. String operands are passed through as-is
+  // since Concat prints null ones as "null" itself; everything else goes
+  // through String.valueOf or StringOps.Str.
+  void Concat(const BinExpr& expr) {
+    vector<ConcatOperand> operands;
+    FlattenConcat(expr, &operands);
+    CHECK(operands.size() >= 2);
+
+    Mem size = builder_.AllocTemp(SizeClass::INT);
+    builder_.ConstNumeric(size, (i32)operands.size());
+    Mem parts = builder_.AllocArray(rt_ids_.string_tid, size, expr.Op().pos);
+
+    Mem first = ConcatValue(operands.at(0));
+    {
+      Mem second = ConcatValue(operands.at(1));
+      StoreConcatPart(parts, 0, operands.at(0), first);
+      StoreConcatPart(parts, 1, operands.at(1), second);
+    }
+    for (size_t i = 2; i < operands.size(); ++i) {
+      Mem value = ConcatValue(operands.at(i));
+      StoreConcatPart(parts, i, operands.at(i), value);
+    }
+
+    builder_.StaticCall(res_, rt_ids_.stringops_type.base, rt_ids_.stringops_concat, {parts}, expr.Op().pos);
+  }
+
+  Mem ConcatValue(const ConcatOperand& operand) {
+    Mem value = builder_.AllocTemp(SizeClassFrom(operand.expr->GetTypeId()));
+    WithResultIn(value).Visit(operand.expr);
+    return value;
+  }
+
+  // Converts an evaluated operand to a string and stores it at index i of
+  // parts.
+  void StoreConcatPart(Mem parts, size_t i, const ConcatOperand& operand, Mem value) {
+    TypeId tid = operand.expr->GetTypeId();
+
+    Mem str = value;
+    if (tid != rt_ids_.string_tid) {
+      str = builder_.AllocTemp(SizeClass::PTR);
+      if (value.Size() == SizeClass::PTR) {
+        builder_.StaticCall(str, rt_ids_.stringops_type.base, rt_ids_.stringops_str, {value}, operand.pos);
+      } else {
+        CHECK(TypeChecker::IsPrimitive(tid));
+        builder_.StaticCall(str, rt_ids_.string_tid.base, rt_ids_.string_valueof.at(tid.base), {value}, operand.pos);
+      }
+    }
+
+    Mem idx = builder_.AllocTemp(SizeClass::INT);
+    builder_.ConstNumeric(idx, (i32)i);
+
+    Mem slot = builder_.AllocTemp(SizeClass::PTR);
+    builder_.ArrayAddr(slot, parts, idx, SizeClass::PTR, operand.pos);
+    builder_.MovToAddr(slot, str, operand.pos);
+  }
+
   // Location result of the computation should be stored.
   Mem res_;
   Mem array_rvalue_;
@@ -669,7 +737,7 @@ class MethodIRGenerator final : public ast::Visitor {
 
 class ProgramIRGenerator final : public ast::Visitor {
  public:
-  ProgramIRGenerator(const TypeInfoMap& tinfo_map, const ConstStringMap& string_map, const RuntimeLinkIds& rt_ids) : tinfo_map_(tinfo_map), string_map_(string_map), rt_ids_(rt_ids) {}
+  ProgramIRGenerator(const TypeInfoMap& tinfo_map, const ConstStringMap& string_map, const RuntimeLinkIds& rt_ids, int entry_fileid) : tinfo_map_(tinfo_map), string_map_(string_map), rt_ids_(rt_ids), entry_fileid_(entry_fileid) {}
   VISIT_DECL(CompUnit, unit, ) {
     stringstream ss;
     ss << 'f' << unit.FileId() << ".s";
@@ -866,14 +934,15 @@ class ProgramIRGenerator final : public ast::Visitor {
     {
       Mem ret = builder.AllocDummy();
 
-      // Entry point is a static method called "test" with no params.
+      // Entry point is a static method called "test" with no params in the
+      // entry file.
       is_entry_point =
         (decl->Name() == "test"
          && decl->Mods().HasModifier(lexer::Modifier::STATIC)
          && decl->Params().Params().Size() == 0
          && decl->TypePtr() != nullptr
          && decl->TypePtr()->GetTypeId() == TypeId::kInt
-         && current_unit_.fileid == runtime::kNumRuntimeFiles);
+         && current_unit_.fileid == entry_fileid_);
 
       MethodIRGenerator gen(ret, builder.AllocDummy(), false, &builder, &empty_locals, &locals_map, {out->tid, 0}, string_map_, rt_ids_);
       gen.Visit(decl);
@@ -891,6 +960,7 @@ class ProgramIRGenerator final : public ast::Visitor {
   const TypeInfoMap& tinfo_map_;
   const ConstStringMap& string_map_;
   const RuntimeLinkIds& rt_ids_;
+  const int entry_fileid_;
 };
 
 RuntimeLinkIds LookupRuntimeIds(const TypeSet& typeset, const TypeInfoMap& tinfo_map) {
@@ -904,16 +974,6 @@ RuntimeLinkIds LookupRuntimeIds(const TypeSet& typeset, const TypeInfoMap& tinfo
   CHECK(rt_ids.string_tid.IsValid());
   TypeInfo string_tinfo = tinfo_map.LookupTypeInfo(rt_ids.string_tid);
 
-  rt_ids.string_concat = string_tinfo.methods.ResolveCall(
-      tinfo_map,
-      rt_ids.string_tid,
-      types::CallContext::INSTANCE,
-      rt_ids.string_tid,
-      TypeIdList({rt_ids.string_tid}),
-      "concat", PosRange(-1, -1, -1), &throwaway);
-  CHECK(!throwaway.IsFatal());
-  CHECK(rt_ids.string_concat != ast::kErrorMethodId);
-
   auto valueof_method = [&](ast::TypeId tid) {
     ast::MethodId mid = string_tinfo.methods.ResolveCall(
         tinfo_map,
@@ -947,27 +1007,6 @@ RuntimeLinkIds LookupRuntimeIds(const TypeSet& typeset, const TypeInfoMap& tinfo
   CHECK(!throwaway.IsFatal());
   CHECK(rt_ids.type_info_constructor != ast::kErrorMethodId);
 
-  rt_ids.type_info_instanceof = type_info_tinfo.methods.ResolveCall(
-      tinfo_map,
-      rt_ids.type_info_tid,
-      types::CallContext::STATIC,
-      rt_ids.type_info_tid,
-      TypeIdList({rt_ids.type_info_tid, rt_ids.type_info_tid}),
-      "InstanceOf", PosRange(-1, -1, -1), &throwaway);
-  CHECK(!throwaway.IsFatal());
-  CHECK(rt_ids.type_info_instanceof != ast::kErrorMethodId);
-
-  rt_ids.type_info_num_types = type_info_tinfo.fields.ResolveAccess(
-      tinfo_map,
-      rt_ids.type_info_tid,
-      types::CallContext::STATIC,
-      rt_ids.type_info_tid,
-      "num_types",
-      PosRange(-1, -1, -1),
-      &throwaway);
-  CHECK(!throwaway.IsFatal());
-  CHECK(rt_ids.type_info_num_types != ast::kErrorFieldId);
-
   rt_ids.stringops_type = typeset.TryGet("__joos_internal__.StringOps");
   CHECK(rt_ids.stringops_type.IsValid());
 
@@ -981,6 +1020,15 @@ RuntimeLinkIds LookupRuntimeIds(const TypeSet& typeset, const TypeInfoMap& tinfo
       "Str", PosRange(-1, -1, -1), &throwaway);
   CHECK(!throwaway.IsFatal());
   CHECK(rt_ids.stringops_str != ast::kErrorMethodId);
+  rt_ids.stringops_concat = stringops_tinfo.methods.ResolveCall(
+      tinfo_map,
+      rt_ids.stringops_type,
+      types::CallContext::STATIC,
+      rt_ids.stringops_type,
+      TypeIdList({{rt_ids.string_tid.base, 1}}),
+      "Concat", PosRange(-1, -1, -1), &throwaway);
+  CHECK(!throwaway.IsFatal());
+  CHECK(rt_ids.stringops_concat != ast::kErrorMethodId);
 
   rt_ids.stackframe_type = typeset.TryGet("__joos_internal__.StackFrame");
   CHECK(rt_ids.type_info_tid.IsValid());
@@ -1011,11 +1059,14 @@ RuntimeLinkIds LookupRuntimeIds(const TypeSet& typeset, const TypeInfoMap& tinfo
 
 } // namespace
 
-Program GenerateIR(sptr<const ast::Program> program, const TypeSet& typeset, const TypeInfoMap& tinfo_map, const ConstStringMap& string_map) {
+Program GenerateIR(sptr<const ast::Program> program, const TypeSet& typeset, const TypeInfoMap& tinfo_map, const ConstStringMap& string_map, int entry_fileid) {
   RuntimeLinkIds rt_ids = LookupRuntimeIds(typeset, tinfo_map);
-  ProgramIRGenerator gen(tinfo_map, string_map, rt_ids);
+  ProgramIRGenerator gen(tinfo_map, string_map, rt_ids, entry_fileid);
   gen.Visit(program);
   gen.prog.rt_ids = rt_ids;
+  FoldTypeChecks(tinfo_map, &gen.prog);
+  Devirtualize(tinfo_map, &gen.prog);
+  InlineCalls(tinfo_map, &gen.prog);
   return gen.prog;
 }
 
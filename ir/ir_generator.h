@@ -8,7 +8,9 @@
 
 namespace ir {
 
-Program GenerateIR(sptr<const ast::Program> program, const types::TypeSet& typeset, const types::TypeInfoMap& tinfo_map, const types::ConstStringMap& string_map);
+// Builds the IR for program. Its entry point is the static int test() method
+// declared in the file with id entry_fileid.
+Program GenerateIR(sptr<const ast::Program> program, const types::TypeSet& typeset, const types::TypeInfoMap& tinfo_map, const types::ConstStringMap& string_map, int entry_fileid);
 
 } // namespace ir
 
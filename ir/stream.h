@@ -10,16 +10,14 @@ struct RuntimeLinkIds {
   ast::TypeId object_tid;
 
   ast::TypeId string_tid;
-  ast::MethodId string_concat;
   map<ast::TypeId::Base, ast::MethodId> string_valueof;
 
   ast::TypeId type_info_tid;
   ast::MethodId type_info_constructor;
-  ast::MethodId type_info_instanceof;
-  ast::FieldId type_info_num_types;
 
   ast::TypeId stringops_type;
   ast::MethodId stringops_str;
+  ast::MethodId stringops_concat;
 
   ast::TypeId stackframe_type;
   ast::MethodId stackframe_print;
@@ -134,6 +132,9 @@ enum class OpType {
   // (Mem, Mem, int file_offset).
   CHECK_ARRAY_STORE,
 
+  // (Mem, int file_offset).
+  CHECK_NULL,
+
   // (Mem, TypeId::Base, MethodId, int file_offset, int nargs, Mem[]).
   STATIC_CALL,
 
@@ -150,6 +151,23 @@ struct Op {
   // Indices into args vector.
   size_t begin;
   size_t end;
+
+  // The InlineSite this op was inlined through, as an index into
+  // Stream::inline_sites plus one. Zero for ops of the stream's own method.
+  u64 inline_site = 0;
+};
+
+// A call that was replaced by the body of its callee. File offsets of ops
+// inlined through this site are relative to the callee's file.
+struct InlineSite {
+  int fileid;
+  ast::TypeId::Base tid;
+  ast::MethodId mid;
+
+  // The site the call itself was made from, using the same encoding as
+  // Op::inline_site, and the call's file offset in that site's file.
+  u64 parent;
+  u64 call_offset;
 };
 
 struct Stream {
@@ -162,6 +180,8 @@ struct Stream {
   vector<Op> ops;
 
   vector<SizeClass> params;
+
+  vector<InlineSite> inline_sites;
 };
 
 struct Type {
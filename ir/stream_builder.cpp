@@ -378,7 +378,7 @@ void StreamBuilder::Ret(Mem ret) {
 
 Stream StreamBuilder::Build(bool is_entry_point, ast::TypeId::Base tid, ast::MethodId mid) const {
   CHECK(params_initialized_);
-  return Stream{is_entry_point, tid, mid, args_, ops_, params_};
+  return Stream{is_entry_point, tid, mid, args_, ops_, params_, {}};
 }
 
 } // namespace ir
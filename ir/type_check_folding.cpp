@@ -0,0 +1,136 @@
+#include "ir/type_check_folding.h"
+
+#include "lexer/lexer.h"
+#include "types/typechecker.h"
+
+using ast::TypeId;
+using ast::TypeKind;
+using types::TypeChecker;
+using types::TypeInfo;
+using types::TypeInfoMap;
+
+namespace ir {
+
+namespace {
+
+enum class Outcome {
+  UNKNOWN,
+  ALWAYS_TRUE,
+  ALWAYS_FALSE,
+};
+
+bool IsKnownType(const TypeInfoMap& tinfo_map, TypeId::Base tid) {
+  return tinfo_map.GetTypeMap().count({tid, 0}) == 1;
+}
+
+// Decides `src instanceof dst' for a non-null value of static type src, where
+// neither is an array type.
+Outcome DecideNonArray(const TypeInfoMap& tinfo_map, TypeId::Base object_tid, TypeId::Base src, TypeId::Base dst) {
+  if (src == dst || dst == object_tid) {
+    return Outcome::ALWAYS_TRUE;
+  }
+
+  // The source may be the null type, whose check is never reached.
+  if (!IsKnownType(tinfo_map, src) || !IsKnownType(tinfo_map, dst)) {
+    return Outcome::UNKNOWN;
+  }
+
+  if (tinfo_map.IsAncestor({src, 0}, {dst, 0})) {
+    return Outcome::ALWAYS_TRUE;
+  }
+
+  // A final class has no subclasses, so its instances all have exactly the
+  // static type.
+  const TypeInfo& src_tinfo = tinfo_map.LookupTypeInfo({src, 0});
+  if (src_tinfo.kind == TypeKind::CLASS && src_tinfo.mods.HasModifier(lexer::FINAL)) {
+    return Outcome::ALWAYS_FALSE;
+  }
+
+  return Outcome::UNKNOWN;
+}
+
+Outcome Decide(const TypeInfoMap& tinfo_map, TypeId::Base object_tid, TypeId::Base dst, bool dst_array, TypeId::Base src, bool src_array) {
+  // The typechecker only allows array to non-array checks that succeed.
+  if (!dst_array && src_array) {
+    return Outcome::ALWAYS_TRUE;
+  }
+
+  if (!dst_array && !src_array) {
+    return DecideNonArray(tinfo_map, object_tid, src, dst);
+  }
+
+  if (dst_array && src_array) {
+    bool dst_prim = TypeChecker::IsPrimitive({dst, 0});
+    bool src_prim = TypeChecker::IsPrimitive({src, 0});
+    if (dst_prim || src_prim) {
+      return (dst == src) ? Outcome::ALWAYS_TRUE : Outcome::ALWAYS_FALSE;
+    }
+
+    // Reference arrays are covariant in their element type.
+    return DecideNonArray(tinfo_map, object_tid, src, dst);
+  }
+
+  // Non-array to array needs a runtime check unless the value can't be an
+  // array at all.
+  if (!IsKnownType(tinfo_map, src)) {
+    return Outcome::UNKNOWN;
+  }
+  const TypeInfo& src_tinfo = tinfo_map.LookupTypeInfo({src, 0});
+  if (src_tinfo.kind == TypeKind::CLASS && src != object_tid) {
+    return Outcome::ALWAYS_FALSE;
+  }
+
+  return Outcome::UNKNOWN;
+}
+
+void FoldStream(const TypeInfoMap& tinfo_map, TypeId::Base object_tid, Stream* stream) {
+  vector<Op> ops;
+  for (size_t i = 0; i < stream->ops.size(); ++i) {
+    Op op = stream->ops.at(i);
+    if (op.type != OpType::INSTANCE_OF) {
+      ops.push_back(op);
+      continue;
+    }
+
+    const u64* args = &stream->args[op.begin];
+    MemId dst = args[0];
+    Outcome outcome = Decide(tinfo_map, object_tid, args[2], args[3] == 1, args[4], args[5] == 1);
+
+    if (outcome == Outcome::UNKNOWN) {
+      ops.push_back(op);
+      continue;
+    }
+
+    bool result = (outcome == Outcome::ALWAYS_TRUE);
+
+    // A cast that always succeeds needs neither the test nor the check.
+    if (result && i + 1 < stream->ops.size()) {
+      const Op& next = stream->ops.at(i + 1);
+      if (next.type == OpType::CAST_EXCEPTION_IF_FALSE && stream->args[next.begin] == dst) {
+        ++i;
+        continue;
+      }
+    }
+
+    // Rewrite the op in place as (Mem, SizeClass, Value).
+    stream->args[op.begin + 1] = (u64)SizeClass::BOOL;
+    stream->args[op.begin + 2] = result ? 1 : 0;
+    ops.push_back({OpType::CONST, op.begin, op.begin + 3, op.inline_site});
+  }
+
+  stream->ops = ops;
+}
+
+} // namespace
+
+void FoldTypeChecks(const TypeInfoMap& tinfo_map, Program* prog) {
+  for (CompUnit& unit : prog->units) {
+    for (Type& type : unit.types) {
+      for (Stream& stream : type.streams) {
+        FoldStream(tinfo_map, prog->rt_ids.object_tid.base, &stream);
+      }
+    }
+  }
+}
+
+} // namespace ir
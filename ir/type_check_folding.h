@@ -0,0 +1,18 @@
+#ifndef IR_TYPE_CHECK_FOLDING_H
+#define IR_TYPE_CHECK_FOLDING_H
+
+#include "ir/mem.h"
+#include "ir/stream.h"
+#include "types/type_info_map.h"
+
+namespace ir {
+
+// Replaces INSTANCE_OF ops whose result is decided by the static type
+// hierarchy with constants, and drops the CAST_EXCEPTION_IF_FALSE that
+// immediately follows one that always succeeds. INSTANCE_OF is only ever
+// emitted after a null check, so a folded test leaves just that null check.
+void FoldTypeChecks(const types::TypeInfoMap& tinfo_map, Program* prog);
+
+} // namespace ir
+
+#endif
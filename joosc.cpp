@@ -10,9 +10,13 @@
 #include "base/error.h"
 #include "base/errorlist.h"
 #include "base/fileset.h"
+#include "base/shared_ptr_vector.h"
+#include "base/thread_pool.h"
 #include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
 #include "parser/parser.h"
 #include "runtime/runtime.h"
+#include "snapshot/snapshot.h"
 #include "types/type_info_map.h"
 #include "types/type_info_map.h"
 #include "types/types.h"
@@ -23,21 +27,28 @@ using std::cerr;
 using std::cout;
 using std::endl;
 using std::function;
+using std::ifstream;
 using std::ofstream;
 using std::ostream;
 
+using ast::CompUnit;
 using ast::PrintVisitor;
 using ast::Program;
 using backend::common::OffsetTable;
+using base::Error;
 using base::ErrorList;
 using base::FileSet;
-using lexer::LexJoosFiles;
-using lexer::StripSkippableTokens;
-using lexer::Token;
-using parser::Parse;
+using base::SharedPtrVector;
+using base::ThreadPool;
+using lexer::LexSignificantTokens;
+using lexer::TokenBuffer;
+using parser::ParseFile;
+using snapshot::Snapshot;
+using snapshot::UnitCache;
 using types::ConstStringMap;
 using types::TypeInfoMap;
 using types::TypeSet;
+using types::TypecheckCache;
 using types::TypecheckProgram;
 using weeder::WeedProgram;
 
@@ -50,40 +61,220 @@ bool PrintErrors(const ErrorList& errors, ostream* err, const FileSet* fs) {
   return errors.IsFatal();
 }
 
+vector<pair<string, string>> RuntimeFiles() {
+  return {
+    {"__joos_internal__/TypeInfo.java", runtime::TypeInfoFile},
+    {"__joos_internal__/StringOps.java", runtime::StringOpsFile},
+    {"__joos_internal__/StackFrame.java", runtime::StackFrameFile},
+    {"__joos_internal__/Array.java", runtime::ArrayFile},
+  };
 }
 
-sptr<const Program> CompilerFrontend(CompilerStage stage, const FileSet* fs, TypeSet* typeset_out, TypeInfoMap* tinfo_out, ConstStringMap* string_map_out, ErrorList* err_out) {
-  // Lex files.
-  vector<vector<Token>> tokens;
-  LexJoosFiles(fs, &tokens, err_out);
+// A snapshot is only usable with the runtime it was built from, since the
+// runtime's units are taken from it.
+bool MatchesRuntime(const Snapshot& snapshot) {
+  vector<pair<string, string>> runtime_files = RuntimeFiles();
+  if (snapshot.NumLeadingFiles() != (int)runtime_files.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < runtime_files.size(); ++i) {
+    if (snapshot.Path(i) != runtime_files.at(i).first || snapshot.Contents(i) != runtime_files.at(i).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct BatchProgram {
+  string dir;
+  vector<string> files;
+};
+
+bool ReadManifest(const string& path, vector<BatchProgram>* programs_out, ostream* err) {
+  ifstream in(path);
+  if (!in) {
+    *err << "joosc: could not open manifest " << path << std::endl;
+    return false;
+  }
+
+  string line;
+  for (int lineno = 1; std::getline(in, line); ++lineno) {
+    stringstream ss(line);
+    BatchProgram program;
+    if (!(ss >> program.dir) || program.dir[0] == '#') {
+      continue;
+    }
+    string file;
+    while (ss >> file) {
+      program.files.push_back(file);
+    }
+    if (program.files.empty()) {
+      *err << path << ":" << lineno << ": no files given for " << program.dir << std::endl;
+      return false;
+    }
+    programs_out->push_back(program);
+  }
+  return true;
+}
+
+// Returns the files named by every program, in the order the first program
+// names them.
+vector<string> SharedFiles(const vector<BatchProgram>& programs) {
+  if (programs.size() < 2) {
+    return {};
+  }
+
+  map<string, size_t> counts;
+  for (const auto& program : programs) {
+    for (const auto& file : set<string>(program.files.begin(), program.files.end())) {
+      ++counts[file];
+    }
+  }
+
+  vector<string> shared;
+  set<string> seen;
+  for (const auto& file : programs.at(0).files) {
+    if (counts.at(file) == programs.size() && seen.insert(file).second) {
+      shared.push_back(file);
+    }
+  }
+  return shared;
+}
+
+// The weeded units of the files every program in a batch starts with.
+class SharedUnits final : public UnitCache {
+ public:
+  SharedUnits(const SharedPtrVector<const CompUnit>& units) : units_(units) {}
+
+  sptr<const CompUnit> Lookup(const FileSet&, int fileid) const override {
+    if (fileid >= units_.Size()) {
+      return nullptr;
+    }
+    return units_.At(fileid);
+  }
+
+ private:
+  const SharedPtrVector<const CompUnit> units_;
+};
+
+} // namespace
+
+sptr<const Program> CompilerFrontend(CompilerStage stage, const FileSet* fs, const CompilerOptions& opts, TypeSet* typeset_out, TypeInfoMap* tinfo_out, ConstStringMap* string_map_out, ErrorList* err_out, ThreadPool* pool, UnitCache* cache, TypecheckCache* typecheck_cache) {
+  ThreadPool serial(1);
+  if (pool == nullptr) {
+    pool = &serial;
+  }
+
+  // Each file is lexed, stripped of comments and whitespace, and parsed
+  // independently. Errors are kept per file and per phase so they can be
+  // merged below in exactly the order a serial run would produce them.
+  struct FileResult {
+    ErrorList lex_errors;
+    ErrorList unsupported_errors;
+    ErrorList parse_errors;
+    sptr<const CompUnit> unit;
+    bool from_cache = false;
+  };
+  vector<FileResult> results(fs->Size());
+
+  pool->ParallelFor(fs->Size(), [&](size_t i) {
+    FileResult& result = results.at(i);
+
+    // Cached units were lexed, parsed, and weeded without errors when they
+    // were stored.
+    if (cache != nullptr && stage >= CompilerStage::PARSE) {
+      result.unit = cache->Lookup(*fs, i);
+      if (result.unit != nullptr) {
+        result.from_cache = true;
+        return;
+      }
+    }
+
+    // Lex files, dropping comments and whitespace and looking for unsupported
+    // tokens as we go.
+    TokenBuffer tokens(i);
+    LexSignificantTokens(fs, fs->Get(i), i, &tokens, &result.lex_errors, &result.unsupported_errors, opts.lex_engine);
+    if (result.lex_errors.IsFatal() || stage == CompilerStage::LEX) {
+      return;
+    }
+    if (result.unsupported_errors.IsFatal() || stage == CompilerStage::UNSUPPORTED_TOKS) {
+      return;
+    }
+
+    // Parse.
+    result.unit = ParseFile(fs, i, tokens, &result.parse_errors, opts.ast_allocation);
+  });
+
+  auto merge = [&](ErrorList FileResult::*errors) {
+    for (FileResult& result : results) {
+      vector<Error*> released;
+      (result.*errors).Release(&released);
+      for (Error* error : released) {
+        err_out->Append(error);
+      }
+    }
+  };
+
+  merge(&FileResult::lex_errors);
   if (err_out->IsFatal() || stage == CompilerStage::LEX) {
     return nullptr;
   }
 
-  // Strip err_out comments and whitespace.
-  vector<vector<Token>> filtered_tokens;
-  StripSkippableTokens(tokens, &filtered_tokens);
-
-  // Look for unsupported tokens.
-  FindUnsupportedTokens(tokens, err_out);
+  merge(&FileResult::unsupported_errors);
   if (err_out->IsFatal() || stage == CompilerStage::UNSUPPORTED_TOKS) {
     return nullptr;
   }
 
-  // Parse.
-  sptr<const Program> program = Parse(fs, filtered_tokens, err_out);
+  merge(&FileResult::parse_errors);
+  SharedPtrVector<const CompUnit> units;
+  SharedPtrVector<const CompUnit> parsed_units;
+  for (const FileResult& result : results) {
+    if (result.unit == nullptr) {
+      continue;
+    }
+    units.Append(result.unit);
+    if (!result.from_cache) {
+      parsed_units.Append(result.unit);
+    }
+  }
+  sptr<const Program> program = make_shared<Program>(units);
   if (err_out->IsFatal() || stage == CompilerStage::PARSE) {
     return program;
   }
 
-  // Weed.
-  program = WeedProgram(fs, program, err_out);
-  if (err_out->IsFatal() || stage == CompilerStage::WEED) {
+  // Weed only the freshly parsed units, then put them back among the cached
+  // units in file order.
+  sptr<const Program> weeded = WeedProgram(fs, make_shared<Program>(parsed_units), err_out);
+  {
+    SharedPtrVector<const CompUnit> merged;
+    int next_weeded = 0;
+    for (const FileResult& result : results) {
+      if (result.unit == nullptr) {
+        continue;
+      }
+      if (result.from_cache) {
+        merged.Append(result.unit);
+      } else {
+        merged.Append(weeded->CompUnits().At(next_weeded++));
+      }
+    }
+    CHECK(next_weeded == weeded->CompUnits().Size());
+    program = make_shared<Program>(merged);
+  }
+  if (err_out->IsFatal()) {
+    return program;
+  }
+  if (cache != nullptr) {
+    for (const auto& unit : program->CompUnits().Vec()) {
+      cache->Store(*fs, unit->FileId(), unit);
+    }
+  }
+  if (stage == CompilerStage::WEED) {
     return program;
   }
 
   // Type-checking.
-  program = TypecheckProgram(program, typeset_out, tinfo_out, string_map_out, err_out);
+  program = TypecheckProgram(program, typeset_out, tinfo_out, string_map_out, err_out, typecheck_cache);
   if (err_out->IsFatal() || stage == CompilerStage::TYPE_CHECK) {
     return program;
   }
@@ -92,8 +283,12 @@ sptr<const Program> CompilerFrontend(CompilerStage stage, const FileSet* fs, Typ
   return program;
 }
 
-bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const string& dir, const TypeSet& typeset, const TypeInfoMap& tinfo_map, const ConstStringMap& string_map, const FileSet& fs, std::ostream* err) {
-  ir::Program ir_prog = ir::GenerateIR(prog, typeset, tinfo_map, string_map);
+bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const string& dir, const TypeSet& typeset, const TypeInfoMap& tinfo_map, const ConstStringMap& string_map, const FileSet& fs, int entry_fileid, std::ostream* err, OutputCache* cache) {
+  ir::Program ir_prog = ir::GenerateIR(prog, typeset, tinfo_map, string_map, entry_fileid);
+
+  // The IR refers to types, fields and methods by id only, so the AST, and
+  // any arenas its nodes live in, can go now.
+  prog.reset();
   if (stage == CompilerStage::GEN_IR) {
     return true;
   }
@@ -102,22 +297,51 @@ bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const s
   // Generate type sizes, field offsets, and method offsets.
   OffsetTable offset_table = OffsetTable::Build(tinfo_map, 4);
 
-  bool success = true;
-  backend::i386::Writer writer(tinfo_map, offset_table, ir_prog.rt_ids, fs);
-  for (const ir::CompUnit& comp_unit : ir_prog.units) {
-    string fname = dir + "/" + comp_unit.filename;
+  // Writes one output file, skipping it if the cache says it is unchanged.
+  auto write_file = [&](const string& fname, const function<void(ostream*)>& write) {
+    string contents;
+    if (cache != nullptr) {
+      stringstream ss;
+      write(&ss);
+      contents = ss.str();
+      auto iter = cache->find(fname);
+      if (iter != cache->end() && iter->second == contents) {
+        return true;
+      }
+      cache->erase(fname);
+    }
 
     ofstream out(fname);
     if (!out) {
       // TODO: make error pretty.
       *err << "Could not open output file: " << fname << "\n";
-      success = false;
-      continue;
+      return false;
     }
 
-    writer.WriteCompUnit(comp_unit, &out);
+    if (cache != nullptr) {
+      out << contents;
+    } else {
+      write(&out);
+    }
+    if (!(out << std::flush)) {
+      // TODO: make error pretty.
+      *err << "Could not write to output file: " << fname << "\n";
+      return false;
+    }
+
+    if (cache != nullptr) {
+      (*cache)[fname] = contents;
+    }
+    return true;
+  };
 
-    out << std::flush;
+  bool success = true;
+  backend::i386::Writer writer(tinfo_map, offset_table, ir_prog.rt_ids, fs);
+  for (const ir::CompUnit& comp_unit : ir_prog.units) {
+    string fname = dir + "/" + comp_unit.filename;
+    success = write_file(fname, [&](ostream* out) {
+      writer.WriteCompUnit(comp_unit, out);
+    }) && success;
   }
 
   vector<pair<string, function<void(ostream*)>>> writers;
@@ -129,6 +353,7 @@ bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const s
   writers.emplace_back(make_pair("main.s", [&](ostream* out) {
     writer.WriteMain(out);
     writer.WriteStaticInit(ir_prog, out);
+    writer.WriteSubtypes(out);
   }));
 
   writers.emplace_back(make_pair("traces.s", [&](ostream* out) {
@@ -137,19 +362,7 @@ bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const s
   }));
 
   for (auto& p : writers) {
-    string fname = dir + "/" + p.first;
-    ofstream out(fname);
-    if (!out) {
-      // TODO: make error pretty.
-      *err << "Could not open output file: " << fname << "\n";
-      success = false;
-      break;
-    }
-
-    p.second(&out);
-    if (!(out << std::flush)) {
-      // TODO: make error pretty.
-      *err << "Could not write to output file: " << fname << "\n";
+    if (!write_file(dir + "/" + p.first, p.second)) {
       success = false;
       break;
     }
@@ -158,44 +371,193 @@ bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const s
   return success;
 }
 
-bool CompilerMain(CompilerStage stage, const vector<string>& files, ostream*, ostream* err) {
-  // Open files.
-  FileSet* fs = nullptr;
-  {
-    ErrorList errors;
-    FileSet::Builder builder;
-
-    // Runtime files.
-    builder.AddStringFile("__joos_internal__/TypeInfo.java", runtime::TypeInfoFile);
-    builder.AddStringFile("__joos_internal__/StringOps.java", runtime::StringOpsFile);
-    builder.AddStringFile("__joos_internal__/StackFrame.java", runtime::StackFrameFile);
-    builder.AddStringFile("__joos_internal__/Array.java", runtime::ArrayFile);
+bool LoadSnapshot(const string& path, uptr<Snapshot>* out, ostream* err) {
+  ErrorList errors;
+  Snapshot* loaded = nullptr;
+  if (Snapshot::Load(path, &loaded, &errors)) {
+    out->reset(loaded);
+    if (!MatchesRuntime(**out)) {
+      errors.Append(base::MakeError([=](ostream* out, const base::OutputOptions& opt, const FileSet*) {
+        *out << path << " " << opt.Red() << "error: " << opt.ResetColor()
+             << "snapshot was built against a different runtime; rebuild it with --emit-snapshot";
+      }));
+    }
+  }
+  if (errors.IsFatal()) {
+    errors.PrintTo(err, base::OutputOptions::kUserOutput, &FileSet::Empty());
+    out->reset();
+    return false;
+  }
+  return true;
+}
 
+bool OpenFiles(const vector<string>& files, Snapshot* snapshot, FileSet** fs_out, ostream* err) {
+  ErrorList errors;
+  FileSet::Builder builder;
+
+  if (snapshot != nullptr) {
+    // The snapshot supplies the runtime files and its own files.
+    snapshot->AddFiles(files, &builder);
+  } else {
+    for (const auto& file : RuntimeFiles()) {
+      builder.AddStringFile(file.first, file.second);
+    }
     for (const auto& file : files) {
       builder.AddDiskFile(file);
     }
+  }
 
-    if (!builder.Build(&fs, &errors)) {
-      errors.PrintTo(&cerr, base::OutputOptions::kUserOutput, fs);
-      return false;
-    }
+  if (!builder.Build(fs_out, &errors)) {
+    errors.PrintTo(err, base::OutputOptions::kUserOutput, *fs_out);
+    return false;
+  }
+  return true;
+}
+
+bool CompilerMain(CompilerStage stage, const vector<string>& files, ostream*, ostream* err, const CompilerOptions& opts) {
+  uptr<Snapshot> snapshot;
+  if (!opts.snapshot.empty() && !LoadSnapshot(opts.snapshot, &snapshot, err)) {
+    return false;
+  }
+
+  // Open files.
+  FileSet* fs = nullptr;
+  if (!OpenFiles(files, snapshot.get(), &fs, err)) {
+    return false;
   }
   uptr<FileSet> fs_deleter(fs);
   if (stage == CompilerStage::OPEN_FILES) {
     return true;
   }
 
+  // A snapshot holds weeded units, so that is as far as we go when writing
+  // one.
+  bool emit_snapshot = !opts.emit_snapshot.empty();
+  if (emit_snapshot) {
+    stage = CompilerStage::WEED;
+  }
+
   ErrorList errors;
   TypeInfoMap tinfo_map = TypeInfoMap::Empty();
   TypeSet typeset = TypeSet::Empty();
   ConstStringMap string_map;
-  sptr<const Program> program = CompilerFrontend(stage, fs, &typeset, &tinfo_map, &string_map, &errors);
+  ThreadPool pool(opts.num_threads);
+  sptr<const Program> program = CompilerFrontend(stage, fs, opts, &typeset, &tinfo_map, &string_map, &errors, &pool, snapshot.get());
   if (PrintErrors(errors, err, fs)) {
     return false;
   }
+
+  if (emit_snapshot) {
+    ErrorList snapshot_errors;
+    if (!snapshot::WriteSnapshot(opts.emit_snapshot, *fs, *program, runtime::kNumRuntimeFiles, &snapshot_errors)) {
+      snapshot_errors.PrintTo(err, base::OutputOptions::kUserOutput, fs);
+      return false;
+    }
+    return true;
+  }
+
   if (stage <= CompilerStage::TYPE_CHECK) {
     return true;
   }
 
-  return CompilerBackend(stage, program, "output", typeset, tinfo_map, string_map, *fs, err);
+  return CompilerBackend(stage, std::move(program), "output", typeset, tinfo_map, string_map, *fs, runtime::kNumRuntimeFiles, err);
+}
+
+bool BatchMain(const string& manifest, ostream* out, ostream* err, const CompilerOptions& opts) {
+  vector<BatchProgram> programs;
+  if (!ReadManifest(manifest, &programs, err)) {
+    return false;
+  }
+
+  // Every program's file set starts with the runtime and the shared files, so
+  // their units have the same file ids everywhere and can be weeded once.
+  vector<string> shared = SharedFiles(programs);
+  vector<pair<string, string>> leading = RuntimeFiles();
+  uptr<SharedUnits> shared_units;
+  ThreadPool pool(opts.num_threads);
+  {
+    FileSet* fs = nullptr;
+    if (!OpenFiles(shared, nullptr, &fs, err)) {
+      return false;
+    }
+    uptr<FileSet> fs_deleter(fs);
+    int first_shared = leading.size();
+    for (size_t i = 0; i < shared.size(); ++i) {
+      leading.push_back({shared.at(i), fs->Get(first_shared + i)->Contents()});
+    }
+
+    // If a shared file has errors, let each program report them.
+    ErrorList errors;
+    TypeInfoMap tinfo_map = TypeInfoMap::Empty();
+    TypeSet typeset = TypeSet::Empty();
+    ConstStringMap string_map;
+    sptr<const Program> program = CompilerFrontend(CompilerStage::WEED, fs, opts, &typeset, &tinfo_map, &string_map, &errors, &pool);
+    if (!errors.IsFatal() && program->CompUnits().Size() == fs->Size()) {
+      shared_units.reset(new SharedUnits(program->CompUnits()));
+    }
+  }
+
+  // Compile the programs in parallel, each on a single thread, buffering their
+  // diagnostics so they come out in manifest order.
+  struct Result {
+    stringstream err;
+    bool success = false;
+  };
+  vector<Result> results(programs.size());
+  pool.ParallelFor(programs.size(), [&](size_t i) {
+    const BatchProgram& program = programs.at(i);
+    ostream* prog_err = &results.at(i).err;
+    set<string> shared_set(shared.begin(), shared.end());
+
+    // The entry point is in the program's first file, which need not come
+    // right after the runtime, so note which id it gets.
+    const string& entry = program.files.at(0);
+    int entry_fileid = -1;
+    FileSet* fs = nullptr;
+    {
+      ErrorList errors;
+      FileSet::Builder builder;
+      int fileid = 0;
+      for (const auto& file : leading) {
+        if (file.first == entry) {
+          entry_fileid = fileid;
+        }
+        builder.AddStringFile(file.first, file.second);
+        ++fileid;
+      }
+      for (const auto& file : program.files) {
+        if (shared_set.count(file) == 0) {
+          if (file == entry) {
+            entry_fileid = fileid;
+          }
+          builder.AddDiskFile(file);
+          ++fileid;
+        }
+      }
+      if (!builder.Build(&fs, &errors)) {
+        errors.PrintTo(prog_err, base::OutputOptions::kUserOutput, fs);
+        return;
+      }
+    }
+    uptr<FileSet> fs_deleter(fs);
+
+    ErrorList errors;
+    TypeInfoMap tinfo_map = TypeInfoMap::Empty();
+    TypeSet typeset = TypeSet::Empty();
+    ConstStringMap string_map;
+    sptr<const Program> ast = CompilerFrontend(CompilerStage::ALL, fs, opts, &typeset, &tinfo_map, &string_map, &errors, nullptr, shared_units.get());
+    if (PrintErrors(errors, prog_err, fs)) {
+      return;
+    }
+    results.at(i).success = CompilerBackend(CompilerStage::ALL, std::move(ast), program.dir, typeset, tinfo_map, string_map, *fs, entry_fileid, prog_err);
+  });
+
+  bool success = true;
+  for (size_t i = 0; i < programs.size(); ++i) {
+    *err << results.at(i).err.str();
+    *out << programs.at(i).dir << (results.at(i).success ? " ok" : " failed") << '\n';
+    success = success && results.at(i).success;
+  }
+  *out << std::flush;
+  return success;
 }
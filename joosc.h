@@ -4,9 +4,19 @@
 #include "ast/ast_fwd.h"
 #include "base/errorlist.h"
 #include "base/fileset.h"
+#include "base/thread_pool.h"
 #include "ir/ir_generator.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
 #include "types/types.h"
 
+namespace snapshot {
+
+class Snapshot;
+class UnitCache;
+
+} // namespace snapshot
+
 namespace types {
 
 class TypeInfoMap;
@@ -29,13 +39,67 @@ enum class CompilerStage {
   ALL,
 };
 
+struct CompilerOptions {
+  // Files are lexed and parsed on this many threads, or in batch mode whole
+  // programs are compiled on them; the output does not depend on the thread
+  // count.
+  int num_threads = 1;
+
+  // If set, the runtime and the given files are weeded and written to this
+  // snapshot instead of being compiled.
+  string emit_snapshot;
+
+  // If set, the files in this snapshot are compiled along with the given
+  // files, after them, without being lexed, parsed, or weeded again.
+  string snapshot;
+
+  // How files are lexed; every engine gives the same tokens.
+  lexer::LexEngine lex_engine = lexer::LexEngine::STATE_FUNCTIONS;
+
+  // Where parsed AST nodes are allocated.
+  parser::AstAllocation ast_allocation = parser::AstAllocation::HEAP;
+};
+
 // Run the compiler up to and including the indicated stage. The second
 // argument is a list of files to compile.
 bool CompilerMain(CompilerStage stage, const vector<string>& files,
-    std::ostream* out, std::ostream* err);
+    std::ostream* out, std::ostream* err,
+    const CompilerOptions& opts = CompilerOptions());
+
+// Compiles each program listed in manifest into its own output directory, all
+// in one process on opts.num_threads threads. Each line of the manifest names
+// an existing output directory followed by the program's files; blank lines
+// and lines starting with '#' are skipped. Files named by every program, such
+// as the standard library, are lexed, parsed, and weeded only once. Writes
+// each program's directory and whether it compiled to out, and returns
+// whether all of them did.
+bool BatchMain(const string& manifest, std::ostream* out, std::ostream* err,
+    const CompilerOptions& opts = CompilerOptions());
+
+// Loads the snapshot at path, checking that it was built from this compiler's
+// runtime.
+bool LoadSnapshot(const string& path, uptr<snapshot::Snapshot>* out, std::ostream* err);
+
+// Opens the runtime files followed by files, or lets snapshot lay out the file
+// set if it is non-null.
+bool OpenFiles(const vector<string>& files, snapshot::Snapshot* snapshot, base::FileSet** fs_out, std::ostream* err);
+
+// Lexes and parses each file on pool, or serially if pool is null, before
+// weeding and type-checking the whole program. Files with a unit in cache are
+// taken from it instead of being lexed, parsed, and weeded, and cache is given
+// the weeded units if weeding succeeds. Type-checking reuses units from
+// typecheck_cache whose dependencies did not change. Files are lexed with
+// opts.lex_engine and their ASTs allocated as opts.ast_allocation says; the
+// other options are left to the caller.
+sptr<const ast::Program> CompilerFrontend(CompilerStage stage, const base::FileSet* fs, const CompilerOptions& opts, types::TypeSet* typeset_out, types::TypeInfoMap* tinfo_out, types::ConstStringMap* string_map_out, base::ErrorList* err_out, base::ThreadPool* pool = nullptr, snapshot::UnitCache* cache = nullptr, types::TypecheckCache* typecheck_cache = nullptr);
 
-sptr<const ast::Program> CompilerFrontend(CompilerStage stage, const base::FileSet* fs, types::TypeSet* typeset_out, types::TypeInfoMap* tinfo_out, types::ConstStringMap* string_map_out, base::ErrorList* err_out);
+// The contents last written to each output file, by file name.
+using OutputCache = map<string, string>;
 
-bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const string& dir, const types::TypeInfoMap& tinfo_map, const types::ConstStringMap& string_map, const base::FileSet& fs, std::ostream* err);
+// Writes the program's assembly to dir. If cache is non-null, output files
+// whose contents match the cache are left untouched. prog is dropped once the
+// IR is built, so pass the last reference to free the AST early. The program's
+// entry point is looked for in the file with id entry_fileid.
+bool CompilerBackend(CompilerStage stage, sptr<const ast::Program> prog, const string& dir, const types::TypeSet& typeset, const types::TypeInfoMap& tinfo_map, const types::ConstStringMap& string_map, const base::FileSet& fs, int entry_fileid, std::ostream* err, OutputCache* cache = nullptr);
 
 #endif
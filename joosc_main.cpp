@@ -1,5 +1,7 @@
+#include <cstdlib>
 #include <iostream>
 
+#include "compile_server.h"
 #include "joosc.h"
 
 using std::cout;
@@ -8,18 +10,109 @@ using std::endl;
 
 int main(int argc, char** argv) {
   const int ERROR = 42;
+  const char* kUsage =
+      "usage: joosc [-j N] [--lexer=ENGINE] [--ast=ALLOC] [--snapshot=FILE] [--serve] <filename>...\n"
+      "       joosc [-j N] [--lexer=ENGINE] [--ast=ALLOC] --emit-snapshot=FILE <filename>...\n"
+      "       joosc [-j N] [--lexer=ENGINE] [--ast=ALLOC] --batch MANIFEST\n"
+      "ENGINE is \"states\" (the default) or \"dfa\".\n"
+      "ALLOC is \"heap\" (the default) or \"arena\".";
+  const string kSnapshotFlag = "--snapshot=";
+  const string kEmitSnapshotFlag = "--emit-snapshot=";
+  const string kLexerFlag = "--lexer=";
+  const string kAstFlag = "--ast=";
 
-  if (argc < 2) {
-    cerr << "usage: joosc <filename>..." << endl;
+  vector<string> files;
+  CompilerOptions opts;
+  bool serve = false;
+  string batch;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "--serve") {
+      serve = true;
+      continue;
+    }
+    if (arg == "--batch") {
+      if (i + 1 == argc) {
+        cerr << kUsage << endl;
+        return ERROR;
+      }
+      ++i;
+      batch = argv[i];
+      continue;
+    }
+    if (arg.compare(0, kSnapshotFlag.size(), kSnapshotFlag) == 0) {
+      opts.snapshot = arg.substr(kSnapshotFlag.size());
+      continue;
+    }
+    if (arg.compare(0, kEmitSnapshotFlag.size(), kEmitSnapshotFlag) == 0) {
+      opts.emit_snapshot = arg.substr(kEmitSnapshotFlag.size());
+      continue;
+    }
+    if (arg.compare(0, kLexerFlag.size(), kLexerFlag) == 0) {
+      string engine = arg.substr(kLexerFlag.size());
+      if (engine == "states") {
+        opts.lex_engine = lexer::LexEngine::STATE_FUNCTIONS;
+      } else if (engine == "dfa") {
+        opts.lex_engine = lexer::LexEngine::DFA;
+      } else {
+        cerr << kUsage << endl;
+        return ERROR;
+      }
+      continue;
+    }
+    if (arg.compare(0, kAstFlag.size(), kAstFlag) == 0) {
+      string allocation = arg.substr(kAstFlag.size());
+      if (allocation == "heap") {
+        opts.ast_allocation = parser::AstAllocation::HEAP;
+      } else if (allocation == "arena") {
+        opts.ast_allocation = parser::AstAllocation::ARENA;
+      } else {
+        cerr << kUsage << endl;
+        return ERROR;
+      }
+      continue;
+    }
+    if (arg.compare(0, 2, "-j") != 0) {
+      files.emplace_back(arg);
+      continue;
+    }
+
+    // Accept both "-j N" and "-jN".
+    string value = arg.substr(2);
+    if (value.empty() && i + 1 < argc) {
+      ++i;
+      value = argv[i];
+    }
+    opts.num_threads = atoi(value.c_str());
+    if (opts.num_threads < 1) {
+      cerr << kUsage << endl;
+      return ERROR;
+    }
+  }
+
+  if (!batch.empty()) {
+    if (!files.empty() || serve || !opts.snapshot.empty() || !opts.emit_snapshot.empty()) {
+      cerr << kUsage << endl;
+      return ERROR;
+    }
+    return BatchMain(batch, &cout, &cerr, opts) ? 0 : ERROR;
+  }
+
+  if (files.empty() || (!opts.snapshot.empty() && !opts.emit_snapshot.empty()) ||
+      (serve && !opts.emit_snapshot.empty())) {
+    cerr << kUsage << endl;
     return ERROR;
   }
 
-  vector<string> files;
-  for (int i = 1; i < argc; ++i) {
-    files.emplace_back(argv[i]);
+  if (serve) {
+    CompileServer server(files, opts, "output");
+    if (!server.Init(&cerr) || !server.Watch(&cerr)) {
+      return ERROR;
+    }
+    return 0;
   }
 
-  bool success = CompilerMain(CompilerStage::ALL, files, &cout, &cerr);
+  bool success = CompilerMain(CompilerStage::ALL, files, &cout, &cerr, opts);
   int retcode = success ? 0 : ERROR;
   return retcode;
 }
@@ -0,0 +1,242 @@
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+
+#include "ast/ast.h"
+#include "base/file_walker.h"
+#include "gtest/gtest.h"
+#include "joosc.h"
+#include "runtime/runtime.h"
+#include "types/type_info_map.h"
+#include "types/typeset.h"
+
+using ast::Program;
+using base::ErrorList;
+using base::FileSet;
+using base::ThreadPool;
+using types::ConstStringMap;
+using types::TypeInfoMap;
+using types::TypeSet;
+
+namespace {
+
+const static string kStdlib5 = "third_party/cs444/stdlib/5.0";
+
+const static string kTest5 = "third_party/cs444/assignment_testcases/a5";
+
+bool EndsWith(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Appends the files under dir whose names end in suffix to out.
+void ListFiles(const string& dir, const string& suffix, vector<string>* out) {
+  auto cb = [&](const dirent& ent) {
+    string basename = string(ent.d_name);
+    if (basename == "." || basename == "..") {
+      return true;
+    }
+    string fullname = dir + '/' + basename;
+    if (ent.d_type == DT_DIR) {
+      ListFiles(fullname, suffix, out);
+    } else if (EndsWith(basename, suffix)) {
+      out->push_back(fullname);
+    }
+    return true;
+  };
+  ASSERT_TRUE(base::WalkDir(dir, cb)) << dir;
+}
+
+string ReadFile(const string& path) {
+  std::ifstream in(path);
+  stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// Makes an empty directory for output named name.
+string TempDir(const string& name) {
+  const char* dir = getenv("TEST_TMPDIR");
+  string path = string(dir == nullptr ? "/tmp" : dir) + "/" + name;
+  EXPECT_TRUE(mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) << path;
+  vector<string> old;
+  ListFiles(path, "", &old);
+  for (const string& file : old) {
+    EXPECT_EQ(0, remove(file.c_str())) << file;
+  }
+  return path;
+}
+
+// The files or directories holding each a5 test program.
+vector<string> A5Tests() {
+  vector<string> tests;
+  auto cb = [&](const dirent& ent) {
+    string basename = string(ent.d_name);
+    if (basename != "." && basename != "..") {
+      tests.push_back(kTest5 + '/' + basename);
+    }
+    return true;
+  };
+  CHECK(base::WalkDir(kTest5, cb));
+  std::sort(tests.begin(), tests.end());
+  return tests;
+}
+
+} // namespace
+
+class BatchMainTest : public ::testing::Test {
+ protected:
+  static string WriteManifest(const string& name, const string& contents) {
+    string path = TempDir("manifests") + "/" + name;
+    std::ofstream out(path);
+    out << contents;
+    EXPECT_TRUE((bool)(out << std::flush)) << path;
+    return path;
+  }
+
+  // A manifest line compiling test against the standard library into dir.
+  static string ProgramLine(const string& dir, const string& test) {
+    vector<string> stdlib;
+    ListFiles(kStdlib5, ".java", &stdlib);
+    string line = dir + ' ' + kTest5 + '/' + test;
+    for (const string& file : stdlib) {
+      line += ' ' + file;
+    }
+    return line + '\n';
+  }
+
+  // Whether some assembly file in dir defines the program's entry point.
+  static bool DefinesEntry(const string& dir) {
+    vector<string> files;
+    ListFiles(dir, ".s", &files);
+    for (const string& file : files) {
+      if (("\n" + ReadFile(file)).find("\n_entry:") != string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+TEST_F(BatchMainTest, SharedStdlib) {
+  string dir1 = TempDir("shared1");
+  string dir2 = TempDir("shared2");
+  string manifest = WriteManifest("shared",
+      ProgramLine(dir1, "J1_01.java") +
+      ProgramLine(dir2, "J1_300locals.java"));
+
+  stringstream out;
+  stringstream err;
+  EXPECT_TRUE(BatchMain(manifest, &out, &err));
+  EXPECT_EQ(dir1 + " ok\n" + dir2 + " ok\n", out.str());
+  EXPECT_EQ("", err.str());
+  EXPECT_TRUE(DefinesEntry(dir1));
+  EXPECT_TRUE(DefinesEntry(dir2));
+}
+
+TEST_F(BatchMainTest, SkipsBlankLinesAndComments) {
+  string dir = TempDir("comments");
+  string manifest = WriteManifest("comments",
+      "# Programs to compile.\n"
+      "\n" +
+      ProgramLine(dir, "J1_01.java") +
+      "   \n"
+      "#" + dir + " " + kTest5 + "/J1_300locals.java\n");
+
+  stringstream out;
+  stringstream err;
+  EXPECT_TRUE(BatchMain(manifest, &out, &err));
+  EXPECT_EQ(dir + " ok\n", out.str());
+  EXPECT_EQ("", err.str());
+  EXPECT_TRUE(DefinesEntry(dir));
+}
+
+TEST_F(BatchMainTest, NoFilesForDir) {
+  string dir = TempDir("nofiles");
+  string manifest = WriteManifest("nofiles",
+      ProgramLine(dir, "J1_01.java") +
+      dir + "\n");
+
+  stringstream out;
+  stringstream err;
+  EXPECT_FALSE(BatchMain(manifest, &out, &err));
+  EXPECT_EQ("", out.str());
+  EXPECT_EQ(manifest + ":2: no files given for " + dir + "\n", err.str());
+}
+
+TEST_F(BatchMainTest, MissingManifest) {
+  stringstream out;
+  stringstream err;
+  string manifest = TempDir("missing") + "/manifest";
+  EXPECT_FALSE(BatchMain(manifest, &out, &err));
+  EXPECT_EQ("", out.str());
+  EXPECT_EQ("joosc: could not open manifest " + manifest + "\n", err.str());
+}
+
+// Compiles each a5 program with the default options and again with its AST in
+// arenas, lexed by the DFA, on several threads, and checks that the assembly
+// is the same. The arena AST is weeded, type-checked, rewritten, and dropped
+// once the IR is built, as in a normal compile.
+class ArenaAstTest : public ::testing::TestWithParam<string> {
+ protected:
+  // Compiles the program into the directory named name, returning the contents
+  // of each output file by name.
+  map<string, string> Compile(const CompilerOptions& opts, const string& name) {
+    vector<string> files;
+    if (EndsWith(GetParam(), ".java")) {
+      files.push_back(GetParam());
+    } else {
+      ListFiles(GetParam(), ".java", &files);
+    }
+    ListFiles(kStdlib5, ".java", &files);
+
+    stringstream err;
+    FileSet* fs = nullptr;
+    EXPECT_TRUE(OpenFiles(files, nullptr, &fs, &err)) << err.str();
+    if (fs == nullptr) {
+      return {};
+    }
+    uptr<FileSet> fs_deleter(fs);
+
+    ErrorList errors;
+    TypeInfoMap tinfo_map = TypeInfoMap::Empty();
+    TypeSet typeset = TypeSet::Empty();
+    ConstStringMap string_map;
+    ThreadPool pool(opts.num_threads);
+    sptr<const Program> program = CompilerFrontend(CompilerStage::ALL, fs, opts, &typeset, &tinfo_map, &string_map, &errors, &pool);
+    EXPECT_FALSE(errors.IsFatal()) << testing::PrintToString(errors);
+    if (errors.IsFatal()) {
+      return {};
+    }
+
+    string dir = TempDir(name);
+    EXPECT_TRUE(CompilerBackend(CompilerStage::ALL, std::move(program), dir, typeset, tinfo_map, string_map, *fs, runtime::kNumRuntimeFiles, &err)) << err.str();
+
+    vector<string> outputs;
+    ListFiles(dir, "", &outputs);
+    map<string, string> contents;
+    for (const string& output : outputs) {
+      contents[output.substr(dir.size() + 1)] = ReadFile(output);
+    }
+    return contents;
+  }
+};
+
+TEST_P(ArenaAstTest, SameOutput) {
+  CompilerOptions arena;
+  arena.num_threads = 4;
+  arena.lex_engine = lexer::LexEngine::DFA;
+  arena.ast_allocation = parser::AstAllocation::ARENA;
+
+  map<string, string> expected = Compile(CompilerOptions(), "heap");
+  map<string, string> actual = Compile(arena, "arena");
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(expected.size(), actual.size());
+  for (const auto& output : expected) {
+    auto iter = actual.find(output.first);
+    ASSERT_TRUE(iter != actual.end()) << output.first;
+    EXPECT_TRUE(iter->second == output.second) << output.first;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(MarmosetA5, ArenaAstTest, testing::ValuesIn(A5Tests()));
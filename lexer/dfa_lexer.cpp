@@ -0,0 +1,336 @@
+#include "lexer/dfa_lexer.h"
+
+#include <cstring>
+
+#include "lexer/lexer_error.h"
+#include "lexer/scan.h"
+#include "std.h"
+
+using base::ErrorList;
+using base::File;
+using base::Pos;
+using base::PosRange;
+
+namespace lexer {
+namespace internal {
+
+namespace {
+
+// The spelling of every symbol in kEntries, longest first; lexer_test checks
+// that the two agree.
+struct SymbolSpelling {
+  const char* str;
+  TokenType type;
+};
+
+constexpr SymbolSpelling kSymbols[] = {
+    {"<=", LE},     {">=", GE},     {"==", EQ},    {"!=", NEQ},
+    {"&&", AND},    {"||", OR},     {"++", INCR},  {"--", DECR},
+    {"+", ADD},     {"-", SUB},     {"*", MUL},    {"/", DIV},
+    {"%", MOD},     {"<", LT},      {">", GT},     {"&", BAND},
+    {"|", BOR},     {"^", XOR},     {"!", NOT},    {"=", ASSG},
+    {"(", LPAREN},  {")", RPAREN},  {"{", LBRACE}, {"}", RBRACE},
+    {"[", LBRACK},  {"]", RBRACK},  {";", SEMI},   {",", COMMA},
+    {".", DOT},
+};
+
+constexpr int kNumSymbols = sizeof(kSymbols) / sizeof(kSymbols[0]);
+
+// The states that do not come from kSymbols. Each symbol prefix gets a state
+// numbered from S_FIRST_SYMBOL.
+enum State : u8 {
+  S_START,
+  S_IDENTIFIER,
+  S_ZERO,
+  S_INTEGER,
+  S_CHAR_OPEN,
+  S_CHAR_ESCAPE,
+  S_CHAR_OCTAL_LOW1,   // After one octal digit in 0-3; two more may follow.
+  S_CHAR_OCTAL_LOW2,
+  S_CHAR_OCTAL_HIGH1,  // After one octal digit in 4-7; one more may follow.
+  S_CHAR_BODY,
+  S_CHAR_CLOSE,
+  S_STRING,
+  S_STRING_ESCAPE,
+  S_STRING_OCTAL_LOW1,
+  S_STRING_OCTAL_LOW2,
+  S_STRING_OCTAL_HIGH1,
+  S_STRING_CLOSE,
+  S_FIRST_SYMBOL,
+};
+
+// Table entries that stop the scan. The cursor is at the character whose
+// column was looked up, which is not part of the token.
+enum Action : u8 {
+  A_EMIT = 128,  // The current state accepts; emit its token.
+  // Runs of whitespace and comments are long, so the scan kernels find where
+  // they end instead of the table.
+  A_WHITESPACE,
+  A_LINE_COMMENT,   // The cursor is at the second '/'.
+  A_BLOCK_COMMENT,  // The cursor is at the '*'.
+  A_UNEXPECTED_CHAR,
+  A_LEADING_ZERO,
+  A_UNCLOSED_BLOCK_COMMENT,
+  A_UNCLOSED_STRING,
+  A_INVALID_CHAR_LIT,
+  A_INVALID_CHAR_ESCAPE,
+  A_INVALID_STRING_ESCAPE,
+};
+
+constexpr int kEof = 128;  // The column looked up at the end of the file.
+constexpr int kNumColumns = kEof + 1;
+
+constexpr int TotalSymbolLength() {
+  int len = 0;
+  for (int i = 0; i < kNumSymbols; ++i) {
+    for (const char* c = kSymbols[i].str; *c != '\0'; ++c) {
+      ++len;
+    }
+  }
+  return len;
+}
+
+constexpr int kMaxStates = S_FIRST_SYMBOL + TotalSymbolLength();
+static_assert(kMaxStates <= A_EMIT, "DFA states overlap actions");
+
+struct Dfa {
+  u8 next[kMaxStates][kNumColumns];
+  u8 accepts[kMaxStates];  // A TokenType, or NUM_TOKEN_TYPES.
+  int num_states;
+};
+
+constexpr bool IsWhitespace(int c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+constexpr bool IsNumeric(int c) { return '0' <= c && c <= '9'; }
+constexpr bool IsOctal(int c) { return '0' <= c && c <= '7'; }
+
+constexpr bool IsIdentifierStart(int c) {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_' ||
+         c == '$';
+}
+
+constexpr bool IsIdentifierChar(int c) {
+  return IsIdentifierStart(c) || IsNumeric(c);
+}
+
+constexpr bool IsNonOctalEscape(int c) {
+  return c == 'b' || c == 't' || c == 'n' || c == 'f' || c == 'r' ||
+         c == '\'' || c == '"' || c == '\\';
+}
+
+constexpr void Fill(Dfa& dfa, int state, u8 next) {
+  for (int c = 0; c < kNumColumns; ++c) {
+    dfa.next[state][c] = next;
+  }
+}
+
+// Characters after an escape: the escaped char itself, or up to three octal
+// digits with a value of at most 255. Callers fill in what follows a shorter
+// octal escape.
+constexpr void AddEscape(Dfa& dfa, int escape, int done, int low1, int low2,
+                         int high1) {
+  for (int c = 0; c < kNumColumns; ++c) {
+    if (IsNonOctalEscape(c)) {
+      dfa.next[escape][c] = done;
+    } else if ('0' <= c && c <= '3') {
+      dfa.next[escape][c] = low1;
+    } else if (IsOctal(c)) {
+      dfa.next[escape][c] = high1;
+    }
+  }
+  for (int c = '0'; c <= '7'; ++c) {
+    dfa.next[low1][c] = low2;
+    dfa.next[low2][c] = done;
+    dfa.next[high1][c] = done;
+  }
+}
+
+constexpr void AddStringBody(Dfa& dfa, int state) {
+  Fill(dfa, state, S_STRING);
+  dfa.next[state]['"'] = S_STRING_CLOSE;
+  dfa.next[state]['\\'] = S_STRING_ESCAPE;
+  dfa.next[state]['\n'] = A_UNCLOSED_STRING;
+  dfa.next[state][kEof] = A_UNCLOSED_STRING;
+}
+
+constexpr Dfa BuildDfa() {
+  Dfa dfa = {};
+  for (int s = 0; s < kMaxStates; ++s) {
+    Fill(dfa, s, A_EMIT);
+    dfa.accepts[s] = NUM_TOKEN_TYPES;
+  }
+
+  Fill(dfa, S_START, A_UNEXPECTED_CHAR);
+  for (int c = 0; c < kEof; ++c) {
+    if (IsWhitespace(c)) {
+      dfa.next[S_START][c] = A_WHITESPACE;
+    }
+    if (IsIdentifierStart(c)) {
+      dfa.next[S_START][c] = S_IDENTIFIER;
+    }
+    if (IsIdentifierChar(c)) {
+      dfa.next[S_IDENTIFIER][c] = S_IDENTIFIER;
+    }
+    if (IsNumeric(c)) {
+      dfa.next[S_START][c] = (c == '0') ? S_ZERO : S_INTEGER;
+      dfa.next[S_ZERO][c] = A_LEADING_ZERO;
+      dfa.next[S_INTEGER][c] = S_INTEGER;
+    }
+  }
+  dfa.accepts[S_IDENTIFIER] = IDENTIFIER;
+  dfa.accepts[S_ZERO] = INTEGER;
+  dfa.accepts[S_INTEGER] = INTEGER;
+
+  // Symbols form a trie hanging off the start state; since every prefix of a
+  // symbol is itself a symbol, stopping at the first missing transition gives
+  // the longest match.
+  int num_states = S_FIRST_SYMBOL;
+  for (int i = 0; i < kNumSymbols; ++i) {
+    int state = S_START;
+    for (const char* c = kSymbols[i].str; *c != '\0'; ++c) {
+      if (dfa.next[state][(int)*c] >= A_EMIT) {
+        dfa.next[state][(int)*c] = num_states++;
+      }
+      state = dfa.next[state][(int)*c];
+    }
+    dfa.accepts[state] = kSymbols[i].type;
+  }
+
+  // Comments start from the "/" symbol's state.
+  int slash = dfa.next[S_START]['/'];
+  dfa.next[slash]['/'] = A_LINE_COMMENT;
+  dfa.next[slash]['*'] = A_BLOCK_COMMENT;
+
+  // Character literals hold exactly one char or escape.
+  dfa.next[S_START]['\''] = S_CHAR_OPEN;
+  Fill(dfa, S_CHAR_OPEN, S_CHAR_BODY);
+  dfa.next[S_CHAR_OPEN]['\\'] = S_CHAR_ESCAPE;
+  dfa.next[S_CHAR_OPEN]['\''] = A_INVALID_CHAR_LIT;
+  dfa.next[S_CHAR_OPEN]['\n'] = A_INVALID_CHAR_LIT;
+  dfa.next[S_CHAR_OPEN][kEof] = A_INVALID_CHAR_LIT;
+  Fill(dfa, S_CHAR_ESCAPE, A_INVALID_CHAR_ESCAPE);
+  for (int s : {S_CHAR_OCTAL_LOW1, S_CHAR_OCTAL_LOW2, S_CHAR_OCTAL_HIGH1, S_CHAR_BODY}) {
+    Fill(dfa, s, A_INVALID_CHAR_LIT);
+    dfa.next[s]['\''] = S_CHAR_CLOSE;
+  }
+  AddEscape(dfa, S_CHAR_ESCAPE, S_CHAR_BODY, S_CHAR_OCTAL_LOW1,
+            S_CHAR_OCTAL_LOW2, S_CHAR_OCTAL_HIGH1);
+  dfa.accepts[S_CHAR_CLOSE] = CHAR;
+
+  // String literals run to the closing quote on the same line.
+  dfa.next[S_START]['"'] = S_STRING;
+  for (int s : {S_STRING, S_STRING_OCTAL_LOW1, S_STRING_OCTAL_LOW2, S_STRING_OCTAL_HIGH1}) {
+    AddStringBody(dfa, s);
+  }
+  Fill(dfa, S_STRING_ESCAPE, A_INVALID_STRING_ESCAPE);
+  AddEscape(dfa, S_STRING_ESCAPE, S_STRING, S_STRING_OCTAL_LOW1,
+            S_STRING_OCTAL_LOW2, S_STRING_OCTAL_HIGH1);
+  dfa.accepts[S_STRING_CLOSE] = STRING;
+
+  dfa.num_states = num_states;
+  return dfa;
+}
+
+constexpr Dfa kDfa = BuildDfa();
+
+// Only accepting states may stop with A_EMIT, so a scan never has to back up
+// to an earlier accepting state.
+constexpr bool DfaIsWellFormed() {
+  for (int s = S_START + 1; s < kDfa.num_states; ++s) {
+    if (kDfa.accepts[s] != NUM_TOKEN_TYPES) {
+      continue;
+    }
+    for (int c = 0; c < kNumColumns; ++c) {
+      if (kDfa.next[s][c] == A_EMIT) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(DfaIsWellFormed(), "a non-accepting DFA state can emit");
+
+base::Error* MakeDfaError(u8 action, int fileid, int begin, int end) {
+  switch (action) {
+    case A_UNEXPECTED_CHAR:
+      return new UnexpectedCharError(Pos(fileid, begin));
+    case A_LEADING_ZERO:
+      return new LeadingZeroInIntLitError(Pos(fileid, begin));
+    case A_UNCLOSED_BLOCK_COMMENT:
+      return new UnclosedBlockCommentError(PosRange(fileid, begin, begin + 2));
+    case A_UNCLOSED_STRING:
+      return new UnclosedStringLitError(Pos(fileid, begin));
+    case A_INVALID_CHAR_LIT:
+      return new InvalidCharacterLitError(PosRange(fileid, begin, end));
+    case A_INVALID_CHAR_ESCAPE:
+      return new InvalidCharacterEscapeError(PosRange(fileid, begin, end));
+    case A_INVALID_STRING_ESCAPE:
+      // The escape starts at the backslash just before the cursor.
+      return new InvalidCharacterEscapeError(PosRange(fileid, end - 1, end));
+    default:
+      UNREACHABLE();
+  }
+}
+
+}  // namespace
+
+void LexWithDfa(const File* file, int fileid, TokenSink* tokens_out,
+                ErrorList* errors_out) {
+  const u8* buf = file->Data();
+  const int size = file->Size();
+  const ScanKernels& kernels = FastestScanKernels();
+
+  int begin = 0;
+  while (begin < size) {
+    int state = S_START;
+    int end = begin;
+    u8 next = kDfa.next[state][buf[end]];
+    while (next < A_EMIT) {
+      state = next;
+      ++end;
+      next = kDfa.next[state][end < size ? buf[end] : kEof];
+    }
+
+    TokenType type = NUM_TOKEN_TYPES;
+    switch (next) {
+      case A_EMIT:
+        type = (TokenType)kDfa.accepts[state];
+        if (type == IDENTIFIER) {
+          type = MatchKeyword(buf + begin, end - begin);
+        }
+        break;
+      case A_WHITESPACE:
+        type = WHITESPACE;
+        end = kernels.skip_whitespace(buf, begin, size);
+        break;
+      case A_LINE_COMMENT: {
+        // glibc's memchr is already vectorized.
+        type = LINE_COMMENT;
+        const void* newline = memchr(buf + end + 1, '\n', size - end - 1);
+        end = (newline == nullptr) ? size : (const u8*)newline - buf + 1;
+        break;
+      }
+      case A_BLOCK_COMMENT:
+        type = BLOCK_COMMENT;
+        end = kernels.find_block_comment_end(buf, end + 1, size);
+        if (end == size) {
+          errors_out->Append(MakeDfaError(A_UNCLOSED_BLOCK_COMMENT, fileid, begin, end));
+          return;
+        }
+        end += 2;
+        break;
+      default:
+        errors_out->Append(MakeDfaError(next, fileid, begin, end));
+        return;
+    }
+
+    tokens_out->Emit(type, PosRange(fileid, begin, end));
+    begin = end;
+  }
+}
+
+}  // namespace internal
+}  // namespace lexer
@@ -0,0 +1,20 @@
+#ifndef LEXER_DFA_LEXER_H
+#define LEXER_DFA_LEXER_H
+
+#include "base/errorlist.h"
+#include "base/file.h"
+#include "lexer/lexer.h"
+#include "lexer/token_sink.h"
+
+namespace lexer {
+namespace internal {
+
+// Lexes file with a transition table built at compile time; see
+// LexEngine::DFA. The file must already be known to be ASCII.
+void LexWithDfa(const base::File* file, int fileid, TokenSink* tokens_out,
+                base::ErrorList* errors_out);
+
+}  // namespace internal
+}  // namespace lexer
+
+#endif
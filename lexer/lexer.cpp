@@ -1,6 +1,12 @@
 #include "lexer/lexer.h"
 
+#include <cstring>
+
+#include "lexer/dfa_lexer.h"
 #include "lexer/lexer_error.h"
+#include "lexer/scan.h"
+#include "lexer/token_buffer.h"
+#include "lexer/token_sink.h"
 #include "std.h"
 
 using base::Error;
@@ -123,7 +129,7 @@ const TokenTypeInfo& Token::TypeInfo() const {
 namespace internal {
 
 struct LexState {
-  LexState(const FileSet* fs, const File* file, int fileid, vector<Token>* tokens,
+  LexState(const FileSet* fs, const File* file, int fileid, TokenSink* tokens,
            base::ErrorList* errors)
       : fs(fs), file(file), fileid(fileid), tokens(tokens), errors(errors) {}
 
@@ -162,7 +168,7 @@ struct LexState {
   // and ending at the cursor.
   void EmitToken(TokenType tok) {
     CHECK(begin < end);
-    tokens->push_back(Token(tok, PosRange(fileid, begin, end)));
+    tokens->Emit(tok, PosRange(fileid, begin, end));
     begin = end;
   }
 
@@ -195,7 +201,7 @@ struct LexState {
   int begin = 0;
   int end = 0;
 
-  vector<Token>* tokens;
+  TokenSink* tokens;
   base::ErrorList* errors;
 
   StateFn stateFn;
@@ -225,39 +231,129 @@ bool IsStringEscapable(u8 c) {
          c == '\'' || c == '"' || c == '\\' || IsOctal(c);
 }
 
-bool PosRangeStringMatches(const FileSet* fs, const PosRange& range,
-                           const string& s) {
-  if ((int)s.size() != range.end - range.begin) {
-    return false;
+// The spelling of every keyword in kEntries; lexer_test checks that the two
+// agree.
+struct KeywordSpelling {
+  const char* str;
+  int len;
+  TokenType type;
+};
+
+constexpr KeywordSpelling kKeywords[] = {
+    {"abstract", 8, K_ABSTRACT},
+    {"default", 7, K_DEFAULT},
+    {"if", 2, K_IF},
+    {"private", 7, K_PRIVATE},
+    {"this", 4, K_THIS},
+    {"boolean", 7, K_BOOL},
+    {"do", 2, K_DO},
+    {"implements", 10, K_IMPLEMENTS},
+    {"protected", 9, K_PROTECTED},
+    {"throw", 5, K_THROW},
+    {"break", 5, K_BREAK},
+    {"double", 6, K_DOUBLE},
+    {"import", 6, K_IMPORT},
+    {"public", 6, K_PUBLIC},
+    {"throws", 6, K_THROWS},
+    {"byte", 4, K_BYTE},
+    {"else", 4, K_ELSE},
+    {"instanceof", 10, K_INSTANCEOF},
+    {"return", 6, K_RETURN},
+    {"transient", 9, K_TRANSIENT},
+    {"case", 4, K_CASE},
+    {"extends", 7, K_EXTENDS},
+    {"int", 3, K_INT},
+    {"short", 5, K_SHORT},
+    {"try", 3, K_TRY},
+    {"catch", 5, K_CATCH},
+    {"final", 5, K_FINAL},
+    {"interface", 9, K_INTERFACE},
+    {"static", 6, K_STATIC},
+    {"void", 4, K_VOID},
+    {"char", 4, K_CHAR},
+    {"finally", 7, K_FINALLY},
+    {"long", 4, K_LONG},
+    {"strictfp", 8, K_STRICTFP},
+    {"volatile", 8, K_VOLATILE},
+    {"class", 5, K_CLASS},
+    {"float", 5, K_FLOAT},
+    {"native", 6, K_NATIVE},
+    {"super", 5, K_SUPER},
+    {"while", 5, K_WHILE},
+    {"const", 5, K_CONST},
+    {"for", 3, K_FOR},
+    {"new", 3, K_NEW},
+    {"switch", 6, K_SWITCH},
+    {"continue", 8, K_CONTINUE},
+    {"goto", 4, K_GOTO},
+    {"package", 7, K_PACKAGE},
+    {"synchronized", 12, K_SYNCHRONIZED},
+    {"true", 4, K_TRUE},
+    {"false", 5, K_FALSE},
+    {"null", 4, K_NULL},
+};
+
+constexpr int kNumKeywords = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr int kMinKeywordLen = 2;
+constexpr int kMaxKeywordLen = 12;
+constexpr int kKeywordHashSize = 256;
+
+// Hashes a string of at least kMinKeywordLen chars. The multipliers were
+// picked so that no two keywords collide; KeywordHashIsPerfect checks this,
+// along with the lengths in kKeywords.
+constexpr int KeywordHash(u8 first, u8 second, u8 last, int len) {
+  return (first + 5 * second + 19 * last + len) & (kKeywordHashSize - 1);
+}
+
+constexpr int KeywordHash(const char* s, int len) {
+  return KeywordHash(s[0], s[1], s[len - 1], len);
+}
+
+constexpr int Length(const char* s) {
+  int len = 0;
+  while (s[len] != '\0') {
+    ++len;
   }
-  File* f = fs->Get(range.fileid);
-  for (u64 i = 0; i < s.size(); ++i) {
-    if (s[i] != f->At(range.begin + i)) {
+  return len;
+}
+
+constexpr bool KeywordHashIsPerfect() {
+  for (int i = 0; i < kNumKeywords; ++i) {
+    if (kKeywords[i].len != Length(kKeywords[i].str) ||
+        kKeywords[i].len < kMinKeywordLen || kKeywords[i].len > kMaxKeywordLen) {
       return false;
     }
+    for (int j = 0; j < i; ++j) {
+      if (KeywordHash(kKeywords[i].str, kKeywords[i].len) ==
+          KeywordHash(kKeywords[j].str, kKeywords[j].len)) {
+        return false;
+      }
+    }
   }
   return true;
 }
 
-/**
- * Tries to match a string with all tokens/reserved words.
- * Returns the type of the keyword, or IDENTIFIER if no keywords were matched.
- */
-TokenType MatchKeywords(const FileSet* fs, const PosRange& range) {
-  for (int i = 0; i < NUM_TOKEN_TYPES; ++i) {
-    const TokenTypeInfo& typeInfo = TokenTypeInfo::kEntries[i];
-    if (!typeInfo.IsKeyword()) {
-      continue;
-    }
+static_assert(KeywordHashIsPerfect(),
+              "keyword hash has a collision; pick new multipliers");
 
-    if (PosRangeStringMatches(fs, range, typeInfo.Value())) {
-      return typeInfo.Type();
-    }
-  }
+// Maps each hash value to an index into kKeywords, or -1.
+struct KeywordTable {
+  i8 slots[kKeywordHashSize];
+};
 
-  return IDENTIFIER;
+constexpr KeywordTable BuildKeywordTable() {
+  KeywordTable table = {};
+  for (int i = 0; i < kKeywordHashSize; ++i) {
+    table.slots[i] = -1;
+  }
+  for (int i = 0; i < kNumKeywords; ++i) {
+    table.slots[KeywordHash(kKeywords[i].str, kKeywords[i].len)] = i;
+  }
+  return table;
 }
 
+constexpr KeywordTable kKeywordTable = BuildKeywordTable();
+
 void Start(LexState* state);
 void Integer(LexState* state);
 void Whitespace(LexState* state);
@@ -336,9 +432,8 @@ void Integer(LexState* state) {
 }
 
 void Whitespace(LexState* state) {
-  while (!state->IsAtEnd() && IsWhitespace(state->Peek())) {
-    state->Advance();
-  }
+  state->end = FastestScanKernels().skip_whitespace(
+      state->file->Data(), state->end, state->file->Size());
 
   state->EmitToken(WHITESPACE);
   state->SetNextState(&Start);
@@ -347,15 +442,10 @@ void Whitespace(LexState* state) {
 void LineComment(LexState* state) {
   state->Advance(2);  // Advance past the "//".
 
-  while (!state->IsAtEnd()) {
-    // TODO: handle windows newlines?
-    u8 next = state->Peek();
-    state->Advance();
-
-    if (next == '\n') {
-      break;
-    }
-  }
+  // TODO: handle windows newlines?
+  const u8* buf = state->file->Data();
+  const void* newline = memchr(buf + state->end, '\n', state->file->Size() - state->end);
+  state->end = (newline == nullptr) ? state->file->Size() : (const u8*)newline - buf + 1;
 
   state->EmitToken(LINE_COMMENT);
   state->SetNextState(&Start);
@@ -364,23 +454,14 @@ void LineComment(LexState* state) {
 void BlockComment(LexState* state) {
   state->Advance(2);  // Advance past the "/*".
 
-  bool prevStar = false;
-
-  while (true) {
-    if (state->IsAtEnd()) {
-      state->EmitFatal(new UnclosedBlockCommentError(
-          PosRange(state->fileid, state->begin, state->begin + 2)));
-      return;
-    }
-
-    u8 next = state->Peek();
-    state->Advance();
-
-    if (prevStar && next == '/') {
-      break;
-    }
-    prevStar = (next == '*');
+  int close = FastestScanKernels().find_block_comment_end(
+      state->file->Data(), state->end, state->file->Size());
+  if (close == state->file->Size()) {
+    state->EmitFatal(new UnclosedBlockCommentError(
+        PosRange(state->fileid, state->begin, state->begin + 2)));
+    return;
   }
+  state->end = close + 2;  // Advance past the "*/".
 
   state->EmitToken(BLOCK_COMMENT);
   state->SetNextState(&Start);
@@ -396,8 +477,8 @@ void Identifier(LexState* state) {
     state->Advance();
   }
 
-  TokenType keywordOrIdentifier = MatchKeywords(
-      state->fs, PosRange(state->fileid, state->begin, state->end));
+  TokenType keywordOrIdentifier = MatchKeyword(
+      state->file->Data() + state->begin, state->end - state->begin);
   state->EmitToken(keywordOrIdentifier);
   state->SetNextState(&Start);
 }
@@ -521,6 +602,21 @@ void String(LexState* state) {
 
 }  // namespace internal
 
+TokenType MatchKeyword(const u8* s, int len) {
+  if (len < internal::kMinKeywordLen || len > internal::kMaxKeywordLen) {
+    return IDENTIFIER;
+  }
+  int slot = internal::kKeywordTable.slots[internal::KeywordHash(s[0], s[1], s[len - 1], len)];
+  if (slot < 0) {
+    return IDENTIFIER;
+  }
+  const internal::KeywordSpelling& keyword = internal::kKeywords[slot];
+  if (keyword.len != len || memcmp(keyword.str, s, len) != 0) {
+    return IDENTIFIER;
+  }
+  return keyword.type;
+}
+
 jchar ConvertCharEscape(string s, u64 start, u64* next) {
   if (s[start] != '\\') {
     *next = start + 1;
@@ -572,15 +668,21 @@ jstring ConvertStringEscapes(string s) {
   return out;
 }
 
-void LexJoosFile(const base::FileSet* fs, const base::File* file, int fileid,
-                 vector<Token>* tokens_out, base::ErrorList* errors_out) {
+namespace {
+
+void Lex(const base::FileSet* fs, const base::File* file, int fileid,
+         internal::TokenSink* tokens_out, base::ErrorList* errors_out,
+         LexEngine engine) {
   // Remove anything with non-ANSI characters.
-  for (int i = 0; i < file->Size(); i++) {
-    u8 c = file->At(i);
-    if (c > 127) {
-      errors_out->Append(new NonAnsiCharError(Pos(fileid, i)));
-      return;
-    }
+  int non_ascii = internal::FastestScanKernels().find_non_ascii(file->Data(), 0, file->Size());
+  if (non_ascii != file->Size()) {
+    errors_out->Append(new NonAnsiCharError(Pos(fileid, non_ascii)));
+    return;
+  }
+
+  if (engine == LexEngine::DFA) {
+    internal::LexWithDfa(file, fileid, tokens_out, errors_out);
+    return;
   }
 
   internal::LexState state(fs, file, fileid, tokens_out, errors_out);
@@ -588,13 +690,37 @@ void LexJoosFile(const base::FileSet* fs, const base::File* file, int fileid,
   state.Run();
 }
 
+}  // namespace
+
+void LexJoosFile(const base::FileSet* fs, const base::File* file, int fileid,
+                 vector<Token>* tokens_out, base::ErrorList* errors_out,
+                 LexEngine engine) {
+  internal::TokenSink sink(tokens_out);
+  Lex(fs, file, fileid, &sink, errors_out, engine);
+}
+
+void LexSignificantTokens(const base::FileSet* fs, const base::File* file,
+                          int fileid, TokenBuffer* tokens_out,
+                          base::ErrorList* errors_out,
+                          base::ErrorList* unsupported_out, LexEngine engine) {
+  CHECK(tokens_out->FileId() == fileid);
+
+  // The stdlib and test programs average about 3.5 bytes of source per
+  // significant token, so this rarely needs to grow.
+  const int kBytesPerSignificantToken = 3;
+  tokens_out->Reserve(tokens_out->Size() + file->Size() / kBytesPerSignificantToken + 1);
+
+  internal::TokenSink sink(tokens_out, unsupported_out);
+  Lex(fs, file, fileid, &sink, errors_out, engine);
+}
+
 void LexJoosFiles(const base::FileSet* fs, vector<vector<Token>>* tokens_out,
-                  base::ErrorList* errors_out) {
+                  base::ErrorList* errors_out, LexEngine engine) {
   tokens_out->clear();
   tokens_out->resize(fs->Size());
 
   for (int i = 0; i < fs->Size(); i++) {
-    LexJoosFile(fs, fs->Get(i), i, &(*tokens_out)[i], errors_out);
+    LexJoosFile(fs, fs->Get(i), i, &(*tokens_out)[i], errors_out, engine);
   }
 }
 
@@ -256,8 +256,34 @@ struct Token {
   base::PosRange pos;
 };
 
+// The ways LexJoosFile can scan a file. They produce identical tokens and
+// errors.
+enum class LexEngine {
+  // Hand-written state functions, one per kind of token.
+  STATE_FUNCTIONS,
+  // A transition table built at compile time from the token definitions.
+  DFA,
+};
+
+void LexJoosFile(const base::FileSet* fs, const base::File* file, int fileid,
+                 vector<Token>* tokens_out, base::ErrorList* errors_out,
+                 LexEngine engine = LexEngine::STATE_FUNCTIONS);
 void LexJoosFiles(const base::FileSet* fs, vector<vector<Token>>* tokens_out,
-                  base::ErrorList* errors_out);
+                  base::ErrorList* errors_out,
+                  LexEngine engine = LexEngine::STATE_FUNCTIONS);
+
+class TokenBuffer;
+
+// Lexes file in one pass, appending only the tokens the parser needs to
+// tokens_out, whose fileid must be fileid. The result is the same as LexJoosFile followed by
+// StripSkippableTokens, and unsupported_out gets the errors
+// FindUnsupportedTokens would report. Use LexJoosFile when whitespace and
+// comments matter.
+void LexSignificantTokens(const base::FileSet* fs, const base::File* file,
+                          int fileid, TokenBuffer* tokens_out,
+                          base::ErrorList* errors_out,
+                          base::ErrorList* unsupported_out,
+                          LexEngine engine = LexEngine::STATE_FUNCTIONS);
 
 void StripSkippableTokens(const vector<Token>& tokens, vector<Token>* out);
 void StripSkippableTokens(const vector<vector<Token>>& tokens,
@@ -268,6 +294,10 @@ void FindUnsupportedTokens(const vector<Token>& tokens,
 void FindUnsupportedTokens(const vector<vector<Token>>& tokens,
                            base::ErrorList* errors);
 
+// Returns the keyword spelled by the len bytes at s, or IDENTIFIER if they do
+// not spell one.
+TokenType MatchKeyword(const u8* s, int len);
+
 bool IsBoolOp(TokenType op);
 bool IsRelationalOp(TokenType op);
 bool IsEqualityOp(TokenType op);
@@ -1,5 +1,6 @@
 #include "base/error.h"
 #include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
 #include "gtest/gtest.h"
 
 using base::ErrorList;
@@ -8,7 +9,7 @@ using base::PosRange;
 
 namespace lexer {
 
-class LexerTest : public ::testing::Test {
+class LexerTest : public ::testing::TestWithParam<LexEngine> {
  protected:
   void SetUp() { fs = nullptr; }
 
@@ -20,7 +21,7 @@ class LexerTest : public ::testing::Test {
   void LexString(string s) {
     ASSERT_TRUE(
         FileSet::Builder().AddStringFile("foo.joos", s).Build(&fs, &errors));
-    LexJoosFiles(fs, &tokens, &errors);
+    LexJoosFiles(fs, &tokens, &errors, GetParam());
   }
 
   vector<vector<Token>> tokens;
@@ -28,12 +29,12 @@ class LexerTest : public ::testing::Test {
   FileSet* fs;
 };
 
-TEST_F(LexerTest, EmptyFile) {
+TEST_P(LexerTest, EmptyFile) {
   LexString("");
   EXPECT_EQ(0u, tokens[0].size());
 }
 
-TEST_F(LexerTest, Whitespace) {
+TEST_P(LexerTest, Whitespace) {
   LexString(" \n    \r   \t");
   EXPECT_EQ(1u, tokens[0].size());
 
@@ -43,7 +44,7 @@ TEST_F(LexerTest, Whitespace) {
 
 // Tests that the SymbolLiterals are sorted by length, so that we do maximal
 // munch correctly.
-TEST_F(LexerTest, SymbolsMaximalMunch) {
+TEST_P(LexerTest, SymbolsMaximalMunch) {
   uint last = 2;
   for (uint t = LE; t < LPAREN; ++t) {
     uint cur = TokenTypeInfo::FromTokenType((TokenType)t).Value().size();
@@ -52,7 +53,7 @@ TEST_F(LexerTest, SymbolsMaximalMunch) {
   }
 }
 
-TEST_F(LexerTest, Symbols) {
+TEST_P(LexerTest, Symbols) {
   LexString("<<=>>====!=!&&&|||+-*/%(){}[];,.++--");
 
   ASSERT_EQ(28u, tokens[0].size());
@@ -87,7 +88,22 @@ TEST_F(LexerTest, Symbols) {
   EXPECT_EQ(DECR, tokens[0][27].type);
 }
 
-TEST_F(LexerTest, Comment) {
+TEST_P(LexerTest, EverySymbolEntry) {
+  for (uint t = 0; t < NUM_TOKEN_TYPES; ++t) {
+    const TokenTypeInfo& info = TokenTypeInfo::FromTokenType((TokenType)t);
+    if (!info.IsSymbol() || info.IsKeyword()) {
+      continue;
+    }
+    TearDown();
+    errors.Clear();
+    LexString(info.Value());
+    ASSERT_FALSE(errors.IsFatal()) << info.Value();
+    ASSERT_EQ(1u, tokens[0].size()) << info.Value();
+    EXPECT_EQ(info.Type(), tokens[0][0].type) << info.Value();
+  }
+}
+
+TEST_P(LexerTest, Comment) {
   LexString("// foo bar\n/*baz*/");
 
   EXPECT_EQ(2u, tokens[0].size());
@@ -99,7 +115,7 @@ TEST_F(LexerTest, Comment) {
   EXPECT_EQ(PosRange(0, 11, 18), tokens[0][1].pos);
 }
 
-TEST_F(LexerTest, LineCommentAtEof) {
+TEST_P(LexerTest, LineCommentAtEof) {
   LexString("// foo bar");
 
   EXPECT_EQ(1u, tokens[0].size());
@@ -108,14 +124,14 @@ TEST_F(LexerTest, LineCommentAtEof) {
   EXPECT_EQ(PosRange(0, 0, 10), tokens[0][0].pos);
 }
 
-TEST_F(LexerTest, UnclosedBlockComment) {
+TEST_P(LexerTest, UnclosedBlockComment) {
   LexString("hello /* there \n\n end");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnclosedBlockCommentError(0:6-8)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, SimpleInteger) {
+TEST_P(LexerTest, SimpleInteger) {
   LexString("123");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -123,7 +139,7 @@ TEST_F(LexerTest, SimpleInteger) {
   EXPECT_EQ(Token(INTEGER, PosRange(0, 0, 3)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, LeadingZeroInteger) {
+TEST_P(LexerTest, LeadingZeroInteger) {
   LexString("023");
 
   EXPECT_EQ(1, errors.Size());
@@ -131,7 +147,7 @@ TEST_F(LexerTest, LeadingZeroInteger) {
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, OnlyZero) {
+TEST_P(LexerTest, OnlyZero) {
   LexString("0");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -139,7 +155,7 @@ TEST_F(LexerTest, OnlyZero) {
   EXPECT_EQ(Token(INTEGER, PosRange(0, 0, 1)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, SimpleIdentifier) {
+TEST_P(LexerTest, SimpleIdentifier) {
   LexString("foo");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -147,7 +163,7 @@ TEST_F(LexerTest, SimpleIdentifier) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 0, 3)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, NumberBeforeIdentifier) {
+TEST_P(LexerTest, NumberBeforeIdentifier) {
   LexString("3m");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -157,7 +173,7 @@ TEST_F(LexerTest, NumberBeforeIdentifier) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 1, 2)), tokens[0][1]);
 }
 
-TEST_F(LexerTest, NumberIdentifier) {
+TEST_P(LexerTest, NumberIdentifier) {
   LexString("foo123bar890");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -165,7 +181,7 @@ TEST_F(LexerTest, NumberIdentifier) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 0, 12)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, UnderscoreIdentifier) {
+TEST_P(LexerTest, UnderscoreIdentifier) {
   LexString("MAX_VALUE");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -173,7 +189,7 @@ TEST_F(LexerTest, UnderscoreIdentifier) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 0, 9)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, DollarIdentifier) {
+TEST_P(LexerTest, DollarIdentifier) {
   LexString("cash$");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -181,7 +197,7 @@ TEST_F(LexerTest, DollarIdentifier) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 0, 5)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, CommentBetweenIdentifiers) {
+TEST_P(LexerTest, CommentBetweenIdentifiers) {
   LexString("abc/*foobar*/def");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -192,7 +208,7 @@ TEST_F(LexerTest, CommentBetweenIdentifiers) {
   EXPECT_EQ(Token(IDENTIFIER, PosRange(0, 13, 16)), tokens[0][2]);
 }
 
-TEST_F(LexerTest, Keywords) {
+TEST_P(LexerTest, Keywords) {
   LexString("while true null char if const volatile synchronized goto");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(17u, tokens[0].size());
@@ -207,7 +223,7 @@ TEST_F(LexerTest, Keywords) {
   EXPECT_EQ(K_GOTO, tokens[0][16].type);
 }
 
-TEST_F(LexerTest, AlmostKeywords) {
+TEST_P(LexerTest, AlmostKeywords) {
   LexString("if3 dof ifwhile freturn");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(7u, tokens[0].size());
@@ -217,14 +233,31 @@ TEST_F(LexerTest, AlmostKeywords) {
   EXPECT_EQ(IDENTIFIER, tokens[0][6].type);
 }
 
-TEST_F(LexerTest, KeywordPrefixAtEOF) {
+TEST_P(LexerTest, EveryKeywordEntry) {
+  for (uint t = 0; t < NUM_TOKEN_TYPES; ++t) {
+    const TokenTypeInfo& info = TokenTypeInfo::FromTokenType((TokenType)t);
+    const string& value = info.Value();
+    TokenType expected = info.IsKeyword() ? info.Type() : IDENTIFIER;
+    EXPECT_EQ(expected, MatchKeyword((const u8*)value.data(), value.size()))
+        << value;
+  }
+}
+
+TEST_P(LexerTest, KeywordHashNearMisses) {
+  for (string s : {"a", "IF", "If", "nul", "nulL", "synchronize",
+                   "synchronizedd", "_if", "whilE", "inT", "fi"}) {
+    EXPECT_EQ(IDENTIFIER, MatchKeyword((const u8*)s.data(), s.size())) << s;
+  }
+}
+
+TEST_P(LexerTest, KeywordPrefixAtEOF) {
   LexString("fo");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens[0].size());
   EXPECT_EQ(IDENTIFIER, tokens[0][0].type);
 }
 
-TEST_F(LexerTest, OnlyString) {
+TEST_P(LexerTest, OnlyString) {
   LexString("\"goober\"");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -233,42 +266,42 @@ TEST_F(LexerTest, OnlyString) {
   EXPECT_EQ(Token(STRING, PosRange(0, 0, 8)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, UnendedString) {
+TEST_P(LexerTest, UnendedString) {
   LexString("\"goober");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnclosedStringLitError(0:0)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnendedStringAtEOF) {
+TEST_P(LexerTest, UnendedStringAtEOF) {
   LexString("\"");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnclosedStringLitError(0:0)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnendedEscapedQuoteString) {
+TEST_P(LexerTest, UnendedEscapedQuoteString) {
   LexString("foo\"goober\\\"");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnclosedStringLitError(0:3)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, StringOverNewline) {
+TEST_P(LexerTest, StringOverNewline) {
   LexString("baz\"foo\nbar\"");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnclosedStringLitError(0:3)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, StringWithEscapedOctal) {
+TEST_P(LexerTest, StringWithEscapedOctal) {
   LexString("\"Hello Mr. \\333. How are you doing this fine \\013?\"");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
   EXPECT_EQ(Token(STRING, PosRange(0, 0, 51)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, StringWithOutOfRangeOctalWorks) {
+TEST_P(LexerTest, StringWithOutOfRangeOctalWorks) {
   // Lexes a '\40' and then a 0. Works in java.
   LexString("\"What the heck is a \\400?\"");
   ASSERT_FALSE(errors.IsFatal());
@@ -276,13 +309,13 @@ TEST_F(LexerTest, StringWithOutOfRangeOctalWorks) {
   EXPECT_EQ(Token(STRING, PosRange(0, 0, 26)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, StringWithBadEscape) {
+TEST_P(LexerTest, StringWithBadEscape) {
   LexString("\"Lol: \\91\"");
   EXPECT_EQ("InvalidCharacterEscapeError(0:6)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, StringEscapedQuote) {
+TEST_P(LexerTest, StringEscapedQuote) {
   LexString("\"foo\\\"bar\"");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -291,14 +324,14 @@ TEST_F(LexerTest, StringEscapedQuote) {
   EXPECT_EQ(Token(STRING, PosRange(0, 0, 10)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, AssignStringTest) {
+TEST_P(LexerTest, AssignStringTest) {
   LexString("string foo = \"foo\";");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
   ASSERT_EQ(8u, tokens[0].size());
 }
 
-TEST_F(LexerTest, SimpleChar) {
+TEST_P(LexerTest, SimpleChar) {
   LexString("'a'");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -306,14 +339,14 @@ TEST_F(LexerTest, SimpleChar) {
   EXPECT_EQ(Token(CHAR, PosRange(0, 0, 3)), tokens[0][0]);
 }
 
-TEST_F(LexerTest, MultipleChars) {
+TEST_P(LexerTest, MultipleChars) {
   LexString("'ab'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-2)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, EscapedChars) {
+TEST_P(LexerTest, EscapedChars) {
   LexString("'\\b''\\t''\\n''\\f''\\r''\\\'''\\\\'");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -323,7 +356,7 @@ TEST_F(LexerTest, EscapedChars) {
   }
 }
 
-TEST_F(LexerTest, EscapedOctalChars) {
+TEST_P(LexerTest, EscapedOctalChars) {
   LexString("'\\0''\\1''\\123''\\001''\\377'");
   ASSERT_FALSE(errors.IsFatal());
   ASSERT_EQ(1u, tokens.size());
@@ -333,27 +366,27 @@ TEST_F(LexerTest, EscapedOctalChars) {
   }
 }
 
-TEST_F(LexerTest, BadEscapedChar) {
+TEST_P(LexerTest, BadEscapedChar) {
   LexString("'\\a'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterEscapeError(0:0-2)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, BadTooHighEscapedChar) {
+TEST_P(LexerTest, BadTooHighEscapedChar) {
   LexString("'\\456'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-4)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnexpectedChar) {
+TEST_P(LexerTest, UnexpectedChar) {
   LexString("\\");
   EXPECT_EQ(1, errors.Size());
   EXPECT_EQ("UnexpectedCharError(0:0)", testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnsupportedToken) {
+TEST_P(LexerTest, UnsupportedToken) {
   LexString("synchronized do");
   FindUnsupportedTokens(tokens, &errors);
   ASSERT_TRUE(errors.IsFatal());
@@ -363,69 +396,167 @@ TEST_F(LexerTest, UnsupportedToken) {
             testing::PrintToString(*errors.At(1)));
 }
 
-TEST_F(LexerTest, BadBarelyTooHighEscapedChar) {
+TEST_P(LexerTest, SignificantTokensMatchStripped) {
+  const vector<string> inputs = {
+    "public class Foo { /* c */ int x = 0; // d\n }",
+    "synchronized do /* */ x++ -- y",
+    "  \t\n",
+    "a /* unclosed",
+    "do '\\9' x",
+  };
+  for (const string& input : inputs) {
+    TearDown();
+    errors.Clear();
+    LexString(input);
+    vector<Token> expected;
+    StripSkippableTokens(tokens[0], &expected);
+    ErrorList expected_unsupported;
+    FindUnsupportedTokens(tokens[0], &expected_unsupported);
+
+    TokenBuffer significant(0);
+    ErrorList lex_errors;
+    ErrorList unsupported;
+    LexSignificantTokens(fs, fs->Get(0), 0, &significant, &lex_errors, &unsupported, GetParam());
+    EXPECT_EQ(expected, significant.ToVector()) << input;
+    EXPECT_EQ(testing::PrintToString(errors), testing::PrintToString(lex_errors)) << input;
+    EXPECT_EQ(testing::PrintToString(expected_unsupported), testing::PrintToString(unsupported)) << input;
+  }
+}
+
+TEST_P(LexerTest, BadBarelyTooHighEscapedChar) {
   LexString("'\\378'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-4)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, MultipleCharsWithEscape) {
+TEST_P(LexerTest, MultipleCharsWithEscape) {
   LexString("'\\0a'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-3)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, EmptyChar) {
+TEST_P(LexerTest, EmptyChar) {
   LexString("''");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, ThreeApostropheChar) {
+TEST_P(LexerTest, ThreeApostropheChar) {
   LexString("'''");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnclosedCharAtEOF) {
+TEST_P(LexerTest, UnclosedCharAtEOF) {
   LexString("'");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnclosedChar2AtEOF) {
+TEST_P(LexerTest, UnclosedChar2AtEOF) {
   LexString("'a");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-2)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnclosedChar) {
+TEST_P(LexerTest, UnclosedChar) {
   LexString("'foobar");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-2)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnclosedTrailingChar) {
+TEST_P(LexerTest, UnclosedTrailingChar) {
   LexString("'\\");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterEscapeError(0:0-2)",
             testing::PrintToString(*errors.At(0)));
 }
 
-TEST_F(LexerTest, UnclosedTrailingOctalEscape) {
+TEST_P(LexerTest, UnclosedTrailingOctalEscape) {
   LexString("'\\0");
   ASSERT_TRUE(errors.IsFatal());
   EXPECT_EQ("InvalidCharacterLitError(0:0-3)",
             testing::PrintToString(*errors.At(0)));
 }
 
+INSTANTIATE_TEST_CASE_P(Engines, LexerTest,
+                        testing::Values(LexEngine::STATE_FUNCTIONS,
+                                        LexEngine::DFA));
+
+// Lexes each input with every engine, checking that the tokens and errors
+// match exactly.
+TEST(LexEngineTest, EnginesAgree) {
+  const vector<string> inputs = {
+    "public class Foo { int x = 0; /* c */ // d\n String s = \"a\\tb\\377\\400\"; }",
+    "char c = '\\12'; char d = '\\7a';",
+    "a<=b>=c==d!=e&&f||g++h--i+j-k*l/m%n<o>p&q|r^s!t=u(v)w{x}y[z];,.",
+    "x /* unclosed",
+    "/*/ still open */ y",
+    "\"abc\\q\"",
+    "\"abc\n\"",
+    "'ab'",
+    "'\\9'",
+    "00",
+    "0 01",
+    "#",
+    "\t\r\n  instanceof$_ _if if3 synchronized",
+    "'",
+    "\"",
+    "'\\",
+    "\"\\",
+  };
+  for (const string& input : inputs) {
+    FileSet* fs = nullptr;
+    ErrorList errors;
+    ASSERT_TRUE(FileSet::Builder().AddStringFile("foo.joos", input).Build(&fs, &errors));
+    uptr<FileSet> fs_owner(fs);
+
+    vector<vector<Token>> expected_tokens;
+    ErrorList expected_errors;
+    LexJoosFiles(fs, &expected_tokens, &expected_errors, LexEngine::STATE_FUNCTIONS);
+
+    vector<vector<Token>> tokens;
+    LexJoosFiles(fs, &tokens, &errors, LexEngine::DFA);
+    EXPECT_EQ(expected_tokens, tokens) << input;
+    EXPECT_EQ(testing::PrintToString(expected_errors), testing::PrintToString(errors)) << input;
+  }
+}
+
+TEST(TokenBufferTest, RoundTrips) {
+  vector<Token> tokens = {
+    Token(K_CLASS, PosRange(3, 0, 5)),
+    Token(IDENTIFIER, PosRange(3, 6, 9)),
+    Token(LBRACE, PosRange(3, 1000000000, 1000000001)),
+    Token(STRING, PosRange(3, 20, 20 + 0xFFFE)),
+    Token(STRING, PosRange(3, 70000, 70000 + 0xFFFF)),
+    Token(STRING, PosRange(3, 200000, 300000)),
+    Token(RBRACE, PosRange(3, 300000, 300001)),
+  };
+  TokenBuffer buffer(3, tokens);
+  ASSERT_EQ((int)tokens.size(), buffer.Size());
+  for (int i = 0; i < buffer.Size(); ++i) {
+    EXPECT_EQ(tokens[i].type, buffer.Type(i));
+    EXPECT_EQ(tokens[i].pos, buffer.Pos(i));
+    EXPECT_EQ(tokens[i], buffer.At(i));
+  }
+  EXPECT_EQ(tokens, buffer.ToVector());
+}
+
+TEST(TokenBufferTest, Empty) {
+  TokenBuffer buffer(7);
+  EXPECT_TRUE(buffer.Empty());
+  EXPECT_EQ(7, buffer.FileId());
+  buffer.Append(SEMI, 4, 5);
+  EXPECT_FALSE(buffer.Empty());
+  EXPECT_EQ(Token(SEMI, PosRange(7, 4, 5)), buffer.At(0));
+}
 
 TEST(TokenTypeInfoTest, Unsupported) {
   EXPECT_FALSE(TokenTypeInfo::FromTokenType(K_DO).IsSupported());
@@ -0,0 +1,199 @@
+#include "lexer/scan.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEXER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace lexer {
+namespace internal {
+
+namespace {
+
+bool IsWhitespace(u8 c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+int FindNonAsciiScalar(const u8* buf, int begin, int end) {
+  for (int i = begin; i < end; ++i) {
+    if (buf[i] > 127) {
+      return i;
+    }
+  }
+  return end;
+}
+
+int SkipWhitespaceScalar(const u8* buf, int begin, int end) {
+  for (int i = begin; i < end; ++i) {
+    if (!IsWhitespace(buf[i])) {
+      return i;
+    }
+  }
+  return end;
+}
+
+// Most whitespace runs are a single space or a short indent, which is
+// quicker to check a byte at a time. Returns the end of the run, or -1 if it
+// is longer than 16 bytes.
+int SkipShortWhitespace(const u8* buf, int begin, int end) {
+  int stop = std::min(end, begin + 16);
+  for (int i = begin; i < stop; ++i) {
+    if (!IsWhitespace(buf[i])) {
+      return i;
+    }
+  }
+  return stop == end ? end : -1;
+}
+
+int FindBlockCommentEndScalar(const u8* buf, int begin, int end) {
+  for (int i = begin; i + 1 < end; ++i) {
+    if (buf[i] == '*' && buf[i + 1] == '/') {
+      return i;
+    }
+  }
+  return end;
+}
+
+#ifdef LEXER_SCAN_X86
+
+// Each vector loop handles whole blocks and leaves the tail to the scalar
+// version. Masks have one bit per byte, lowest address first.
+
+__attribute__((target("sse2")))
+int FindNonAsciiSse2(const u8* buf, int begin, int end) {
+  int i = begin;
+  for (; i + 16 <= end; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+    u32 mask = _mm_movemask_epi8(v);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return FindNonAsciiScalar(buf, i, end);
+}
+
+__attribute__((target("sse2")))
+int SkipWhitespaceSse2(const u8* buf, int begin, int end) {
+  int i = SkipShortWhitespace(buf, begin, end);
+  if (i >= 0) {
+    return i;
+  }
+  i = begin + 16;
+  for (; i + 16 <= end; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+    __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+    u32 mask = ~(u32)_mm_movemask_epi8(ws) & 0xFFFF;
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return SkipWhitespaceScalar(buf, i, end);
+}
+
+__attribute__((target("sse2")))
+int FindBlockCommentEndSse2(const u8* buf, int begin, int end) {
+  int i = begin;
+  for (; i + 17 <= end; i += 16) {
+    __m128i star = _mm_loadu_si128((const __m128i*)(buf + i));
+    __m128i slash = _mm_loadu_si128((const __m128i*)(buf + i + 1));
+    u32 mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(star, _mm_set1_epi8('*')),
+                      _mm_cmpeq_epi8(slash, _mm_set1_epi8('/'))));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return FindBlockCommentEndScalar(buf, i, end);
+}
+
+__attribute__((target("avx2")))
+int FindNonAsciiAvx2(const u8* buf, int begin, int end) {
+  int i = begin;
+  for (; i + 32 <= end; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+    u32 mask = _mm256_movemask_epi8(v);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return FindNonAsciiSse2(buf, i, end);
+}
+
+__attribute__((target("avx2")))
+int SkipWhitespaceAvx2(const u8* buf, int begin, int end) {
+  int i = SkipShortWhitespace(buf, begin, end);
+  if (i >= 0) {
+    return i;
+  }
+  i = begin + 16;
+  for (; i + 32 <= end; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+    __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+    u32 mask = ~(u32)_mm256_movemask_epi8(ws);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return SkipWhitespaceSse2(buf, i, end);
+}
+
+__attribute__((target("avx2")))
+int FindBlockCommentEndAvx2(const u8* buf, int begin, int end) {
+  int i = begin;
+  for (; i + 33 <= end; i += 32) {
+    __m256i star = _mm256_loadu_si256((const __m256i*)(buf + i));
+    __m256i slash = _mm256_loadu_si256((const __m256i*)(buf + i + 1));
+    u32 mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(star, _mm256_set1_epi8('*')),
+                         _mm256_cmpeq_epi8(slash, _mm256_set1_epi8('/'))));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return FindBlockCommentEndSse2(buf, i, end);
+}
+
+#endif  // LEXER_SCAN_X86
+
+vector<ScanKernels> FindSupportedScanKernels() {
+  vector<ScanKernels> kernels;
+#ifdef LEXER_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back({"avx2", &FindNonAsciiAvx2, &SkipWhitespaceAvx2,
+                       &FindBlockCommentEndAvx2});
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    kernels.push_back({"sse2", &FindNonAsciiSse2, &SkipWhitespaceSse2,
+                       &FindBlockCommentEndSse2});
+  }
+#endif
+  kernels.push_back({"scalar", &FindNonAsciiScalar, &SkipWhitespaceScalar,
+                     &FindBlockCommentEndScalar});
+  return kernels;
+}
+
+}  // namespace
+
+const vector<ScanKernels>& SupportedScanKernels() {
+  static const vector<ScanKernels> kernels = FindSupportedScanKernels();
+  return kernels;
+}
+
+const ScanKernels& FastestScanKernels() {
+  static const ScanKernels& kernels = SupportedScanKernels().front();
+  return kernels;
+}
+
+}  // namespace internal
+}  // namespace lexer
@@ -0,0 +1,34 @@
+#ifndef LEXER_SCAN_H
+#define LEXER_SCAN_H
+
+#include "std.h"
+
+namespace lexer {
+namespace internal {
+
+// Kernels that scan a file buffer many bytes at a time. Each looks at
+// buf[begin, end) and returns end if it finds nothing.
+struct ScanKernels {
+  const char* name;
+
+  // The index of the first byte above 127.
+  int (*find_non_ascii)(const u8* buf, int begin, int end);
+
+  // The index of the first byte that is not ' ', '\n', '\r', or '\t'.
+  int (*skip_whitespace)(const u8* buf, int begin, int end);
+
+  // The index of the first "*/" that lies entirely in the range.
+  int (*find_block_comment_end)(const u8* buf, int begin, int end);
+};
+
+// Every implementation this CPU can run, fastest first. The last one is plain
+// C++ and always present.
+const vector<ScanKernels>& SupportedScanKernels();
+
+// The fastest supported kernels, chosen on first use.
+const ScanKernels& FastestScanKernels();
+
+}  // namespace internal
+}  // namespace lexer
+
+#endif
@@ -0,0 +1,84 @@
+#include "lexer/scan.h"
+
+#include "gtest/gtest.h"
+
+namespace lexer {
+namespace internal {
+
+namespace {
+
+bool IsWhitespace(u8 c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+} // namespace
+
+class ScanTest : public ::testing::TestWithParam<ScanKernels> {
+ protected:
+  // Every [begin, end) window of buf up to 80 bytes long, so that each vector
+  // width sees both whole blocks and every tail length.
+  template <typename F>
+  void ForEachWindow(const string& buf, F&& fn) {
+    for (int begin = 0; begin < (int)buf.size(); ++begin) {
+      for (int end = begin; end <= (int)buf.size() && end - begin <= 80; ++end) {
+        fn((const u8*)buf.data(), begin, end);
+      }
+    }
+  }
+};
+
+TEST_P(ScanTest, FindNonAscii) {
+  string buf(100, 'a');
+  buf[37] = (char)0x80;
+  buf[70] = (char)0xFF;
+  ForEachWindow(buf, [&](const u8* b, int begin, int end) {
+    int expected = end;
+    for (int i = begin; i < end; ++i) {
+      if (b[i] > 127) {
+        expected = i;
+        break;
+      }
+    }
+    EXPECT_EQ(expected, GetParam().find_non_ascii(b, begin, end)) << begin << ' ' << end;
+  });
+}
+
+TEST_P(ScanTest, SkipWhitespace) {
+  string buf = string(40, ' ') + "\t\r\n  x" + string(50, '\n') + "\f" + string(3, ' ');
+  ForEachWindow(buf, [&](const u8* b, int begin, int end) {
+    int expected = end;
+    for (int i = begin; i < end; ++i) {
+      if (!IsWhitespace(b[i])) {
+        expected = i;
+        break;
+      }
+    }
+    EXPECT_EQ(expected, GetParam().skip_whitespace(b, begin, end)) << begin << ' ' << end;
+  });
+}
+
+TEST_P(ScanTest, FindBlockCommentEnd) {
+  string buf = "/* a ** b */" + string(20, '*') + "/" + string(30, 'x') + "*" +
+               string(15, '/') + "**//" + string(16, '*') + "*/";
+  ForEachWindow(buf, [&](const u8* b, int begin, int end) {
+    int expected = end;
+    for (int i = begin; i + 1 < end; ++i) {
+      if (b[i] == '*' && b[i + 1] == '/') {
+        expected = i;
+        break;
+      }
+    }
+    EXPECT_EQ(expected, GetParam().find_block_comment_end(b, begin, end)) << begin << ' ' << end;
+  });
+}
+
+TEST(ScanKernelsTest, ScalarIsLast) {
+  EXPECT_EQ(string("scalar"), SupportedScanKernels().back().name);
+  EXPECT_EQ(SupportedScanKernels().front().name, FastestScanKernels().name);
+}
+
+INSTANTIATE_TEST_CASE_P(Supported, ScanTest,
+                        testing::ValuesIn(SupportedScanKernels()));
+
+}  // namespace internal
+}  // namespace lexer
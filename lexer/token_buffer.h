@@ -0,0 +1,104 @@
+#ifndef LEXER_TOKEN_BUFFER_H
+#define LEXER_TOKEN_BUFFER_H
+
+#include <map>
+
+#include "base/file.h"
+#include "lexer/lexer.h"
+
+namespace lexer {
+
+// The tokens of one file, stored as parallel arrays instead of a
+// vector<Token>. A Token is 16 bytes; here each one costs 7: its type, the
+// offset it starts at, and its length. The fileid is kept once for the whole
+// file and Tokens and PosRanges are rebuilt on demand.
+class TokenBuffer final {
+ public:
+  explicit TokenBuffer(int fileid) : fileid_(fileid) {}
+
+  // Copies tokens, which must all come from fileid.
+  TokenBuffer(int fileid, const vector<Token>& tokens) : fileid_(fileid) {
+    Reserve(tokens.size());
+    for (const Token& token : tokens) {
+      Append(token);
+    }
+  }
+
+  TokenBuffer(TokenBuffer&&) = default;
+  TokenBuffer& operator=(TokenBuffer&&) = default;
+
+  int FileId() const { return fileid_; }
+  int Size() const { return types_.size(); }
+  bool Empty() const { return types_.empty(); }
+
+  TokenType Type(int i) const { return (TokenType)types_[i]; }
+
+  int Begin(int i) const { return begins_[i]; }
+
+  int End(int i) const {
+    int length = lengths_[i];
+    if (length == kLongLength) {
+      length = long_lengths_.at(i);
+    }
+    return begins_[i] + length;
+  }
+
+  base::PosRange Pos(int i) const {
+    return base::PosRange(fileid_, Begin(i), End(i));
+  }
+
+  Token At(int i) const { return Token(Type(i), Pos(i)); }
+
+  void Reserve(int n) {
+    types_.reserve(n);
+    begins_.reserve(n);
+    lengths_.reserve(n);
+  }
+
+  void Append(TokenType type, int begin, int end) {
+    int length = end - begin;
+    if (length >= kLongLength) {
+      long_lengths_[types_.size()] = length;
+      length = kLongLength;
+    }
+    types_.push_back((u8)type);
+    begins_.push_back(begin);
+    lengths_.push_back((u16)length);
+  }
+
+  void Append(const Token& token) {
+    CHECK(token.pos.fileid == fileid_);
+    Append(token.type, token.pos.begin, token.pos.end);
+  }
+
+  vector<Token> ToVector() const {
+    vector<Token> tokens;
+    tokens.reserve(Size());
+    for (int i = 0; i < Size(); ++i) {
+      tokens.push_back(At(i));
+    }
+    return tokens;
+  }
+
+  // Bytes used per token, not counting unused capacity or long tokens.
+  static constexpr int kBytesPerToken = sizeof(u8) + sizeof(u32) + sizeof(u16);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TokenBuffer);
+
+  static_assert(NUM_TOKEN_TYPES <= 256, "TokenType must fit in a u8");
+
+  // Tokens at least this long keep their real length in long_lengths_. Only
+  // huge string literals get here.
+  static constexpr int kLongLength = 0xFFFF;
+
+  int fileid_;
+  vector<u8> types_;
+  vector<u32> begins_;
+  vector<u16> lengths_;
+  std::map<int, int> long_lengths_;
+};
+
+}  // namespace lexer
+
+#endif
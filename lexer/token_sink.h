@@ -0,0 +1,49 @@
+#ifndef LEXER_TOKEN_SINK_H
+#define LEXER_TOKEN_SINK_H
+
+#include "base/errorlist.h"
+#include "lexer/lexer.h"
+#include "lexer/lexer_error.h"
+#include "lexer/token_buffer.h"
+
+namespace lexer {
+namespace internal {
+
+// Where a lexer engine puts each token it finds.
+class TokenSink final {
+ public:
+  // Keeps every token, including whitespace and comments.
+  TokenSink(vector<Token>* tokens) : tokens_(tokens) {}
+
+  // Keeps only the tokens the parser needs, and reports each unsupported
+  // token to unsupported.
+  TokenSink(TokenBuffer* tokens, base::ErrorList* unsupported)
+      : significant_(tokens), unsupported_(unsupported) {}
+
+  void Emit(TokenType type, base::PosRange pos) {
+    if (significant_ == nullptr) {
+      tokens_->push_back(Token(type, pos));
+      return;
+    }
+    const TokenTypeInfo& info = TokenTypeInfo::kEntries[type];
+    if (info.IsSkippable()) {
+      return;
+    }
+    if (!info.IsSupported()) {
+      unsupported_->Append(new UnsupportedTokenError(pos));
+    }
+    significant_->Append(type, pos.begin, pos.end);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TokenSink);
+
+  vector<Token>* tokens_ = nullptr;
+  TokenBuffer* significant_ = nullptr;
+  base::ErrorList* unsupported_ = nullptr;
+};
+
+}  // namespace internal
+}  // namespace lexer
+
+#endif
@@ -1,16 +1,17 @@
 #include "parser/parser.h"
 
 #include "ast/ast.h"
+#include "base/arena.h"
 #include "base/macros.h"
 #include "base/file.h"
 #include "base/unique_ptr_vector.h"
 #include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
 #include "parser/parser_internal.h"
 
 using namespace ast;
 
 using std::cerr;
-using std::function;
 using std::move;
 
 using base::Error;
@@ -54,6 +55,8 @@ using lexer::STRING;
 using lexer::Token;
 using lexer::TokenType;
 using parser::internal::ConvertError;
+using parser::internal::DeferredError;
+using parser::internal::FirstOf;
 using parser::internal::Result;
 
 #define RETURN_IF_ERR(check)    \
@@ -108,7 +111,7 @@ TYPE_INFO_PRED(IsModifier);
 #undef TYPE_INFO_PRED
 
 sptr<const Expr> FixPrecedence(const SharedPtrVector<const Expr>& owned_exprs,
-                    const vector<Token>& ops) {
+                    const vector<Token>& ops, base::Arena* arena) {
   vector<sptr<const Expr>> outstack;
   vector<Token> opstack;
 
@@ -159,9 +162,9 @@ sptr<const Expr> FixPrecedence(const SharedPtrVector<const Expr>& owned_exprs,
     if (nextop.type == lexer::K_INSTANCEOF) {
       auto instance_of_expr = dynamic_cast<const InstanceOfExpr*>(rhs.get());
       CHECK(instance_of_expr != nullptr);
-      outstack.push_back(make_shared<InstanceOfExpr>(lhs, nextop, instance_of_expr->GetTypePtr()));
+      outstack.push_back(base::MakeShared<InstanceOfExpr>(arena, lhs, nextop, instance_of_expr->GetTypePtr()));
     } else {
-      outstack.push_back(make_shared<BinExpr>(lhs, nextop, rhs));
+      outstack.push_back(base::MakeShared<BinExpr>(arena, lhs, nextop, rhs));
     }
   }
 
@@ -222,40 +225,50 @@ Parser Parser::EatSemis() const {
   return cur;
 }
 
-Error* Parser::MakeUnexpectedTokenError(Token token) const {
+DeferredError Parser::MakeUnexpectedTokenError(Token token) const {
   // TODO: say what you expected instead.
-  return MakeSimplePosRangeError(Pos(token.pos.fileid, token.pos.begin),
-                                 "UnexpectedTokenError", "Unexpected token.");
+  return DeferredError(Pos(token.pos.fileid, token.pos.begin),
+                       "UnexpectedTokenError", "Unexpected token.");
 }
 
-Error* Parser::MakeDuplicateModifierError(Token token) const {
-  return MakeSimplePosRangeError(token.pos, "DuplicateModifierError",
-                                 "Duplicate modifier.");
+DeferredError Parser::MakeDuplicateModifierError(Token token) const {
+  return DeferredError(token.pos, "DuplicateModifierError",
+                       "Duplicate modifier.");
 }
 
-Error* Parser::MakeParamRequiresNameError(Token token) const {
-  return MakeSimplePosRangeError(token.pos, "ParamRequiresNameError",
-                                 "A parameter requires a type and a name.");
+DeferredError Parser::MakeParamRequiresNameError(Token token) const {
+  return DeferredError(token.pos, "ParamRequiresNameError",
+                       "A parameter requires a type and a name.");
 }
 
-Error* Parser::MakeUnexpectedEOFError() const {
+DeferredError Parser::MakeUnexpectedEOFError() const {
   // TODO: say what you expected instead.
   // TODO: this will crash on an empty file.
-  return MakeSimplePosRangeError(
-      Pos(tokens_->at(0).pos.fileid, file_->Size() - 1),
+  return DeferredError(
+      Pos(fid_, file_->Size() - 1),
       "UnexpectedEOFError", "Unexpected end-of-file.");
 }
 
-Parser Parser::ParseTokenIf(function<bool(Token)> pred,
-                            Result<Token>* out) const {
-  if (IsAtEnd()) {
-    return Fail(MakeUnexpectedEOFError(), out);
+bool Parser::IsVarDeclNext() const {
+  // Matches Type Identifier "=" without building anything; see ParseType.
+  int k = 0;
+  if (IsNext(IsPrimitive)) {
+    k = 1;
+  } else if (IsNext(IDENTIFIER)) {
+    k = 1;
+    while (Peek(k) == DOT && Peek(k + 1) == IDENTIFIER) {
+      k += 2;
+    }
+  } else {
+    return false;
   }
-
-  if (!pred(GetNext())) {
-    return Fail(MakeUnexpectedTokenError(GetNext()), out);
+  if (Peek(k) == LBRACK) {
+    if (Peek(k + 1) != RBRACK) {
+      return false;
+    }
+    k += 2;
   }
-  return Advance().Success(new Token(GetNext()), out);
+  return Peek(k) == IDENTIFIER && Peek(k + 1) == ASSG;
 }
 
 Parser Parser::ParseQualifiedName(Result<QualifiedName>* out) const {
@@ -279,9 +292,8 @@ Parser Parser::ParseQualifiedName(Result<QualifiedName>* out) const {
     Parser next = cur.ParseTokenIf(ExactType(DOT), &dot)
                       .ParseTokenIf(ExactType(IDENTIFIER), &nextIdent);
     if (!next) {
-      ErrorList errors;
-      FirstOf(&errors, &dot, &nextIdent);
-      return Fail(move(errors), out);
+      FirstOf(out, &dot, &nextIdent);
+      return Fail();
     }
 
     tokens.push_back(*dot.Get());
@@ -289,7 +301,7 @@ Parser Parser::ParseQualifiedName(Result<QualifiedName>* out) const {
     cur = next;
   }
   QualifiedName result = MakeQualifiedName(GetFile(), tokens);
-  return cur.Success(new QualifiedName(result), out);
+  return cur.Success(Make<QualifiedName>(result), out);
 }
 
 Parser Parser::ParsePrimitiveType(Result<Type>* out) const {
@@ -303,7 +315,7 @@ Parser Parser::ParsePrimitiveType(Result<Type>* out) const {
 
   Result<Token> primitive;
   Parser after = ParseTokenIf(IsPrimitive, &primitive);
-  RETURN_IF_GOOD(after, new PrimitiveType(*primitive.Get()), out);
+  RETURN_IF_GOOD(after, Make<PrimitiveType>(*primitive.Get()), out);
 
   *out = ConvertError<Token, Type>(move(primitive));
   return Fail();
@@ -315,7 +327,7 @@ Parser Parser::ParseSingleType(Result<Type>* out) const {
   //   QualifiedName
   SHORT_CIRCUIT;
 
-  {
+  if (IsNext(IsPrimitive)) {
     Result<Type> primitive;
     Parser after = ParsePrimitiveType(&primitive);
     if (after) {
@@ -327,7 +339,7 @@ Parser Parser::ParseSingleType(Result<Type>* out) const {
   if (IsNext(IDENTIFIER)) {
     Result<QualifiedName> reference;
     Parser after = ParseQualifiedName(&reference);
-    RETURN_IF_GOOD(after, new ReferenceType(*reference.Get()), out);
+    RETURN_IF_GOOD(after, Make<ReferenceType>(*reference.Get()), out);
 
     *out = ConvertError<QualifiedName, Type>(move(reference));
     return Fail();
@@ -358,7 +370,7 @@ Parser Parser::ParseType(Result<Type>* out) const {
 
     Parser afterArray = afterSingle.ParseTokenIf(ExactType(LBRACK), &lbrack)
                             .ParseTokenIf(ExactType(RBRACK), &rbrack);
-    RETURN_IF_GOOD(afterArray, new ArrayType(single.Get(), *lbrack.Get(), *rbrack.Get()), out);
+    RETURN_IF_GOOD(afterArray, Make<ArrayType>(single.Get(), *lbrack.Get(), *rbrack.Get()), out);
 
     *out = ConvertError<Token, Type>(move(rbrack));
     return Fail();
@@ -394,9 +406,8 @@ Parser Parser::ParseExpression(Result<Expr>* out) const {
 
     Parser next = cur.ParseTokenIf(IsBinOp, &binOp);
     if (!next) {
-      ErrorList errors;
-      binOp.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &binOp);
+      return Fail();
     }
 
     // Check if binop is instanceof.
@@ -404,20 +415,18 @@ Parser Parser::ParseExpression(Result<Expr>* out) const {
       Result<Type> instanceOfType;
       next = next.ParseType(&instanceOfType);
       if (!next) {
-        ErrorList errors;
-        instanceOfType.ReleaseErrors(&errors);
-        return Fail(move(errors), out);
+        FirstOf(out, &instanceOfType);
+        return Fail();
       }
 
       // Wrap type in partially-completed InstanceOfExpr.
       operators.push_back(*binOp.Get());
-      exprs.Append(make_shared<InstanceOfExpr>(nullptr, *binOp.Get(), instanceOfType.Get()));
+      exprs.Append(Make<InstanceOfExpr>(nullptr, *binOp.Get(), instanceOfType.Get()));
     } else {
       next = next.ParseUnaryExpression(&nextExpr);
       if (!next) {
-        ErrorList errors;
-        FirstOf(&errors, &binOp, &nextExpr);
-        return Fail(move(errors), out);
+        FirstOf(out, &binOp, &nextExpr);
+        return Fail();
       }
 
       operators.push_back(*binOp.Get());
@@ -426,7 +435,7 @@ Parser Parser::ParseExpression(Result<Expr>* out) const {
     cur = next;
   }
 
-  return cur.Success(FixPrecedence(exprs, operators), out);
+  return cur.Success(FixPrecedence(exprs, operators, arena_), out);
 }
 
 Parser Parser::ParseUnaryExpression(Result<Expr>* out, bool allowSub) const {
@@ -448,14 +457,13 @@ Parser Parser::ParseUnaryExpression(Result<Expr>* out, bool allowSub) const {
     Result<Expr> expr;
     Parser after =
         ParseTokenIf(IsUnaryOp, &unaryOp).ParseUnaryExpression(&expr);
-    RETURN_IF_GOOD(after, new UnaryExpr(*unaryOp.Get(), expr.Get()), out);
+    RETURN_IF_GOOD(after, Make<UnaryExpr>(*unaryOp.Get(), expr.Get()), out);
 
-    ErrorList errors;
-    FirstOf(&errors, &unaryOp, &expr);
-    return Fail(move(errors), out);
+    FirstOf(out, &unaryOp, &expr);
+    return Fail();
   }
 
-  {
+  if (IsNext(LPAREN)) {
     Result<Expr> expr;
     Parser after = ParseCastExpression(&expr);
     RETURN_IF_GOOD(after, expr.Get(), out);
@@ -479,21 +487,19 @@ Parser Parser::ParseCastExpression(Result<Expr>* out) const {
                      .ParseType(&type);
 
   if (!afterType) {
-    ErrorList errors;
-    FirstOf(&errors, &lparen, &type);
-    return Fail(move(errors), out);
+    FirstOf(out, &lparen, &type);
+    return Fail();
   }
 
   bool isPrimitive = HasPrimitive(*type.Get());
   Parser after = afterType
                  .ParseTokenIf(ExactType(RPAREN), &rparen)
                  .ParseUnaryExpression(&expr, isPrimitive);
-  RETURN_IF_GOOD(after, new CastExpr(*lparen.Get(), type.Get(), *rparen.Get(), expr.Get()), out);
+  RETURN_IF_GOOD(after, Make<CastExpr>(*lparen.Get(), type.Get(), *rparen.Get(), expr.Get()), out);
 
   // Collect the first error, and use that.
-  ErrorList errors;
-  FirstOf(&errors, &rparen, &expr);
-  return Fail(move(errors), out);
+  FirstOf(out, &rparen, &expr);
+  return Fail();
 }
 
 Parser Parser::ParsePrimary(Result<Expr>* out) const {
@@ -538,9 +544,8 @@ Parser Parser::ParseNewExpression(Result<Expr>* out) const {
       ParseTokenIf(ExactType(K_NEW), &newTok).ParseSingleType(&type);
   if (!afterType) {
     // Collect the first error, and use that.
-    ErrorList errors;
-    FirstOf(&errors, &newTok, &type);
-    return Fail(move(errors), out);
+    FirstOf(out, &newTok, &type);
+    return Fail();
   }
 
   if (afterType.IsAtEnd()) {
@@ -561,13 +566,12 @@ Parser Parser::ParseNewExpression(Result<Expr>* out) const {
 
     if (!afterCall) {
       // Collect the first error, and use that.
-      ErrorList errors;
-      FirstOf(&errors, &lparen, &args, &rparen);
-      return Fail(move(errors), out);
+      FirstOf(out, &lparen, &args, &rparen);
+      return Fail();
     }
 
     sptr<const Expr> newExpr =
-        make_shared<NewClassExpr>(*newTok.Get(), type.Get(), *lparen.Get(), *args.Get(), *rparen.Get());
+        Make<NewClassExpr>(*newTok.Get(), type.Get(), *lparen.Get(), *args.Get(), *rparen.Get());
     Result<Expr> nested;
     Parser afterEnd = afterCall.ParsePrimaryEnd(newExpr, &nested);
     RETURN_IF_GOOD(afterEnd, nested.Get(), out);
@@ -586,12 +590,11 @@ Parser Parser::ParseNewExpression(Result<Expr>* out) const {
 
   if (!after) {
     // Collect the first error, and use that.
-    ErrorList errors;
-    FirstOf(&errors, &lbrack, &sizeExpr, &rbrack);
-    return Fail(move(errors), out);
+    FirstOf(out, &lbrack, &sizeExpr, &rbrack);
+    return Fail();
   }
 
-  sptr<const Expr> newExpr = make_shared<NewArrayExpr>(*newTok.Get(), type.Get(), *lbrack.Get(), sizeExpr.Get(), *rbrack.Get());
+  sptr<const Expr> newExpr = Make<NewArrayExpr>(*newTok.Get(), type.Get(), *lbrack.Get(), sizeExpr.Get(), *rbrack.Get());
 
   Result<Expr> nested;
   Parser afterEnd = after.ParsePrimaryEndNoArrayAccess(newExpr, &nested);
@@ -617,26 +620,26 @@ Parser Parser::ParsePrimaryBase(Result<Expr>* out) const {
     Parser after = (*this).Advance();
     switch (lit.type) {
       case INTEGER:
-        return after.Success(new IntLitExpr(lit), out);
+        return after.Success(Make<IntLitExpr>(lit), out);
       case CHAR: {
         string s = TokenString(GetFile(), Token(lit.type, base::PosRange(fid_, lit.pos.begin + 1, lit.pos.end - 1)));
         u64 next = 0;
         jchar c = lexer::ConvertCharEscape(s, 0, &next);
         CHECK(next == s.length());
         return after.Success(
-            new CharLitExpr(lit, c),
+            Make<CharLitExpr>(lit, c),
             out);
       }
       case K_TRUE:
       case K_FALSE:
-        return after.Success(new BoolLitExpr(lit), out);
+        return after.Success(Make<BoolLitExpr>(lit), out);
       case K_NULL:
-        return after.Success(new NullLitExpr(lit), out);
+        return after.Success(Make<NullLitExpr>(lit), out);
       case STRING: {
         // Strip off quotes.
         string s = TokenString(GetFile(), Token(lit.type, base::PosRange(fid_, lit.pos.begin + 1, lit.pos.end - 1)));
         return after.Success(
-            new StringLitExpr(lit, lexer::ConvertStringEscapes(s)),
+            Make<StringLitExpr>(lit, lexer::ConvertStringEscapes(s)),
             out);
       }
       default:
@@ -644,10 +647,10 @@ Parser Parser::ParsePrimaryBase(Result<Expr>* out) const {
     }
   }
 
-  {
+  if (IsNext(K_THIS)) {
     Result<Token> thisTok;
     Parser after = ParseTokenIf(ExactType(K_THIS), &thisTok);
-    RETURN_IF_GOOD(after, new ThisExpr(*thisTok.Get()), out);
+    RETURN_IF_GOOD(after, Make<ThisExpr>(*thisTok.Get()), out);
   }
 
   if (IsNext(LPAREN)) {
@@ -659,17 +662,16 @@ Parser Parser::ParsePrimaryBase(Result<Expr>* out) const {
                        .ParseTokenIf(ExactType(LPAREN), &lparen)
                        .ParseExpression(&expr)
                        .ParseTokenIf(ExactType(RPAREN), &rparen);
-    RETURN_IF_GOOD(after, new ParenExpr(*lparen.Get(), expr.Get(), *rparen.Get()), out);
+    RETURN_IF_GOOD(after, Make<ParenExpr>(*lparen.Get(), expr.Get(), *rparen.Get()), out);
 
-    ErrorList errors;
-    FirstOf(&errors, &lparen, &expr, &rparen);
-    return Fail(move(errors), out);
+    FirstOf(out, &lparen, &expr, &rparen);
+    return Fail();
   }
 
   if (IsNext(IDENTIFIER)) {
     Result<QualifiedName> name;
     Parser after = ParseQualifiedName(&name);
-    RETURN_IF_GOOD(after, new NameExpr(*name.Get()), out);
+    RETURN_IF_GOOD(after, Make<NameExpr>(*name.Get()), out);
 
     *out = ConvertError<QualifiedName, Expr>(move(name));
     return Fail();
@@ -695,13 +697,12 @@ Parser Parser::ParsePrimaryEnd(sptr<const Expr> base, Result<Expr>* out) const {
                        .ParseTokenIf(ExactType(RBRACK), &rbrack);
 
     if (!after) {
-      ErrorList errors;
-      FirstOf(&errors, &lbrack, &expr, &rbrack);
-      return Fail(move(errors), out);
+      FirstOf(out, &lbrack, &expr, &rbrack);
+      return Fail();
     }
 
     // Try optional PrimaryEndNoArrayAccess.
-    sptr<const Expr> index = make_shared<ArrayIndexExpr>(base, *lbrack.Get(), expr.Get(), *rbrack.Get());
+    sptr<const Expr> index = Make<ArrayIndexExpr>(base, *lbrack.Get(), expr.Get(), *rbrack.Get());
     Result<Expr> nested;
     Parser afterEnd = after.ParsePrimaryEndNoArrayAccess(index, &nested);
     RETURN_IF_GOOD(afterEnd, nested.Get(), out);
@@ -735,12 +736,11 @@ Parser Parser::ParsePrimaryEndNoArrayAccess(sptr<const Expr> base,
         ExactType(IDENTIFIER), &ident);
 
     if (!after) {
-      ErrorList errors;
-      FirstOf(&errors, &dot, &ident);
-      return Fail(move(errors), out);
+      FirstOf(out, &dot, &ident);
+      return Fail();
     }
 
-    sptr<const Expr> deref = make_shared<FieldDerefExpr>(base, TokenString(GetFile(), *ident.Get()),
+    sptr<const Expr> deref = Make<FieldDerefExpr>(base, TokenString(GetFile(), *ident.Get()),
                                      *ident.Get());
     Result<Expr> nested;
     Parser afterEnd = after.ParsePrimaryEnd(deref, &nested);
@@ -760,12 +760,11 @@ Parser Parser::ParsePrimaryEndNoArrayAccess(sptr<const Expr> base,
                        .ParseTokenIf(ExactType(RPAREN), &rparen);
 
     if (!after) {
-      ErrorList errors;
-      FirstOf(&errors, &lparen, &args, &rparen);
-      return Fail(move(errors), out);
+      FirstOf(out, &lparen, &args, &rparen);
+      return Fail();
     }
 
-    sptr<const Expr> call = make_shared<CallExpr>(base, *lparen.Get(), *args.Get(), *rparen.Get());
+    sptr<const Expr> call = Make<CallExpr>(base, *lparen.Get(), *args.Get(), *rparen.Get());
     Result<Expr> nested;
     Parser afterEnd = after.ParsePrimaryEnd(call, &nested);
     RETURN_IF_GOOD(afterEnd, nested.Get(), out);
@@ -783,7 +782,7 @@ Parser Parser::ParseArgumentList(Result<SharedPtrVector<const Expr>>* out) const
   Result<Expr> first;
   Parser cur = ParseExpression(&first);
   if (!cur) {
-    return Success(new SharedPtrVector<const Expr>(args), out);
+    return Success(Make<SharedPtrVector<const Expr>>(args), out);
   }
   args.Append(first.Get());
 
@@ -795,16 +794,15 @@ Parser Parser::ParseArgumentList(Result<SharedPtrVector<const Expr>>* out) const
         cur.ParseTokenIf(ExactType(COMMA), &comma).ParseExpression(&expr);
     if (!next) {
       // Fail on hanging comma.
-      ErrorList errors;
-      FirstOf(&errors, &comma, &expr);
-      return Fail(move(errors), out);
+      FirstOf(out, &comma, &expr);
+      return Fail();
     }
 
     args.Append(expr.Get());
     cur = next;
   }
 
-  return cur.Success(new SharedPtrVector<const Expr>(args), out);
+  return cur.Success(Make<SharedPtrVector<const Expr>>(args), out);
 }
 
 Parser Parser::ParseStmt(Result<Stmt>* out) const {
@@ -819,7 +817,7 @@ Parser Parser::ParseStmt(Result<Stmt>* out) const {
   SHORT_CIRCUIT;
 
   if (IsNext(SEMI)) {
-    return Advance().Success(new EmptyStmt(GetNext()), out);
+    return Advance().Success(Make<EmptyStmt>(GetNext()), out);
   }
 
   if (IsNext(LBRACE)) {
@@ -847,12 +845,11 @@ Parser Parser::ParseStmt(Result<Stmt>* out) const {
     Result<Token> semi;
     Parser after =
         (*this).ParseExpression(&expr).ParseTokenIf(ExactType(SEMI), &semi);
-    RETURN_IF_GOOD(after, new ExprStmt(expr.Get()), out);
+    RETURN_IF_GOOD(after, Make<ExprStmt>(expr.Get()), out);
 
     // Fail on last case.
-    ErrorList errors;
-    FirstOf(&errors, &expr, &semi);
-    return Fail(move(errors), out);
+    FirstOf(out, &expr, &semi);
+    return Fail();
   }
 }
 
@@ -871,13 +868,12 @@ Parser Parser::ParseVarDecl(Result<Stmt>* out) const {
                      .ParseTokenIf(ExactType(ASSG), &eq)
                      .ParseExpression(&expr);
   RETURN_IF_GOOD(
-      after, new LocalDeclStmt(type.Get(), TokenString(file_, *ident.Get()), *ident.Get(), expr.Get()),
+      after, Make<LocalDeclStmt>(type.Get(), TokenString(file_, *ident.Get()), *ident.Get(), expr.Get()),
       out);
 
   // TODO: Make it fatal error only after we find equals?
-  ErrorList errors;
-  FirstOf(&errors, &type, &ident, &eq, &expr);
-  return Fail(move(errors), out);
+  FirstOf(out, &type, &ident, &eq, &expr);
+  return Fail();
 }
 
 Parser Parser::ParseReturnStmt(Result<Stmt>* out) const {
@@ -889,7 +885,7 @@ Parser Parser::ParseReturnStmt(Result<Stmt>* out) const {
   Parser afterRet = ParseTokenIf(ExactType(K_RETURN), &ret);
 
   if (afterRet && afterRet.IsNext(SEMI)) {
-    return afterRet.Advance().Success(new ReturnStmt(*ret.Get(), nullptr), out);
+    return afterRet.Advance().Success(Make<ReturnStmt>(*ret.Get(), nullptr), out);
   }
 
   Result<Expr> expr;
@@ -897,11 +893,10 @@ Parser Parser::ParseReturnStmt(Result<Stmt>* out) const {
   Parser afterAll =
       afterRet.ParseExpression(&expr).ParseTokenIf(ExactType(SEMI), &semi);
 
-  RETURN_IF_GOOD(afterAll, new ReturnStmt(*ret.Get(), expr.Get()), out);
+  RETURN_IF_GOOD(afterAll, Make<ReturnStmt>(*ret.Get(), expr.Get()), out);
 
-  ErrorList errors;
-  FirstOf(&errors, &ret, &expr, &semi);
-  return Fail(move(errors), out);
+  FirstOf(out, &ret, &expr, &semi);
+  return Fail();
 }
 
 Parser Parser::ParseBlock(Result<Stmt>* out) const {
@@ -923,7 +918,7 @@ Parser Parser::ParseBlock(Result<Stmt>* out) const {
   Token lbrace = GetNext();
   Parser cur = Advance();
   while (!cur.IsNext(RBRACE)) {
-    {
+    if (cur.IsVarDeclNext()) {
       Result<Stmt> varDecl;
       Result<Token> semi;
       Parser next =
@@ -943,14 +938,13 @@ Parser Parser::ParseBlock(Result<Stmt>* out) const {
         cur = next;
         continue;
       }
-      ErrorList errors;
-      stmt.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &stmt);
+      return Fail();
     }
   }
 
   Token rbrace = cur.GetNext();
-  return cur.Advance().Success(new BlockStmt(lbrace, stmts, rbrace), out);
+  return cur.Advance().Success(Make<BlockStmt>(lbrace, stmts, rbrace), out);
 }
 
 Parser Parser::ParseIfStmt(Result<Stmt>* out) const {
@@ -971,26 +965,24 @@ Parser Parser::ParseIfStmt(Result<Stmt>* out) const {
                      .ParseTokenIf(ExactType(RPAREN), &rparen)
                      .ParseStmt(&stmt);
   if (!after) {
-    ErrorList errors;
-    FirstOf(&errors, &tokIf, &lparen, &expr, &rparen, &stmt);
-    return Fail(move(errors), out);
+    FirstOf(out, &tokIf, &lparen, &expr, &rparen, &stmt);
+    return Fail();
   }
 
   if (!after.IsNext(K_ELSE)) {
     return after.Success(
-        new IfStmt(expr.Get(), stmt.Get(), make_shared<EmptyStmt>(lexer::Token(lexer::SEMI, base::PosRange(-1, -1, -1)))), out);
+        Make<IfStmt>(expr.Get(), stmt.Get(), Make<EmptyStmt>(lexer::Token(lexer::SEMI, base::PosRange(-1, -1, -1)))), out);
   }
 
   Result<Stmt> elseStmt;
   Parser afterElse = after.Advance().ParseStmt(&elseStmt);
   RETURN_IF_GOOD(afterElse,
-                 new IfStmt(expr.Get(), stmt.Get(), elseStmt.Get()),
+                 Make<IfStmt>(expr.Get(), stmt.Get(), elseStmt.Get()),
                  out);
 
   // Committed to having else, so fail.
-  ErrorList errors;
-  elseStmt.ReleaseErrors(&errors);
-  return Fail(move(errors), out);
+  FirstOf(out, &elseStmt);
+  return Fail();
 }
 
 Parser Parser::ParseForInit(Result<Stmt>* out) const {
@@ -999,7 +991,7 @@ Parser Parser::ParseForInit(Result<Stmt>* out) const {
   //   Expression
   SHORT_CIRCUIT;
 
-  {
+  if (IsVarDeclNext()) {
     Result<Stmt> varDecl;
     Parser after = ParseVarDecl(&varDecl);
     RETURN_IF_GOOD(after, varDecl.Get(), out);
@@ -1009,10 +1001,9 @@ Parser Parser::ParseForInit(Result<Stmt>* out) const {
     Result<Expr> expr;
     Parser after = ParseExpression(&expr);
     // Note: This ExprStmt didn't consume a semicolon!
-    RETURN_IF_GOOD(after, new ExprStmt(expr.Get()), out);
-    ErrorList errors;
-    expr.ReleaseErrors(&errors);
-    return Fail(move(errors), out);
+    RETURN_IF_GOOD(after, Make<ExprStmt>(expr.Get()), out);
+    FirstOf(out, &expr);
+    return Fail();
   }
 }
 
@@ -1027,9 +1018,8 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
       ExactType(LPAREN), &lparen);
 
   if (!next) {
-    ErrorList errors;
-    FirstOf(&errors, &forTok, &lparen);
-    return Fail(move(errors), out);
+    FirstOf(out, &forTok, &lparen);
+    return Fail();
   }
 
   // TODO: Make emptystmt not print anything.
@@ -1037,7 +1027,7 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
   // Parse optional for initializer.
   sptr<const Stmt> forInit;
   if (next.IsNext(SEMI)) {
-    forInit.reset(new EmptyStmt(next.GetNext()));
+    forInit = Make<EmptyStmt>(next.GetNext());
     next = next.Advance();
   } else {
     Result<Stmt> stmt;
@@ -1045,9 +1035,8 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
     Parser afterInit =
         next.ParseForInit(&stmt).ParseTokenIf(ExactType(SEMI), &semi);
     if (!afterInit) {
-      ErrorList errors;
-      FirstOf(&errors, &stmt, &semi);
-      return next.Fail(move(errors), out);
+      FirstOf(out, &stmt, &semi);
+      return next.Fail();
     }
     forInit = stmt.Get();
     next = afterInit;
@@ -1063,9 +1052,8 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
     Parser afterCond =
         next.ParseExpression(&cond).ParseTokenIf(ExactType(SEMI), &semi);
     if (!afterCond) {
-      ErrorList errors;
-      FirstOf(&errors, &cond, &semi);
-      return next.Fail(move(errors), out);
+      FirstOf(out, &cond, &semi);
+      return next.Fail();
     }
     forCond = cond.Get();
     next = afterCond;
@@ -1077,9 +1065,8 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
     Result<Expr> update;
     Parser afterUpdate = next.ParseExpression(&update);
     if (!afterUpdate) {
-      ErrorList errors;
-      update.ReleaseErrors(&errors);
-      return next.Fail(move(errors), out);
+      FirstOf(out, &update);
+      return next.Fail();
     }
     forUpdate = update.Get();
     next = afterUpdate;
@@ -1089,13 +1076,12 @@ Parser Parser::ParseForStmt(Result<Stmt>* out) const {
   Result<Token> rparen;
   Result<Stmt> body;
   Parser after = next.ParseTokenIf(ExactType(RPAREN), &rparen).ParseStmt(&body);
-  RETURN_IF_GOOD(after, new ForStmt(forInit, forCond,
+  RETURN_IF_GOOD(after, Make<ForStmt>(forInit, forCond,
                                     forUpdate, body.Get()),
                  out);
 
-  ErrorList errors;
-  FirstOf(&errors, &rparen, &body);
-  return next.Fail(move(errors), out);
+  FirstOf(out, &rparen, &body);
+  return next.Fail();
 }
 
 Parser Parser::ParseWhileStmt(internal::Result<Stmt>* out) const {
@@ -1117,11 +1103,10 @@ Parser Parser::ParseWhileStmt(internal::Result<Stmt>* out) const {
                      .ParseTokenIf(ExactType(RPAREN), &rparen)
                      .ParseStmt(&body);
 
-  RETURN_IF_GOOD(after, new WhileStmt(cond.Get(), body.Get()), out);
+  RETURN_IF_GOOD(after, Make<WhileStmt>(cond.Get(), body.Get()), out);
 
-  ErrorList errors;
-  FirstOf(&errors, &whileTok, &lparen, &cond, &rparen, &body);
-  return Fail(move(errors), out);
+  FirstOf(out, &whileTok, &lparen, &cond, &rparen, &body);
+  return Fail();
 }
 
 Parser Parser::ParseModifierList(Result<ModifierList>* out) const {
@@ -1142,7 +1127,7 @@ Parser Parser::ParseModifierList(Result<ModifierList>* out) const {
     Result<Token> tok;
     Parser next = cur.ParseTokenIf(IsModifier, &tok);
     if (!next) {
-      return cur.Success(new ModifierList(move(ml)), out);
+      return cur.Success(Make<ModifierList>(move(ml)), out);
     }
     if (!ml.AddModifier(*tok.Get())) {
       return cur.Fail(MakeDuplicateModifierError(*tok.Get()), out);
@@ -1183,9 +1168,8 @@ Parser Parser::ParseMemberDecl(Result<MemberDecl>* out) const {
   }
   Parser afterCommon = afterType.ParseTokenIf(ExactType(IDENTIFIER), &ident);
   if (!afterCommon) {
-    ErrorList errors;
-    FirstOf(&errors, &mods, &type, &ident);
-    return Fail(move(errors), out);
+    FirstOf(out, &mods, &type, &ident);
+    return Fail();
   }
 
   // Parse method.
@@ -1197,23 +1181,21 @@ Parser Parser::ParseMemberDecl(Result<MemberDecl>* out) const {
             ExactType(RPAREN), &rparen);
 
     if (!afterParams) {
-      ErrorList errors;
-      FirstOf(&errors, &params, &rparen);
-      return afterCommon.Fail(move(errors), out);
+      FirstOf(out, &params, &rparen);
+      return afterCommon.Fail();
     }
 
     sptr<const Stmt> bodyPtr(nullptr);
     Parser afterBody = afterParams;
     if (afterParams.IsNext(SEMI)) {
-      bodyPtr.reset(new EmptyStmt(afterParams.GetNext()));
+      bodyPtr = Make<EmptyStmt>(afterParams.GetNext());
       afterBody = afterParams.Advance();
     } else {
       Result<Stmt> body;
       afterBody = afterParams.ParseBlock(&body);
       if (!afterBody) {
-        ErrorList errors;
-        body.ReleaseErrors(&errors);
-        return afterParams.Fail(move(errors), out);
+        FirstOf(out, &body);
+        return afterParams.Fail();
       }
       bodyPtr = body.Get();
     }
@@ -1223,7 +1205,7 @@ Parser Parser::ParseMemberDecl(Result<MemberDecl>* out) const {
       typeptr = type.Get();
     }
     return afterBody.Success(
-        new MethodDecl(*mods.Get(), typeptr, TokenString(file_, *ident.Get()),
+        Make<MethodDecl>(*mods.Get(), typeptr, TokenString(file_, *ident.Get()),
             *ident.Get(), params.Get(), bodyPtr),
         out);
   }
@@ -1231,7 +1213,7 @@ Parser Parser::ParseMemberDecl(Result<MemberDecl>* out) const {
   // Parse field.
   if (afterCommon.IsNext(SEMI)) {
     return afterCommon.Advance().Success(
-        new FieldDecl(*mods.Get(), type.Get(), TokenString(file_, *ident.Get()),
+        Make<FieldDecl>(*mods.Get(), type.Get(), TokenString(file_, *ident.Get()),
             *ident.Get(), nullptr),
         out);
   }
@@ -1243,13 +1225,12 @@ Parser Parser::ParseMemberDecl(Result<MemberDecl>* out) const {
                         .ParseExpression(&val)
                         .ParseTokenIf(ExactType(SEMI), &semi);
 
-  RETURN_IF_GOOD(afterVal, new FieldDecl(*mods.Get(), type.Get(),
+  RETURN_IF_GOOD(afterVal, Make<FieldDecl>(*mods.Get(), type.Get(),
         TokenString(file_, *ident.Get()), *ident.Get(), val.Get()),
                  out);
 
-  ErrorList errors;
-  FirstOf(&errors, &eq, &val, &semi);
-  return afterCommon.Fail(move(errors), out);
+  FirstOf(out, &eq, &val, &semi);
+  return afterCommon.Fail();
 }
 
 Parser Parser::ParseParamList(Result<ParamList>* out) const {
@@ -1272,9 +1253,8 @@ Parser Parser::ParseParamList(Result<ParamList>* out) const {
         break;
       }
       // Bad token or EOF after a comma.
-      ErrorList errors;
-      type.ReleaseErrors(&errors);
-      return cur.Fail(move(errors), out);
+      FirstOf(out, &type);
+      return cur.Fail();
     }
     firstParam = false;
 
@@ -1284,7 +1264,7 @@ Parser Parser::ParseParamList(Result<ParamList>* out) const {
       return afterType.Fail(MakeParamRequiresNameError(cur.GetNext()), out);
     }
     cur = afterIdent;
-    params.Append(make_shared<Param>(type.Get(), TokenString(file_, *ident.Get()), *ident.Get()));
+    params.Append(Make<Param>(type.Get(), TokenString(file_, *ident.Get()), *ident.Get()));
 
     if (cur.IsNext(COMMA)) {
       cur = cur.Advance();
@@ -1292,7 +1272,7 @@ Parser Parser::ParseParamList(Result<ParamList>* out) const {
       break;
     }
   }
-  return cur.Success(new ParamList(params), out);
+  return cur.Success(Make<ParamList>(params), out);
 }
 
 Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
@@ -1312,9 +1292,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
   Result<ModifierList> mods;
   Parser afterMods = (*this).ParseModifierList(&mods);
   if (!afterMods) {
-    ErrorList errors;
-    mods.ReleaseErrors(&errors);
-    return Fail(move(errors), out);
+    FirstOf(out, &mods);
+    return Fail();
   }
 
   if (afterMods.IsAtEnd()) {
@@ -1333,9 +1312,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
   Parser afterIdent = afterType.ParseTokenIf(ExactType(IDENTIFIER), &ident);
 
   if (!afterIdent) {
-    ErrorList errors;
-    ident.ReleaseErrors(&errors);
-    return Fail(move(errors), out);
+    FirstOf(out, &ident);
+    return Fail();
   }
 
   vector<QualifiedName> extends;
@@ -1348,9 +1326,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
       .ParseQualifiedName(&firstExtend);
 
     if (!afterExtends) {
-      ErrorList errors;
-      firstExtend.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &firstExtend);
+      return Fail();
     }
 
     extends.push_back(*firstExtend.Get());
@@ -1362,9 +1339,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
         .ParseQualifiedName(&nextExtend);
 
       if (!afterExtends) {
-        ErrorList errors;
-        nextExtend.ReleaseErrors(&errors);
-        return Fail(move(errors), out);
+        FirstOf(out, &nextExtend);
+        return Fail();
       }
 
       extends.push_back(*nextExtend.Get());
@@ -1378,9 +1354,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
       .ParseQualifiedName(&firstImplements);
 
     if (!afterImplements) {
-      ErrorList errors;
-      firstImplements.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &firstImplements);
+      return Fail();
     }
 
     implements.push_back(*firstImplements.Get());
@@ -1390,9 +1365,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
         .ParseQualifiedName(&nextImplement);
 
       if (!afterImplements) {
-        ErrorList errors;
-        nextImplement.ReleaseErrors(&errors);
-        return Fail(move(errors), out);
+        FirstOf(out, &nextImplement);
+        return Fail();
       }
 
       implements.push_back(*nextImplement.Get());
@@ -1402,9 +1376,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
   Result<Token> lbrace;
   Parser afterBrace = afterImplements.ParseTokenIf(ExactType(LBRACE), &lbrace);
   if (!afterBrace) {
-    ErrorList errors;
-    lbrace.ReleaseErrors(&errors);
-    return afterImplements.Fail(move(errors), out);
+    FirstOf(out, &lbrace);
+    return afterImplements.Fail();
   }
 
   SharedPtrVector<const MemberDecl> members;
@@ -1420,9 +1393,8 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
     Parser afterMember = afterBody.ParseMemberDecl(&member);
 
     if (!afterMember) {
-      ErrorList errors;
-      member.ReleaseErrors(&errors);
-      return afterBody.Fail(move(errors), out);
+      FirstOf(out, &member);
+      return afterBody.Fail();
     }
 
     members.Append(member.Get());
@@ -1430,7 +1402,7 @@ Parser Parser::ParseTypeDecl(Result<TypeDecl>* out) const {
   }
 
   Parser afterRbrace = afterBody.Advance();
-  return afterRbrace.Success(new TypeDecl(*mods.Get(), kind, TokenString(GetFile(), *ident.Get()),
+  return afterRbrace.Success(Make<TypeDecl>(*mods.Get(), kind, TokenString(GetFile(), *ident.Get()),
         *ident.Get(), extends, implements, members), out);
 }
 
@@ -1449,9 +1421,8 @@ Parser Parser::ParseImportDecl(Result<ImportDecl>* out) const {
       ExactType(IDENTIFIER), &ident);
 
   if (!cur) {
-    ErrorList errors;
-    FirstOf(&errors, &import, &ident);
-    return Fail(move(errors), out);
+    FirstOf(out, &import, &ident);
+    return Fail();
   }
   tokens.push_back(*ident.Get());
 
@@ -1469,9 +1440,8 @@ Parser Parser::ParseImportDecl(Result<ImportDecl>* out) const {
     Result<Token> nextIdent;
     next = next.ParseTokenIf(ExactType(IDENTIFIER), &nextIdent);
     if (!next) {
-      ErrorList errors;
-      nextIdent.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &nextIdent);
+      return Fail();
     }
 
     tokens.push_back(dot);
@@ -1483,13 +1453,12 @@ Parser Parser::ParseImportDecl(Result<ImportDecl>* out) const {
   Parser afterSemi = cur.ParseTokenIf(ExactType(SEMI), &semi);
 
   if (!afterSemi) {
-    ErrorList errors;
-    semi.ReleaseErrors(&errors);
-    return Fail(move(errors), out);
+    FirstOf(out, &semi);
+    return Fail();
   }
 
   return afterSemi.Success(
-      new ImportDecl(MakeQualifiedName(GetFile(), tokens), isWildCard), out);
+      Make<ImportDecl>(MakeQualifiedName(GetFile(), tokens), isWildCard), out);
 }
 
 Parser Parser::ParseCompUnit(internal::Result<CompUnit>* out) const {
@@ -1508,7 +1477,7 @@ Parser Parser::ParseCompUnit(internal::Result<CompUnit>* out) const {
   SharedPtrVector<const TypeDecl> types;
 
   if (IsAtEnd()) {
-    return Success(new CompUnit(fid_, nullptr, imports, types), out);
+    return Success(Make<CompUnit>(fid_, nullptr, imports, types), out);
   }
 
   sptr<const QualifiedName> packageName(nullptr);
@@ -1524,9 +1493,8 @@ Parser Parser::ParseCompUnit(internal::Result<CompUnit>* out) const {
                        .ParseTokenIf(ExactType(SEMI), &semi);
 
     if (!afterPackage) {
-      ErrorList errors;
-      FirstOf(&errors, &package, &name, &semi);
-      return Fail(move(errors), out);
+      FirstOf(out, &package, &name, &semi);
+      return Fail();
     }
 
     packageName = name.Get();
@@ -1538,9 +1506,8 @@ Parser Parser::ParseCompUnit(internal::Result<CompUnit>* out) const {
     afterImports = afterImports.ParseImportDecl(&import).EatSemis();
 
     if (!afterImports) {
-      ErrorList errors;
-      import.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &import);
+      return Fail();
     }
 
     imports.push_back(*import.Get());
@@ -1552,16 +1519,15 @@ Parser Parser::ParseCompUnit(internal::Result<CompUnit>* out) const {
     afterTypes = afterTypes.ParseTypeDecl(&type).EatSemis();
 
     if (!afterTypes) {
-      ErrorList errors;
-      type.ReleaseErrors(&errors);
-      return Fail(move(errors), out);
+      FirstOf(out, &type);
+      return Fail();
     }
 
     types.Append(type.Get());
   }
 
   return afterTypes.Success(
-      new CompUnit(fid_, packageName, imports, types), out);
+      Make<CompUnit>(fid_, packageName, imports, types), out);
 }
 
 sptr<const Program> Parse(const base::FileSet* fs,
@@ -1572,22 +1538,39 @@ sptr<const Program> Parse(const base::FileSet* fs,
   SharedPtrVector<const CompUnit> units;
 
   for (int i = 0; i < fs->Size(); ++i) {
-    const File* file = fs->Get(i);
-    const vector<Token>& filetoks = tokens[i];
-    Result<CompUnit> unit;
+    sptr<const CompUnit> unit =
+        ParseFile(fs, i, lexer::TokenBuffer(i, tokens[i]), error_out);
+    if (unit != nullptr) {
+      units.Append(unit);
+    }
+  }
+
+  return make_shared<Program>(units);
+}
 
-    Parser parser(fs, file, i, &filetoks, 0);
-    parser.ParseCompUnit(&unit);
+sptr<const CompUnit> ParseFile(const base::FileSet* fs, int fileid,
+                               const lexer::TokenBuffer& tokens,
+                               ErrorList* error_out, AstAllocation allocation) {
+  CHECK(tokens.FileId() == fileid);
+  const File* file = fs->Get(fileid);
+  Result<CompUnit> unit;
 
-    if (unit) {
-      units.Append(unit.Get());
-    }
+  // The nodes keep the arena alive, so it can go out of scope here.
+  sptr<base::Arena> arena;
+  if (allocation == AstAllocation::ARENA) {
+    arena = make_shared<base::Arena>();
+  }
+  Parser parser(fs, file, fileid, &tokens, 0, false, arena.get());
+  parser.ParseCompUnit(&unit);
 
-    // Move all errors and warnings to the output list.
-    unit.ReleaseErrors(error_out);
+  sptr<const CompUnit> result;
+  if (unit) {
+    result = unit.Get();
   }
 
-  return make_shared<Program>(units);
+  // Move all errors and warnings to the output list.
+  unit.ReleaseErrors(error_out);
+  return result;
 }
 
 // TODO: "Integer[] a;" gives strange error - should say requires
@@ -5,13 +5,30 @@
 #include "base/errorlist.h"
 #include "base/fileset.h"
 #include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
 
 namespace parser {
 
+// Where the parser allocates AST nodes.
+enum class AstAllocation {
+  // Each node on its own, with make_shared.
+  HEAP,
+  // In one arena per file, together with their shared_ptr control blocks. The
+  // arena is freed in one go once no node of the file is referenced.
+  ARENA,
+};
+
 sptr<const ast::Program> Parse(const base::FileSet* fs,
                           const vector<vector<lexer::Token>>& tokens,
                           base::ErrorList* out);
 
+// Parses the tokens of a single file. Returns nullptr if the file could not
+// be parsed; errors are appended to out either way.
+sptr<const ast::CompUnit> ParseFile(const base::FileSet* fs, int fileid,
+                                    const lexer::TokenBuffer& tokens,
+                                    base::ErrorList* out,
+                                    AstAllocation allocation = AstAllocation::HEAP);
+
 string TokenString(const base::File* file, lexer::Token token);
 
 } // namespace parser
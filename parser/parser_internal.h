@@ -2,14 +2,32 @@
 #define PARSER_PARSER_INTERNAL_H
 
 #include "ast/ast.h"
+#include "base/arena.h"
 #include "base/errorlist.h"
 #include "base/file.h"
 #include "gtest/gtest.h"
 #include "lexer/lexer.h"
+#include "lexer/token_buffer.h"
 
 namespace parser {
 namespace internal {
 
+// An error that has been found but not built yet. Most failures happen in
+// alternatives that the parser backtracks over, so the Error is only
+// allocated if someone asks for it.
+struct DeferredError {
+  DeferredError(base::PosRange pos, const char* name, const char* msg)
+      : pos(pos), name(name), msg(msg) {}
+
+  base::Error* Build() const {
+    return base::MakeSimplePosRangeError(pos, name, msg);
+  }
+
+  base::PosRange pos;
+  const char* name;
+  const char* msg;
+};
+
 template <typename T>
 class Result final {
  public:
@@ -19,7 +37,9 @@ class Result final {
 
   explicit operator bool() const { return IsSuccess(); }
 
-  bool IsSuccess() const { return !errors_.IsFatal(); }
+  bool IsSuccess() const { return !has_deferred_ && !errors_.IsFatal(); }
+
+  bool HasErrors() const { return has_deferred_ || errors_.Size() > 0; }
 
   sptr<const T> Get() const {
     if (!IsSuccess()) {
@@ -29,6 +49,7 @@ class Result final {
   }
 
   void ReleaseErrors(base::ErrorList* out) {
+    BuildDeferred();
     vector<base::Error*> errors;
     errors_.Release(&errors);
     for (auto err : errors) {
@@ -36,15 +57,39 @@ class Result final {
     }
   }
 
-  const base::ErrorList& Errors() const { return errors_; }
+  const base::ErrorList& Errors() const {
+    BuildDeferred();
+    return errors_;
+  }
+
+  // Replaces this result's errors with other's, leaving other empty.
+  template <typename U>
+  void TakeErrors(Result<U>* other) {
+    errors_ = std::move(other->errors_);
+    has_deferred_ = other->has_deferred_;
+    deferred_ = other->deferred_;
+    other->has_deferred_ = false;
+  }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(Result);
 
+  template <typename U>
+  friend class Result;
+
   Result(sptr<const T> data) : success_(true), data_(data) {}
   Result(base::Error* err) { errors_.Append(err); }
   Result(base::ErrorList&& errors)
       : success_(false), errors_(std::forward<base::ErrorList>(errors)) {}
+  Result(const DeferredError& err)
+      : success_(false), has_deferred_(true), deferred_(err) {}
+
+  void BuildDeferred() const {
+    if (has_deferred_) {
+      errors_.Append(deferred_.Build());
+      has_deferred_ = false;
+    }
+  }
 
   template <typename U>
   friend Result<U> MakeSuccess(const U* t);
@@ -58,12 +103,14 @@ class Result final {
   template <typename U>
   friend Result<U> Failure(base::ErrorList&&);
 
-  template <typename T1, typename T2>
-  friend Result<T2> ConvertError(Result<T1>&&);
+  template <typename U>
+  friend Result<U> Failure(const DeferredError&);
 
   bool success_ = false;
   sptr<const T> data_;
-  base::ErrorList errors_;
+  mutable base::ErrorList errors_;
+  mutable bool has_deferred_ = false;
+  DeferredError deferred_ = DeferredError(base::PosRange(-1, -1, -1), "", "");
 };
 
 template <typename T>
@@ -82,37 +129,55 @@ template <typename T>
 Result<T> Failure(base::ErrorList&& e) {
   return Result<T>(std::forward<base::ErrorList>(e));
 }
-
 template <typename T>
-void FirstOf(base::ErrorList* out, T* result) {
-  result->ReleaseErrors(out);
+Result<T> Failure(const DeferredError& e) {
+  return Result<T>(e);
 }
 
-template <typename T, typename... Rest>
-void FirstOf(base::ErrorList* out, T* first, Rest... rest) {
-  if (first->Errors().Size() == 0) {
+// Moves the errors of the first result that has any into out; the last
+// result's errors are taken if none of the others have any.
+template <typename T, typename U>
+void FirstOf(Result<T>* out, Result<U>* last) {
+  out->TakeErrors(last);
+}
+
+template <typename T, typename U, typename... Rest>
+void FirstOf(Result<T>* out, Result<U>* first, Rest... rest) {
+  if (!first->HasErrors()) {
     return FirstOf(out, rest...);
   }
 
-  first->ReleaseErrors(out);
+  out->TakeErrors(first);
 }
 
 template <typename T, typename U>
 Result<U> ConvertError(Result<T>&& r) {
-  return Result<U>(std::move(r.errors_));
+  Result<U> result;
+  result.TakeErrors(&r);
+  return result;
 }
 
 }  // namespace internal
 
 struct Parser {
   Parser(const base::FileSet* fs, const base::File* file, int fid,
-         const vector<lexer::Token>* tokens, int index = 0, bool failed = false)
-      : fs_(fs), file_(file), fid_(fid), tokens_(tokens), index_(index), failed_(failed) {}
+         const lexer::TokenBuffer* tokens, int index = 0, bool failed = false,
+         base::Arena* arena = nullptr)
+      : fs_(fs), file_(file), fid_(fid), tokens_(tokens), index_(index), failed_(failed), arena_(arena) {}
 
   explicit operator bool() const { return !failed_; }
 
-  Parser ParseTokenIf(std::function<bool(lexer::Token)> pred,
-                      internal::Result<lexer::Token>* out) const;
+  template <typename P>
+  Parser ParseTokenIf(P pred, internal::Result<lexer::Token>* out) const {
+    if (IsAtEnd()) {
+      return Fail(MakeUnexpectedEOFError(), out);
+    }
+
+    if (!pred(GetNext())) {
+      return Fail(MakeUnexpectedTokenError(GetNext()), out);
+    }
+    return Advance().Success(Make<lexer::Token>(GetNext()), out);
+  }
 
   // Type-related parsers.
   Parser ParseQualifiedName(internal::Result<ast::QualifiedName>* out) const;
@@ -158,47 +223,57 @@ struct Parser {
   // Helper methods.
   Parser EatSemis() const;
 
-  bool IsAtEnd() const { return failed_ || (uint)index_ >= tokens_->size(); }
+  bool IsAtEnd() const { return failed_ || index_ >= tokens_->Size(); }
 
   bool Failed() const { return failed_; }
 
   lexer::Token GetNext() const {
     CHECK(!IsAtEnd());
-    return tokens_->at(index_);
+    return tokens_->At(index_);
   }
 
  private:
-  base::Error* MakeUnexpectedTokenError(lexer::Token token) const;
-  base::Error* MakeDuplicateModifierError(lexer::Token token) const;
-  base::Error* MakeParamRequiresNameError(lexer::Token token) const;
-  base::Error* MakeUnexpectedEOFError() const;
+  internal::DeferredError MakeUnexpectedTokenError(lexer::Token token) const;
+  internal::DeferredError MakeDuplicateModifierError(lexer::Token token) const;
+  internal::DeferredError MakeParamRequiresNameError(lexer::Token token) const;
+  internal::DeferredError MakeUnexpectedEOFError() const;
 
   bool IsNext(lexer::TokenType type) const {
-    return !IsAtEnd() && GetNext().type == type;
+    return !IsAtEnd() && tokens_->Type(index_) == type;
   }
 
-  bool IsNext(std::function<bool(lexer::Token)> pred) const {
+  template <typename P>
+  bool IsNext(P pred) const {
     return !IsAtEnd() && pred(GetNext());
   }
 
-  Parser Advance(int i = 1) const {
-    return Parser(fs_, file_, fid_, tokens_, index_ + i, failed_);
+  // The type of the token k past the next one, or NUM_TOKEN_TYPES if there
+  // is none.
+  lexer::TokenType Peek(int k) const {
+    int i = index_ + k;
+    if (failed_ || i >= tokens_->Size()) {
+      return lexer::NUM_TOKEN_TYPES;
+    }
+    return tokens_->Type(i);
   }
 
-  template <typename T>
-  Parser Fail(base::Error* error, internal::Result<T>* out) const {
-    *out = internal::Failure<T>(error);
-    return Fail();
+  // Whether a LocalVariableDeclaration could start here, judged from the
+  // tokens up to its "=". ParseVarDecl fails whenever this is false.
+  bool IsVarDeclNext() const;
+
+  Parser Advance(int i = 1) const {
+    return Parser(fs_, file_, fid_, tokens_, index_ + i, failed_, arena_);
   }
 
   template <typename T>
-  Parser Fail(base::ErrorList&& errors, internal::Result<T>* out) const {
-    *out = internal::Failure<T>(std::forward<base::ErrorList>(errors));
+  Parser Fail(const internal::DeferredError& error,
+              internal::Result<T>* out) const {
+    *out = internal::Failure<T>(error);
     return Fail();
   }
 
   Parser Fail() const {
-    return Parser(fs_, file_, fid_, tokens_, index_, /* failed */ true);
+    return Parser(fs_, file_, fid_, tokens_, index_, /* failed */ true, arena_);
   }
 
   template <typename T, typename U>
@@ -213,15 +288,22 @@ struct Parser {
     return *this;
   }
 
+  // Allocates an AST node, in the arena if there is one.
+  template <typename T, typename... Args>
+  sptr<T> Make(Args&&... args) const {
+    return base::MakeShared<T>(arena_, std::forward<Args>(args)...);
+  }
+
   const base::FileSet* Fs() const { return fs_; }
   const base::File* GetFile() const { return file_; }
 
   const base::FileSet* fs_ = nullptr;
   const base::File* file_ = nullptr;
   int fid_ = -1;
-  const vector<lexer::Token>* tokens_ = nullptr;
+  const lexer::TokenBuffer* tokens_ = nullptr;
   int index_ = -1;
   bool failed_ = false;
+  base::Arena* arena_ = nullptr;
 };
 
 }  // namespace parser
@@ -1,6 +1,8 @@
 #include "parser/parser_internal.h"
 
+#include "ast/composite_visitor.h"
 #include "ast/print_visitor.h"
+#include "ast/static_visitor.h"
 #include "gtest/gtest.h"
 #include "lexer/lexer.h"
 
@@ -52,10 +54,12 @@ class ParserTest : public ::testing::Test {
     ASSERT_EQ(1u, tokens.size());
     ASSERT_FALSE(errors.IsFatal());
 
-    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, &tokens[0]));
+    buffer_.reset(new lexer::TokenBuffer(0, tokens[0]));
+    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, buffer_.get()));
   }
 
   vector<vector<Token>> tokens;
+  uptr<lexer::TokenBuffer> buffer_;
   uptr<FileSet> fs_;
   uptr<Parser> parser_;
 };
@@ -1802,4 +1806,137 @@ TEST_F(ParserTest, CompUnitManySemisSuccess) {
             Str(unit.Get()));
 }
 
+class PruneEmptyStmtVisitor : public Visitor {
+  VISIT_DECL(EmptyStmt, stmt, stmtptr) {
+    return VisitResult::SKIP_PRUNE;
+  }
+};
+
+TEST_F(ParserTest, RewriteUnchangedDoesNotCopy) {
+  MakeParser("class Foo { void f() { a = 1; } void g(int x) { b(x, 2); } }");
+  Result<CompUnit> unit;
+  ASSERT_TRUE(b(parser_->ParseCompUnit(&unit)));
+
+  Visitor visitor;
+  EXPECT_EQ(unit.Get(), visitor.Rewrite(unit.Get()));
+  const Visitor::RewriteStats& stats = visitor.GetRewriteStats();
+  EXPECT_EQ(0u, stats.nodes_rebuilt);
+  EXPECT_EQ(0u, stats.lists_rebuilt);
+  EXPECT_EQ(6u, stats.lists);
+  EXPECT_EQ(6u, stats.AllocationsSaved());
+}
+
+TEST_F(ParserTest, RewriteCopiesOnlyChangedPath) {
+  MakeParser("class Foo { void f() { a = 1; ; } void g() { ; } void h() { b = 2; } }");
+  Result<CompUnit> unit;
+  ASSERT_TRUE(b(parser_->ParseCompUnit(&unit)));
+
+  PruneEmptyStmtVisitor visitor;
+  sptr<const CompUnit> after = visitor.Rewrite(unit.Get());
+  EXPECT_EQ("class Foo {K_VOID f(){(a ASSG INTEGER);}K_VOID g(){}K_VOID h(){(b ASSG INTEGER);}}", Str(after));
+
+  const SharedPtrVector<const MemberDecl>& oldMembers = unit.Get()->Types().At(0)->Members();
+  const SharedPtrVector<const MemberDecl>& newMembers = after->Types().At(0)->Members();
+  EXPECT_NE(oldMembers.At(0), newMembers.At(0));
+  EXPECT_NE(oldMembers.At(1), newMembers.At(1));
+  EXPECT_EQ(oldMembers.At(2), newMembers.At(2));
+
+  // Only f, g, and what contains them are copied; h is left alone.
+  const Visitor::RewriteStats& stats = visitor.GetRewriteStats();
+  EXPECT_EQ(4u, stats.lists_rebuilt);
+  EXPECT_EQ(6u, stats.nodes_rebuilt);
+}
+
+TEST_F(ParserTest, VisitIsReadOnly) {
+  MakeParser("class Foo { void f() { ; } }");
+  Result<CompUnit> unit;
+  ASSERT_TRUE(b(parser_->ParseCompUnit(&unit)));
+
+  PruneEmptyStmtVisitor visitor;
+  EXPECT_THROW(visitor.Visit(unit.Get()), std::logic_error);
+  EXPECT_EQ(0u, visitor.GetRewriteStats().lists_rebuilt);
+
+  // The failed Visit leaves the visitor able to rewrite.
+  EXPECT_NE(unit.Get(), visitor.Rewrite(unit.Get()));
+  EXPECT_EQ(3u, visitor.GetRewriteStats().lists_rebuilt);
+}
+
+class StaticPruneEmptyStmtVisitor final : public StaticVisitor<StaticPruneEmptyStmtVisitor> {
+ public:
+  VISIT_DECL(EmptyStmt, stmt, stmtptr) {
+    ++emptyStmts;
+    return VisitResult::SKIP_PRUNE;
+  }
+
+  int emptyStmts = 0;
+};
+
+TEST_F(ParserTest, StaticVisitorMatchesVisitor) {
+  MakeParser("class Foo { void f() { a = 1; ; } void g() { ; } void h() { b = 2; } }");
+  Result<CompUnit> unit;
+  ASSERT_TRUE(b(parser_->ParseCompUnit(&unit)));
+
+  EXPECT_EQ(NodeKind::CompUnit, unit.Get()->GetNodeKind());
+  const MemberDecl& f = *unit.Get()->Types().At(0)->Members().At(0);
+  EXPECT_EQ(NodeKind::MethodDecl, f.GetNodeKind());
+
+  PruneEmptyStmtVisitor dynamicVisitor;
+  StaticPruneEmptyStmtVisitor staticVisitor;
+  sptr<const CompUnit> dynamicAfter = dynamicVisitor.Rewrite(unit.Get());
+  sptr<const CompUnit> staticAfter = staticVisitor.Rewrite(unit.Get());
+
+  EXPECT_EQ(Str(dynamicAfter), Str(staticAfter));
+  EXPECT_EQ(2, staticVisitor.emptyStmts);
+  EXPECT_EQ(dynamicVisitor.GetRewriteStats().nodes, staticVisitor.GetRewriteStats().nodes);
+  EXPECT_EQ(dynamicVisitor.GetRewriteStats().nodes_rebuilt, staticVisitor.GetRewriteStats().nodes_rebuilt);
+}
+
+// Counts what it sees, without looking inside g.
+class CountingVisitor : public Visitor {
+ public:
+  VISIT_DECL(MethodDecl, decl, declptr) {
+    ++methods;
+    return decl.Name() == "g" ? VisitResult::SKIP : VisitResult::RECURSE;
+  }
+  VISIT_DECL(EmptyStmt, stmt, stmtptr) {
+    ++emptyStmts;
+    return VisitResult::RECURSE;
+  }
+
+  int methods = 0;
+  int emptyStmts = 0;
+};
+
+TEST_F(ParserTest, CompositeVisitorMatchesPassesInOrder) {
+  MakeParser("class Foo { void f() { a = 1; ; } void g() { ; } void h() { b = 2; } }");
+  Result<CompUnit> unit;
+  ASSERT_TRUE(b(parser_->ParseCompUnit(&unit)));
+
+  CountingVisitor before;
+  PruneEmptyStmtVisitor prune;
+  CountingVisitor after;
+  sptr<const CompUnit> expected = after.Rewrite(prune.Rewrite(before.Rewrite(unit.Get())));
+
+  // Every pass is shown the empty statements, and each counting pass skips g
+  // without stopping the others.
+  CountingVisitor composedBefore;
+  PruneEmptyStmtVisitor composedPrune;
+  CountingVisitor composedAfter;
+  CompositeVisitor<CountingVisitor, PruneEmptyStmtVisitor, CountingVisitor> composite(&composedBefore, &composedPrune, &composedAfter);
+  EXPECT_TRUE(composite.AnyHooks<EmptyStmt>());
+  EXPECT_FALSE(composite.AnyHooks<IntLitExpr>());
+  sptr<const CompUnit> actual = composite.Rewrite(unit.Get());
+
+  EXPECT_EQ(Str(expected), Str(actual));
+  EXPECT_TRUE(composite.Pruned());
+  EXPECT_EQ(before.methods, composedBefore.methods);
+  EXPECT_EQ(1, composedBefore.emptyStmts);
+  EXPECT_EQ(before.emptyStmts, composedBefore.emptyStmts);
+
+  // Alone, the last pass never saw the pruned statements; composed, it saw
+  // the one outside g, which is why Pruned() is reported.
+  EXPECT_EQ(0, after.emptyStmts);
+  EXPECT_EQ(1, composedAfter.emptyStmts);
+}
+
 }  // namespace parser
@@ -7,6 +7,8 @@ public final class StackFrame {
   protected String file;
   protected String type;
   protected String method;
+  // The frame this method was inlined into, if any.
+  protected StackFrame caller;
   protected int line;
 
   public static void PrintException(int type) {
@@ -42,5 +44,9 @@ public final class StackFrame {
     System.out.print(type);
     System.out.print(".");
     System.out.println(method);
+
+    if (caller != null) {
+      caller.Print();
+    }
   }
 }
@@ -13,4 +13,30 @@ public class StringOps {
 
     return s;
   }
+
+  // Joins parts into a new String, sizing it up front so each part is copied
+  // exactly once. Null parts are printed as "null".
+  public static String Concat(String[] parts) {
+    int length = 0;
+    for (int i = 0; i < parts.length; i = i + 1) {
+      if (parts[i] == null) {
+        parts[i] = "null";
+      }
+      length = length + parts[i].chars.length;
+    }
+
+    char[] chars = new char[length];
+    int j = 0;
+    for (int i = 0; i < parts.length; i = i + 1) {
+      char[] part = parts[i].chars;
+      for (int k = 0; k < part.length; k = k + 1) {
+        chars[j] = part[k];
+        j = j + 1;
+      }
+    }
+
+    String s = new String();
+    s.chars = chars;
+    return s;
+  }
 }
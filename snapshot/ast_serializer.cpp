@@ -0,0 +1,961 @@
+#include "snapshot/ast_serializer.h"
+
+#include "ast/ast.h"
+#include "ast/visitor.h"
+
+using ast::ArrayIndexExpr;
+using ast::ArrayType;
+using ast::BinExpr;
+using ast::BlockStmt;
+using ast::BoolLitExpr;
+using ast::CallExpr;
+using ast::CastExpr;
+using ast::CharLitExpr;
+using ast::CompUnit;
+using ast::ConstExpr;
+using ast::EmptyStmt;
+using ast::Expr;
+using ast::ExprStmt;
+using ast::FieldDecl;
+using ast::FieldDerefExpr;
+using ast::ForStmt;
+using ast::IfStmt;
+using ast::ImportDecl;
+using ast::InstanceOfExpr;
+using ast::IntLitExpr;
+using ast::LocalDeclStmt;
+using ast::MemberDecl;
+using ast::MethodDecl;
+using ast::ModifierList;
+using ast::NameExpr;
+using ast::NewArrayExpr;
+using ast::NewClassExpr;
+using ast::NullLitExpr;
+using ast::Param;
+using ast::ParamList;
+using ast::ParenExpr;
+using ast::PrimitiveType;
+using ast::QualifiedName;
+using ast::ReferenceType;
+using ast::ReturnStmt;
+using ast::StaticRefExpr;
+using ast::Stmt;
+using ast::StringLitExpr;
+using ast::ThisExpr;
+using ast::Type;
+using ast::TypeDecl;
+using ast::TypeId;
+using ast::TypeKind;
+using ast::UnaryExpr;
+using ast::VisitResult;
+using ast::WhileStmt;
+using base::PosRange;
+using base::SharedPtrVector;
+using lexer::Token;
+
+namespace snapshot {
+
+namespace {
+
+// Every node is preceded by one of these; kNull stands in for an absent
+// child.
+enum class Tag : u8 {
+  kNull,
+
+  kArrayIndexExpr,
+  kBinExpr,
+  kBoolLitExpr,
+  kCallExpr,
+  kCastExpr,
+  kCharLitExpr,
+  kFieldDerefExpr,
+  kInstanceOfExpr,
+  kIntLitExpr,
+  kNameExpr,
+  kNewArrayExpr,
+  kNewClassExpr,
+  kNullLitExpr,
+  kParenExpr,
+  kStaticRefExpr,
+  kStringLitExpr,
+  kThisExpr,
+  kUnaryExpr,
+  kConstExpr,
+
+  kBlockStmt,
+  kEmptyStmt,
+  kExprStmt,
+  kForStmt,
+  kIfStmt,
+  kLocalDeclStmt,
+  kReturnStmt,
+  kWhileStmt,
+
+  kPrimitiveType,
+  kReferenceType,
+  kArrayType,
+
+  kFieldDecl,
+  kMethodDecl,
+};
+
+// Integers are written as LEB128 varints; signed ones are zigzag-encoded
+// first.
+class Writer {
+ public:
+  Writer(int fileid, vector<u8>* out) : fileid_(fileid), out_(out) {}
+
+  void U64(u64 v) {
+    while (v >= 0x80) {
+      out_->push_back((u8)(v | 0x80));
+      v >>= 7;
+    }
+    out_->push_back((u8)v);
+  }
+
+  void I64(i64 v) {
+    U64(((u64)v << 1) ^ (u64)(v >> 63));
+  }
+
+  void Bool(bool b) {
+    U64(b ? 1 : 0);
+  }
+
+  void Put(Tag tag) {
+    out_->push_back((u8)tag);
+  }
+
+  void Str(const string& s) {
+    U64(s.size());
+    out_->insert(out_->end(), s.begin(), s.end());
+  }
+
+  void JStr(const jstring& s) {
+    U64(s.size());
+    for (jchar c : s) {
+      U64(c);
+    }
+  }
+
+  // Positions in the unit's own file are stored without their file id, so
+  // they can be renumbered on load. Anything else, such as the placeholder
+  // positions of synthesized tokens, is kept verbatim.
+  void Pos(PosRange pos) {
+    bool local = pos.fileid == fileid_;
+    Bool(local);
+    if (!local) {
+      I64(pos.fileid);
+    }
+    I64(pos.begin);
+    I64(pos.end - pos.begin);
+  }
+
+  void Tok(Token token) {
+    U64(token.type);
+    Pos(token.pos);
+  }
+
+  void Tid(TypeId tid) {
+    U64(tid.base);
+    U64(tid.ndims);
+  }
+
+ private:
+  int fileid_;
+  vector<u8>* out_;
+};
+
+class Reader {
+ public:
+  Reader(const u8* data, size_t len, int fileid) : data_(data), len_(len), fileid_(fileid) {}
+
+  bool AtEnd() const { return pos_ == len_; }
+
+  u64 U64() {
+    u64 v = 0;
+    for (int shift = 0; ; shift += 7) {
+      CHECK(shift < 64);
+      u8 byte = Byte();
+      v |= (u64)(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return v;
+      }
+    }
+  }
+
+  i64 I64() {
+    u64 v = U64();
+    return (i64)(v >> 1) ^ -(i64)(v & 1);
+  }
+
+  bool Bool() {
+    return U64() != 0;
+  }
+
+  Tag Get() {
+    u8 tag = Byte();
+    CHECK(tag <= (u8)Tag::kMethodDecl);
+    return (Tag)tag;
+  }
+
+  string Str() {
+    u64 size = U64();
+    CHECK(size <= len_ - pos_);
+    string s((const char*)data_ + pos_, size);
+    pos_ += size;
+    return s;
+  }
+
+  jstring JStr() {
+    u64 size = U64();
+    CHECK(size <= len_ - pos_);
+    jstring s;
+    s.reserve(size);
+    for (u64 i = 0; i < size; ++i) {
+      s.push_back((jchar)U64());
+    }
+    return s;
+  }
+
+  PosRange Pos() {
+    int fileid = Bool() ? fileid_ : (int)I64();
+    int begin = (int)I64();
+    int size = (int)I64();
+    return PosRange(fileid, begin, begin + size);
+  }
+
+  Token Tok() {
+    u64 type = U64();
+    CHECK(type < lexer::NUM_TOKEN_TYPES);
+    return Token((lexer::TokenType)type, Pos());
+  }
+
+  TypeId Tid() {
+    TypeId::Base base = U64();
+    u64 ndims = U64();
+    return TypeId{base, ndims};
+  }
+
+  int FileId() const { return fileid_; }
+
+ private:
+  u8 Byte() {
+    CHECK(pos_ < len_);
+    return data_[pos_++];
+  }
+
+  const u8* data_;
+  size_t len_;
+  size_t pos_ = 0;
+  int fileid_;
+};
+
+class Serializer final : public ast::Visitor {
+ public:
+  Serializer(Writer* w) : w_(w) {}
+
+  void Name(const QualifiedName& name) {
+    w_->U64(name.Tokens().size());
+    for (Token token : name.Tokens()) {
+      w_->Tok(token);
+    }
+    w_->U64(name.Parts().size());
+    for (const string& part : name.Parts()) {
+      w_->Str(part);
+    }
+    w_->Str(name.Name());
+  }
+
+  void Mods(const ModifierList& mods) {
+    vector<Token> tokens;
+    for (int i = 0; i < lexer::NUM_MODIFIERS; ++i) {
+      if (mods.HasModifier((lexer::Modifier)i)) {
+        tokens.push_back(mods.GetModifierToken((lexer::Modifier)i));
+      }
+    }
+    w_->U64(tokens.size());
+    for (Token token : tokens) {
+      w_->Tok(token);
+    }
+  }
+
+  void TypeNode(const sptr<const Type>& type) {
+    if (type == nullptr) {
+      w_->Put(Tag::kNull);
+      return;
+    }
+
+    if (auto prim = std::dynamic_pointer_cast<const PrimitiveType>(type)) {
+      w_->Put(Tag::kPrimitiveType);
+      w_->Tid(prim->GetTypeId());
+      w_->Tok(prim->GetToken());
+    } else if (auto ref = std::dynamic_pointer_cast<const ReferenceType>(type)) {
+      w_->Put(Tag::kReferenceType);
+      w_->Tid(ref->GetTypeId());
+      Name(ref->Name());
+    } else if (auto arr = std::dynamic_pointer_cast<const ArrayType>(type)) {
+      w_->Put(Tag::kArrayType);
+      w_->Tid(arr->GetTypeId());
+      TypeNode(arr->ElemTypePtr());
+      w_->Tok(arr->Lbrack());
+      w_->Tok(arr->Rbrack());
+    } else {
+      UNREACHABLE();
+    }
+  }
+
+  template <typename T>
+  void Node(const sptr<const T>& node) {
+    if (node == nullptr) {
+      w_->Put(Tag::kNull);
+      return;
+    }
+    Visit(node);
+  }
+
+  template <typename T>
+  void Nodes(const SharedPtrVector<const T>& nodes) {
+    w_->U64(nodes.Size());
+    for (int i = 0; i < nodes.Size(); ++i) {
+      Node(nodes.At(i));
+    }
+  }
+
+  void Params(const ParamList& params) {
+    w_->U64(params.Params().Size());
+    for (const auto& param : params.Params()) {
+      w_->U64(param.GetVarId());
+      TypeNode(param.GetTypePtr());
+      w_->Str(param.Name());
+      w_->Tok(param.NameToken());
+    }
+  }
+
+  void Unit(const CompUnit& unit) {
+    w_->Bool(unit.PackagePtr() != nullptr);
+    if (unit.PackagePtr() != nullptr) {
+      Name(*unit.PackagePtr());
+    }
+
+    w_->U64(unit.Imports().size());
+    for (const ImportDecl& import : unit.Imports()) {
+      Name(import.Name());
+      w_->Bool(import.IsWildCard());
+    }
+
+    w_->U64(unit.Types().Size());
+    for (const auto& decl : unit.Types()) {
+      w_->Tid(decl.GetTypeId());
+      Mods(decl.Mods());
+      w_->U64((u64)decl.Kind());
+      w_->Str(decl.Name());
+      w_->Tok(decl.NameToken());
+      w_->U64(decl.Extends().size());
+      for (const QualifiedName& name : decl.Extends()) {
+        Name(name);
+      }
+      w_->U64(decl.Implements().size());
+      for (const QualifiedName& name : decl.Implements()) {
+        Name(name);
+      }
+      Nodes(decl.Members());
+    }
+  }
+
+  VISIT_DECL(ArrayIndexExpr, expr,) {
+    w_->Put(Tag::kArrayIndexExpr);
+    w_->Tid(expr.GetTypeId());
+    Node(expr.BasePtr());
+    w_->Tok(expr.Lbrack());
+    Node(expr.IndexPtr());
+    w_->Tok(expr.Rbrack());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(BinExpr, expr,) {
+    w_->Put(Tag::kBinExpr);
+    w_->Tid(expr.GetTypeId());
+    Node(expr.LhsPtr());
+    w_->Tok(expr.Op());
+    Node(expr.RhsPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(BoolLitExpr, expr,) {
+    w_->Put(Tag::kBoolLitExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.GetToken());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(CallExpr, expr,) {
+    w_->Put(Tag::kCallExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->U64(expr.GetMethodId());
+    Node(expr.BasePtr());
+    w_->Tok(expr.Lparen());
+    Nodes(expr.Args());
+    w_->Tok(expr.Rparen());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(CastExpr, expr,) {
+    w_->Put(Tag::kCastExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.Lparen());
+    TypeNode(expr.GetTypePtr());
+    w_->Tok(expr.Rparen());
+    Node(expr.GetExprPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(CharLitExpr, expr,) {
+    w_->Put(Tag::kCharLitExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.GetToken());
+    w_->U64(expr.Char());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(FieldDerefExpr, expr,) {
+    w_->Put(Tag::kFieldDerefExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->U64(expr.GetFieldId());
+    Node(expr.BasePtr());
+    w_->Str(expr.FieldName());
+    w_->Tok(expr.GetToken());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(InstanceOfExpr, expr,) {
+    w_->Put(Tag::kInstanceOfExpr);
+    w_->Tid(expr.GetTypeId());
+    Node(expr.LhsPtr());
+    w_->Tok(expr.InstanceOf());
+    TypeNode(expr.GetTypePtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(IntLitExpr, expr,) {
+    w_->Put(Tag::kIntLitExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.GetToken());
+    w_->I64(expr.Value());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(NameExpr, expr,) {
+    w_->Put(Tag::kNameExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->U64(expr.GetVarId());
+    Name(expr.Name());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(NewArrayExpr, expr,) {
+    w_->Put(Tag::kNewArrayExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.NewToken());
+    TypeNode(expr.GetTypePtr());
+    w_->Tok(expr.Lbrack());
+    Node(expr.GetExprPtr());
+    w_->Tok(expr.Rbrack());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(NewClassExpr, expr,) {
+    w_->Put(Tag::kNewClassExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->U64(expr.GetMethodId());
+    w_->Tok(expr.NewToken());
+    TypeNode(expr.GetTypePtr());
+    w_->Tok(expr.Lparen());
+    Nodes(expr.Args());
+    w_->Tok(expr.Rparen());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(NullLitExpr, expr,) {
+    w_->Put(Tag::kNullLitExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.GetToken());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ParenExpr, expr,) {
+    w_->Put(Tag::kParenExpr);
+    w_->Tok(expr.Lparen());
+    Node(expr.NestedPtr());
+    w_->Tok(expr.Rparen());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(StaticRefExpr, expr,) {
+    w_->Put(Tag::kStaticRefExpr);
+    TypeNode(expr.GetRefTypePtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(StringLitExpr, expr,) {
+    w_->Put(Tag::kStringLitExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.GetToken());
+    w_->JStr(expr.Str());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ThisExpr, expr,) {
+    w_->Put(Tag::kThisExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.ThisToken());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(UnaryExpr, expr,) {
+    w_->Put(Tag::kUnaryExpr);
+    w_->Tid(expr.GetTypeId());
+    w_->Tok(expr.Op());
+    Node(expr.RhsPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ConstExpr, expr,) {
+    w_->Put(Tag::kConstExpr);
+    Node(expr.ConstantPtr());
+    Node(expr.OriginalPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(BlockStmt, stmt,) {
+    w_->Put(Tag::kBlockStmt);
+    w_->Tok(stmt.Lbrace());
+    Nodes(stmt.Stmts());
+    w_->Tok(stmt.Rbrace());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(EmptyStmt, stmt,) {
+    w_->Put(Tag::kEmptyStmt);
+    w_->Tok(stmt.Semi());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ExprStmt, stmt,) {
+    w_->Put(Tag::kExprStmt);
+    Node(stmt.GetExprPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ForStmt, stmt,) {
+    w_->Put(Tag::kForStmt);
+    Node(stmt.InitPtr());
+    Node(stmt.CondPtr());
+    Node(stmt.UpdatePtr());
+    Node(stmt.BodyPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(IfStmt, stmt,) {
+    w_->Put(Tag::kIfStmt);
+    Node(stmt.CondPtr());
+    Node(stmt.TrueBodyPtr());
+    Node(stmt.FalseBodyPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(LocalDeclStmt, stmt,) {
+    w_->Put(Tag::kLocalDeclStmt);
+    w_->U64(stmt.GetVarId());
+    TypeNode(stmt.GetTypePtr());
+    w_->Str(stmt.Name());
+    w_->Tok(stmt.NameToken());
+    Node(stmt.GetExprPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(ReturnStmt, stmt,) {
+    w_->Put(Tag::kReturnStmt);
+    w_->Tok(stmt.ReturnToken());
+    Node(stmt.GetExprPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(WhileStmt, stmt,) {
+    w_->Put(Tag::kWhileStmt);
+    Node(stmt.CondPtr());
+    Node(stmt.BodyPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(FieldDecl, field,) {
+    w_->Put(Tag::kFieldDecl);
+    Mods(field.Mods());
+    w_->Str(field.Name());
+    w_->Tok(field.NameToken());
+    w_->U64(field.GetFieldId());
+    TypeNode(field.GetTypePtr());
+    Node(field.ValPtr());
+    return VisitResult::SKIP;
+  }
+
+  VISIT_DECL(MethodDecl, meth,) {
+    w_->Put(Tag::kMethodDecl);
+    Mods(meth.Mods());
+    w_->Str(meth.Name());
+    w_->Tok(meth.NameToken());
+    w_->U64(meth.GetMethodId());
+    TypeNode(meth.TypePtr());
+    Params(meth.Params());
+    Node(meth.BodyPtr());
+    return VisitResult::SKIP;
+  }
+
+ private:
+  Writer* w_;
+};
+
+class Deserializer {
+ public:
+  Deserializer(Reader* r) : r_(r) {}
+
+  QualifiedName Name() {
+    vector<Token> tokens;
+    u64 num_tokens = r_->U64();
+    for (u64 i = 0; i < num_tokens; ++i) {
+      tokens.push_back(r_->Tok());
+    }
+    vector<string> parts;
+    u64 num_parts = r_->U64();
+    for (u64 i = 0; i < num_parts; ++i) {
+      parts.push_back(r_->Str());
+    }
+    string name = r_->Str();
+    return QualifiedName(tokens, parts, name);
+  }
+
+  ModifierList Mods() {
+    ModifierList mods;
+    u64 num_mods = r_->U64();
+    for (u64 i = 0; i < num_mods; ++i) {
+      CHECK(mods.AddModifier(r_->Tok()));
+    }
+    return mods;
+  }
+
+  sptr<const Type> TypeNode() {
+    Tag tag = r_->Get();
+    if (tag == Tag::kNull) {
+      return nullptr;
+    }
+
+    TypeId tid = r_->Tid();
+    switch (tag) {
+      case Tag::kPrimitiveType:
+        return make_shared<PrimitiveType>(r_->Tok(), tid);
+      case Tag::kReferenceType:
+        return make_shared<ReferenceType>(Name(), tid);
+      case Tag::kArrayType: {
+        sptr<const Type> elem = TypeNode();
+        Token lbrack = r_->Tok();
+        Token rbrack = r_->Tok();
+        return make_shared<ArrayType>(elem, lbrack, rbrack, tid);
+      }
+      default:
+        throw std::logic_error("snapshot: expected a type");
+    }
+  }
+
+  SharedPtrVector<const Expr> Exprs() {
+    SharedPtrVector<const Expr> exprs;
+    u64 size = r_->U64();
+    for (u64 i = 0; i < size; ++i) {
+      exprs.Append(ExprNode());
+    }
+    return exprs;
+  }
+
+  sptr<const Expr> ExprNode() {
+    Tag tag = r_->Get();
+    switch (tag) {
+      case Tag::kNull:
+        return nullptr;
+      case Tag::kArrayIndexExpr: {
+        TypeId tid = r_->Tid();
+        sptr<const Expr> base = ExprNode();
+        Token lbrack = r_->Tok();
+        sptr<const Expr> index = ExprNode();
+        Token rbrack = r_->Tok();
+        return make_shared<ArrayIndexExpr>(base, lbrack, index, rbrack, tid);
+      }
+      case Tag::kBinExpr: {
+        TypeId tid = r_->Tid();
+        sptr<const Expr> lhs = ExprNode();
+        Token op = r_->Tok();
+        sptr<const Expr> rhs = ExprNode();
+        return make_shared<BinExpr>(lhs, op, rhs, tid);
+      }
+      case Tag::kBoolLitExpr: {
+        TypeId tid = r_->Tid();
+        return make_shared<BoolLitExpr>(r_->Tok(), tid);
+      }
+      case Tag::kCallExpr: {
+        TypeId tid = r_->Tid();
+        ast::MethodId mid = r_->U64();
+        sptr<const Expr> base = ExprNode();
+        Token lparen = r_->Tok();
+        SharedPtrVector<const Expr> args = Exprs();
+        Token rparen = r_->Tok();
+        return make_shared<CallExpr>(base, lparen, args, rparen, mid, tid);
+      }
+      case Tag::kCastExpr: {
+        TypeId tid = r_->Tid();
+        Token lparen = r_->Tok();
+        sptr<const Type> type = TypeNode();
+        Token rparen = r_->Tok();
+        sptr<const Expr> expr = ExprNode();
+        return make_shared<CastExpr>(lparen, type, rparen, expr, tid);
+      }
+      case Tag::kCharLitExpr: {
+        TypeId tid = r_->Tid();
+        Token token = r_->Tok();
+        jchar c = (jchar)r_->U64();
+        return make_shared<CharLitExpr>(token, c, tid);
+      }
+      case Tag::kFieldDerefExpr: {
+        TypeId tid = r_->Tid();
+        ast::FieldId fid = r_->U64();
+        sptr<const Expr> base = ExprNode();
+        string fieldname = r_->Str();
+        Token token = r_->Tok();
+        return make_shared<FieldDerefExpr>(base, fieldname, token, fid, tid);
+      }
+      case Tag::kInstanceOfExpr: {
+        TypeId tid = r_->Tid();
+        sptr<const Expr> lhs = ExprNode();
+        Token instanceof = r_->Tok();
+        sptr<const Type> type = TypeNode();
+        return make_shared<InstanceOfExpr>(lhs, instanceof, type, tid);
+      }
+      case Tag::kIntLitExpr: {
+        TypeId tid = r_->Tid();
+        Token token = r_->Tok();
+        i32 value = (i32)r_->I64();
+        return make_shared<IntLitExpr>(token, value, tid);
+      }
+      case Tag::kNameExpr: {
+        TypeId tid = r_->Tid();
+        ast::LocalVarId vid = r_->U64();
+        return make_shared<NameExpr>(Name(), vid, tid);
+      }
+      case Tag::kNewArrayExpr: {
+        TypeId tid = r_->Tid();
+        Token newTok = r_->Tok();
+        sptr<const Type> type = TypeNode();
+        Token lbrack = r_->Tok();
+        sptr<const Expr> expr = ExprNode();
+        Token rbrack = r_->Tok();
+        return make_shared<NewArrayExpr>(newTok, type, lbrack, expr, rbrack, tid);
+      }
+      case Tag::kNewClassExpr: {
+        TypeId tid = r_->Tid();
+        ast::MethodId mid = r_->U64();
+        Token newTok = r_->Tok();
+        sptr<const Type> type = TypeNode();
+        Token lparen = r_->Tok();
+        SharedPtrVector<const Expr> args = Exprs();
+        Token rparen = r_->Tok();
+        return make_shared<NewClassExpr>(newTok, type, lparen, args, rparen, mid, tid);
+      }
+      case Tag::kNullLitExpr: {
+        TypeId tid = r_->Tid();
+        return make_shared<NullLitExpr>(r_->Tok(), tid);
+      }
+      case Tag::kParenExpr: {
+        Token lparen = r_->Tok();
+        sptr<const Expr> nested = ExprNode();
+        Token rparen = r_->Tok();
+        return make_shared<ParenExpr>(lparen, nested, rparen);
+      }
+      case Tag::kStaticRefExpr:
+        return make_shared<StaticRefExpr>(TypeNode());
+      case Tag::kStringLitExpr: {
+        TypeId tid = r_->Tid();
+        Token token = r_->Tok();
+        jstring str = r_->JStr();
+        return make_shared<StringLitExpr>(token, str, tid);
+      }
+      case Tag::kThisExpr: {
+        TypeId tid = r_->Tid();
+        return make_shared<ThisExpr>(r_->Tok(), tid);
+      }
+      case Tag::kUnaryExpr: {
+        TypeId tid = r_->Tid();
+        Token op = r_->Tok();
+        sptr<const Expr> rhs = ExprNode();
+        return make_shared<UnaryExpr>(op, rhs, tid);
+      }
+      case Tag::kConstExpr: {
+        sptr<const Expr> constant = ExprNode();
+        sptr<const Expr> original = ExprNode();
+        return make_shared<ConstExpr>(constant, original);
+      }
+      default:
+        throw std::logic_error("snapshot: expected an expression");
+    }
+  }
+
+  sptr<const Stmt> StmtNode() {
+    Tag tag = r_->Get();
+    switch (tag) {
+      case Tag::kNull:
+        return nullptr;
+      case Tag::kBlockStmt: {
+        Token lbrace = r_->Tok();
+        SharedPtrVector<const Stmt> stmts;
+        u64 size = r_->U64();
+        for (u64 i = 0; i < size; ++i) {
+          stmts.Append(StmtNode());
+        }
+        Token rbrace = r_->Tok();
+        return make_shared<BlockStmt>(lbrace, stmts, rbrace);
+      }
+      case Tag::kEmptyStmt:
+        return make_shared<EmptyStmt>(r_->Tok());
+      case Tag::kExprStmt:
+        return make_shared<ExprStmt>(ExprNode());
+      case Tag::kForStmt: {
+        sptr<const Stmt> init = StmtNode();
+        sptr<const Expr> cond = ExprNode();
+        sptr<const Expr> update = ExprNode();
+        sptr<const Stmt> body = StmtNode();
+        return make_shared<ForStmt>(init, cond, update, body);
+      }
+      case Tag::kIfStmt: {
+        sptr<const Expr> cond = ExprNode();
+        sptr<const Stmt> trueBody = StmtNode();
+        sptr<const Stmt> falseBody = StmtNode();
+        return make_shared<IfStmt>(cond, trueBody, falseBody);
+      }
+      case Tag::kLocalDeclStmt: {
+        ast::LocalVarId vid = r_->U64();
+        sptr<const Type> type = TypeNode();
+        string name = r_->Str();
+        Token nameToken = r_->Tok();
+        sptr<const Expr> expr = ExprNode();
+        return make_shared<LocalDeclStmt>(type, name, nameToken, expr, vid);
+      }
+      case Tag::kReturnStmt: {
+        Token returnToken = r_->Tok();
+        return make_shared<ReturnStmt>(returnToken, ExprNode());
+      }
+      case Tag::kWhileStmt: {
+        sptr<const Expr> cond = ExprNode();
+        sptr<const Stmt> body = StmtNode();
+        return make_shared<WhileStmt>(cond, body);
+      }
+      default:
+        throw std::logic_error("snapshot: expected a statement");
+    }
+  }
+
+  sptr<const ParamList> Params() {
+    SharedPtrVector<const Param> params;
+    u64 size = r_->U64();
+    for (u64 i = 0; i < size; ++i) {
+      ast::LocalVarId vid = r_->U64();
+      sptr<const Type> type = TypeNode();
+      string name = r_->Str();
+      Token nameToken = r_->Tok();
+      params.Append(make_shared<Param>(type, name, nameToken, vid));
+    }
+    return make_shared<ParamList>(params);
+  }
+
+  sptr<const MemberDecl> Member() {
+    Tag tag = r_->Get();
+    CHECK(tag == Tag::kFieldDecl || tag == Tag::kMethodDecl);
+
+    ModifierList mods = Mods();
+    string name = r_->Str();
+    Token nameToken = r_->Tok();
+
+    if (tag == Tag::kFieldDecl) {
+      ast::FieldId fid = r_->U64();
+      sptr<const Type> type = TypeNode();
+      sptr<const Expr> val = ExprNode();
+      return make_shared<FieldDecl>(mods, type, name, nameToken, val, fid);
+    }
+
+    ast::MethodId mid = r_->U64();
+    sptr<const Type> type = TypeNode();
+    sptr<const ParamList> params = Params();
+    sptr<const Stmt> body = StmtNode();
+    return make_shared<MethodDecl>(mods, type, name, nameToken, params, body, mid);
+  }
+
+  sptr<const CompUnit> Unit() {
+    sptr<const QualifiedName> package;
+    if (r_->Bool()) {
+      package = make_shared<QualifiedName>(Name());
+    }
+
+    vector<ImportDecl> imports;
+    u64 num_imports = r_->U64();
+    for (u64 i = 0; i < num_imports; ++i) {
+      QualifiedName name = Name();
+      imports.emplace_back(name, r_->Bool());
+    }
+
+    SharedPtrVector<const TypeDecl> types;
+    u64 num_types = r_->U64();
+    for (u64 i = 0; i < num_types; ++i) {
+      TypeId tid = r_->Tid();
+      ModifierList mods = Mods();
+      u64 kind = r_->U64();
+      CHECK(kind <= (u64)TypeKind::INTERFACE);
+      string name = r_->Str();
+      Token nameToken = r_->Tok();
+
+      vector<QualifiedName> extends;
+      u64 num_extends = r_->U64();
+      for (u64 j = 0; j < num_extends; ++j) {
+        extends.push_back(Name());
+      }
+
+      vector<QualifiedName> implements;
+      u64 num_implements = r_->U64();
+      for (u64 j = 0; j < num_implements; ++j) {
+        implements.push_back(Name());
+      }
+
+      SharedPtrVector<const MemberDecl> members;
+      u64 num_members = r_->U64();
+      for (u64 j = 0; j < num_members; ++j) {
+        members.Append(Member());
+      }
+
+      types.Append(make_shared<TypeDecl>(mods, (TypeKind)kind, name, nameToken, extends, implements, members, tid));
+    }
+
+    return make_shared<CompUnit>(r_->FileId(), package, imports, types);
+  }
+
+ private:
+  Reader* r_;
+};
+
+} // namespace
+
+void SerializeCompUnit(const CompUnit& unit, vector<u8>* out) {
+  Writer writer(unit.FileId(), out);
+  Serializer(&writer).Unit(unit);
+}
+
+sptr<const CompUnit> DeserializeCompUnit(const u8* data, size_t len, int fileid) {
+  Reader reader(data, len, fileid);
+  sptr<const CompUnit> unit = Deserializer(&reader).Unit();
+  CHECK(reader.AtEnd());
+  return unit;
+}
+
+} // namespace snapshot
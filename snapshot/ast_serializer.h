@@ -0,0 +1,19 @@
+#ifndef SNAPSHOT_AST_SERIALIZER_H
+#define SNAPSHOT_AST_SERIALIZER_H
+
+#include "ast/ast_fwd.h"
+#include "std.h"
+
+namespace snapshot {
+
+// Appends a self-contained encoding of unit to out.
+void SerializeCompUnit(const ast::CompUnit& unit, vector<u8>* out);
+
+// Rebuilds a unit written by SerializeCompUnit, moving it and every position
+// that was in its file to fileid. Throws std::logic_error if the bytes are
+// malformed.
+sptr<const ast::CompUnit> DeserializeCompUnit(const u8* data, size_t len, int fileid);
+
+} // namespace snapshot
+
+#endif
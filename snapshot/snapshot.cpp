@@ -0,0 +1,273 @@
+#include "snapshot/snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ast/ast.h"
+#include "base/error.h"
+#include "snapshot/ast_serializer.h"
+
+using ast::CompUnit;
+using ast::Program;
+using base::ErrorList;
+using base::File;
+using base::FileSet;
+using base::OutputOptions;
+
+namespace snapshot {
+
+namespace {
+
+// Layout, all integers little-endian:
+//
+//   Header
+//   EntryHeader[num_files]
+//   blobs, each starting on an 8-byte boundary
+//
+// Every offset is from the start of the file, so the file can be used
+// directly from a read-only mapping.
+const char kMagic[8] = {'J', 'O', 'O', 'S', 'S', 'N', 'A', 'P'};
+
+struct Header {
+  char magic[8];
+  u32 version;
+  u32 num_files;
+  u32 num_leading_files;
+  u32 padding;
+};
+
+struct EntryHeader {
+  u64 path_offset;
+  u64 path_size;
+  u64 contents_offset;
+  u64 contents_size;
+  u64 ast_offset;
+  u64 ast_size;
+
+  // Checksum of the entry's path, contents and AST blobs. The AST decoder
+  // trusts its input, so a damaged entry must be caught before it is decoded.
+  u64 checksum;
+};
+
+base::Error* MakeSnapshotError(const string& path, const string& msg) {
+  return base::MakeError([=](std::ostream* out, const OutputOptions& opt, const FileSet*) {
+    if (opt.simple) {
+      *out << "SnapshotError{" << path << "," << msg << "}";
+      return;
+    }
+    *out << path << " " << opt.Red() << "error: " << opt.ResetColor() << msg;
+  });
+}
+
+// 64-bit FNV-1a, continuing from hash.
+u64 Checksum(const u8* data, u64 size, u64 hash = 0xcbf29ce484222325ull) {
+  for (u64 i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+u64 EntryChecksum(const u8* base, const EntryHeader& entry) {
+  u64 hash = Checksum(base + entry.path_offset, entry.path_size);
+  hash = Checksum(base + entry.contents_offset, entry.contents_size, hash);
+  return Checksum(base + entry.ast_offset, entry.ast_size, hash);
+}
+
+u64 AppendBlob(const u8* data, size_t size, vector<u8>* out) {
+  while (out->size() % 8 != 0) {
+    out->push_back(0);
+  }
+  u64 offset = out->size();
+  out->insert(out->end(), data, data + size);
+  return offset;
+}
+
+} // namespace
+
+bool WriteSnapshot(const string& path, const FileSet& fs, const Program& prog, int num_leading_files, ErrorList* errors) {
+  CHECK(num_leading_files <= fs.Size());
+
+  map<int, sptr<const CompUnit>> units;
+  for (const auto& unit : prog.CompUnits().Vec()) {
+    units[unit->FileId()] = unit;
+  }
+  CHECK((int)units.size() == fs.Size());
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kSnapshotVersion;
+  header.num_files = fs.Size();
+  header.num_leading_files = num_leading_files;
+  header.padding = 0;
+
+  vector<u8> out(sizeof(Header) + fs.Size() * sizeof(EntryHeader));
+  vector<EntryHeader> entries(fs.Size());
+  vector<u8> buf;
+  for (int i = 0; i < fs.Size(); ++i) {
+    const File* file = fs.Get(i);
+    EntryHeader& entry = entries.at(i);
+
+    string name = file->Dirname().empty() ? file->Basename() : file->Dirname() + "/" + file->Basename();
+    entry.path_offset = AppendBlob((const u8*)name.data(), name.size(), &out);
+    entry.path_size = name.size();
+
+    buf.clear();
+    for (int j = 0; j < file->Size(); ++j) {
+      buf.push_back(file->At(j));
+    }
+    entry.contents_offset = AppendBlob(buf.data(), buf.size(), &out);
+    entry.contents_size = buf.size();
+
+    buf.clear();
+    SerializeCompUnit(*units.at(i), &buf);
+    entry.ast_offset = AppendBlob(buf.data(), buf.size(), &out);
+    entry.ast_size = buf.size();
+  }
+
+  for (EntryHeader& entry : entries) {
+    entry.checksum = EntryChecksum(out.data(), entry);
+  }
+
+  memcpy(out.data(), &header, sizeof(Header));
+  memcpy(out.data() + sizeof(Header), entries.data(), entries.size() * sizeof(EntryHeader));
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file || !file.write((const char*)out.data(), out.size()) || !file.flush()) {
+    errors->Append(MakeSnapshotError(path, "could not write snapshot"));
+    return false;
+  }
+  return true;
+}
+
+bool Snapshot::Load(const string& path, Snapshot** out, ErrorList* errors) {
+  CHECK(out != nullptr);
+  CHECK(errors != nullptr);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    errors->Append(MakeSnapshotError(path, strerror(errno)));
+    return false;
+  }
+
+  struct stat filestat;
+  memset(&filestat, 0, sizeof(filestat));
+  if (fstat(fd, &filestat) == -1) {
+    errors->Append(MakeSnapshotError(path, strerror(errno)));
+    close(fd);
+    return false;
+  }
+
+  size_t size = filestat.st_size;
+  if (size < sizeof(Header)) {
+    errors->Append(MakeSnapshotError(path, "not a snapshot"));
+    close(fd);
+    return false;
+  }
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    errors->Append(MakeSnapshotError(path, strerror(errno)));
+    return false;
+  }
+
+  uptr<Snapshot> snapshot(new Snapshot((const u8*)addr, size));
+
+  Header header;
+  memcpy(&header, snapshot->data_, sizeof(Header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    errors->Append(MakeSnapshotError(path, "not a snapshot"));
+    return false;
+  }
+  if (header.version != kSnapshotVersion) {
+    errors->Append(MakeSnapshotError(path, "snapshot version " + std::to_string(header.version) + " is not supported; rebuild it with --emit-snapshot"));
+    return false;
+  }
+
+  u64 table_end = sizeof(Header) + (u64)header.num_files * sizeof(EntryHeader);
+  if (header.num_leading_files > header.num_files || table_end > size) {
+    errors->Append(MakeSnapshotError(path, "snapshot is truncated"));
+    return false;
+  }
+
+  auto in_bounds = [&](u64 offset, u64 len) {
+    return offset <= size && len <= size - offset;
+  };
+
+  snapshot->num_leading_files_ = header.num_leading_files;
+  for (u32 i = 0; i < header.num_files; ++i) {
+    EntryHeader eh;
+    memcpy(&eh, snapshot->data_ + sizeof(Header) + i * sizeof(EntryHeader), sizeof(EntryHeader));
+    if (!in_bounds(eh.path_offset, eh.path_size) ||
+        !in_bounds(eh.contents_offset, eh.contents_size) ||
+        !in_bounds(eh.ast_offset, eh.ast_size)) {
+      errors->Append(MakeSnapshotError(path, "snapshot is truncated"));
+      return false;
+    }
+    if (EntryChecksum(snapshot->data_, eh) != eh.checksum) {
+      errors->Append(MakeSnapshotError(path, "snapshot is corrupt; rebuild it with --emit-snapshot"));
+      return false;
+    }
+
+    const u8* base = snapshot->data_;
+    snapshot->entries_.push_back({
+        string((const char*)base + eh.path_offset, eh.path_size),
+        base + eh.contents_offset, eh.contents_size,
+        base + eh.ast_offset, eh.ast_size});
+  }
+
+  *out = snapshot.release();
+  return true;
+}
+
+Snapshot::~Snapshot() {
+  munmap((void*)data_, size_);
+}
+
+string Snapshot::Contents(int index) const {
+  const Entry& entry = entries_.at(index);
+  return string((const char*)entry.contents, entry.contents_size);
+}
+
+void Snapshot::AddFiles(const vector<string>& user_files, base::FileSet::Builder* builder) {
+  fileid_to_entry_.clear();
+
+  int fileid = 0;
+  for (int i = 0; i < num_leading_files_; ++i) {
+    builder->AddStringFile(Path(i), Contents(i));
+    fileid_to_entry_[fileid++] = i;
+  }
+
+  for (const string& file : user_files) {
+    builder->AddDiskFile(file);
+    ++fileid;
+  }
+
+  for (int i = num_leading_files_; i < NumFiles(); ++i) {
+    builder->AddStringFile(Path(i), Contents(i));
+    fileid_to_entry_[fileid++] = i;
+  }
+}
+
+bool Snapshot::HasUnit(int fileid) const {
+  return fileid_to_entry_.count(fileid) == 1;
+}
+
+sptr<const CompUnit> Snapshot::DecodeUnit(int fileid) const {
+  const Entry& entry = entries_.at(fileid_to_entry_.at(fileid));
+  return DeserializeCompUnit(entry.ast, entry.ast_size, fileid);
+}
+
+sptr<const CompUnit> Snapshot::Lookup(const FileSet&, int fileid) const {
+  if (!HasUnit(fileid)) {
+    return nullptr;
+  }
+  return DecodeUnit(fileid);
+}
+
+} // namespace snapshot
@@ -0,0 +1,72 @@
+#ifndef SNAPSHOT_SNAPSHOT_H
+#define SNAPSHOT_SNAPSHOT_H
+
+#include "ast/ast_fwd.h"
+#include "base/errorlist.h"
+#include "base/fileset.h"
+#include "snapshot/unit_cache.h"
+
+namespace snapshot {
+
+// Bumped whenever the file layout or the AST encoding changes; snapshots from
+// other versions are rejected rather than misread.
+const u32 kSnapshotVersion = 2;
+
+// Writes every file in fs, along with its unit from prog, to path. The first
+// num_leading_files files are placed before the user's files when the snapshot
+// is loaded; the rest are placed after them. prog must contain a unit for
+// every file.
+bool WriteSnapshot(const string& path, const base::FileSet& fs, const ast::Program& prog, int num_leading_files, base::ErrorList* errors);
+
+// A read-only view of a file written by WriteSnapshot. The file is mapped into
+// memory; units are only decoded when asked for.
+class Snapshot final : public UnitCache {
+ public:
+  // Fails with an error, rather than crashing later, if any entry does not
+  // match its checksum.
+  static bool Load(const string& path, Snapshot** out, base::ErrorList* errors);
+
+  ~Snapshot() override;
+
+  int NumFiles() const { return (int)entries_.size(); }
+  int NumLeadingFiles() const { return num_leading_files_; }
+  const string& Path(int index) const { return entries_.at(index).path; }
+  string Contents(int index) const;
+
+  // Adds the leading files, then user_files from disk, then the remaining
+  // files to builder, matching the file ids a normal run given the same files
+  // in that order would assign.
+  void AddFiles(const vector<string>& user_files, base::FileSet::Builder* builder);
+
+  // Whether the file with this id (as assigned by AddFiles) came from the
+  // snapshot.
+  bool HasUnit(int fileid) const;
+
+  // Decodes the weeded unit stored for fileid. Safe to call concurrently.
+  sptr<const ast::CompUnit> DecodeUnit(int fileid) const;
+
+  sptr<const ast::CompUnit> Lookup(const base::FileSet& fs, int fileid) const override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Snapshot);
+
+  struct Entry {
+    string path;
+    const u8* contents;
+    u64 contents_size;
+    const u8* ast;
+    u64 ast_size;
+  };
+
+  Snapshot(const u8* data, size_t size) : data_(data), size_(size) {}
+
+  const u8* data_;
+  size_t size_;
+  int num_leading_files_ = 0;
+  vector<Entry> entries_;
+  map<int, int> fileid_to_entry_;
+};
+
+} // namespace snapshot
+
+#endif
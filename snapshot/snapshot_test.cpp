@@ -0,0 +1,181 @@
+#include <cstdlib>
+#include <fstream>
+
+#include "ast/ast.h"
+#include "ast/print_visitor.h"
+#include "gtest/gtest.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "snapshot/ast_serializer.h"
+#include "snapshot/snapshot.h"
+
+using ast::CompUnit;
+using ast::PrintVisitor;
+using ast::Program;
+using base::ErrorList;
+using base::FileSet;
+using base::SharedPtrVector;
+using lexer::Token;
+
+namespace snapshot {
+
+class SnapshotTest : public ::testing::Test {
+ protected:
+  void Parse(const vector<string>& sources) {
+    ErrorList errors;
+    FileSet::Builder builder;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      builder.AddStringFile("Foo" + std::to_string(i) + ".java", sources.at(i));
+    }
+    FileSet* fs;
+    ASSERT_TRUE(builder.Build(&fs, &errors));
+    fs_.reset(fs);
+
+    SharedPtrVector<const CompUnit> units;
+    for (int i = 0; i < fs->Size(); ++i) {
+      vector<Token> tokens;
+      vector<Token> filtered;
+      lexer::LexJoosFile(fs, fs->Get(i), i, &tokens, &errors);
+      lexer::StripSkippableTokens(tokens, &filtered);
+      sptr<const CompUnit> unit = parser::ParseFile(fs, i, lexer::TokenBuffer(i, filtered), &errors);
+      ASSERT_FALSE(errors.IsFatal()) << testing::PrintToString(errors);
+      units.Append(unit);
+    }
+    prog_ = make_shared<Program>(units);
+  }
+
+  static string Print(const CompUnit& unit) {
+    stringstream ss;
+    sptr<const CompUnit> ptr(&unit, [](const CompUnit*) {});
+    PrintVisitor::Pretty(&ss).Visit(ptr);
+    return ss.str();
+  }
+
+  static string TempPath(const string& name) {
+    const char* dir = getenv("TEST_TMPDIR");
+    return string(dir == nullptr ? "/tmp" : dir) + "/" + name;
+  }
+
+  uptr<FileSet> fs_;
+  sptr<const Program> prog_;
+};
+
+const char kSource[] =
+    "package a.b;\n"
+    "import java.util.*;\n"
+    "import java.io.Serializable;\n"
+    "public abstract class Foo extends Object implements Serializable {\n"
+    "  protected static final int[] xs = new int[10];\n"
+    "  public Foo(int a, Object b) { this.baz(this); }\n"
+    "  public abstract String bar(char c);\n"
+    "  public int baz(Foo f) {\n"
+    "    String s = \"hi\\n\" + 'x' + -2147483648 + null + true;\n"
+    "    for (int i = 0; i < xs.length; i = i + 1) {\n"
+    "      if (f instanceof Foo) return (int)xs[i]; else ;\n"
+    "    }\n"
+    "    while (!(this == f)) f = (Foo)new Object();\n"
+    "    return a.b.Foo.xs[0] + f.baz(this);\n"
+    "  }\n"
+    "}\n";
+
+TEST_F(SnapshotTest, RoundTripsUnit) {
+  Parse({kSource});
+  const CompUnit& unit = *prog_->CompUnits().At(0);
+
+  vector<u8> bytes;
+  SerializeCompUnit(unit, &bytes);
+  sptr<const CompUnit> decoded = DeserializeCompUnit(bytes.data(), bytes.size(), 0);
+
+  EXPECT_EQ(Print(unit), Print(*decoded));
+
+  // Re-encoding is stable.
+  vector<u8> again;
+  SerializeCompUnit(*decoded, &again);
+  EXPECT_EQ(bytes, again);
+}
+
+TEST_F(SnapshotTest, RenumbersFile) {
+  Parse({kSource});
+  vector<u8> bytes;
+  SerializeCompUnit(*prog_->CompUnits().At(0), &bytes);
+
+  sptr<const CompUnit> decoded = DeserializeCompUnit(bytes.data(), bytes.size(), 7);
+  EXPECT_EQ(7, decoded->FileId());
+  const ast::TypeDecl& decl = *decoded->Types().At(0);
+  EXPECT_EQ(7, decl.NameToken().pos.fileid);
+  EXPECT_EQ(prog_->CompUnits().At(0)->Types().At(0)->NameToken().pos.begin, decl.NameToken().pos.begin);
+}
+
+TEST_F(SnapshotTest, TruncatedUnitThrows) {
+  Parse({kSource});
+  vector<u8> bytes;
+  SerializeCompUnit(*prog_->CompUnits().At(0), &bytes);
+  EXPECT_THROW(DeserializeCompUnit(bytes.data(), bytes.size() / 2, 0), std::logic_error);
+}
+
+TEST_F(SnapshotTest, WritesAndLoadsFiles) {
+  Parse({"class A {}", kSource, "class C { int c; }"});
+  string path = TempPath("snapshot_test.snap");
+
+  ErrorList errors;
+  ASSERT_TRUE(WriteSnapshot(path, *fs_, *prog_, 1, &errors));
+
+  Snapshot* loaded = nullptr;
+  ASSERT_TRUE(Snapshot::Load(path, &loaded, &errors));
+  uptr<Snapshot> snapshot(loaded);
+  ASSERT_EQ(3, snapshot->NumFiles());
+  EXPECT_EQ(1, snapshot->NumLeadingFiles());
+  EXPECT_EQ("Foo1.java", snapshot->Path(1));
+  EXPECT_EQ(kSource, snapshot->Contents(1));
+
+  // Leading files come before the user's files, and the rest after them.
+  FileSet::Builder builder;
+  snapshot->AddFiles({"base/testdata/a.txt"}, &builder);
+  FileSet* fs;
+  ASSERT_TRUE(builder.Build(&fs, &errors));
+  uptr<FileSet> fs_deleter(fs);
+  ASSERT_EQ(4, fs->Size());
+  EXPECT_EQ("Foo0.java", fs->Get(0)->Basename());
+  EXPECT_EQ("a.txt", fs->Get(1)->Basename());
+  EXPECT_EQ("Foo1.java", fs->Get(2)->Basename());
+  EXPECT_EQ("Foo2.java", fs->Get(3)->Basename());
+
+  EXPECT_TRUE(snapshot->HasUnit(0));
+  EXPECT_FALSE(snapshot->HasUnit(1));
+  EXPECT_TRUE(snapshot->HasUnit(3));
+  sptr<const CompUnit> unit = snapshot->DecodeUnit(2);
+  EXPECT_EQ(2, unit->FileId());
+  EXPECT_EQ(Print(*prog_->CompUnits().At(1)), Print(*unit));
+  EXPECT_FALSE(errors.IsFatal());
+}
+
+TEST_F(SnapshotTest, RejectsCorruptUnit) {
+  Parse({"class A {}", kSource});
+  string path = TempPath("snapshot_test_corrupt.snap");
+
+  ErrorList errors;
+  ASSERT_TRUE(WriteSnapshot(path, *fs_, *prog_, 0, &errors));
+
+  // The last blob in the file is the last unit's AST.
+  std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekg(-1, std::ios::end);
+  char last = (char)file.get();
+  file.seekp(-1, std::ios::end);
+  file.put((char)(last ^ 0x40));
+  file.close();
+
+  Snapshot* loaded = nullptr;
+  EXPECT_FALSE(Snapshot::Load(path, &loaded, &errors));
+  EXPECT_EQ(nullptr, loaded);
+  EXPECT_TRUE(errors.IsFatal());
+}
+
+TEST_F(SnapshotTest, RejectsOtherFiles) {
+  ErrorList errors;
+  Snapshot* loaded = nullptr;
+  EXPECT_FALSE(Snapshot::Load("base/testdata/testfile.txt", &loaded, &errors));
+  EXPECT_EQ(nullptr, loaded);
+  EXPECT_TRUE(errors.IsFatal());
+}
+
+} // namespace snapshot
@@ -0,0 +1,32 @@
+#ifndef SNAPSHOT_UNIT_CACHE_H
+#define SNAPSHOT_UNIT_CACHE_H
+
+#include "ast/ast_fwd.h"
+#include "base/fileset.h"
+
+namespace snapshot {
+
+// Weeded units kept from an earlier compile, so the frontend can skip lexing,
+// parsing, and weeding files it has already seen.
+class UnitCache {
+ public:
+  virtual ~UnitCache() = default;
+
+  // Returns the weeded unit for fs's file fileid, or nullptr if the file must
+  // be compiled. May be called from several threads at once.
+  virtual sptr<const ast::CompUnit> Lookup(const base::FileSet& fs, int fileid) const = 0;
+
+  // Offered every unit of a weeded program, whether or not it came from
+  // Lookup.
+  virtual void Store(const base::FileSet&, int, sptr<const ast::CompUnit>) {}
+
+ protected:
+  UnitCache() = default;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(UnitCache);
+};
+
+} // namespace snapshot
+
+#endif
@@ -0,0 +1,33 @@
+// CODE_GENERATION
+public class J1_concatOperandSideEffect {
+    public int n = 0;
+
+    public J1_concatOperandSideEffect() {}
+
+    public String toString() {
+	return "n" + n;
+    }
+
+    public String bump() {
+	n = n + 1;
+	return "!";
+    }
+
+    public static int test() {
+	// Both operands of + are evaluated before either is converted to a
+	// string, so o is converted after bump() has changed it.
+	J1_concatOperandSideEffect o = new J1_concatOperandSideEffect();
+	String a = o + o.bump() + o; // "n1!n1"
+
+	J1_concatOperandSideEffect p = new J1_concatOperandSideEffect();
+	String b = p + (p.bump() + p); // "n1!n1"
+
+	J1_concatOperandSideEffect q = new J1_concatOperandSideEffect();
+	String c = "" + q + q.bump(); // "n0!"
+
+	if (a.equals((Object) "n1!n1") && b.equals((Object) "n1!n1") && c.equals((Object) "n0!")) {
+	    return 123;
+	}
+	return 0;
+    }
+}
@@ -1,31 +1,89 @@
 section .text
 
 ; Allocates eax bytes of memory. Pointer to allocated memory returned in eax.
+; Memory is handed out by bumping __heap_ptr through a chunk that ends at
+; __heap_end; only when a chunk runs out do we grow the heap, by at least
+; 1MiB at a time. Allocations are rounded up to a multiple of 4 bytes.
+; Chunks always come from fresh brk or mmap pages and memory is never reused,
+; so [__heap_ptr, __heap_end) is known to be zero and callers need not clear
+; what they are given.
+; Clobbers ebx and ecx, and also edx when the heap grows by mmap.
     global __malloc
 __malloc:
-    push eax
+    add eax, 3
+    and eax, 0xfffffffc
+    mov ebx, [__heap_ptr]
+    add eax, ebx ; eax = heap ptr after this allocation
+    jc .grow
+    cmp eax, [__heap_end]
+    ja .grow
+    mov [__heap_ptr], eax
+    mov eax, ebx
+    ret
+.grow:
+    sub eax, ebx
+    push eax     ; save rounded number of bytes requested
     mov eax, 45  ; sys_brk system call
     mov ebx, 0   ; 0 bytes - query current brk
     int 0x80
-    pop ebx
-    push eax
-    add ebx, eax ; move brk ahead by number of bytes requested
+    cmp eax, [__heap_end]
+    je .extend   ; brk is where our chunk ends, so we can extend it in place
+    add eax, 3   ; otherwise, start a fresh chunk at the current brk
+    and eax, 0xfffffffc
+    mov [__heap_ptr], eax
+    mov [__heap_end], eax
+.extend:
+    pop ecx
+    add ecx, 0x100000 ; grow by the request plus a 1MiB chunk
+    mov ebx, [__heap_end]
+    add ebx, ecx
+    jc .mmap
+    push ebx
     mov eax, 45  ; sys_brk system call
     int 0x80
     pop ebx
-    cmp eax, 0   ; on error, exit with code 22
-    jne ok
+    cmp eax, ebx ; on error, brk returns the old break
+    jb .mmap
+    mov [__heap_end], eax
+    sub ecx, 0x100000
+    jmp .retry
+.mmap:
+    ; brk is exhausted, so fall back to an anonymous mapping of ecx bytes.
+    push ebp
+    push esi
+    push edi
+    push ecx
+    mov eax, 192 ; sys_mmap2 system call
+    mov ebx, 0   ; let the kernel pick the address
+    mov edx, 3   ; PROT_READ | PROT_WRITE
+    mov esi, 0x22 ; MAP_PRIVATE | MAP_ANONYMOUS
+    mov edi, -1  ; no backing file
+    mov ebp, 0
+    int 0x80
+    pop ecx
+    pop edi
+    pop esi
+    pop ebp
+    cmp eax, 0xfffff000 ; on error, exit with code 22
+    jae .oom
+    mov [__heap_ptr], eax
+    add eax, ecx
+    mov [__heap_end], eax
+    sub ecx, 0x100000
+.retry:
+    mov eax, ecx
+    jmp __malloc
+.oom:
     mov eax, 22
     call __debexit
-ok:
-    mov eax, ebx
-    ret
 
 ; Debugging exit: ends the process, returning the value of
 ; eax as the exit code.
     global __debexit
 __debexit:
-    mov ebx, eax
+    push eax
+    call __flush
+    pop ebx
     mov eax, 1   ; sys_exit system call
     int 0x80
 
@@ -33,24 +91,63 @@ __debexit:
 ; Call this in cases where the Joos code would throw an exception.
     global __exception
 __exception:
+    call __flush
     mov eax, 1   ; sys_exit system call
     mov ebx, 13
     int 0x80
 
 ; Implementation of java.io.OutputStream.nativeWrite method.
-; Outputs the low-order byte of eax to standard output.
+; Buffers the low-order byte of eax for standard output, flushing the buffer
+; once it is full.
     global NATIVEjava.io.OutputStream.nativeWrite
 NATIVEjava.io.OutputStream.nativeWrite:
-    mov [char], al ; save the low order byte in memory
+    mov ecx, [__out_len]
+    mov [__out_buf + ecx], al ; save the low order byte in the buffer
+    inc ecx
+    mov [__out_len], ecx
+    cmp ecx, 4096
+    jb .done
+    call __flush
+.done:
+    mov eax, 0     ; return 0
+    ret
+
+; Writes any buffered output to standard output and empties the buffer.
+; Must be called before the process exits. Clobbers eax, ebx, ecx and edx.
+    global __flush
+__flush:
+    mov ecx, __out_buf ; address of bytes to write
+    mov edx, [__out_len] ; number of bytes to write
+.loop:
+    test edx, edx
+    jz .done
     mov eax, 4     ; sys_write system call
-    mov ecx, char  ; address of bytes to write
     mov ebx, 1     ; stdout
-    mov edx, 1     ; number of bytes to write
     int 0x80
-    mov eax, 0     ; return 0
+    cmp eax, 0     ; on error, drop the rest of the buffer
+    jle .done
+    add ecx, eax   ; otherwise, retry any partial write
+    sub edx, eax
+    jmp .loop
+.done:
+    mov dword [__out_len], 0
     ret
 
 section .data
 
-char:
+__out_len:
     dd 0
+
+; Bounds of the current heap chunk. Generated code bumps __heap_ptr inline and
+; only calls into _joos_malloc when the chunk is exhausted.
+    global __heap_ptr
+__heap_ptr:
+    dd 0
+    global __heap_end
+__heap_end:
+    dd 0
+
+section .bss
+
+__out_buf:
+    resb 4096
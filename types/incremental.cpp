@@ -0,0 +1,200 @@
+#include "types/incremental.h"
+
+#include "ast/ast.h"
+
+using std::ostream;
+
+using ast::CompUnit;
+using ast::ModifierList;
+using ast::TypeId;
+
+namespace types {
+
+namespace {
+
+// Returns tid's info, or nullptr if tinfo_map does not have it.
+const TypeInfo* FindTypeInfo(const TypeInfoMap& tinfo_map, TypeId tid) {
+  if (tid.ndims > 0) {
+    return &tinfo_map.LookupTypeInfo(tid);
+  }
+  auto iter = tinfo_map.GetTypeMap().find(tid);
+  if (iter == tinfo_map.GetTypeMap().end()) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
+void PrintTid(ostream* out, TypeId tid) {
+  *out << tid.base << ':' << tid.ndims << ' ';
+}
+
+void PrintMods(ostream* out, const ModifierList& mods) {
+  for (int i = 0; i < lexer::NUM_MODIFIERS; ++i) {
+    *out << (mods.HasModifier((lexer::Modifier)i) ? '1' : '0');
+  }
+  *out << ' ';
+}
+
+void PrintTids(ostream* out, const TypeIdList& tids) {
+  *out << '[';
+  for (int i = 0; i < tids.Size(); ++i) {
+    PrintTid(out, tids.At(i));
+  }
+  *out << ']';
+}
+
+// Prints everything about tid's declaration a typechecker can observe without
+// resolving one of its members. Ancestors are included since IsAncestor walks
+// them.
+string TypeKey(const TypeInfoMap& tinfo_map, TypeId tid) {
+  const TypeInfo* tinfo = FindTypeInfo(tinfo_map, tid);
+  if (tinfo == nullptr) {
+    return "";
+  }
+
+  stringstream ss;
+  PrintTid(&ss, tinfo->type);
+  PrintMods(&ss, tinfo->mods);
+  ss << (int)tinfo->kind << ' ' << tinfo->package << ' ' << tinfo->name << ' ';
+  PrintTids(&ss, tinfo->extends);
+  PrintTids(&ss, tinfo->implements);
+
+  set<TypeId> ancestors;
+  vector<TypeId> stack = {tid};
+  while (!stack.empty()) {
+    const TypeInfo* cur = FindTypeInfo(tinfo_map, stack.back());
+    stack.pop_back();
+    if (cur == nullptr) {
+      continue;
+    }
+    TypeIdList parents = Concat({cur->extends, cur->implements});
+    for (int i = 0; i < parents.Size(); ++i) {
+      if (ancestors.insert(parents.At(i)).second) {
+        stack.push_back(parents.At(i));
+      }
+    }
+  }
+  ss << '{';
+  for (TypeId ancestor : ancestors) {
+    PrintTid(&ss, ancestor);
+  }
+  ss << '}';
+  return ss.str();
+}
+
+// Prints every method, constructor, and field called name in tid, including
+// the ids the typechecker would write into the AST.
+string MemberKey(const TypeInfoMap& tinfo_map, TypeId tid, const string& name) {
+  const TypeInfo* tinfo = FindTypeInfo(tinfo_map, tid);
+  if (tinfo == nullptr) {
+    return "";
+  }
+
+  stringstream ss;
+  for (const auto& entry : tinfo->methods.GetMethodMap()) {
+    const MethodInfo& minfo = entry.second;
+    if (minfo.signature.name != name) {
+      continue;
+    }
+    ss << "m " << minfo.mid << ' ' << minfo.parent_mid << ' ' << minfo.signature.is_constructor << ' ';
+    PrintTid(&ss, minfo.class_type);
+    PrintTid(&ss, minfo.return_type);
+    PrintMods(&ss, minfo.mods);
+    PrintTids(&ss, minfo.signature.param_types);
+    ss << '\n';
+  }
+  for (const auto& entry : tinfo->fields.GetFieldMap()) {
+    const FieldInfo& finfo = entry.second;
+    if (finfo.name != name) {
+      continue;
+    }
+    ss << "f " << finfo.fid << ' ';
+    PrintTid(&ss, finfo.class_type);
+    PrintTid(&ss, finfo.field_type);
+    PrintMods(&ss, finfo.mods);
+    ss << '\n';
+  }
+  return ss.str();
+}
+
+} // namespace
+
+void Dependencies::AddType(TypeId tid) {
+  if (!tid.IsValid()) {
+    return;
+  }
+  types_.insert(tid);
+  if (tid.ndims > 0) {
+    types_.insert({tid.base, 0});
+  }
+}
+
+void Dependencies::AddMember(TypeId tid, const string& name) {
+  if (!tid.IsValid()) {
+    return;
+  }
+  members_.insert({tid, name});
+}
+
+bool Dependencies::ChangedBetween(const TypeInfoMap& before, const TypeInfoMap& after) const {
+  for (TypeId tid : types_) {
+    if (TypeKey(before, tid) != TypeKey(after, tid)) {
+      return true;
+    }
+  }
+  for (const auto& member : members_) {
+    if (MemberKey(before, member.first, member.second) != MemberKey(after, member.first, member.second)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TypecheckCache::CanReuse(const TypeSet& typeset) const {
+  return typeset_ != nullptr && typeset_->HasSameTypes(typeset);
+}
+
+sptr<const CompUnit> TypecheckCache::Lookup(sptr<const CompUnit> weeded, const TypeInfoMap& tinfo_map) const {
+  CHECK(tinfo_map_ != nullptr);
+  auto iter = entries_.find(weeded->FileId());
+  if (iter == entries_.end() || iter->second.weeded != weeded) {
+    return nullptr;
+  }
+  if (iter->second.deps.ChangedBetween(*tinfo_map_, tinfo_map)) {
+    return nullptr;
+  }
+  return iter->second.checked;
+}
+
+void TypecheckCache::Store(sptr<const CompUnit> weeded, sptr<const CompUnit> checked, const Dependencies& deps) {
+  pending_[weeded->FileId()] = {weeded, checked, deps};
+}
+
+void TypecheckCache::Keep(sptr<const CompUnit> weeded) {
+  pending_[weeded->FileId()] = entries_.at(weeded->FileId());
+}
+
+void TypecheckCache::Commit(const TypeSet& typeset, const TypeInfoMap& tinfo_map) {
+  num_checked_ = 0;
+  for (const auto& entry : pending_) {
+    auto old = entries_.find(entry.first);
+    if (old == entries_.end() || old->second.checked != entry.second.checked) {
+      ++num_checked_;
+    }
+  }
+
+  entries_.swap(pending_);
+  pending_.clear();
+  typeset_.reset(new TypeSet(typeset));
+  tinfo_map_.reset(new TypeInfoMap(tinfo_map));
+}
+
+void TypecheckCache::Clear() {
+  entries_.clear();
+  pending_.clear();
+  typeset_.reset();
+  tinfo_map_.reset();
+  num_checked_ = 0;
+}
+
+} // namespace types
@@ -0,0 +1,84 @@
+#ifndef TYPES_INCREMENTAL_H
+#define TYPES_INCREMENTAL_H
+
+#include "ast/ast_fwd.h"
+#include "ast/ids.h"
+#include "types/type_info_map.h"
+#include "types/typeset.h"
+
+namespace types {
+
+// The parts of a TypeInfoMap that typechecking one CompUnit looked at. If none
+// of them differ in a later TypeInfoMap, typechecking the same unit against it
+// gives the same result.
+class Dependencies final {
+ public:
+  Dependencies() = default;
+
+  // The unit looked at tid's declaration: its modifiers, kind, and ancestors.
+  void AddType(ast::TypeId tid);
+
+  // The unit resolved a method, constructor, or field called name in tid.
+  void AddMember(ast::TypeId tid, const string& name);
+
+  // Whether anything recorded differs between before and after.
+  bool ChangedBetween(const TypeInfoMap& before, const TypeInfoMap& after) const;
+
+ private:
+  set<ast::TypeId> types_;
+  set<pair<ast::TypeId, string>> members_;
+};
+
+// Typechecked units from an earlier TypecheckProgram, along with what each of
+// them depended on. Units are keyed by the weeded CompUnit they were built
+// from, so callers must pass the same CompUnit objects for unchanged files.
+class TypecheckCache final {
+ public:
+  TypecheckCache() = default;
+
+  // Whether any unit may be reused in a program with this typeset. Adding,
+  // removing, or renaming a type can renumber TypeIds, so every unit must be
+  // typechecked again.
+  bool CanReuse(const TypeSet& typeset) const;
+
+  // Returns the typechecked unit stored for weeded, or nullptr if it must be
+  // typechecked again against tinfo_map.
+  sptr<const ast::CompUnit> Lookup(sptr<const ast::CompUnit> weeded, const TypeInfoMap& tinfo_map) const;
+
+  // Records a unit typechecked by the current TypecheckProgram.
+  void Store(sptr<const ast::CompUnit> weeded, sptr<const ast::CompUnit> checked, const Dependencies& deps);
+
+  // Records that the current TypecheckProgram reused the unit Lookup returned
+  // for weeded.
+  void Keep(sptr<const ast::CompUnit> weeded);
+
+  // Replaces the cached units with the ones stored since the last call, which
+  // were checked against typeset and tinfo_map.
+  void Commit(const TypeSet& typeset, const TypeInfoMap& tinfo_map);
+
+  // Drops everything; used when typechecking fails.
+  void Clear();
+
+  // The number of units the last TypecheckProgram typechecked rather than
+  // reused.
+  int NumChecked() const { return num_checked_; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TypecheckCache);
+
+  struct Entry {
+    sptr<const ast::CompUnit> weeded;
+    sptr<const ast::CompUnit> checked;
+    Dependencies deps;
+  };
+
+  uptr<TypeSet> typeset_;
+  uptr<TypeInfoMap> tinfo_map_;
+  map<int, Entry> entries_;
+  map<int, Entry> pending_;
+  int num_checked_ = 0;
+};
+
+} // namespace types
+
+#endif
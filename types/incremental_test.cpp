@@ -0,0 +1,143 @@
+#include "types/incremental.h"
+
+#include "ast/ast.h"
+#include "base/file.h"
+#include "types/types_test.h"
+
+using ast::CompUnit;
+using base::FileSet;
+
+namespace types {
+
+namespace {
+
+// Hands back the weeded unit of any file whose id and contents are unchanged,
+// as the compile server does.
+class ContentsUnitCache final : public snapshot::UnitCache {
+ public:
+  sptr<const CompUnit> Lookup(const FileSet& fs, int fileid) const override {
+    auto iter = units_.find({fileid, fs.Get(fileid)->Contents()});
+    if (iter == units_.end()) {
+      return nullptr;
+    }
+    return iter->second;
+  }
+
+  void Store(const FileSet& fs, int fileid, sptr<const CompUnit> unit) override {
+    units_[{fileid, fs.Get(fileid)->Contents()}] = unit;
+  }
+
+ private:
+  map<pair<int, string>, sptr<const CompUnit>> units_;
+};
+
+} // namespace
+
+class IncrementalTest : public TypesTest {
+ protected:
+  void Compile(const vector<pair<string, string>>& file_contents) {
+    errors_.Clear();
+    ParseProgram(file_contents, &units_, &typecheck_cache_);
+  }
+
+  ContentsUnitCache units_;
+  TypecheckCache typecheck_cache_;
+};
+
+TEST_F(IncrementalTest, UnchangedProgramIsNotRechecked) {
+  vector<pair<string, string>> files = {
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 1; } }"},
+  };
+  Compile(files);
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(fs_->Size(), typecheck_cache_.NumChecked());
+
+  Compile(files);
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(0, typecheck_cache_.NumChecked());
+}
+
+TEST_F(IncrementalTest, BodyChangeRechecksOnlyThatUnit) {
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+  });
+  EXPECT_NO_ERRS();
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { int x = 2; return x; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+  });
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(1, typecheck_cache_.NumChecked());
+}
+
+TEST_F(IncrementalTest, SignatureChangeRechecksDependents) {
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+    {"Baz.java", "public class Baz { public Baz() {} public int h() { return 3; } }"},
+  });
+  EXPECT_NO_ERRS();
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public static int f() { return 1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+    {"Baz.java", "public class Baz { public Baz() {} public int h() { return 3; } }"},
+  });
+  EXPECT_TRUE(errors_.IsFatal());
+}
+
+TEST_F(IncrementalTest, SignatureChangeLeavesUnrelatedUnits) {
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+    {"Baz.java", "public class Baz { public Baz() {} public int h() { return 3; } }"},
+  });
+  EXPECT_NO_ERRS();
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public short f() { return (short)1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+    {"Baz.java", "public class Baz { public Baz() {} public int h() { return 3; } }"},
+  });
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(2, typecheck_cache_.NumChecked());
+}
+
+TEST_F(IncrementalTest, ReusedUnitsKeepTheirDependencies) {
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 1; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+  });
+  EXPECT_NO_ERRS();
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public int f() { return 2; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+  });
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(1, typecheck_cache_.NumChecked());
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} public static int f() { return 2; } }"},
+    {"Bar.java", "public class Bar { public Bar() {} public int g() { return new Foo().f(); } }"},
+  });
+  EXPECT_TRUE(errors_.IsFatal());
+}
+
+TEST_F(IncrementalTest, NewTypeRechecksEverything) {
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} }"},
+  });
+  EXPECT_NO_ERRS();
+
+  Compile({
+    {"Foo.java", "public class Foo { public Foo() {} }"},
+    {"Bar.java", "public class Bar { public Bar() {} }"},
+  });
+  EXPECT_NO_ERRS();
+  EXPECT_EQ(fs_->Size(), typecheck_cache_.NumChecked());
+}
+
+} // namespace types
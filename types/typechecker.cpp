@@ -241,7 +241,8 @@ REWRITE_DEFN(TypeChecker, CallExpr, Expr, expr,) {
     return nullptr;
   }
 
-  const TypeInfo& tinfo = typeinfo_.LookupTypeInfo(lhs_tid);
+  const TypeInfo& tinfo = LookupTypeInfo(lhs_tid);
+  AddMemberDependency(lhs_tid, field_deref->FieldName());
 
   MethodId mid = tinfo.methods.ResolveCall(typeinfo_, curtype_, cc, lhs_tid, TypeIdList(arg_tids), field_deref->FieldName(), field_deref->GetToken().pos, errors_);
   if (mid == kErrorMethodId) {
@@ -275,7 +276,7 @@ REWRITE_DEFN(TypeChecker, NewClassExpr, Expr, expr,) {
   CallContext cc = CallContext::CONSTRUCTOR;
   TypeId tid = type->GetTypeId();
 
-  const TypeInfo& tinfo = typeinfo_.LookupTypeInfo(tid);
+  const TypeInfo& tinfo = LookupTypeInfo(tid);
   if (!tinfo.type.IsValid()) {
     return nullptr;
   }
@@ -283,6 +284,7 @@ REWRITE_DEFN(TypeChecker, NewClassExpr, Expr, expr,) {
   const ReferenceType* ref_type = dynamic_cast<const ReferenceType*>(type.get());
   CHECK(ref_type != nullptr);
 
+  AddMemberDependency(tid, tinfo.name);
   MethodId mid = tinfo.methods.ResolveCall(typeinfo_, curtype_, cc, tid, TypeIdList(arg_tids), tinfo.name, ref_type->Name().Tokens().back().pos, errors_);
   if (mid == kErrorMethodId) {
     return nullptr;
@@ -347,7 +349,8 @@ REWRITE_DEFN(TypeChecker, FieldDerefExpr, Expr, expr,) {
     return nullptr;
   }
 
-  const TypeInfo& tinfo = typeinfo_.LookupTypeInfo(base_tid);
+  const TypeInfo& tinfo = LookupTypeInfo(base_tid);
+  AddMemberDependency(base_tid, expr.FieldName());
   FieldId fid = tinfo.fields.ResolveAccess(typeinfo_, curtype_, cc, base_tid, expr.FieldName(), expr.GetToken().pos, errors_);
   if (fid == kErrorFieldId) {
     return nullptr;
@@ -446,7 +449,8 @@ REWRITE_DEFN(TypeChecker, NameExpr, Expr, expr, exprptr) {
   // might use them if resolving this as a Type fails.
   ErrorList field_errors;
   {
-    TypeInfo tinfo = typeinfo_.LookupTypeInfo(curtype_);
+    TypeInfo tinfo = LookupTypeInfo(curtype_);
+    AddMemberDependency(curtype_, parts.at(0));
     FieldId fid = tinfo.fields.ResolveAccess(typeinfo_, curtype_, CallContext::INSTANCE, curtype_, parts.at(0), toks.at(0).pos, &field_errors);
     bool ok = fid != kErrorFieldId;
     if (ok) {
@@ -467,6 +471,7 @@ REWRITE_DEFN(TypeChecker, NameExpr, Expr, expr, exprptr) {
       string name = ss.str();
       TypeId tid = typeset_.TryGet(name);
       if (tid.IsValid()) {
+        AddTypeDependency(tid);
         sptr<const Type> resolved_type = make_shared<ReferenceType>(
             SliceFirstN(expr.Name(), i + 1), tid);
         auto static_ref = make_shared<StaticRefExpr>(resolved_type);
@@ -575,7 +580,7 @@ REWRITE_DEFN(TypeChecker, UnaryExpr, Expr, expr, exprptr) {
 
 REWRITE_DEFN(TypeChecker, BlockStmt, Stmt, stmt, stmtptr) {
   ScopeGuard s(&symbol_table_);
-  return Visitor::RewriteBlockStmt(stmt, stmtptr);
+  return StaticVisitor::RewriteBlockStmt(stmt, stmtptr);
 }
 
 REWRITE_DEFN(TypeChecker, ForStmt, Stmt, stmt,) {
@@ -732,11 +737,12 @@ REWRITE_DEFN(TypeChecker, FieldDecl, MemberDecl, decl, declptr) {
   }
 
   // Lookup field and rewrite with fid.
-  const TypeInfo& tinfo = typeinfo_.LookupTypeInfo(curtype_);
+  const TypeInfo& tinfo = LookupTypeInfo(curtype_);
   // Can fail if type is blacklisted.
   if (!tinfo.type.IsValid()) {
     return nullptr;
   }
+  AddMemberDependency(curtype_, decl.Name());
   const FieldInfo& finfo = tinfo.fields.LookupField(decl.Name());
 
   return make_shared<FieldDecl>(decl.Mods(), type, decl.Name(), decl.NameToken(), val, finfo.fid);
@@ -768,12 +774,13 @@ REWRITE_DEFN(TypeChecker, MethodDecl, MemberDecl, decl, declptr) {
     paramtids.push_back(param.GetType().GetTypeId());
   }
 
-  const TypeInfo& tinfo = typeinfo_.LookupTypeInfo(curtype_);
+  const TypeInfo& tinfo = LookupTypeInfo(curtype_);
   // Can fail if type is blacklisted.
   if (!tinfo.type.IsValid()) {
     return nullptr;
   }
 
+  AddMemberDependency(curtype_, decl.Name());
   const MethodInfo& minfo = tinfo.methods.LookupMethod(MethodSignature{is_constructor, decl.Name(), paramtids});
   sptr<const Stmt> body = Rewrite(decl.BodyPtr());
 
@@ -801,13 +808,14 @@ REWRITE_DEFN(TypeChecker, TypeDecl, TypeDecl, type, typeptr) {
   // If we have method info, then just use the default implementation of
   // RewriteTypeDecl.
   if (belowTypeDecl_) {
-    return Visitor::RewriteTypeDecl(type, typeptr);
+    return StaticVisitor::RewriteTypeDecl(type, typeptr);
   }
 
   // Otherwise create a sub-visitor that has the type info, and let it rewrite
   // this node.
   TypeId curtid = typeset_.TryGet(type.Name());
   CHECK(!curtid.IsError()); // Pruned in DeclResolver.
+  AddTypeDependency(curtid);
 
   TypeChecker below = InsideTypeDecl(curtid);
   return below.Rewrite(typeptr);
@@ -817,7 +825,7 @@ REWRITE_DEFN(TypeChecker, CompUnit, CompUnit, unit, unitptr) {
   // If we have import info, then just use the default implementation of
   // RewriteCompUnit.
   if (belowCompUnit_) {
-    return Visitor::RewriteCompUnit(unit, unitptr);
+    return StaticVisitor::RewriteCompUnit(unit, unitptr);
   }
 
   // Don't emit import errors again - they are already emitted in decl_resolver.
@@ -1,38 +1,45 @@
 #ifndef TYPES_TYPECHECKER_H
 #define TYPES_TYPECHECKER_H
 
-#include "ast/visitor.h"
+#include "ast/static_visitor.h"
 #include "base/errorlist.h"
 #include "gtest/gtest.h"
+#include "types/incremental.h"
 #include "types/symbol_table.h"
 #include "types/type_info_map.h"
 #include "types/typeset.h"
 
 namespace types {
 
-class TypeChecker final : public ast::Visitor {
+class TypeChecker final : public ast::StaticVisitor<TypeChecker> {
  public:
-   TypeChecker(base::ErrorList* errors) : TypeChecker(errors, TypeSet::Empty(), TypeInfoMap::Empty()) {}
+   TypeChecker(base::ErrorList* errors) : TypeChecker(errors, TypeSet::Empty(), TypeInfoMap::Empty(), nullptr) {}
 
   TypeChecker WithTypeSet(const TypeSet& typeset) const {
     CHECK(!belowCompUnit_);
-    return TypeChecker(errors_, typeset, typeinfo_);
+    return TypeChecker(errors_, typeset, typeinfo_, deps_);
   }
 
   TypeChecker WithTypeInfoMap(const TypeInfoMap& typeinfo) const {
     CHECK(!belowCompUnit_);
-    return TypeChecker(errors_, typeset_, typeinfo);
+    return TypeChecker(errors_, typeset_, typeinfo, deps_);
+  }
+
+  // Records everything the checker looks up in the TypeInfoMap into deps.
+  TypeChecker WithDependencies(Dependencies* deps) const {
+    CHECK(!belowCompUnit_);
+    return TypeChecker(errors_, typeset_, typeinfo_, deps);
   }
 
   TypeChecker InsideCompUnit(sptr<const ast::QualifiedName> package) const {
     CHECK(!belowCompUnit_);
-    return TypeChecker(errors_, typeset_, typeinfo_, true, package);
+    return TypeChecker(errors_, typeset_, typeinfo_, deps_, true, package);
   }
 
   TypeChecker InsideTypeDecl(ast::TypeId curtype) const {
     CHECK(belowCompUnit_);
     CHECK(!belowTypeDecl_);
-    return TypeChecker(errors_, typeset_, typeinfo_, true, package_, true, curtype);
+    return TypeChecker(errors_, typeset_, typeinfo_, deps_, true, package_, true, curtype);
   }
 
   TypeChecker InsideMemberDecl(bool is_static, ast::TypeId cur_member_type, const ast::ParamList& params) const {
@@ -57,7 +64,7 @@ class TypeChecker final : public ast::Visitor {
 
     // Construct initial symbol table with params for this method.
     return TypeChecker(
-        errors_, typeset_, typeinfo_,
+        errors_, typeset_, typeinfo_, deps_,
         true, package_,
         true, curtype_,
         true, is_static, cur_member_type, SymbolTable(paramInfos, errors_));
@@ -108,12 +115,12 @@ class TypeChecker final : public ast::Visitor {
   FRIEND_TEST(TypeCheckerHierarchyTest, IsCastablePrimitives);
 
   TypeChecker(base::ErrorList* errors,
-              const TypeSet& typeset, const TypeInfoMap& typeinfo,
+              const TypeSet& typeset, const TypeInfoMap& typeinfo, Dependencies* deps,
               bool belowCompUnit = false, sptr<const ast::QualifiedName> package = nullptr,
               bool belowTypeDecl = false, ast::TypeId curtype = ast::TypeId::kUnassigned,
               bool belowMemberDecl = false, bool belowStaticMember = false, ast::TypeId curMethRet = ast::TypeId::kUnassigned,
               SymbolTable symbol_table = SymbolTable::Empty())
-      : errors_(errors), typeset_(typeset), typeinfo_(typeinfo),
+      : errors_(errors), typeset_(typeset), typeinfo_(typeinfo), deps_(deps),
         belowCompUnit_(belowCompUnit), package_(package),
         belowTypeDecl_(belowTypeDecl), curtype_(curtype),
         belowMemberDecl_(belowMemberDecl), belowStaticMember_(belowStaticMember), curMemberType_(curMethRet),
@@ -121,6 +128,15 @@ class TypeChecker final : public ast::Visitor {
 
   sptr<const ast::Type> MustResolveType(sptr<const ast::Type> type);
 
+  // Looks up tid in the TypeInfoMap, recording the dependency.
+  const TypeInfo& LookupTypeInfo(ast::TypeId tid) const;
+
+  // Records that the checker depends on tid's declaration.
+  void AddTypeDependency(ast::TypeId tid) const;
+
+  // Records that a member called name was resolved in tid.
+  void AddMemberDependency(ast::TypeId tid, const string& name) const;
+
   bool IsReferenceWidening(ast::TypeId lhs, ast::TypeId rhs) const;
   bool IsAssignable(ast::TypeId lhs, ast::TypeId rhs) const;
   bool IsComparable(ast::TypeId lhs, ast::TypeId rhs) const;
@@ -150,6 +166,7 @@ class TypeChecker final : public ast::Visitor {
 
   TypeSet typeset_;
   const TypeInfoMap& typeinfo_;
+  Dependencies* deps_; // Null unless dependencies are being recorded.
 
   const bool belowCompUnit_ = false;
   const sptr<const ast::QualifiedName> package_; // Only populated if below CompUnit and the CompUnit has a package statement.
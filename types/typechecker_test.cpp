@@ -57,7 +57,8 @@ class TypeCheckerTest : public ::testing::Test {
     ASSERT_FALSE(errors_.IsFatal());
     ASSERT_EQ(0, errors_.Size());
 
-    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, &tokens[0]));
+    buffer_.reset(new lexer::TokenBuffer(0, tokens[0]));
+    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, buffer_.get()));
 
     typeChecker_.reset(new TypeChecker(&errors_));
   }
@@ -94,6 +95,7 @@ class TypeCheckerTest : public ::testing::Test {
   base::ErrorList errors_;
   uptr<base::FileSet> fs_;
   vector<vector<lexer::Token>> tokens;
+  uptr<lexer::TokenBuffer> buffer_;
   uptr<parser::Parser> parser_;
   uptr<TypeChecker> typeChecker_;
 };
@@ -405,6 +407,13 @@ TEST_F(TypeCheckerTest, CallExprFieldDerefExprParamError) {
   EXPECT_ERRS("UndefinedMethodError(0:56-59)\n");
 }
 
+TEST_F(TypeCheckerTest, CallExprOnArrayElementOk) {
+  ParseProgram({
+    {"A.java", "public class A { public A() { Object[] a = new Object[1]; a[0].equals(a[0]); } }"},
+  });
+  EXPECT_NO_ERRS();
+}
+
 TEST_F(TypeCheckerTest, CallExprOnVoid) {
   ParseProgram({
     {"A.java", "public class A { public void foo() { int x = foo().bar(); } }"},
@@ -15,11 +15,29 @@ namespace types {
 sptr<const Type> TypeChecker::MustResolveType(sptr<const Type> type) {
   sptr<const Type> ret = ResolveType(type, typeset_, errors_);
   if (ret->GetTypeId().IsValid()) {
+    AddTypeDependency(ret->GetTypeId());
     return ret;
   }
   return nullptr;
 }
 
+const TypeInfo& TypeChecker::LookupTypeInfo(TypeId tid) const {
+  AddTypeDependency(tid);
+  return typeinfo_.LookupTypeInfo(tid);
+}
+
+void TypeChecker::AddTypeDependency(TypeId tid) const {
+  if (deps_ != nullptr) {
+    deps_->AddType(tid);
+  }
+}
+
+void TypeChecker::AddMemberDependency(TypeId tid, const string& name) const {
+  if (deps_ != nullptr) {
+    deps_->AddMember(tid, name);
+  }
+}
+
 TypeId TypeChecker::JavaLangType(const string& name) const {
   return typeset_.TryGet("java.lang." + name);
 }
@@ -141,6 +159,8 @@ bool TypeChecker::IsReferenceWidening(TypeId lhs, TypeId rhs) const {
   }
 
   // Check if lhs is an ancestor of rhs.
+  AddTypeDependency(lhs);
+  AddTypeDependency(rhs);
   return typeinfo_.IsAncestor(rhs, lhs);
 }
 
@@ -2,12 +2,14 @@
 
 #include "ast/ast.h"
 #include "types/decl_resolver.h"
+#include "types/incremental.h"
 #include "types/type_info_map.h"
 #include "types/typechecker.h"
 #include "types/constant_folding.h"
 #include "types/dataflow_visitor.h"
 #include "types/typeset.h"
 
+using ast::CompUnit;
 using ast::Program;
 using ast::QualifiedName;
 using ast::TypeId;
@@ -15,6 +17,7 @@ using base::Error;
 using base::ErrorList;
 using base::MakeError;
 using base::OutputOptions;
+using base::SharedPtrVector;
 using base::PosRange;
 using lexer::Token;
 
@@ -82,16 +85,50 @@ TypeInfoMap BuildTypeInfoMap(const TypeSet& typeset, sptr<const Program> prog,
   return builder.Build(error_out);
 }
 
+// Typechecks each unit of resolved, the decl-resolved form of weeded, unless
+// cache has a typechecked unit for it whose dependencies are unchanged.
+sptr<const Program> TypecheckUnits(const TypeChecker& typechecker, const Program& weeded, const Program& resolved, const TypeSet& typeset, const TypeInfoMap& tinfo_map, TypecheckCache* cache) {
+  CHECK(weeded.CompUnits().Size() == resolved.CompUnits().Size());
+  bool can_reuse = cache->CanReuse(typeset);
+
+  SharedPtrVector<const CompUnit> units;
+  for (int i = 0; i < resolved.CompUnits().Size(); ++i) {
+    sptr<const CompUnit> weeded_unit = weeded.CompUnits().At(i);
+    sptr<const CompUnit> resolved_unit = resolved.CompUnits().At(i);
+    CHECK(weeded_unit->FileId() == resolved_unit->FileId());
+
+    sptr<const CompUnit> checked;
+    if (can_reuse) {
+      checked = cache->Lookup(weeded_unit, tinfo_map);
+    }
+    if (checked != nullptr) {
+      units.Append(checked);
+      cache->Keep(weeded_unit);
+      continue;
+    }
+
+    Dependencies deps;
+    checked = typechecker.WithDependencies(&deps).Rewrite(resolved_unit);
+    units.Append(checked);
+    cache->Store(weeded_unit, checked, deps);
+  }
+  return make_shared<Program>(units);
+}
+
 }  // namespace
 
-sptr<const Program> TypecheckProgram(sptr<const Program> prog, TypeSet* typeset_out, TypeInfoMap* tinfo_out, ConstStringMap* string_map_out, ErrorList* errors) {
+sptr<const Program> TypecheckProgram(sptr<const Program> prog, TypeSet* typeset_out, TypeInfoMap* tinfo_out, ConstStringMap* string_map_out, ErrorList* errors, TypecheckCache* cache) {
   // Phase 1: Build a typeset.
   TypeSet typeSet = BuildTypeSet(*prog, errors);
   if (!VerifyTypeSet(typeSet, errors)) {
+    if (cache != nullptr) {
+      cache->Clear();
+    }
     return prog;
   }
 
   // Phase 2: Build a type info map.
+  sptr<const Program> weeded = prog;
   TypeInfoMap typeInfo = BuildTypeInfoMap(typeSet, prog, &prog, errors);
   ast::TypeId string_type = ast::TypeId::kUnassigned;
 
@@ -101,7 +138,16 @@ sptr<const Program> TypecheckProgram(sptr<const Program> prog, TypeSet* typeset_
         .WithTypeSet(typeSet)
         .WithTypeInfoMap(typeInfo);
 
-    prog = typechecker.Rewrite(prog);
+    // Only reuse units if the type info map is sound; a blacklisted type can
+    // hide errors in units that depend on it.
+    if (cache != nullptr && errors->IsFatal()) {
+      cache->Clear();
+    }
+    if (cache != nullptr) {
+      prog = TypecheckUnits(typechecker, *weeded, *prog, typeSet, typeInfo, cache);
+    } else {
+      prog = typechecker.Rewrite(prog);
+    }
 
     string_type = typechecker.JavaLangType("String");
   }
@@ -109,8 +155,14 @@ sptr<const Program> TypecheckProgram(sptr<const Program> prog, TypeSet* typeset_
   // Don't progress with constant folding and dataflow if we have errors so far
   // because pruned return statements will cause false positives.
   if (errors->IsFatal()) {
+    if (cache != nullptr) {
+      cache->Clear();
+    }
     return prog;
   }
+  if (cache != nullptr) {
+    cache->Commit(typeSet, typeInfo);
+  }
 
   // Phase 4: Dataflow Analysis.
   {
@@ -10,15 +10,20 @@ namespace types {
 
 class TypeInfoMap;
 class TypeSet;
+class TypecheckCache;
 
 using StringId = u64;
 using ConstStringMap = map<jstring, StringId>;
 
+// Typechecks prog. If cache is non-null, units it holds whose dependencies are
+// unchanged are reused instead of being typechecked again, and the cache is
+// updated with this program's units.
 sptr<const ast::Program> TypecheckProgram(sptr<const ast::Program> prog,
                                           TypeSet* typeset_out,
                                           TypeInfoMap* tinfo_out,
                                           ConstStringMap* string_map_out,
-                                          base::ErrorList* err_out);
+                                          base::ErrorList* err_out,
+                                          TypecheckCache* cache = nullptr);
 
 }  // namespace types
 
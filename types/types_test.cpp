@@ -10,7 +10,7 @@ using base::FileSet;
 namespace types {
 
   // Pairs of file name, file contents.
-  sptr<const Program> ParseProgramWithStdlib(FileSet** fs, const vector<pair<string, string>>& file_contents, ErrorList* out) {
+  sptr<const Program> ParseProgramWithStdlib(FileSet** fs, const vector<pair<string, string>>& file_contents, ErrorList* out, snapshot::UnitCache* cache, TypecheckCache* typecheck_cache) {
     // find third_party/cs444/stdlib/3.0 -type f -name '*.java'
     static const vector<string> stdlib = {
       "third_party/cs444/stdlib/3.0/java/io/Serializable.java",
@@ -31,18 +31,18 @@ namespace types {
     };
 
     base::FileSet::Builder fs_builder;
-    for (const string& file_name : stdlib) {
-      fs_builder.AddDiskFile(file_name);
-    }
     for (auto contents : file_contents) {
       fs_builder.AddStringFile(contents.first, contents.second);
     }
+    for (const string& file_name : stdlib) {
+      fs_builder.AddDiskFile(file_name);
+    }
     CHECK(fs_builder.Build(fs, out));
 
     TypeSet typeset = TypeSet::Empty();
     TypeInfoMap tinfo_map = TypeInfoMap::Empty();
     ConstStringMap string_map;
-    return CompilerFrontend(CompilerStage::TYPE_CHECK, *fs, &typeset, &tinfo_map, &string_map, out);
+    return CompilerFrontend(CompilerStage::TYPE_CHECK, *fs, CompilerOptions(), &typeset, &tinfo_map, &string_map, out, nullptr, cache, typecheck_cache);
   }
 
 } // namespace types
@@ -7,6 +7,8 @@
 #include "base/errorlist.h"
 #include "base/fileset.h"
 #include "gtest/gtest.h"
+#include "snapshot/unit_cache.h"
+#include "types/incremental.h"
 
 #define EXPECT_ERRS(msg) EXPECT_EQ(msg, testing::PrintToString(errors_))
 #define EXPECT_NO_ERRS() EXPECT_EQ(0, errors_.Size())
@@ -14,13 +16,13 @@
 
 namespace types {
 
-sptr<const ast::Program> ParseProgramWithStdlib(base::FileSet** fs, const vector<pair<string, string>>& file_contents, base::ErrorList* out);
+sptr<const ast::Program> ParseProgramWithStdlib(base::FileSet** fs, const vector<pair<string, string>>& file_contents, base::ErrorList* out, snapshot::UnitCache* cache = nullptr, TypecheckCache* typecheck_cache = nullptr);
 
 class TypesTest : public ::testing::Test {
 protected:
-  sptr<const ast::Program> ParseProgram(const vector<pair<string, string>>& file_contents) {
+  sptr<const ast::Program> ParseProgram(const vector<pair<string, string>>& file_contents, snapshot::UnitCache* cache = nullptr, TypecheckCache* typecheck_cache = nullptr) {
     base::FileSet* fs;
-    sptr<const ast::Program> program = ParseProgramWithStdlib(&fs, file_contents, &errors_);
+    sptr<const ast::Program> program = ParseProgramWithStdlib(&fs, file_contents, &errors_, cache, typecheck_cache);
     fs_.reset(fs);
     return program;
   }
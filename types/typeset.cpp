@@ -431,6 +431,20 @@ TypeSet TypeSetBuilder::Build(ErrorList* errors) const {
   return TypeSet(sptr<Data>(data));
 }
 
+bool TypeSet::HasSameTypes(const TypeSet& other) const {
+  const vector<Type>& mine = data_->qual_name_index_;
+  const vector<Type>& theirs = other.data_->qual_name_index_;
+  if (mine.size() != theirs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < mine.size(); ++i) {
+    if (mine[i].longname != theirs[i].longname || mine[i].tid != theirs[i].tid) {
+      return false;
+    }
+  }
+  return true;
+}
+
 auto TypeSet::LookupInPkgScope(const string& pkg, const string& name) const -> const Type* {
   auto cmp = [](const Type& lhs, const pair<string, string>& rhs) {
     return tie(lhs.pkg, lhs.simple_name) < tie(rhs.first, rhs.second);
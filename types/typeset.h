@@ -42,6 +42,11 @@ public:
     return Get(name, kFakePos, &throwaway);
   }
 
+  // Whether other declares the same qualified names with the same TypeIds. If
+  // so, a lookup from a file with unchanged imports resolves the same way in
+  // both.
+  bool HasSameTypes(const TypeSet& other) const;
+
 private:
   friend class TypeSetBuilder;
 
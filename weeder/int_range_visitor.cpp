@@ -55,13 +55,13 @@ REWRITE_DEFN(IntRangeVisitor, IntLitExpr, Expr, expr,) {
   return make_shared<IntLitExpr>(token, int_result.first);
 }
 
-REWRITE_DEFN(IntRangeVisitor, UnaryExpr, Expr, expr,) {
-  if (expr.Op().type != SUB || !IS_CONST_REF(IntLitExpr, expr.Rhs())) {
-    auto rhs = Rewrite(expr.RhsPtr());
-    if (rhs == nullptr) {
-      return nullptr;
-    }
-    return make_shared<ast::UnaryExpr>(expr.Op(), rhs);
+bool IntRangeVisitor::IsNegatedIntLit(const ast::UnaryExpr& expr) {
+  return expr.Op().type == SUB && IS_CONST_REF(IntLitExpr, expr.Rhs());
+}
+
+REWRITE_DEFN(IntRangeVisitor, UnaryExpr, Expr, expr, exprptr) {
+  if (!IsNegatedIntLit(expr)) {
+    return Visitor::RewriteUnaryExpr(expr, exprptr);
   }
 
   Token token = dynamic_cast<const IntLitExpr&>(expr.Rhs()).GetToken();
@@ -15,7 +15,11 @@ class IntRangeVisitor : public ast::Visitor {
   IntRangeVisitor(const base::FileSet* fs, base::ErrorList* errors) : fs_(fs), errors_(errors) {}
 
   REWRITE_DECL(IntLitExpr, Expr, expr,);
-  REWRITE_DECL(UnaryExpr, Expr, expr,);
+  REWRITE_DECL(UnaryExpr, Expr, expr, exprptr);
+
+  // Whether expr is a minus sign applied directly to an int literal, which
+  // is checked as a single negative literal.
+  static bool IsNegatedIntLit(const ast::UnaryExpr& expr);
 
  private:
   const base::FileSet* fs_;
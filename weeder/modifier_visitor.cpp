@@ -284,7 +284,7 @@ VISIT_DEFN(InterfaceModifierVisitor, MethodDecl, decl,) {
   return VisitResult::SKIP;
 }
 
-REWRITE_DEFN(ModifierVisitor, TypeDecl, TypeDecl, decl, declptr) {
+VISIT_DEFN(ModifierVisitor, TypeDecl, decl, declptr) {
   if (decl.Kind() == TypeKind::CLASS) {
     // A class cannot be protected, static, or native.
     VerifyNoneOf(decl.Mods(), errors_, MakeClassModifierError,
@@ -300,7 +300,8 @@ REWRITE_DEFN(ModifierVisitor, TypeDecl, TypeDecl, decl, declptr) {
     }
 
     ClassModifierVisitor visitor(errors_);
-    return visitor.Rewrite(declptr);
+    visitor.Visit(declptr);
+    return VisitResult::SKIP;
   }
 
   CHECK(decl.Kind() == TypeKind::INTERFACE);
@@ -313,7 +314,8 @@ REWRITE_DEFN(ModifierVisitor, TypeDecl, TypeDecl, decl, declptr) {
               MakeInterfaceNoAccessModError, {PUBLIC});
 
   InterfaceModifierVisitor visitor(errors_);
-  return visitor.Rewrite(declptr);
+  visitor.Visit(declptr);
+  return VisitResult::SKIP;
 }
 
 }  // namespace weeder
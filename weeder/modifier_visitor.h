@@ -14,7 +14,7 @@ class ModifierVisitor : public ast::Visitor {
  public:
   ModifierVisitor(base::ErrorList* errors) : errors_(errors) {}
 
-  REWRITE_DECL(TypeDecl, TypeDecl, decl, declptr);
+  VISIT_DECL(TypeDecl, decl, declptr);
 
  private:
   base::ErrorList* errors_;
@@ -27,12 +27,11 @@ Error* MakeMultipleTypesPerCompUnitError(Token token) {
 }  // namespace
 
 VISIT_DEFN(StructureVisitor, Program, prog,) {
-  CHECK(prog.CompUnits().Size() == fs_->Size());
-
+  // prog may hold only some of the files in fs_, e.g. when the rest come
+  // from a snapshot that has already been weeded.
   for (int i = 0; i < prog.CompUnits().Size(); ++i) {
-    const File* file = fs_->Get(i);
     const CompUnit* unit = prog.CompUnits().At(i).get();
-    CHECK(unit->FileId() == i);
+    const File* file = fs_->Get(unit->FileId());
 
     if (unit->Types().Size() > 1) {
       for (int j = 0; j < unit->Types().Size(); ++j) {
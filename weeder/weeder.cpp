@@ -1,5 +1,6 @@
 #include "weeder/weeder.h"
 
+#include "ast/composite_visitor.h"
 #include "weeder/assignment_visitor.h"
 #include "weeder/call_visitor.h"
 #include "weeder/int_range_visitor.h"
@@ -7,13 +8,58 @@
 #include "weeder/structure_visitor.h"
 #include "weeder/type_visitor.h"
 
+using ast::Expr;
 using ast::Program;
+using base::Error;
 using base::ErrorList;
 using base::FileSet;
 
 namespace weeder {
 
-sptr<const Program> WeedProgram(const FileSet* fs, sptr<const Program> prog, ErrorList* out) {
+namespace {
+
+// The passes that only look at the tree, in the order they used to run.
+using LookingPasses = ast::CompositeVisitor<AssignmentVisitor, CallVisitor, TypeVisitor, ModifierVisitor, StructureVisitor>;
+
+// Runs all of the weeder passes in a single traversal. The int range pass
+// replaces the literals it checks, so it can't be one of the composed passes;
+// it rewrites them here instead, which is only the same as running it after
+// the others as long as none of them looks at those nodes.
+class FusedVisitor final : public LookingPasses {
+ public:
+  FusedVisitor(AssignmentVisitor* assignment, CallVisitor* call, TypeVisitor* type, ModifierVisitor* modifier, IntRangeVisitor* int_range, StructureVisitor* structure)
+      : LookingPasses(assignment, call, type, modifier, structure), int_range_(int_range) {}
+
+  // Whether any pass pruned a subtree. Passes that ran after it used to never
+  // see that subtree, but here they already have.
+  bool Pruned() const { return LookingPasses::Pruned() || int_range_pruned_; }
+
+  REWRITE_DECL(IntLitExpr, Expr, expr, exprptr) {
+    return NoteRewrite(int_range_->RewriteIntLitExpr(expr, exprptr));
+  }
+
+  REWRITE_DECL(UnaryExpr, Expr, expr, exprptr) {
+    if (IntRangeVisitor::IsNegatedIntLit(expr)) {
+      return NoteRewrite(int_range_->RewriteUnaryExpr(expr, exprptr));
+    }
+    return LookingPasses::RewriteUnaryExpr(expr, exprptr);
+  }
+
+ private:
+  static_assert(!AnyHooks<ast::IntLitExpr>() && !AnyHooks<ast::UnaryExpr>(), "the int range pass would rewrite nodes another pass looks at");
+
+  sptr<const Expr> NoteRewrite(sptr<const Expr> expr) {
+    if (expr == nullptr) {
+      int_range_pruned_ = true;
+    }
+    return expr;
+  }
+
+  IntRangeVisitor* int_range_;
+  bool int_range_pruned_ = false;
+};
+
+sptr<const Program> WeedSequentially(const FileSet* fs, sptr<const Program> prog, ErrorList* out) {
   AssignmentVisitor assignmentChecker(out);
   prog = assignmentChecker.Rewrite(prog);
 
@@ -35,4 +81,42 @@ sptr<const Program> WeedProgram(const FileSet* fs, sptr<const Program> prog, Err
   return prog;
 }
 
+} // namespace
+
+sptr<const Program> WeedProgram(const FileSet* fs, sptr<const Program> prog, ErrorList* out) {
+  // Every pass reports into its own ErrorList so that the errors can be put
+  // in the order the passes used to run in.
+  ErrorList assignment_errors;
+  ErrorList call_errors;
+  ErrorList type_errors;
+  ErrorList modifier_errors;
+  ErrorList int_range_errors;
+  ErrorList structure_errors;
+
+  AssignmentVisitor assignment(&assignment_errors);
+  CallVisitor call(&call_errors);
+  TypeVisitor type(&type_errors);
+  ModifierVisitor modifier(&modifier_errors);
+  IntRangeVisitor int_range(fs, &int_range_errors);
+  StructureVisitor structure(fs, &structure_errors);
+
+  FusedVisitor fused(&assignment, &call, &type, &modifier, &int_range, &structure);
+  sptr<const Program> weeded = fused.Rewrite(prog);
+  if (!fused.Pruned()) {
+    for (ErrorList* errors : {&assignment_errors, &call_errors, &type_errors, &modifier_errors, &int_range_errors, &structure_errors}) {
+      vector<Error*> released;
+      errors->Release(&released);
+      for (Error* error : released) {
+        out->Append(error);
+      }
+    }
+    return weeded;
+  }
+
+  // Something was pruned, which only happens alongside an error. Weed again
+  // one pass at a time, so that no pass reports errors in code an earlier
+  // pass pruned.
+  return WeedSequentially(fs, prog, out);
+}
+
 }  // namespace weeder
@@ -0,0 +1,69 @@
+#include "weeder/weeder.h"
+
+#include "weeder/weeder_test.h"
+
+using ast::CompUnit;
+using ast::Program;
+using base::ErrorList;
+using base::SharedPtrVector;
+using parser::internal::Result;
+
+namespace weeder {
+
+class WeedProgramTest : public WeederTest {
+ protected:
+  sptr<const Program> ParseProgram(const string& program) {
+    MakeParser(program);
+
+    Result<CompUnit> unit;
+    if (!parser_->ParseCompUnit(&unit)) {
+      return nullptr;
+    }
+
+    SharedPtrVector<const CompUnit> units;
+    units.Append(unit.Get());
+
+    return make_shared<Program>(units);
+  }
+};
+
+TEST_F(WeedProgramTest, NoErrors) {
+  sptr<const Program> prog = ParseProgram("public class foo { public int f() { int x = -2147483648; x = x + 1; return x; } }");
+  ASSERT_TRUE(prog != nullptr);
+
+  ErrorList errors;
+  sptr<const Program> weeded = WeedProgram(fs_.get(), prog, &errors);
+  EXPECT_FALSE(errors.IsFatal());
+  ASSERT_TRUE(weeded != nullptr);
+  EXPECT_EQ(1, weeded->CompUnits().Size());
+}
+
+TEST_F(WeedProgramTest, ErrorsInPassOrder) {
+  // Met in the tree, the class modifiers come before the instanceof, but the
+  // type pass ran before the modifier pass.
+  sptr<const Program> prog = ParseProgram("class bar { public void f() { boolean b = x instanceof int; } }");
+  ASSERT_TRUE(prog != nullptr);
+
+  ErrorList errors;
+  WeedProgram(fs_.get(), prog, &errors);
+
+  string expected =
+      "InvalidInstanceOfTypeError(0:44-54)\n"
+      "ClassNoAccessModError(0:6-9)\n"
+      "IncorrectFileNameError(0:6-9)\n";
+  EXPECT_EQ(expected, testing::PrintToString(errors));
+}
+
+TEST_F(WeedProgramTest, PrunedCodeIsNotChecked) {
+  // The assignment pass prunes the whole statement, so the type pass never
+  // gets to complain about "new int()".
+  sptr<const Program> prog = ParseProgram("public class foo { public void f() { 1 = new int(); } }");
+  ASSERT_TRUE(prog != nullptr);
+
+  ErrorList errors;
+  WeedProgram(fs_.get(), prog, &errors);
+
+  EXPECT_EQ("InvalidLHSError(0:39)\n", testing::PrintToString(errors));
+}
+
+}  // namespace weeder
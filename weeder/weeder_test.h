@@ -41,11 +41,13 @@ class WeederTest : public ::testing::Test {
     ASSERT_EQ(1u, tokens.size());
     ASSERT_FALSE(errors.IsFatal());
 
-    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, &tokens[0]));
+    buffer_.reset(new lexer::TokenBuffer(0, tokens[0]));
+    parser_.reset(new parser::Parser(fs, fs->Get(0), 0, buffer_.get()));
   }
 
   uptr<base::FileSet> fs_;
   vector<vector<lexer::Token>> tokens;
+  uptr<lexer::TokenBuffer> buffer_;
   uptr<parser::Parser> parser_;
 };
 